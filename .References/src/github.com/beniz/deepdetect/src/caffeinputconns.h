@@ -161,15 +161,14 @@ namespace dd
 	    {
 	      throw;
 	    }
-	  float *mean = nullptr;
 	  std::string meanfullname = _model_repo + "/" + _meanfname;
 	  if (_data_mean.count() == 0 && _has_mean_file)
 	    {
 	      caffe::BlobProto blob_proto;
 	      caffe::ReadProtoFromBinaryFile(meanfullname.c_str(),&blob_proto);
 	      _data_mean.FromProto(blob_proto);
-	      mean = _data_mean.mutable_cpu_data();
 	    }
+	  const float *mean = _data_mean.count() != 0 ? _data_mean.cpu_data() : nullptr;
 	  if (!_db_fname.empty())
 	    {
 	      _test_dbfullname = _db_fname;
@@ -177,44 +176,27 @@ namespace dd
 	      return; // done
 	    }
 	  else _db = false;
+
+	  // images are written straight into the float data of their own datum, in parallel
+	  std::chrono::time_point<std::chrono::system_clock> tstart = std::chrono::system_clock::now();
+	  size_t nimgs = _dv_test.size();
+	  _dv_test.resize(nimgs + this->_images.size());
+#pragma omp parallel for
 	  for (int i=0;i<(int)this->_images.size();i++)
-	    {      
-	      caffe::Datum datum;
-	      caffe::CVMatToDatum(this->_images.at(i),&datum);
+	    {
+	      caffe::Datum &datum = _dv_test.at(nimgs+i);
+	      if (mean || _has_mean_scalar)
+		image_to_float_datum(this->_images.at(i),mean,datum);
+	      else caffe::CVMatToDatum(this->_images.at(i),&datum);
 	      if (!_test_labels.empty())
 		datum.set_label(_test_labels.at(i));
-	      if (_data_mean.count() != 0)
-		{
-		  int height = datum.height();
-		  int width = datum.width();
-		  for (int c=0;c<datum.channels();++c)
-		    for (int h=0;h<height;++h)
-		      for (int w=0;w<width;++w)
-			{
-			  int data_index = (c*height+h)*width+w;
-			  float datum_element = static_cast<float>(static_cast<uint8_t>(datum.data()[data_index]));
-			  datum.add_float_data(datum_element - mean[data_index]);
-			}
-		  datum.clear_data();
-		}
-	      else if (_has_mean_scalar)
-		{
-		  int height = datum.height();
-		  int width = datum.width();
-		  for (int c=0;c<datum.channels();++c)
-		    for (int h=0;h<height;++h)
-		      for (int w=0;w<width;++w)
-			{
-			  int data_index = (c*height+h)*width+w;
-			  float datum_element = static_cast<float>(static_cast<uint8_t>(datum.data()[data_index]));
-			  datum.add_float_data(datum_element - _mean[c]);
-			}
-		  datum.clear_data();
-		}
-	      _dv_test.push_back(datum);
+	    }
+	  for (int i=0;i<(int)this->_images.size();i++)
+	    {
 	      _ids.push_back(this->_uris.at(i));
 	      _imgs_size.insert(std::pair<std::string,std::pair<int,int>>(this->_uris.at(i),this->_images_size.at(i)));
 	    }
+	  _preprocess_time = std::chrono::duration<double,std::milli>(std::chrono::system_clock::now()-tstart).count();
 	  this->_images.clear();
 	  this->_images_size.clear();
 	}
@@ -267,6 +249,43 @@ namespace dd
 	}
     }
 
+    /**
+     * \brief writes image pixels minus mean as float data, in channel, height, width order
+     * @param img the 8 bits image
+     * @param mean the mean image, or nullptr for the mean scalar
+     * @param datum the datum to fill up
+     */
+    void image_to_float_datum(const cv::Mat &img,
+			      const float *mean,
+			      caffe::Datum &datum) const
+    {
+      int channels = img.channels();
+      int height = img.rows;
+      int width = img.cols;
+      datum.set_channels(channels);
+      datum.set_height(height);
+      datum.set_width(width);
+      datum.set_encoded(false);
+      datum.mutable_float_data()->Resize(channels*height*width,0.0);
+      float *data = datum.mutable_float_data()->mutable_data();
+      for (int h=0;h<height;++h)
+	{
+	  const uchar *ptr = img.ptr<uchar>(h);
+	  for (int w=0;w<width;++w)
+	    for (int c=0;c<channels;++c)
+	      {
+		int data_index = (c*height+h)*width+w;
+		data[data_index] = static_cast<float>(ptr[w*channels+c]) - (mean ? mean[data_index] : static_cast<float>(_mean[c]));
+	      }
+	}
+    }
+
+    void timings(APIData &out) const
+    {
+      ImgInputFileConn::timings(out);
+      out.add("preprocess",_preprocess_time);
+    }
+
     std::vector<caffe::Datum> get_dv_test(const int &num,
 					  const bool &has_mean_file)
       {
@@ -319,6 +338,7 @@ namespace dd
     std::string _meanfname = "mean.binaryproto";
     std::string _correspname = "corresp.txt";
     caffe::Blob<float> _data_mean; // mean binary image if available.
+    double _preprocess_time = 0.0; // time spent writing images into datums, in milliseconds.
     std::vector<caffe::Datum>::const_iterator _dt_vit;
   };
 
@@ -825,115 +845,97 @@ namespace dd
 	  datum_channels = 1;
 	else if (_embed && !_characters)
 	  datum_channels = _sequence;
-	else datum_channels = _vocab.size(); // XXX: may be very large
+	else datum_channels = feature_size(); // XXX: may be very large
 	datum.set_channels(datum_channels);
        	datum.set_height(1);
 	datum.set_width(1);
 	datum.set_label(tbe->_target);
-	if (!_characters)
+	fill_datum(tbe,datum_channels,datum);
+	return datum;
+      }
+
+    void fill_datum(TxtBowEntry *tbe,
+		    const int &datum_channels,
+		    caffe::Datum &datum)
+      {
+	if (!_embed)
 	  {
-	    std::unordered_map<std::string,Word>::const_iterator wit;
-	    if (!_embed)
-	      {
-		for (int i=0;i<datum_channels;i++) // XXX: expected to be slow
-		  datum.add_float_data(0.0);
-		tbe->reset();
-		while(tbe->has_elt())
-		  {
-		    std::string key;
-		    double val;
-		    tbe->get_next_elt(key,val);
-		    if ((wit = _vocab.find(key))!=_vocab.end())
-		      datum.set_float_data(_vocab[key]._pos,static_cast<float>(val));
-		  }
-	      }
-	    else
-	      {
-		tbe->reset();
-		int i = 0;
-		while(tbe->has_elt())
-		  {
-		    std::string key;
-		    double val;
-		    tbe->get_next_elt(key,val);
-		    if ((wit = _vocab.find(key))!=_vocab.end())
-		      datum.add_float_data(static_cast<float>(_vocab[key]._pos));
-		    ++i;
-		    if (i == _sequence) // tmp limit on sequence length
-		      break;
-		  }
-		while (datum.float_data_size() < _sequence)
-		  datum.add_float_data(0.0);
-	      }
+	    datum.mutable_float_data()->Resize(datum_channels,0.0);
+	    for (size_t i=0;i<tbe->_ids.size();i++)
+	      datum.set_float_data(tbe->_ids[i],static_cast<float>(tbe->_vals[i]));
 	  }
-	else // character-level features
+	else
 	  {
-	    tbe->reset();
-	    std::vector<int> vals;
-	    std::unordered_map<uint32_t,int>::const_iterator whit;
-	    while(tbe->has_elt())
-	      {
-		std::string key;
-		double val = -1.0;
-		tbe->get_next_elt(key,val);
-		uint32_t c = std::strtoul(key.c_str(),0,10);
-		if ((whit=_alphabet.find(c))!=_alphabet.end())
-		  vals.push_back((*whit).second);
-		else vals.push_back(-1);
-	      }
-	    /*if (vals.size() > _sequence)
-	      std::cerr << "more characters than sequence / " << vals.size() << " / sequence=" << _sequence << std::endl;*/
-	    if (!_embed)
+	    int seq = std::min(_sequence,static_cast<int>(tbe->_ids.size())); // tmp limit on sequence length
+	    for (int i=0;i<seq;i++)
+	      datum.add_float_data(static_cast<float>(tbe->_ids[i]));
+	    while (datum.float_data_size() < _sequence)
+	      datum.add_float_data(0.0);
+	  }
+      }
+
+    void fill_datum(TxtCharEntry *tbe,
+		    const int &datum_channels,
+		    caffe::Datum &datum) // character-level features
+      {
+	(void)datum_channels;
+	tbe->reset();
+	std::vector<int> vals;
+	std::unordered_map<uint32_t,int>::const_iterator whit;
+	while(tbe->has_elt())
+	  {
+	    std::string key;
+	    double val = -1.0;
+	    tbe->get_next_elt(key,val);
+	    uint32_t c = std::strtoul(key.c_str(),0,10);
+	    if ((whit=_alphabet.find(c))!=_alphabet.end())
+	      vals.push_back((*whit).second);
+	    else vals.push_back(-1);
+	  }
+	/*if (vals.size() > _sequence)
+	  std::cerr << "more characters than sequence / " << vals.size() << " / sequence=" << _sequence << std::endl;*/
+	if (!_embed)
+	  {
+	    for (int c=0;c<_sequence;c++)
 	      {
-		for (int c=0;c<_sequence;c++)
-		  {
-		    std::vector<float> v(_alphabet.size(),0.0);
-		    if (c<(int)vals.size() && vals[c] != -1)
-		      v[vals[c]] = 1.0;
-		    for (float f: v)
-		      datum.add_float_data(f);
-		  }
-		datum.set_height(_sequence);
-		datum.set_width(_alphabet.size());
+		std::vector<float> v(_alphabet.size(),0.0);
+		if (c<(int)vals.size() && vals[c] != -1)
+		  v[vals[c]] = 1.0;
+		for (float f: v)
+		  datum.add_float_data(f);
 	      }
-	    else
+	    datum.set_height(_sequence);
+	    datum.set_width(_alphabet.size());
+	  }
+	else
+	  {
+	    for (int c=0;c<_sequence;c++)
 	      {
-		for (int c=0;c<_sequence;c++)
-		  {
-		    double val = 0.0;
-		    if (c<(int)vals.size() && vals[c] != -1)
-		      val = static_cast<float>(vals[c]+1.0); // +1 as offset to null index
-		    datum.add_float_data(val);
-		  }
-		datum.set_height(_sequence); //TODO: height to sequence and channels to 1 ?
-		datum.set_width(1);
+		double val = 0.0;
+		if (c<(int)vals.size() && vals[c] != -1)
+		  val = static_cast<float>(vals[c]+1.0); // +1 as offset to null index
+		datum.add_float_data(val);
 	      }
+	    datum.set_height(_sequence); //TODO: height to sequence and channels to 1 ?
+	    datum.set_width(1);
 	  }
-	return datum;
       }
 
     caffe::SparseDatum to_sparse_datum(TxtBowEntry *tbe)
       {
 	caffe::SparseDatum datum;
 	datum.set_label(tbe->_target);
-	std::unordered_map<std::string,Word>::const_iterator wit;
-	tbe->reset();
-	int nwords = 0;
-	while(tbe->has_elt())
+	// entries are sorted (position,value) arrays, copied as is
+	int nwords = tbe->_ids.size();
+	datum.mutable_data()->Reserve(nwords);
+	datum.mutable_indices()->Reserve(nwords);
+	for (int i=0;i<nwords;i++)
 	  {
-	    std::string key;
-	    double val;
-	    tbe->get_next_elt(key,val);
-	    if ((wit = _vocab.find(key))!=_vocab.end())
-	      {
-		int word_pos = _vocab[key]._pos;
-		datum.add_data(static_cast<float>(val));
-		datum.add_indices(word_pos);
-		++nwords;
-	      }
+	    datum.add_data(static_cast<float>(tbe->_vals[i]));
+	    datum.add_indices(tbe->_ids[i]);
 	  }
 	datum.set_nnz(nwords);
-	datum.set_size(_vocab.size());
+	datum.set_size(feature_size());
 	return datum;
       }
 
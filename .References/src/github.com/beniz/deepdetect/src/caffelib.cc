@@ -59,11 +59,14 @@ namespace dd
     _autoencoder = cl._autoencoder;
     cl._net = nullptr;
     _crop_size = cl._crop_size;
+    _nreplicas = cl._nreplicas;
+    _predict_batcher.configure(cl._predict_batcher.max_batch_size(),cl._predict_batcher.timeout(),cl._predict_batcher.max_leaders());
   }
 
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
   CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::~CaffeLib()
   {
+    _replicas.clear();
     delete _net;
     _net = nullptr;
   }
@@ -456,6 +459,15 @@ namespace dd
       _autoencoder = true;
     if (!_autoencoder && _nclasses == 0)
       throw MLLibBadParamException("number of classes is unknown (nclasses == 0)");
+    if (ad.has("predict_replicas"))
+      _nreplicas = std::min(ad.get("predict_replicas").get<int>(),NetPool<Net<float>>::max_nets);
+    if (ad.has("predict_batch_size"))
+      {
+	int predict_batch_timeout = 5; // ms
+	if (ad.has("predict_batch_timeout"))
+	  predict_batch_timeout = ad.get("predict_batch_timeout").get<int>();
+	_predict_batcher.configure(ad.get("predict_batch_size").get<int>(),predict_batch_timeout,_nreplicas);
+      }
     if (_regression && _ntargets == 0)
       throw MLLibBadParamException("number of regression targets is unknown (ntargets == 0)");
     // instantiate model template here, if any
@@ -485,6 +497,7 @@ namespace dd
       }
 
     std::lock_guard<std::mutex> lock(_net_mutex); // XXX: not mandatory as train calls are locking resources from above
+    _replicas.clear(); // waits for predict calls on replicas, they are re-created with the trained weights
     TInputConnectorStrategy inputc(this->_inputc);
     this->_inputc._dv.clear();
     this->_inputc._dv_test.clear();
@@ -1034,66 +1047,28 @@ namespace dd
   int CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::predict(const APIData &ad,
 										   APIData &out)
   {
-    std::lock_guard<std::mutex> lock(_net_mutex); // no concurrent calls since the net is not re-instantiated
-
-    // check for net
-    if (!_net || _net->phase() == caffe::TRAIN)
-      {
-	int cm = create_model(true);
-	if (cm != 0)
-	  LOG(ERROR) << "Error creating model for prediction";
-	if (cm == 1)
-	  throw MLLibInternalException("no model in " + this->_mlmodel._repo + " for initializing the net");
-	else if (cm == 2)
-	  throw MLLibBadParamException("no deploy file in " + this->_mlmodel._repo + " for initializing the net");
-      }
-
-    TInputConnectorStrategy inputc(this->_inputc);
-    TOutputConnectorStrategy tout;
     APIData ad_mllib = ad.getobj("parameters").getobj("mllib");
     APIData ad_output = ad.getobj("parameters").getobj("output");
     bool bbox = false;
-    double confidence_threshold = 0.0;
-    if (ad_output.has("confidence_threshold"))
-      {
-	try
-	  {
-	    confidence_threshold = ad_output.get("confidence_threshold").get<double>();
-	  }
-	catch(std::exception &e)
-	  {
-	    // try from int
-	    confidence_threshold = static_cast<double>(ad_output.get("confidence_threshold").get<int>());
-	  }
-      }
     if (ad_output.has("bbox") && ad_output.get("bbox").get<bool>())
       bbox = true;
+
+    // plain dense classification and regression calls share forward passes with concurrent calls
+    if (_predict_batcher.enabled() && !this->_inputc._sparse && !bbox
+	&& !ad_output.has("measure") && !ad_mllib.has("extract_layer"))
+      return predict_batched(ad,out);
+
+    // no concurrent calls on the net since it is not re-instantiated, replicas take them
+    std::unique_lock<std::mutex> lock(_net_mutex,std::defer_lock);
+    std::unique_ptr<typename NetPool<Net<float>>::Lease> lease;
+    Net<float> *net = checkout_predict_net(lock,lease);
+
+    TInputConnectorStrategy inputc(this->_inputc);
+    TOutputConnectorStrategy tout;
+    double confidence_threshold = get_confidence_threshold(ad_output);
     
     // gpu
-#if !defined(CPU_ONLY) && !defined(USE_CAFFE_CPU_ONLY)
-    bool gpu = _gpu;
-    if (ad_mllib.has("gpu"))
-      {
-	gpu = ad_mllib.get("gpu").get<bool>();
-	if (gpu)
-	  {
-	    set_gpuid(ad_mllib);
-	  }
-      }
-    if (gpu)
-      {
-	for (auto i: _gpuid)
-	  {
-	    Caffe::SetDevice(i);
-	    if (gpu != _gpu)
-	      Caffe::DeviceQuery();
-	  }
-	Caffe::set_mode(Caffe::GPU);
-      }
-    else Caffe::set_mode(Caffe::CPU);
-#else
-    Caffe::set_mode(Caffe::CPU);
-#endif
+    set_predict_mode(ad_mllib);
 
     APIData cad = ad;
     bool has_mean_file = this->_mlmodel._has_mean_file;
@@ -1118,14 +1093,14 @@ namespace dd
 	  }
 
 	bool has_mean_file = this->_mlmodel._has_mean_file;
-	test(_net,ad,inputc,batch_size,has_mean_file,out);
+	test(net,ad,inputc,batch_size,has_mean_file,out);
 	APIData out_meas = out.getobj("measure");
 	out_meas.erase("train_loss");
 	out_meas.erase("iteration");
 	out.add("measure",out_meas);
 	return 0;
       }
-    
+
     std::string extract_layer;
     if (ad_mllib.has("extract_layer"))
       extract_layer = ad_mllib.get("extract_layer").get<std::string>();
@@ -1149,6 +1124,7 @@ namespace dd
     std::vector<APIData> vrad;
     int nclasses = -1;
     int idoffset = 0;
+    double forward_time = 0.0;
     while(true)
       {
 	try
@@ -1159,15 +1135,14 @@ namespace dd
 		if (dv.empty())
 		  break;
 		batch_size = dv.size();
-		if (boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(_net->layers()[0]) == 0)
+		if (boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(net->layers()[0]) == 0)
 		    {
 		      LOG(ERROR) << "deploy net's first layer is required to be of MemoryData type (predict)";
-		      delete _net;
-		      _net = nullptr;
+		      discard_predict_net(net);
 		      throw MLLibBadParamException("deploy net's first layer is required to be of MemoryData type");
 		    }
-		boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(_net->layers()[0])->set_batch_size(batch_size);
-		boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(_net->layers()[0])->AddDatumVector(dv);
+		boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(net->layers()[0])->set_batch_size(batch_size);
+		boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(net->layers()[0])->AddDatumVector(dv);
 	      }
 	    else
 	      {
@@ -1175,40 +1150,39 @@ namespace dd
 		if (dv.empty())
 		  break;
 		batch_size = dv.size();
-		if (boost::dynamic_pointer_cast<caffe::MemorySparseDataLayer<float>>(_net->layers()[0]) == 0)
+		if (boost::dynamic_pointer_cast<caffe::MemorySparseDataLayer<float>>(net->layers()[0]) == 0)
 		  {
 		    LOG(ERROR) << "deploy net's first layer is required to be of MemoryData type (predict)";
-		    delete _net;
-		    _net = nullptr;
+		    discard_predict_net(net);
 		    throw MLLibBadParamException("deploy net's first layer is required to be of MemorySparseData type");
 		  }
-		boost::dynamic_pointer_cast<caffe::MemorySparseDataLayer<float>>(_net->layers()[0])->set_batch_size(batch_size);
-		boost::dynamic_pointer_cast<caffe::MemorySparseDataLayer<float>>(_net->layers()[0])->AddDatumVector(dv);
+		boost::dynamic_pointer_cast<caffe::MemorySparseDataLayer<float>>(net->layers()[0])->set_batch_size(batch_size);
+		boost::dynamic_pointer_cast<caffe::MemorySparseDataLayer<float>>(net->layers()[0])->AddDatumVector(dv);
 	      }
 	  }
 	catch(std::exception &e)
 	  {
 	    LOG(ERROR) << "exception while filling up network for prediction";
-	    delete _net;
-	    _net = nullptr;
+	    discard_predict_net(net);
 	    throw;
 	  }
 	
 	float loss = 0.0;
+	std::chrono::time_point<std::chrono::system_clock> tstart = std::chrono::system_clock::now();
 	if (extract_layer.empty()) // supervised
 	  {
 	    std::vector<Blob<float>*> results;
 	    try
 	      {
-		results = _net->Forward(&loss);
+		results = net->Forward(&loss);
 	      }
 	    catch(std::exception &e)
 	      {
 		LOG(ERROR) << "Error while proceeding with supervised prediction forward pass, not enough memory? " << e.what();
-		delete _net;
-		_net = nullptr;
+		discard_predict_net(net);
 		throw;
 	      }
+	    forward_time += std::chrono::duration<double,std::milli>(std::chrono::system_clock::now()-tstart).count();
 	    if (bbox) // in-image object detection
 	      {
 		int results_height = results[0]->height();
@@ -1277,60 +1251,32 @@ namespace dd
 	      }
 	    else // classification
 	      {
-		int slot = results.size() - 1;
-		if (_regression)
-		  {
-		    if (_ntargets > 1)
-		      slot = 1;
-		    else slot = 0; // XXX: more in-depth testing required
-		  }
+		int slot = get_result_slot(results);
 		int scount = results[slot]->count();
 		int scperel = scount / batch_size;
-		nclasses = scperel;
-		if (_autoencoder)
-		  nclasses = scperel = 1;
-		for (int j=0;j<batch_size;j++)
-		  {
-		    APIData rad;
-		    if (!inputc._ids.empty())
-		      rad.add("uri",inputc._ids.at(idoffset+j));
-		    else rad.add("uri",std::to_string(idoffset+j));
-		    rad.add("loss",loss);
-		    std::vector<double> probs;
-		    std::vector<std::string> cats;
-		    for (int i=0;i<nclasses;i++)
-		      {
-			double prob = results[slot]->cpu_data()[j*scperel+i];
-			if (prob < confidence_threshold)
-			  continue;
-			probs.push_back(prob);
-			cats.push_back(this->_mlmodel.get_hcorresp(i));
-		      }
-		    rad.add("probs",probs);
-		    rad.add("cats",cats);
-		    vrad.push_back(rad);
-		  }
+		add_class_results(inputc,results[slot]->cpu_data(),batch_size,scperel,idoffset,
+				  loss,confidence_threshold,nclasses,vrad);
 	      }
 	  }
 	else // unsupervised
 	  {
-	    std::map<std::string,int> n_layer_names_index = _net->layer_names_index();
+	    std::map<std::string,int> n_layer_names_index = net->layer_names_index();
 	    std::map<std::string,int>::const_iterator lit;
 	    if ((lit=n_layer_names_index.find(extract_layer))==n_layer_names_index.end())
 	      throw MLLibBadParamException("unknown extract layer " + extract_layer);
 	    int li = (*lit).second;
 	    try
 	      {
-		loss = _net->ForwardFromTo(0,li);
+		loss = net->ForwardFromTo(0,li);
 	      }
 	    catch(std::exception &e)
 	      {
 		LOG(ERROR) << "Error while proceeding with unsupervised prediction forward pass, not enough memory? " << e.what();
-		delete _net;
-		_net = nullptr;
+		discard_predict_net(net);
 		throw;
 	      }
-	    const std::vector<std::vector<Blob<float>*>>& rresults = _net->top_vecs();
+	    forward_time += std::chrono::duration<double,std::milli>(std::chrono::system_clock::now()-tstart).count();
+	    const std::vector<std::vector<Blob<float>*>>& rresults = net->top_vecs();
 	    std::vector<Blob<float>*> results = rresults.at(li);
 	    int slot = 0;
 	    int scount = results[slot]->count();
@@ -1356,8 +1302,275 @@ namespace dd
 	idoffset += batch_size;
       } // end prediction loop over batches
 
+    finalize_predictions(ad,inputc,tout,vrad,nclasses,bbox,extract_layer.empty(),forward_time,out);
+    return 0;
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  int CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::predict_batched(const APIData &ad,
+											   APIData &out)
+  {
+    TInputConnectorStrategy inputc(this->_inputc);
+    TOutputConnectorStrategy tout;
+    APIData ad_mllib = ad.getobj("parameters").getobj("mllib");
+    APIData ad_output = ad.getobj("parameters").getobj("output");
+    double confidence_threshold = get_confidence_threshold(ad_output);
+
+    // the mode is per thread, the forward pass may run from any of the batched calls
+    set_predict_mode(ad_mllib);
+
+    // input transforms run concurrently, outside of the net lock
+    APIData cad = ad;
+    bool has_mean_file = this->_mlmodel._has_mean_file;
+    cad.add("has_mean_file",has_mean_file);
+    inputc.transform(cad);
+    inputc.reset_dv_test();
+
+    std::vector<APIData> vrad;
+    int nclasses = -1;
+    int idoffset = 0;
+    double forward_time = 0.0; // includes waiting for the batch
+    while(true)
+      {
+	std::vector<Datum> dv = inputc.get_dv_test(_predict_batcher.max_batch_size(),has_mean_file);
+	if (dv.empty())
+	  break;
+	int batch_size = dv.size();
+	typename PredictBatcher<Datum>::Request req(std::move(dv));
+	std::chrono::time_point<std::chrono::system_clock> tstart = std::chrono::system_clock::now();
+	_predict_batcher.run(req,[this](std::vector<Datum> &bdv, std::vector<float> &bout, int &out_size, float &loss)
+			     {
+			       forward_batch(bdv,bout,out_size,loss);
+			     });
+	forward_time += std::chrono::duration<double,std::milli>(std::chrono::system_clock::now()-tstart).count();
+	add_class_results(inputc,req._out.data(),batch_size,req._out_size,idoffset,
+			  req._loss,confidence_threshold,nclasses,vrad);
+	idoffset += batch_size;
+      }
+
+    finalize_predictions(ad,inputc,tout,vrad,nclasses,false,true,forward_time,out);
+    return 0;
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::forward_batch(std::vector<Datum> &dv,
+											  std::vector<float> &out,
+											  int &out_size,
+											  float &loss)
+  {
+    std::unique_lock<std::mutex> lock(_net_mutex,std::defer_lock);
+    std::unique_ptr<typename NetPool<Net<float>>::Lease> lease;
+    Net<float> *net = checkout_predict_net(lock,lease);
+    boost::shared_ptr<caffe::MemoryDataLayer<float>> mdl = boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(net->layers()[0]);
+    if (mdl == 0)
+      {
+	LOG(ERROR) << "deploy net's first layer is required to be of MemoryData type (predict)";
+	discard_predict_net(net);
+	throw MLLibBadParamException("deploy net's first layer is required to be of MemoryData type");
+      }
+    std::vector<Blob<float>*> results;
+    try
+      {
+	mdl->set_batch_size(dv.size());
+	mdl->AddDatumVector(dv);
+	results = net->Forward(&loss);
+      }
+    catch(std::exception &e)
+      {
+	LOG(ERROR) << "Error while proceeding with batched prediction forward pass, not enough memory? " << e.what();
+	discard_predict_net(net);
+	throw;
+      }
+    int slot = get_result_slot(results);
+    const float *data = results[slot]->cpu_data();
+    out_size = results[slot]->count() / dv.size();
+    out.assign(data,data+results[slot]->count());
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::create_predict_model()
+  {
+    if (!_net || _net->phase() == caffe::TRAIN)
+      {
+	_replicas.clear(); // replicas share the weights of the previous net, and the first one is the net
+	int cm = create_model(true);
+	if (cm != 0)
+	  LOG(ERROR) << "Error creating model for prediction";
+	if (cm == 1)
+	  throw MLLibInternalException("no model in " + this->_mlmodel._repo + " for initializing the net");
+	else if (cm == 2)
+	  throw MLLibBadParamException("no deploy file in " + this->_mlmodel._repo + " for initializing the net");
+      }
+    if (_nreplicas > 0 && _replicas.size() == 0)
+      create_replicas();
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::create_replicas()
+  {
+    std::vector<Net<float>*> replicas;
+    try
+      {
+	for (int i=1;i<_nreplicas;i++) // the net is the first replica
+	  {
+	    replicas.push_back(new Net<float>(this->_mlmodel._def,caffe::TEST));
+	    replicas.back()->ShareTrainedLayersWith(_net); // only activations are per replica
+	  }
+      }
+    catch (std::exception &e)
+      {
+	LOG(ERROR) << "Error creating network replicas: " << e.what();
+	for (Net<float> *r: replicas)
+	  delete r;
+	throw;
+      }
+    LOG(INFO) << "Created " << _nreplicas << " predict-only network replicas";
+    _replicas.reset(replicas,_net);
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  Net<float>* CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::checkout_predict_net(std::unique_lock<std::mutex> &lock,
+													 std::unique_ptr<typename NetPool<Net<float>>::Lease> &lease)
+  {
+    while(true)
+      {
+	lock.lock();
+	create_predict_model();
+	if (_replicas.size() == 0)
+	  return _net; // the call keeps the lock
+	lock.unlock();
+
+	// waits for a free replica without the lock, retries if replicas were cleared meanwhile
+	lease.reset(new typename NetPool<Net<float>>::Lease(_replicas));
+	if (lease->get())
+	  return lease->get();
+      }
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::discard_predict_net(Net<float> *net)
+  {
+    // the main net is re-created on next call, replicas only hold activations and are kept,
+    // as is the net when it is a replica since other calls may be using it
+    if (net == _net && _replicas.size() == 0)
+      {
+	delete _net;
+	_net = nullptr;
+      }
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::set_predict_mode(const APIData &ad_mllib)
+  {
+#if !defined(CPU_ONLY) && !defined(USE_CAFFE_CPU_ONLY)
+    bool gpu = _gpu;
+    if (ad_mllib.has("gpu"))
+      {
+	gpu = ad_mllib.get("gpu").get<bool>();
+	if (gpu)
+	  {
+	    set_gpuid(ad_mllib);
+	  }
+      }
+    if (gpu)
+      {
+	for (auto i: _gpuid)
+	  {
+	    Caffe::SetDevice(i);
+	    if (gpu != _gpu)
+	      Caffe::DeviceQuery();
+	  }
+	Caffe::set_mode(Caffe::GPU);
+      }
+    else Caffe::set_mode(Caffe::CPU);
+#else
+    (void)ad_mllib;
+    Caffe::set_mode(Caffe::CPU);
+#endif
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  double CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::get_confidence_threshold(const APIData &ad_output)
+  {
+    double confidence_threshold = 0.0;
+    if (ad_output.has("confidence_threshold"))
+      {
+	try
+	  {
+	    confidence_threshold = ad_output.get("confidence_threshold").get<double>();
+	  }
+	catch(std::exception &e)
+	  {
+	    // try from int
+	    confidence_threshold = static_cast<double>(ad_output.get("confidence_threshold").get<int>());
+	  }
+      }
+    return confidence_threshold;
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  int CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::get_result_slot(const std::vector<Blob<float>*> &results) const
+  {
+    int slot = results.size() - 1;
+    if (_regression)
+      {
+	if (_ntargets > 1)
+	  slot = 1;
+	else slot = 0; // XXX: more in-depth testing required
+      }
+    return slot;
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::add_class_results(const TInputConnectorStrategy &inputc,
+											      const float *data,
+											      const int &batch_size,
+											      int scperel,
+											      const int &idoffset,
+											      const float &loss,
+											      const double &confidence_threshold,
+											      int &nclasses,
+											      std::vector<APIData> &vrad)
+  {
+    nclasses = scperel;
+    if (_autoencoder)
+      nclasses = scperel = 1;
+    for (int j=0;j<batch_size;j++)
+      {
+	APIData rad;
+	if (!inputc._ids.empty())
+	  rad.add("uri",inputc._ids.at(idoffset+j));
+	else rad.add("uri",std::to_string(idoffset+j));
+	rad.add("loss",loss);
+	std::vector<double> probs;
+	std::vector<std::string> cats;
+	for (int i=0;i<nclasses;i++)
+	  {
+	    double prob = data[j*scperel+i];
+	    if (prob < confidence_threshold)
+	      continue;
+	    probs.push_back(prob);
+	    cats.push_back(this->_mlmodel.get_hcorresp(i));
+	  }
+	rad.add("probs",probs);
+	rad.add("cats",cats);
+	vrad.push_back(rad);
+      }
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void CaffeLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::finalize_predictions(const APIData &ad,
+												 const TInputConnectorStrategy &inputc,
+												 TOutputConnectorStrategy &tout,
+												 std::vector<APIData> &vrad,
+												 const int &nclasses,
+												 const bool &bbox,
+												 const bool &supervised,
+												 const double &forward_time,
+												 APIData &out)
+  {
     tout.add_results(vrad);
-    if (extract_layer.empty())
+    if (supervised)
       {
 	if (_regression)
 	  {
@@ -1372,9 +1585,11 @@ namespace dd
     out.add("nclasses",nclasses);
     out.add("bbox",bbox);
     tout.finalize(ad.getobj("parameters").getobj("output"),out);
+    APIData ad_timings;
+    inputc.timings(ad_timings);
+    ad_timings.add("forward",forward_time);
+    out.add("timings",ad_timings);
     out.add("status",0);
-    
-    return 0;
   }
   
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
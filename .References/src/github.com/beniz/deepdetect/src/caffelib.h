@@ -24,6 +24,8 @@
 
 #include "mllibstrategy.h"
 #include "caffemodel.h"
+#include "netpool.h"
+#include "predictbatcher.h"
 #include "caffe/caffe.hpp"
 #include "caffe/layers/memory_data_layer.hpp"
 #include "caffe/layers/memory_sparse_data_layer.hpp"
@@ -129,6 +131,15 @@ namespace dd
      * @return 0 if OK, 1 otherwise
      */
     int predict(const APIData &ad, APIData &out);
+
+    /**
+     * \brief predicts from model, sharing forward passes with concurrent calls
+     *        (dense supervised nets without bbox, measure or feature extraction)
+     * @param ad root data object
+     * @param out output data object (e.g. predictions, ...)
+     * @return 0 if OK, 1 otherwise
+     */
+    int predict_batched(const APIData &ad, APIData &out);
     
     //TODO: status ?
 
@@ -201,6 +212,66 @@ namespace dd
 
       void set_gpuid(const APIData &ad);
 
+      void create_predict_model();
+
+      /**
+       * \brief creates the predict-only replicas, sharing the net's weights, the net is the first one
+       */
+      void create_replicas();
+
+      /**
+       * \brief gets the net for a predict call, a replica if any
+       * @param lock deferred lock on the net mutex, held on return only if there are no replicas
+       * @param lease holds the replica until the call is done
+       * @return the net or replica to run the call on
+       */
+      caffe::Net<float>* checkout_predict_net(std::unique_lock<std::mutex> &lock,
+					      std::unique_ptr<typename NetPool<caffe::Net<float>>::Lease> &lease);
+
+      /**
+       * \brief drops the net after a failed predict call so that it gets re-created
+       * @param net the net or replica the call was using, replicas are kept
+       */
+      void discard_predict_net(caffe::Net<float> *net);
+
+      void set_predict_mode(const APIData &ad_mllib);
+
+      static double get_confidence_threshold(const APIData &ad_output);
+
+      int get_result_slot(const std::vector<Blob<float>*> &results) const;
+
+      /**
+       * \brief forward pass over a batch of concurrent predict calls, under the net lock
+       * @param dv the batch samples
+       * @param out the row-major outputs of the result slot
+       * @param out_size the number of outputs per sample
+       * @param loss the forward pass loss
+       */
+      void forward_batch(std::vector<caffe::Datum> &dv,
+			 std::vector<float> &out,
+			 int &out_size,
+			 float &loss);
+
+      void add_class_results(const TInputConnectorStrategy &inputc,
+			     const float *data,
+			     const int &batch_size,
+			     int scperel,
+			     const int &idoffset,
+			     const float &loss,
+			     const double &confidence_threshold,
+			     int &nclasses,
+			     std::vector<APIData> &vrad);
+
+      void finalize_predictions(const APIData &ad,
+				const TInputConnectorStrategy &inputc,
+				TOutputConnectorStrategy &tout,
+				std::vector<APIData> &vrad,
+				const int &nclasses,
+				const bool &bbox,
+				const bool &supervised,
+				const double &forward_time,
+				APIData &out);
+
       void model_complexity(long int &flops,
 			    long int &params);
       
@@ -213,6 +284,9 @@ namespace dd
       int _ntargets = 0; /**< number of classification or regression targets. */
       bool _autoencoder = false; /**< whether an autoencoder. */
       std::mutex _net_mutex; /**< mutex around net, e.g. no concurrent predict calls as net is not re-instantiated. Use batches instead. */
+      PredictBatcher<caffe::Datum> _predict_batcher; /**< coalesces concurrent predict calls into shared forward passes. */
+      int _nreplicas = 0; /**< number of predict-only net replicas including the net, none by default. */
+      NetPool<caffe::Net<float>> _replicas; /**< predict-only net replicas taking concurrent predict calls. */
       long int _flops = 0;  /**< model flops. */
       long int _params = 0;  /**< number of parameters in the model. */
       int _crop_size = -1; /**< cropping is part of Caffe transforms in input layers, storing here. */
@@ -20,10 +20,95 @@
  */
 
 #include "csvinputfileconn.h"
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <glog/logging.h>
+#include <cstring>
+#include <thread>
 
 namespace dd
 {
+  static const size_t min_chunk_size = 1 << 20; /**< CSV files are parsed in chunks of at least 1MB. */
+
+  // end of line, or of data
+  static const char* line_end(const char *line,
+			      const char *end)
+  {
+    const char *eol = static_cast<const char*>(memchr(line,'\n',end-line));
+    return eol ? eol : end;
+  }
+
+  // line end without trailing ^M, if any
+  static const char* trim_cr(const char *line,
+			     const char *eol)
+  {
+    while(eol != line && *(eol-1) == '\r')
+      --eol;
+    return eol;
+  }
+
+  // maps a CSV file, empty files can't be mapped and are read as empty data
+  static void map_csv_file(const std::string &fname,
+			   boost::iostreams::mapped_file_source &csv_file,
+			   const char *&begin,
+			   const char *&end)
+  {
+    static const char empty = '\0';
+    begin = end = &empty;
+    if (fileops::file_size(fname) == 0)
+      return;
+    try
+      {
+	csv_file.open(fname);
+      }
+    catch(std::exception &e)
+      {
+	LOG(ERROR) << "cannot map file " << fname << ": " << e.what();
+      }
+    LOG(INFO) << "fname=" << fname << " / open=" << csv_file.is_open() << std::endl;
+    if (!csv_file.is_open())
+      throw InputConnectorBadParamException("cannot open file " + fname);
+    begin = csv_file.data();
+    end = begin + csv_file.size();
+  }
+
+  // plain integers and decimals of up to 15 digits are exactly converted in place,
+  // anything else goes through std::stod so that results and errors are unchanged
+  static double parse_double(const char *begin,
+			     const char *end)
+  {
+    static const double pow10[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,1e12,1e13,1e14,1e15};
+    const char *p = begin;
+    bool neg = false;
+    if (p != end && (*p == '-' || *p == '+'))
+      {
+	neg = (*p == '-');
+	++p;
+      }
+    long long mantissa = 0;
+    int ndigits = 0;
+    int nfrac = -1;
+    for (;p != end;++p)
+      {
+	if (*p >= '0' && *p <= '9')
+	  {
+	    mantissa = mantissa * 10 + (*p - '0');
+	    ++ndigits;
+	    if (nfrac >= 0)
+	      ++nfrac;
+	  }
+	else if (*p == '.' && nfrac < 0)
+	  nfrac = 0;
+	else break;
+      }
+    if (p == end && ndigits > 0 && ndigits <= 15)
+      {
+	double val = static_cast<double>(mantissa);
+	if (nfrac > 0)
+	  val /= pow10[nfrac]; // exact operands, correctly rounded
+	return neg ? -val : val;
+      }
+    return std::stod(std::string(begin,end));
+  }
 
   /*- DDCsv -*/
   int DDCsv::read_file(const std::string &fname)
@@ -145,22 +230,53 @@ namespace dd
     //debug
   }
   
+  CSVInputFileConn::ColumnLookup CSVInputFileConn::column_lookup() const
+  {
+    ColumnLookup columns;
+    columns.reserve(_columns.size());
+    for (const std::string &c: _columns)
+      {
+	std::unordered_map<std::string,CCategorical>::const_iterator chit = _categoricals.find(c);
+	columns.push_back(std::make_pair(c,chit != _categoricals.end() ? &(*chit).second : nullptr));
+      }
+    return columns;
+  }
+  
   void CSVInputFileConn::read_csv_line(const std::string &hline,
 				       const std::string &delim,
 				       std::vector<double> &vals,
 				       std::string &column_id,
 				       int &nlines)
     {
-      std::string col;
+      read_csv_line(hline.data(),hline.data()+hline.size(),delim[0],column_lookup(),vals,column_id,nlines);
+      ++nlines;
+    }
+
+  void CSVInputFileConn::read_csv_line(const char *begin,
+				       const char *end,
+				       const char &delim,
+				       const ColumnLookup &columns,
+				       std::vector<double> &vals,
+				       std::string &column_id,
+				       const int &nlines) const
+    {
+      static const std::string no_name;
       std::unordered_set<int>::const_iterator hit;
-      std::stringstream sh(hline);
       int c = -1;
-      auto lit = _columns.begin();
-      while(std::getline(sh,col,delim[0]))
+      size_t l = 0;
+      const char *p = begin;
+      while(p != end)
 	{
+	  // fields are split in place, a trailing delimiter does not open a new field
+	  const char *col_begin = p;
+	  const char *col_end = static_cast<const char*>(memchr(p,delim,end-p));
+	  if (!col_end)
+	    col_end = end;
+	  p = col_end == end ? end : col_end + 1;
 	  ++c;
-	  std::string col_name;
-
+	  const std::string *col_name = &no_name;
+	  const CCategorical *cat = nullptr;
+	  
 	  // detect strings by looking for characters and for quotes
 	  // convert to float unless it is string (ignore strings, aka categorical fields, for now)
 	  if (!_columns.empty()) // in prediction mode, columns from header are not mandatory
@@ -169,56 +285,56 @@ namespace dd
 		{
 		  continue;
 		}
-	      col_name = (*lit);
+	      if (l < columns.size())
+		{
+		  col_name = &columns[l].first;
+		  cat = columns[l].second;
+		}
 	      if (_id_pos == c)
 		{
-		  column_id = col;
+		  column_id.assign(col_begin,col_end);
 		}
 	    }
 	  try
 	    {
-	      double val = 0.0;
-	      if (!col.empty())
+	      if (col_begin != col_end)
 		{
 		  // one-hot vector encoding as required
-		  if (!_columns.empty() && is_category(col_name))
+		  if (cat)
 		    {
 		      // - look up category
-		      std::unordered_map<std::string,CCategorical>::const_iterator chit
-			= _categoricals.find(col_name);
-		      int cnum = (*chit).second.get_cat_num(col);
+		      std::string col(col_begin,col_end);
+		      int cnum = cat->get_cat_num(col);
 		      if (cnum < 0)
 			{
-			  throw InputConnectorBadParamException("unknown category " + col + " for variable " + col_name);
+			  throw InputConnectorBadParamException("unknown category " + col + " for variable " + (*col_name));
 			}
 		      
-		      // - create one-hot vector
-		      int csize = (*chit).second._vals.size();
-		      std::vector<double> ohv = one_hot_vector(cnum,csize);
-		      vals.insert(vals.end(),ohv.begin(),ohv.end());
+		      // - append one-hot vector
+		      size_t csize = cat->_vals.size();
+		      vals.resize(vals.size()+csize,0.0);
+		      vals.at(vals.size()-csize+cnum) = 1.0;
 		    }
 		  else
 		    {
-		      val = std::stod(col);
-		      vals.push_back(val);
+		      vals.push_back(parse_double(col_begin,col_end));
 		    }
 		}
 	    }
 	  catch (std::invalid_argument &e)
 	    {
 	      // not a number, skip for now
-	      if (column_id == col) // if id is string, replace with number / TODO: better scheme
+	      if (column_id.compare(0,std::string::npos,col_begin,col_end-col_begin) == 0) // if id is string, replace with number / TODO: better scheme
 		vals.push_back(c);
 	      else
 		{
-		  LOG(ERROR) << "line " << nlines << ": skipping column " << col_name << " / not a number";
-		  LOG(ERROR) << hline << std::endl;
-		  throw InputConnectorBadParamException("column " + col_name + " is not a number, use categoricals or ignore parameters instead");
+		  LOG(ERROR) << "line " << nlines << ": skipping column " << (*col_name) << " / not a number";
+		  LOG(ERROR) << std::string(begin,end) << std::endl;
+		  throw InputConnectorBadParamException("line " + std::to_string(nlines) + ": column " + (*col_name) + " is not a number, use categoricals or ignore parameters instead");
 		}
 	    }
-	  ++lit;
+	  ++l;
 	}
-      ++nlines;
     }
 
   void CSVInputFileConn::read_header(std::string &hline)
@@ -259,16 +375,123 @@ namespace dd
       throw InputConnectorBadParamException("cannot find id column " + _id);
   }
   
+  void CSVInputFileConn::read_csv_chunks(const char *begin,
+					 const char *end,
+					 std::vector<CSVChunk> &chunks) const
+  {
+    // chunks end on line boundaries, several per thread to balance uneven lines
+    size_t nchunks = std::max(1u,std::thread::hardware_concurrency()) * 4;
+    size_t chunk_size = std::max(static_cast<size_t>(end-begin) / nchunks,min_chunk_size);
+    const char *p = begin;
+    while(p != end)
+      {
+	CSVChunk chunk;
+	chunk._begin = p;
+	p = static_cast<size_t>(end-p) > chunk_size ? p + chunk_size : end;
+	while(p != end && *(p-1) != '\n')
+	  ++p;
+	chunk._end = p;
+	chunks.push_back(std::move(chunk));
+      }
+
+    // line numbers of chunk starts, for error messages
+#pragma omp parallel for
+    for (size_t i=0;i<chunks.size();i++)
+      chunks.at(i)._first_line = std::count(chunks.at(i)._begin,chunks.at(i)._end,'\n');
+    int first_line = 0;
+    for (CSVChunk &chunk: chunks)
+      {
+	int chunk_lines = chunk._first_line;
+	chunk._first_line = first_line;
+	first_line += chunk_lines;
+      }
+    
+    ColumnLookup columns = column_lookup();
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i=0;i<chunks.size();i++)
+      {
+	CSVChunk &chunk = chunks.at(i);
+	try
+	  {
+	    std::vector<double> vals;
+	    std::string cid;
+	    int nlines = chunk._first_line;
+	    const char *line = chunk._begin;
+	    while(line != chunk._end)
+	      {
+		const char *eol = line_end(line,chunk._end);
+		vals.clear();
+		cid.clear();
+		read_csv_line(line,trim_cr(line,eol),_delim[0],columns,vals,cid,nlines);
+		chunk._vals.insert(chunk._vals.end(),vals.begin(),vals.end());
+		chunk._offsets.push_back(chunk._vals.size());
+		if (!_id.empty())
+		  chunk._ids.push_back(cid);
+		++nlines;
+		line = eol == chunk._end ? eol : eol + 1;
+	      }
+	  }
+	catch(...)
+	  {
+	    // exceptions can't leave the parallel loop
+	    chunk._error = std::current_exception();
+	  }
+      }
+    for (CSVChunk &chunk: chunks)
+      if (chunk._error)
+	std::rethrow_exception(chunk._error);
+  }
+
+  void CSVInputFileConn::add_csv_chunks(std::vector<CSVChunk> &chunks,
+					const bool &test,
+					int &nlines)
+  {
+    if (_scale)
+      {
+#pragma omp parallel for schedule(dynamic)
+	for (size_t i=0;i<chunks.size();i++)
+	  {
+	    CSVChunk &chunk = chunks.at(i);
+	    try
+	      {
+		for (size_t r=0;r<chunk.size();r++)
+		  scale_vals(chunk._vals.data()+chunk._offsets.at(r),chunk._offsets.at(r+1)-chunk._offsets.at(r));
+	      }
+	    catch(...)
+	      {
+		chunk._error = std::current_exception();
+	      }
+	  }
+	for (CSVChunk &chunk: chunks)
+	  if (chunk._error)
+	    std::rethrow_exception(chunk._error);
+      }
+    for (CSVChunk &chunk: chunks)
+      {
+	for (size_t r=0;r<chunk.size();r++)
+	  {
+	    std::vector<double> vals(chunk._vals.begin()+chunk._offsets.at(r),chunk._vals.begin()+chunk._offsets.at(r+1));
+	    ++nlines;
+	    std::string cid = !_id.empty() ? chunk._ids.at(r) : std::to_string(nlines);
+	    if (test)
+	      add_test_csvline(cid,vals);
+	    else add_train_csvline(cid,vals);
+	  }
+	chunk = CSVChunk(); // release memory early
+      }
+  }
+  
   void CSVInputFileConn::read_csv(const APIData &ad,
 				  const std::string &fname)
   {
-      std::ifstream csv_file(fname,std::ios::binary);
-      LOG(INFO) << "fname=" << fname << " / open=" << csv_file.is_open() << std::endl;
-      if (!csv_file.is_open())
-	throw InputConnectorBadParamException("cannot open file " + fname);
-      std::string hline;
-      std::getline(csv_file,hline);
+      boost::iostreams::mapped_file_source csv_file;
+      const char *data_start = nullptr;
+      const char *data_end = nullptr;
+      map_csv_file(fname,csv_file,data_start,data_end);
+      const char *hend = line_end(data_start,data_end);
+      std::string hline(data_start,hend);
       read_header(hline);
+      const char *data_begin = hend == data_end ? hend : hend + 1;
       
       //debug
       /*std::cerr << "found " << _detect_cols << " columns\n";
@@ -279,65 +502,71 @@ namespace dd
 		std::cout << std::endl;*/
       //debug
 
-      // categorical variables
+      // categorical variables, in order of appearance
       if (_train && !_categoricals.empty())
 	{
 	  int l = 0;
-	  while(std::getline(csv_file,hline))
+	  const char delim = _delim[0];
+	  std::vector<CCategorical*> columns;
+	  for (const std::string &c: _columns)
+	    columns.push_back(is_category(c) ? &_categoricals[c] : nullptr);
+	  const char *line = data_begin;
+	  while(line != data_end)
 	    {
-	      hline.erase(std::remove(hline.begin(),hline.end(),'\r'),hline.end());
-	      std::vector<double> vals;
-	      std::string cid;
-	      std::string col;
-	      auto hit = _columns.begin();
+	      const char *eol = line_end(line,data_end);
+	      const char *lend = trim_cr(line,eol);
+	      auto hit = columns.begin();
 	      std::unordered_set<int>::const_iterator igit;
-	      std::stringstream sh(hline);
 	      int cu = 0;
-	      while(std::getline(sh,col,_delim[0]))
+	      const char *p = line;
+	      while(p != lend)
 		{
+		  const char *col_end = static_cast<const char*>(memchr(p,delim,lend-p));
+		  if (!col_end)
+		    col_end = lend;
 		  if (cu >= _detect_cols)
 		    {
 		      LOG(ERROR) << "line " << l << " has more columns than headers\n";
-		      LOG(ERROR) << hline << std::endl;
+		      LOG(ERROR) << std::string(line,lend) << std::endl;
 		      throw InputConnectorBadParamException("line has more columns than headers");
 		    }
-		  if ((igit=_ignored_columns_pos.find(cu))!=_ignored_columns_pos.end())
+		  if ((igit=_ignored_columns_pos.find(cu))==_ignored_columns_pos.end())
 		    {
-		      ++cu;
-		      continue;
+		      if (*hit)
+			(*hit)->add_cat(std::string(p,col_end));
+		      ++hit;
 		    }
-		  update_category((*hit),col);
-		  ++hit;
 		  ++cu;
+		  p = col_end == lend ? lend : col_end + 1;
 		}
 	      ++l;
+	      line = eol == data_end ? eol : eol + 1;
 	    }
-	  csv_file.clear();
-	  csv_file.seekg(0,std::ios::beg);
-	  std::getline(csv_file,hline); // skip header line
 	}
 
+      // parse all lines at once, in parallel
+      std::vector<CSVChunk> chunks;
+      read_csv_chunks(data_begin,data_end,chunks);
+      
       // scaling to [0,1]
-      int nlines = 0;
       if (_scale && _min_vals.empty() && _max_vals.empty())
 	{
-	  while(std::getline(csv_file,hline))
-	    {
-	      hline.erase(std::remove(hline.begin(),hline.end(),'\r'),hline.end());
-	      std::vector<double> vals;
-	      std::string cid;
-	      read_csv_line(hline,_delim,vals,cid,nlines);
-	      if (nlines == 1)
-		_min_vals = _max_vals = vals;
-	      else
-		{
-		  for (size_t j=0;j<vals.size();j++)
-		    {
-		      _min_vals.at(j) = std::min(vals.at(j),_min_vals.at(j));
-		      _max_vals.at(j) = std::max(vals.at(j),_max_vals.at(j));
-		    }
-		}
-	    }
+	  for (const CSVChunk &chunk: chunks)
+	    for (size_t r=0;r<chunk.size();r++)
+	      {
+		const double *vals = chunk._vals.data() + chunk._offsets.at(r);
+		size_t nvals = chunk._offsets.at(r+1) - chunk._offsets.at(r);
+		if (_min_vals.empty() && _max_vals.empty())
+		  _min_vals = _max_vals = std::vector<double>(vals,vals+nvals);
+		else
+		  {
+		    for (size_t j=0;j<nvals;j++)
+		      {
+			_min_vals.at(j) = std::min(vals[j],_min_vals.at(j));
+			_max_vals.at(j) = std::max(vals[j],_max_vals.at(j));
+		      }
+		  }
+	      }
 	  
 	  //debug
 	  /*std::cout << "min/max scales:\n";
@@ -346,36 +575,11 @@ namespace dd
 	  std::copy(_max_vals.begin(),_max_vals.end(),std::ostream_iterator<double>(std::cout," "));
 	  std::cout << std::endl;*/
 	  //debug
-	  
-	  csv_file.clear();
-	  csv_file.seekg(0,std::ios::beg);
-	  std::getline(csv_file,hline); // skip header line
-	  nlines = 0;
 	}
       
       // read data
-      while(std::getline(csv_file,hline))
-	{
-	  hline.erase(std::remove(hline.begin(),hline.end(),'\r'),hline.end());
-	  std::vector<double> vals;
-	  std::string cid;
-	  read_csv_line(hline,_delim,vals,cid,nlines);
-	  if (_scale)
-	    {
-	      scale_vals(vals);
-	    }
-	  if (!_id.empty())
-	    {
-	      add_train_csvline(cid,vals);
-	    }
-	  else add_train_csvline(std::to_string(nlines),vals); 
-	  
-	  //debug
-	  /*std::cout << "csv data line #" << nlines << "= " << vals.size() << std::endl;
-	    std::copy(vals.begin(),vals.end(),std::ostream_iterator<double>(std::cout," "));
-	    std::cout << std::endl;*/
-	  //debug
-	}
+      int nlines = 0;
+      add_csv_chunks(chunks,false,nlines);
       LOG(INFO) << "read " << nlines << " lines from " << fname << std::endl;
       csv_file.close();
       
@@ -383,32 +587,16 @@ namespace dd
       if (!_csv_test_fname.empty())
 	{
 	  nlines = 0;
-	  std::ifstream csv_test_file(_csv_test_fname,std::ios::binary);
-	  if (!csv_test_file.is_open())
-	    throw InputConnectorBadParamException("cannot open test file " + fname);
-	  std::getline(csv_test_file,hline); // skip header line
-	  while(std::getline(csv_test_file,hline))
-	    {
-	      hline.erase(std::remove(hline.begin(),hline.end(),'\r'),hline.end());
-	      std::vector<double> vals;
-	      std::string cid;
-	      read_csv_line(hline,_delim,vals,cid,nlines);
-	      if (_scale)
-		{
-		  scale_vals(vals);
-		}
-	      if (!_id.empty())
-		add_test_csvline(cid,vals);
-	      //_csvdata_test.emplace_back(cid,vals);
-	      else add_test_csvline(std::to_string(nlines),vals);
-	      //_csvdata_test.emplace_back(std::to_string(nlines),vals);
-	      
-	      //debug
-	      /*std::cout << "csv test data line=";
-		std::copy(vals.begin(),vals.end(),std::ostream_iterator<double>(std::cout," "));
-		std::cout << std::endl;*/
-	      //debug
-	    }
+	  boost::iostreams::mapped_file_source csv_test_file;
+	  const char *test_start = nullptr;
+	  const char *test_end = nullptr;
+	  map_csv_file(_csv_test_fname,csv_test_file,test_start,test_end);
+	  const char *test_begin = line_end(test_start,test_end); // skip header line
+	  if (test_begin != test_end)
+	    ++test_begin;
+	  chunks.clear();
+	  read_csv_chunks(test_begin,test_end,chunks);
+	  add_csv_chunks(chunks,true,nlines);
 	  LOG(INFO) << "read " << nlines << " lines from " << _csv_test_fname << std::endl;
 	  csv_test_file.close();
 	}
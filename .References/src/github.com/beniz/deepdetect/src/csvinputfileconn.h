@@ -27,6 +27,7 @@
 #include <fstream>
 #include <unordered_set>
 #include <algorithm>
+#include <exception>
 #include <random>
 
 namespace dd
@@ -62,6 +63,30 @@ namespace dd
     std::vector<double> _v; /**< csv line data */
   };
 
+  /**
+   * \brief rows parsed from a chunk of a CSV file, stored one after the other
+   *        in a single contiguous buffer
+   */
+  class CSVChunk
+  {
+  public:
+    CSVChunk() {}
+    ~CSVChunk() {}
+
+    size_t size() const
+    {
+      return _offsets.size() - 1;
+    }
+
+    const char *_begin = nullptr; /**< chunk start in the CSV file. */
+    const char *_end = nullptr; /**< chunk end in the CSV file. */
+    int _first_line = 0; /**< number of data lines before the chunk. */
+    std::vector<double> _vals; /**< values of all rows. */
+    std::vector<size_t> _offsets = {0}; /**< start of each row in _vals, plus the end of the last row. */
+    std::vector<std::string> _ids; /**< row ids, when an id column is set. */
+    std::exception_ptr _error; /**< parsing error, if any. */
+  };
+  
   class CCategorical
   {
   public:
@@ -203,9 +228,15 @@ namespace dd
     }
     
     void scale_vals(std::vector<double> &vals)
+    {
+      scale_vals(vals.data(),vals.size());
+    }
+    
+    void scale_vals(double *vals,
+		    const int &size)
     {
       auto lit = _columns.begin();
-      for (int j=0;j<(int)vals.size();j++)
+      for (int j=0;j<size;j++)
 	{
 	  bool j_is_id = (_columns.empty() || _id.empty()) ? false : (*lit) == _id;
 	  if (j_is_id)
@@ -228,7 +259,7 @@ namespace dd
 	      continue;
 	    }
 	  
-	  vals.at(j) = (vals.at(j) - _min_vals.at(j)) / (_max_vals.at(j) - _min_vals.at(j));
+	  vals[j] = (vals[j] - _min_vals.at(j)) / (_max_vals.at(j) - _min_vals.at(j));
 	  ++lit;
 	}
     }
@@ -409,12 +440,60 @@ namespace dd
     }
 
     void read_header(std::string &hline);
-      
+
+    /**
+     * \brief column names and categorical mappings, in header order
+     */
+    typedef std::vector<std::pair<std::string,const CCategorical*>> ColumnLookup;
+
+    /**
+     * \brief resolves columns once so that categoricals are not looked up by name for every value
+     */
+    ColumnLookup column_lookup() const;
+    
     void read_csv_line(const std::string &hline,
 		       const std::string &delim,
 		       std::vector<double> &vals,
 		       std::string &column_id,
 		       int &nlines);
+
+    /**
+     * \brief parses one line, in place
+     * @param begin line start
+     * @param end line end, without the line feed
+     * @param delim column delimiter
+     * @param columns column lookup from column_lookup
+     * @param vals parsed values, appended
+     * @param column_id line id, if any
+     * @param nlines line number, for errors
+     */
+    void read_csv_line(const char *begin,
+		       const char *end,
+		       const char &delim,
+		       const ColumnLookup &columns,
+		       std::vector<double> &vals,
+		       std::string &column_id,
+		       const int &nlines) const;
+
+    /**
+     * \brief parses memory-mapped CSV data in parallel chunks
+     * @param begin data start, after the header
+     * @param end data end
+     * @param chunks parsed rows, in file order
+     */
+    void read_csv_chunks(const char *begin,
+			 const char *end,
+			 std::vector<CSVChunk> &chunks) const;
+
+    /**
+     * \brief scales parsed rows and adds them to the train or test set, in file order
+     * @param chunks parsed rows, released as they are added
+     * @param test whether to add rows to the test set
+     * @param nlines number of lines read so far
+     */
+    void add_csv_chunks(std::vector<CSVChunk> &chunks,
+			const bool &test,
+			int &nlines);
     
     void read_csv(const APIData &ad,
 		  const std::string &fname);
@@ -28,6 +28,7 @@
 #include <opencv2/highgui/highgui.hpp>
 #include "ext/base64/base64.h"
 #include <glog/logging.h>
+#include <chrono>
 #include <random>
 
 namespace dd
@@ -71,30 +72,23 @@ namespace dd
       else return false;
     }
 
-    // decode image
-    void decode(const std::string &str)
-      {
-	std::vector<unsigned char> vdat(str.begin(),str.end());
-	cv::Mat img = cv::Mat(cv::imdecode(cv::Mat(vdat,true),_bw ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR));
-	_imgs_size.push_back(std::pair<int,int>(img.rows,img.cols));
-	cv::Size size(_width,_height);
-	cv::Mat rimg;
-	cv::resize(img,rimg,size,0,0,CV_INTER_CUBIC);
-	_imgs.push_back(rimg);
-      }
+    // resize to the net input size, keeping the original size
+    void resize(const cv::Mat &img,
+		cv::Mat &rimg,
+		std::pair<int,int> &img_size) const
+    {
+      img_size = std::pair<int,int>(img.rows,img.cols);
+      cv::resize(img,rimg,cv::Size(_width,_height),0,0,_interp);
+    }
     
-    // deserialize image, independent of format
-    void deserialize(std::stringstream &input)
+    // decode image, in place from the encoded bytes
+    void decode(const std::string &str)
       {
-	size_t size = 0;
-	input.seekg(0,input.end);
-	size = input.tellg();
-	input.seekg(0,input.beg);
-	char* data = new char[size];
-	input.read(data, size);
-	std::string str(data,data+size);
-	delete[]data;
-	decode(str);
+	cv::Mat vdat(1,str.size(),CV_8UC1,const_cast<char*>(str.data()));
+	cv::Mat img = cv::imdecode(vdat,_bw ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR);
+	_imgs_size.emplace_back();
+	_imgs.emplace_back();
+	resize(img,_imgs.back(),_imgs_size.back());
       }
     
     // data acquisition
@@ -106,11 +100,9 @@ namespace dd
 	  LOG(ERROR) << "empty image";
 	  return -1;
 	}
-      _imgs_size.push_back(std::pair<int,int>(img.rows,img.cols));
-      cv::Size size(_width,_height);
-      cv::Mat rimg;
-      cv::resize(img,rimg,size,0,0,CV_INTER_CUBIC);
-      _imgs.push_back(rimg);
+      _imgs_size.emplace_back();
+      _imgs.emplace_back();
+      resize(img,_imgs.back(),_imgs_size.back());
       return 0;
     }
 
@@ -128,9 +120,7 @@ namespace dd
 	{
 	  std::string ccontent;
 	  Base64::Decode(content,&ccontent);
-	  std::stringstream sstr;
-	  sstr << ccontent;
-	  deserialize(sstr);
+	  decode(ccontent);
 	}
       else
 	{
@@ -183,24 +173,34 @@ namespace dd
 	    }
 	}
       
-      // read images
-      cv::Size size(_width,_height);
-      _imgs.reserve(lfiles.size());
+      // read images, each into its own slot so that order is kept
+      size_t nimgs = _imgs.size();
+      _imgs.resize(nimgs + lfiles.size());
+      _imgs_size.resize(nimgs + lfiles.size());
       _img_files.reserve(lfiles.size());
       _labels.reserve(lfiles.size());
+      int read_errors = 0;
+#pragma omp parallel for reduction(+:read_errors)
+      for (size_t i=0;i<lfiles.size();i++)
+	{
+	  cv::Mat img = cv::imread(lfiles.at(i).first,_bw ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR);
+	  if (img.empty())
+	    {
+	      LOG(ERROR) << "empty image " << lfiles.at(i).first;
+	      ++read_errors; // exceptions can't leave the parallel loop
+	      continue;
+	    }
+	  resize(img,_imgs.at(nimgs+i),_imgs_size.at(nimgs+i));
+	}
+      if (read_errors)
+	throw InputConnectorBadParamException("failed reading " + std::to_string(read_errors) + " images in " + dir);
       for (std::pair<std::string,int> &p: lfiles)
 	{
-	  cv::Mat img = cv::imread(p.first,_bw ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR);
-	  _imgs_size.push_back(std::pair<int,int>(img.rows,img.cols));
-	  cv::Mat rimg;
-	  cv::resize(img,rimg,size,0,0,CV_INTER_CUBIC);
-	  _imgs.push_back(rimg);
 	  _img_files.push_back(p.first);
 	  if (p.second >= 0)
 	    _labels.push_back(p.second);
-	  if (_imgs.size() % 1000 == 0)
-	    LOG(INFO) << "read " << _imgs.size() << " images\n";
 	}
+      LOG(INFO) << "read " << lfiles.size() << " images\n";
       return 0;
     }
     
@@ -212,6 +212,7 @@ namespace dd
     std::vector<int> _labels;
     int _width = 224;
     int _height = 224;
+    int _interp = cv::INTER_CUBIC; /**< resize interpolation. */
     std::string _db_fname;
   };
   
@@ -221,7 +222,7 @@ namespace dd
   ImgInputFileConn()
     :InputConnectorStrategy(){}
     ImgInputFileConn(const ImgInputFileConn &i)
-      :InputConnectorStrategy(i),_width(i._width),_height(i._height),_bw(i._bw),_mean(i._mean),_has_mean_scalar(i._has_mean_scalar) {}
+      :InputConnectorStrategy(i),_width(i._width),_height(i._height),_bw(i._bw),_mean(i._mean),_has_mean_scalar(i._has_mean_scalar),_interp(i._interp) {}
     ~ImgInputFileConn() {}
 
     void init(const APIData &ad)
@@ -238,6 +239,8 @@ namespace dd
 	_height = ad.get("height").get<int>();
       if (ad.has("bw"))
 	_bw = ad.get("bw").get<bool>();
+      if (ad.has("interp"))
+	_interp = get_interp(ad.get("interp").get<std::string>());
       if (ad.has("shuffle"))
 	_shuffle = ad.get("shuffle").get<bool>();
       if (ad.has("seed"))
@@ -264,6 +267,26 @@ namespace dd
 	}
     }
     
+    /**
+     * \brief resize interpolation from its name, cheaper than cubic are linear, nearest and area
+     * @param interp interpolation name
+     * @return OpenCV interpolation flag
+     */
+    static int get_interp(const std::string &interp)
+    {
+      if (interp == "cubic")
+	return cv::INTER_CUBIC;
+      else if (interp == "linear")
+	return cv::INTER_LINEAR;
+      else if (interp == "nearest")
+	return cv::INTER_NEAREST;
+      else if (interp == "area")
+	return cv::INTER_AREA;
+      else if (interp == "lanczos4")
+	return cv::INTER_LANCZOS4;
+      throw InputConnectorBadParamException("unknown interpolation " + interp);
+    }
+    
     int feature_size() const
     {
       if (_bw) return _width*_height;
@@ -292,6 +315,7 @@ namespace dd
 	      fillup_parameters(ad_param.getobj("input"));
 	    }
 	}
+      std::chrono::time_point<std::chrono::system_clock> tstart = std::chrono::system_clock::now();
       int catch_read = 0;
       std::string catch_msg;
       std::vector<std::string> uris;
@@ -304,6 +328,7 @@ namespace dd
 	  dimg._ctype._bw = _bw;
 	  dimg._ctype._width = _width;
 	  dimg._ctype._height = _height;
+	  dimg._ctype._interp = _interp;
 	  try
 	    {
 	      if (dimg.read_element(u))
@@ -351,6 +376,7 @@ namespace dd
 	}
       if (catch_read)
 	throw InputConnectorBadParamException(catch_msg);
+      _decode_time = std::chrono::duration<double,std::milli>(std::chrono::system_clock::now()-tstart).count();
       _uris = uris;
       if (!_db_fname.empty())
 	return; // db filename is passed to backend
@@ -393,6 +419,15 @@ namespace dd
 	throw InputConnectorBadParamException("no image could be found");
     }
 
+    /**
+     * \brief per-stage latencies of the last transform, in milliseconds
+     * @param out output data object
+     */
+    void timings(APIData &out) const
+    {
+      out.add("decode",_decode_time);
+    }
+
     // data
     std::vector<cv::Mat> _images;
     std::vector<cv::Mat> _test_images;
@@ -407,7 +442,9 @@ namespace dd
     int _seed = -1; /**< shuffling seed. */
     cv::Scalar _mean; /**< mean image pixels, to be subtracted from images. */
     bool _has_mean_scalar = false; /**< whether scalar is set. */
+    int _interp = cv::INTER_CUBIC; /**< resize interpolation, cubic by default. */
     std::string _db_fname;
+    double _decode_time = 0.0; /**< time spent fetching, decoding and resizing images, in milliseconds. */
   };
 }
 
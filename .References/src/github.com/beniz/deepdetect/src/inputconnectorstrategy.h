@@ -173,6 +173,16 @@ namespace dd
     {
       (void)out;
     }
+
+    /**
+     * \brief per-stage latencies of the last transform, in milliseconds,
+     *        returned to user along with predictions
+     * @param out output data object
+     */
+    void timings(APIData &out) const
+    {
+      (void)out;
+    }
     
     bool _train = false; /**< whether in train or predict mode. */
     std::vector<std::string> _uris;
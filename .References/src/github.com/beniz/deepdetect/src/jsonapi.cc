@@ -560,6 +560,8 @@ namespace dd
     jhead.AddMember("service",d["service"],jpred.GetAllocator());
     if (!has_measure)
       jhead.AddMember("time",jout["time"],jpred.GetAllocator());
+    if (jout.HasMember("timings"))
+      jhead.AddMember("timings",jout["timings"],jpred.GetAllocator());
     jpred.AddMember("head",jhead,jpred.GetAllocator());
     if (has_measure)
       {
@@ -0,0 +1,164 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2017 Emmanuel Benazera
+ * Author: Emmanuel Benazera <beniz@droidnik.fr>
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef NETPOOL_H
+#define NETPOOL_H
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace dd
+{
+  /**
+   * \brief pool of predict-only net replicas, owned by the pool except for an optional
+   *        borrowed one, e.g. the owner's main net used as the first replica.
+   *        Free replicas are kept in a mutex-guarded list, callers block on a condition
+   *        variable when all replicas are in use. Checkouts may run concurrently with
+   *        reset and clear: clear waits for checked out replicas to be returned and
+   *        checkouts that come after it get no replica.
+   */
+  template <class TNet>
+    class NetPool
+    {
+    public:
+    /**
+     * \brief replica checked out until destruction
+     */
+    class Lease
+    {
+    public:
+      Lease(NetPool &pool)
+	:_pool(pool),_net(pool.checkout()) {}
+      ~Lease()
+	{
+	  if (_net)
+	    _pool.checkin(_net);
+	}
+      Lease(const Lease&) = delete;
+      Lease& operator=(const Lease&) = delete;
+
+      TNet* get() const { return _net; } /**< nullptr if the pool was empty. */
+
+    private:
+      NetPool &_pool;
+      TNet *_net = nullptr;
+    };
+
+    static const int max_nets = 256; /**< maximum number of replicas. */
+
+    NetPool() {}
+
+    ~NetPool()
+      {
+	clear();
+      }
+
+    /**
+     * \brief replaces replicas, waits for the checked out ones to be returned
+     * @param nets new replicas, ownership is transfered to the pool
+     * @param borrowed additional replica that remains owned by the caller, if any
+     */
+    void reset(const std::vector<TNet*> &nets,
+	       TNet *borrowed=nullptr)
+    {
+      clear();
+      {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_nets = nets;
+	_borrowed = borrowed;
+	if (_borrowed)
+	  _nets.push_back(_borrowed);
+	_free = _nets;
+      }
+      _cv.notify_all();
+    }
+
+    /**
+     * \brief deletes all owned replicas, waits for the checked out ones to be returned
+     */
+    void clear()
+    {
+      {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cv.wait(lock,[this]{ return _out == 0; });
+	for (TNet *n: _nets)
+	  if (n != _borrowed)
+	    delete n;
+	_nets.clear();
+	_free.clear();
+	_borrowed = nullptr;
+      }
+      // checkouts waiting for a free replica get none
+      _cv.notify_all();
+    }
+
+    /**
+     * \brief number of replicas
+     */
+    size_t size() const
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _nets.size();
+    }
+
+    /**
+     * \brief takes a free replica, waits if all are in use
+     * @return replica, to be returned with checkin, or nullptr if the pool is empty
+     */
+    TNet* checkout()
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _cv.wait(lock,[this]{ return !_free.empty() || _nets.empty(); });
+      if (_nets.empty())
+	return nullptr;
+      // checked out replicas hold off clear until they are returned
+      TNet *net = _free.back();
+      _free.pop_back();
+      ++_out;
+      return net;
+    }
+
+    /**
+     * \brief returns a replica to the pool
+     * @param net replica from checkout
+     */
+    void checkin(TNet *net)
+    {
+      {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_free.push_back(net);
+	--_out;
+      }
+      _cv.notify_all();
+    }
+
+    private:
+    std::vector<TNet*> _free; /**< replicas ready for use. */
+    std::vector<TNet*> _nets; /**< all replicas. */
+    TNet *_borrowed = nullptr; /**< replica not owned by the pool, if any. */
+    int _out = 0; /**< number of checked out replicas. */
+    mutable std::mutex _mutex; /**< guards replicas and the checked out count. */
+    std::condition_variable _cv; /**< signals free replicas, returns and clears. */
+  };
+}
+
+#endif
@@ -0,0 +1,217 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2017 Emmanuel Benazera
+ * Author: Emmanuel Benazera <beniz@droidnik.fr>
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PREDICTBATCHER_H
+#define PREDICTBATCHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace dd
+{
+  /**
+   * \brief coalesces concurrent predict calls into single forward passes.
+   *        A caller that finds a free leader slot becomes a leader: it waits
+   *        for other callers until the batch is full or the latency budget expires,
+   *        runs one forward pass over all queued samples and scatters the outputs
+   *        back to every caller. No extra thread is involved. Several leaders
+   *        can run forward passes at once, e.g. one per net replica.
+   */
+  template <class TDatum>
+    class PredictBatcher
+    {
+    public:
+    /**
+     * \brief samples of a single caller and their outputs
+     */
+    class Request
+    {
+    public:
+      Request(std::vector<TDatum> &&dv)
+	:_dv(std::move(dv)) {}
+
+      std::vector<TDatum> _dv; /**< input samples, consumed by the forward pass. */
+      std::vector<float> _out; /**< outputs of the samples, row-major. */
+      int _out_size = 0; /**< number of outputs per sample. */
+      float _loss = 0.0; /**< loss of the forward pass the samples were part of. */
+      std::exception_ptr _error; /**< forward pass error, if any. */
+      bool _done = false;
+    };
+
+    /**
+     * \brief forward pass over a batch: fills up row-major outputs, number of outputs per sample and loss
+     */
+    typedef std::function<void(std::vector<TDatum>&,std::vector<float>&,int&,float&)> ForwardFunc;
+
+    PredictBatcher() {}
+    ~PredictBatcher() {}
+
+    /**
+     * \brief sets up batching
+     * @param max_batch_size maximum number of samples in a forward pass, batching is off below 2
+     * @param timeout_ms maximum time the leader waits for other callers, in milliseconds
+     * @param max_leaders maximum number of concurrent forward passes
+     */
+    void configure(const int &max_batch_size,
+		   const int &timeout_ms,
+		   const int &max_leaders=1)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _max_batch_size = max_batch_size;
+      _timeout = std::chrono::milliseconds(timeout_ms);
+      _max_leaders = std::max(1,max_leaders);
+    }
+
+    bool enabled() const
+    {
+      return _max_batch_size > 1;
+    }
+
+    int max_batch_size() const
+    {
+      return _max_batch_size;
+    }
+
+    int timeout() const
+    {
+      return _timeout.count();
+    }
+
+    int max_leaders() const
+    {
+      return _max_leaders;
+    }
+
+    /**
+     * \brief queues the request and returns once its outputs are filled up
+     * @param req the request, with at most max_batch_size samples
+     * @param forward the forward pass, called by one caller at a time
+     */
+    void run(Request &req,
+	     const ForwardFunc &forward)
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _queue.push_back(&req);
+      _cv.notify_all();
+      while(!req._done)
+	{
+	  if (_leaders >= _max_leaders || _queue.empty())
+	    {
+	      _cv.wait(lock);
+	      continue;
+	    }
+	  ++_leaders;
+	  _cv.wait_for(lock,_timeout,[this]{ return queued_samples() >= _max_batch_size; });
+
+	  // another leader may have taken the queued requests, including ours, meanwhile
+	  if (_queue.empty() || req._done)
+	    {
+	      --_leaders;
+	      _cv.notify_all();
+	      continue;
+	    }
+
+	  // take requests in arrival order, at least one
+	  std::vector<Request*> batch;
+	  int nsamples = 0;
+	  while(!_queue.empty())
+	    {
+	      Request *r = _queue.front();
+	      if (!batch.empty() && nsamples + static_cast<int>(r->_dv.size()) > _max_batch_size)
+		break;
+	      batch.push_back(r);
+	      nsamples += r->_dv.size();
+	      _queue.pop_front();
+	    }
+	  lock.unlock();
+
+	  std::vector<TDatum> dv;
+	  std::vector<int> sizes;
+	  dv.reserve(nsamples);
+	  for (Request *r: batch)
+	    {
+	      sizes.push_back(r->_dv.size());
+	      std::move(r->_dv.begin(),r->_dv.end(),std::back_inserter(dv));
+	      r->_dv.clear();
+	    }
+	  std::vector<float> out;
+	  int out_size = 0;
+	  float loss = 0.0;
+	  std::exception_ptr error;
+	  try
+	    {
+	      forward(dv,out,out_size,loss);
+	    }
+	  catch(...)
+	    {
+	      error = std::current_exception();
+	    }
+
+	  lock.lock();
+	  int offset = 0;
+	  for (size_t i=0;i<batch.size();i++)
+	    {
+	      Request *r = batch.at(i);
+	      r->_error = error;
+	      if (!error)
+		{
+		  r->_out.assign(out.begin()+offset*out_size,out.begin()+(offset+sizes.at(i))*out_size);
+		  r->_out_size = out_size;
+		  r->_loss = loss;
+		}
+	      offset += sizes.at(i);
+	      r->_done = true;
+	    }
+	  --_leaders;
+	  _cv.notify_all();
+	}
+      lock.unlock();
+      if (req._error)
+	std::rethrow_exception(req._error);
+    }
+
+    private:
+    int queued_samples() const
+    {
+      int n = 0;
+      for (const Request *r: _queue)
+	n += r->_dv.size();
+      return n;
+    }
+
+    std::mutex _mutex; /**< mutex around queue and leaders count. */
+    std::condition_variable _cv;
+    std::deque<Request*> _queue; /**< requests waiting for a forward pass. */
+    int _leaders = 0; /**< number of callers collecting or running a batch. */
+    int _max_leaders = 1;
+    int _max_batch_size = 0;
+    std::chrono::milliseconds _timeout = std::chrono::milliseconds(0);
+  };
+}
+
+#endif
@@ -23,6 +23,8 @@
 #include "tflib.h"
 #include "imginputfileconn.h"
 #include "outputconnectorstrategy.h"
+#include "utils/fileops.hpp"
+#include <cstring>
 
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/platform/env.h"
@@ -32,6 +34,7 @@
 
 namespace dd
 {
+  static const int graph_check_interval = 10; /**< seconds between checks of the model graph for changes. */
 
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
   TFLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::TFLib(const TFModel &cmodel)
@@ -50,6 +53,8 @@ namespace dd
     _ntargets = cl._ntargets;
     _inputLayer = cl._inputLayer;
     _outputLayer = cl._outputLayer;
+    _inputLayerFromGraph = cl._inputLayerFromGraph;
+    _outputLayerFromGraph = cl._outputLayerFromGraph;
     _inputFlag = cl._inputFlag;
   }
 
@@ -131,6 +136,119 @@ namespace dd
 	throw MLLibInternalException(concat_run_status.ToString());
       }
   }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  tensorflow::Tensor TFLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::batch_input(const std::vector<tensorflow::Tensor> &dv)
+  {
+    if (dv.size() == 1)
+      return dv.at(0);
+    tensorflow::TensorShape shape = dv.at(0).shape();
+    for (const tensorflow::Tensor &t: dv)
+      if (t.dtype() != tensorflow::DT_FLOAT || t.dims() == 0 || t.dim_size(0) != 1 || !t.shape().IsSameSize(shape))
+	{
+	  std::vector<tensorflow::Tensor> vtfinputs;
+	  tf_concat(dv,vtfinputs);
+	  return vtfinputs.at(0);
+	}
+    
+    // samples are copied into a pooled tensor instead of running a concat graph.
+    // Tensors passed to Session::Run are not held after it returns, and outputs are
+    // consumed before the next batch, so the pooled buffer can be overwritten.
+    shape.set_dim(0,dv.size());
+    tensorflow::Tensor &input = _input_pool[dv.size()];
+    if (!input.shape().IsSameSize(shape))
+      input = tensorflow::Tensor(tensorflow::DT_FLOAT,shape);
+    float *data = input.flat<float>().data();
+    for (const tensorflow::Tensor &t: dv)
+      {
+	std::memcpy(data,t.flat<float>().data(),t.NumElements()*sizeof(float));
+	data += t.NumElements();
+      }
+    return input;
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void TFLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::create_session()
+  {
+    std::string graphFile = this->_mlmodel._graphName;
+    if (graphFile.empty())
+      throw MLLibBadParamException("No pre-trained model found in model repository");
+
+    // predict calls don't stat the graph file, it is only checked for changes every few seconds
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (_session && graphFile == _graph_file
+	&& now - _graph_check < std::chrono::seconds(graph_check_interval))
+      return;
+    _graph_check = now;
+    long int graph_modif = fileops::file_last_modif(graphFile);
+    if (_session && graphFile == _graph_file && graph_modif == _graph_modif)
+      return;
+    if (_session)
+      {
+	LOG(INFO) << "model graph has changed, re-creating session";
+	_session->Close();
+	_session.reset();
+      }
+    _input_pool.clear();
+
+    // layers taken from the previous graph may not exist in the new one
+    if (_inputLayerFromGraph)
+      {
+	_inputLayer.clear();
+	_inputLayerFromGraph = false;
+      }
+    if (_outputLayerFromGraph)
+      {
+	_outputLayer.clear();
+	_outputLayerFromGraph = false;
+      }
+    
+    tensorflow::GraphDef graph_def;
+    LOG(INFO) << "using graphFile dir=" << graphFile;
+    // Loading the graph to the given variable
+    tensorflow::Status graphLoadedStatus = ReadBinaryProto(tensorflow::Env::Default(),graphFile,&graph_def);
+    
+    if (!graphLoadedStatus.ok())
+      {
+	LOG(ERROR) << "failed loading tensorflow graph with status=" << graphLoadedStatus.ToString() << std::endl;
+	throw MLLibBadParamException("failed loading tensorflow graph with status=" + graphLoadedStatus.ToString());
+      }
+
+    /*for (int l=0;l<graph_def.node_size();l++)
+      {
+	std::cerr << graph_def.node(l).name() << std::endl;
+	}*/
+    
+    if (_inputLayer.empty())
+      {
+	_inputLayer = graph_def.node(0).name();
+	_inputLayerFromGraph = true;
+	LOG(INFO) << "using input layer=" << _inputLayer << std::endl;
+      }
+    if (_outputLayer.empty())
+      {
+	_outputLayer = graph_def.node(graph_def.node_size()-1).name();
+	_outputLayerFromGraph = true;
+	LOG(INFO) << "using output layer=" << _outputLayer << std::endl;
+      }
+    //tensorflow::graph::SetDefaultDevice(device, &graph_def);
+    
+    // creating a session with the graph
+    tensorflow::SessionOptions options;
+    tensorflow::ConfigProto &config = options.config;
+    config.mutable_gpu_options()->set_allow_growth(true); // default is we prevent tf from holding all memory across all GPUs
+    _session = std::unique_ptr<tensorflow::Session>(tensorflow::NewSession(options));
+    tensorflow::Status session_create_status = _session->Create(graph_def);
+    
+    if (!session_create_status.ok())
+      {
+	std::cout << session_create_status.ToString()<<std::endl;
+	_session = nullptr;
+	throw MLLibInternalException(session_create_status.ToString());
+      }
+    _graph_file = graphFile;
+    _graph_modif = graph_modif;
+  }
   
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
   int TFLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::train(const APIData &ad,
@@ -173,44 +291,8 @@ namespace dd
 	batch_size = ad_mllib.get("test_batch_size").get<int>();
       }
 
-    tensorflow::GraphDef graph_def;
-    std::string graphFile = this->_mlmodel._graphName;
-    if (graphFile.empty())
-      throw MLLibBadParamException("No pre-trained model found in model repository");
-    LOG(INFO) << "test: using graphFile dir=" << graphFile;
-    // Loading the graph to the given variable
-    tensorflow::Status graphLoadedStatus = ReadBinaryProto(tensorflow::Env::Default(),graphFile,&graph_def);
-    
-    if (!graphLoadedStatus.ok())
-      {
-	LOG(ERROR) << "failed loading tensorflow graph with status=" << graphLoadedStatus.ToString() << std::endl;
-	throw MLLibBadParamException("failed loading tensorflow graph with status=" + graphLoadedStatus.ToString());
-      }
-    std::string inputLayer = _inputLayer;
-    std::string outputLayer = _outputLayer;
-    if (inputLayer.empty())
-      {
-	inputLayer = graph_def.node(0).name();
-	LOG(INFO) << "testing: using input layer=" << inputLayer << std::endl;
-      }
-    if (outputLayer.empty())
-      {
-	outputLayer = graph_def.node(graph_def.node_size()-1).name();
-	LOG(INFO) << "testing: using output layer=" << outputLayer << std::endl;
-      }
-    
-    // creating a session with the graph
-    tensorflow::SessionOptions options;
-    tensorflow::ConfigProto &config = options.config;
-    config.mutable_gpu_options()->set_allow_growth(true); // default is we prevent tf from holding all memory across all GPUs
-    auto session = std::unique_ptr<tensorflow::Session>(tensorflow::NewSession(options));
-    tensorflow::Status session_create_status = session->Create(graph_def);
-    
-    if (!session_create_status.ok())
-      {
-	std::cout << session_create_status.ToString()<<std::endl;
-	throw MLLibInternalException(session_create_status.ToString());
-      }
+    // the session is shared with predict calls, test is called under the net lock
+    create_session();
     
     // vector for storing  the outputAPI of the file 
     APIData ad_res;
@@ -225,14 +307,11 @@ namespace dd
 	std::vector<tensorflow::Tensor> dv = inputc.get_dv(batch_size);
 	if (dv.empty())
 	  break;
-	std::vector<tensorflow::Tensor> vtfinputs;
-	if (dv.size() > 1)
-	  tf_concat(dv,vtfinputs);
-	else vtfinputs = dv;
+	tensorflow::Tensor input = batch_input(dv);
 	
 	// running the loded graph and saving the generated output 
 	std::vector<tensorflow::Tensor> finalOutput; // To save the final Output generated by the tensorflow
-	tensorflow::Status run_status  = session->Run({{inputLayer,*(vtfinputs.begin())}},{outputLayer},{},&finalOutput);
+	tensorflow::Status run_status  = _session->Run({{_inputLayer,input}},{_outputLayer},{},&finalOutput);
 	if (!run_status.ok())
 	  {
 	    std::cout << run_status.ToString() << std::endl;
@@ -303,60 +382,13 @@ namespace dd
     if (ad_mllib.has("test_batch_size"))
       batch_size = ad_mllib.get("test_batch_size").get<int>();
 
+    create_session();
+    
+    // the extract layer only applies to this call
     std::string extract_layer;
     if (ad_mllib.has("extract_layer") && !ad_mllib.get("extract_layer").get<std::string>().empty())
-      {
-       	_outputLayer = ad_mllib.get("extract_layer").get<std::string>();
-	extract_layer = _outputLayer;
-      }
-      
-    if (!_session)
-      {
-	tensorflow::GraphDef graph_def;
-	std::string graphFile = this->_mlmodel._graphName;
-	if (graphFile.empty())
-	  throw MLLibBadParamException("No pre-trained model found in model repository");
-	LOG(INFO) << "predict: using graphFile dir=" << graphFile;
-	// Loading the graph to the given variable
-	tensorflow::Status graphLoadedStatus = ReadBinaryProto(tensorflow::Env::Default(),graphFile,&graph_def);
-	
-	if (!graphLoadedStatus.ok())
-	  {
-	    LOG(ERROR) << "failed loading tensorflow graph with status=" << graphLoadedStatus.ToString() << std::endl;
-	    throw MLLibBadParamException("failed loading tensorflow graph with status=" + graphLoadedStatus.ToString());
-	  }
-
-	/*for (int l=0;l<graph_def.node_size();l++)
-	  {
-	    std::cerr << graph_def.node(l).name() << std::endl;
-	    }*/
-	
-	if (_inputLayer.empty())
-	  {
-	    _inputLayer = graph_def.node(0).name();
-	    LOG(INFO) << "using input layer=" << _inputLayer << std::endl;
-	  }
-	if (_outputLayer.empty())
-	  {
-	    _outputLayer = graph_def.node(graph_def.node_size()-1).name();
-	    LOG(INFO) << "using output layer=" << _outputLayer << std::endl;
-	  }
-	//tensorflow::graph::SetDefaultDevice(device, &graph_def);
-	
-	// creating a session with the graph
-	tensorflow::SessionOptions options;
-	tensorflow::ConfigProto &config = options.config;
-	config.mutable_gpu_options()->set_allow_growth(true); // default is we prevent tf from holding all memory across all GPUs
-	_session = std::unique_ptr<tensorflow::Session>(tensorflow::NewSession(options));
-	tensorflow::Status session_create_status = _session->Create(graph_def);
-	
-	if (!session_create_status.ok())
-	  {
-	    std::cout << session_create_status.ToString()<<std::endl;
-	    _session = nullptr;
-	    throw MLLibInternalException(session_create_status.ToString());
-	  }
-      }
+      extract_layer = ad_mllib.get("extract_layer").get<std::string>();
+    std::string outputLayer = extract_layer.empty() ? _outputLayer : extract_layer;
     
     // vector for storing  the outputAPI of the file 
     std::vector<APIData> vrad;
@@ -367,10 +399,7 @@ namespace dd
 	std::vector<tensorflow::Tensor> dv = inputc.get_dv(batch_size);
 	if (dv.empty())
 	  break;
-	std::vector<tensorflow::Tensor> vtfinputs;
-	if (dv.size() > 1)
-	  tf_concat(dv,vtfinputs);
-	else vtfinputs = dv;
+	tensorflow::Tensor input = batch_input(dv);
 	
 	// other input variables
 	std::pair<std::string,tensorflow::Tensor> othertfinputs;
@@ -391,8 +420,8 @@ namespace dd
 	std::vector<tensorflow::Tensor> finalOutput; // To save the final output generated by the tensorflow
 	tensorflow::Status run_status;
 	if (has_input_vars)
-	  run_status = _session->Run({{_inputLayer,*(vtfinputs.begin())},othertfinputs},{_outputLayer},{},&finalOutput);
-	else run_status = _session->Run({{_inputLayer,*(vtfinputs.begin())}},{_outputLayer},{},&finalOutput);
+	  run_status = _session->Run({{_inputLayer,input},othertfinputs},{outputLayer},{},&finalOutput);
+	else run_status = _session->Run({{_inputLayer,input}},{outputLayer},{},&finalOutput);
 	if (!run_status.ok())
 	  {
 	    std::cout <<run_status.ToString()<<std::endl;
@@ -26,6 +26,8 @@
 #include "tfmodel.h"
 
 # include <string>
+#include <unordered_map>
+#include <chrono>
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -54,6 +56,19 @@ namespace dd
     /*- local functions -*/
     void tf_concat(const std::vector<tensorflow::Tensor> &dv,
 		   std::vector<tensorflow::Tensor> &vtfinputs);
+
+    /**
+     * \brief gathers single samples into a batch input, reusing pooled tensors
+     * @param dv samples, with a first dimension of 1
+     * @return batch input tensor
+     */
+    tensorflow::Tensor batch_input(const std::vector<tensorflow::Tensor> &dv);
+
+    /**
+     * \brief creates the session once, and again only when the model graph changes,
+     *        the graph file is checked every graph_check_interval seconds
+     */
+    void create_session();
     
 
     public:
@@ -63,8 +78,14 @@ namespace dd
     int _ntargets = 0; /**< number of classification or regression targets. */
     std::string _inputLayer; // input Layer of the model
     std::string _outputLayer; // output layer of the model
+    bool _inputLayerFromGraph = false; // whether the input layer was taken from the session's graph
+    bool _outputLayerFromGraph = false; // whether the output layer was taken from the session's graph
     APIData _inputFlag; // boolean input to the model
     std::unique_ptr<tensorflow::Session> _session = nullptr;
+    std::string _graph_file; /**< graph file the session was created from. */
+    long int _graph_modif = -1; /**< graph file modification time when the session was created. */
+    std::chrono::steady_clock::time_point _graph_check; /**< last check of the graph file for changes. */
+    std::unordered_map<int,tensorflow::Tensor> _input_pool; /**< batch input tensors by batch size, reused across calls. */
     std::mutex _net_mutex; /**< mutex around net, e.g. no concurrent predict calls as net is not re-instantiated. Use batches instead. */
     };
   
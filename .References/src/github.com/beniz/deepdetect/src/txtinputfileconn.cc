@@ -110,70 +110,65 @@ namespace dd
       }
     
     // parse content
-    // XXX: parallelize with openmp -> requires thread safe parse_content
-    for (std::pair<std::string,int> &p: lfiles)
+    if (_ctfc->_characters)
       {
-	std::ifstream txt_file(p.first);
-	if (!txt_file.is_open())
-	  throw InputConnectorBadParamException("cannot open file " + p.first);
-	std::stringstream buffer;
-	buffer << txt_file.rdbuf();
-	std::string ct = buffer.str();
-	_ctfc->parse_content(ct,p.second);
-      }
-
-    // post-processing
-    size_t initial_vocab_size = _ctfc->_vocab.size();
-    if (_ctfc->_train)
-      {
-	auto vhit = _ctfc->_vocab.begin();
-	while(vhit!=_ctfc->_vocab.end())
+	for (std::pair<std::string,int> &p: lfiles)
 	  {
-	    if ((*vhit).second._total_count < _ctfc->_min_count)
-	      vhit = _ctfc->_vocab.erase(vhit);
-	    else ++vhit;
+	    std::ifstream txt_file(p.first);
+	    if (!txt_file.is_open())
+	      throw InputConnectorBadParamException("cannot open file " + p.first);
+	    std::stringstream buffer;
+	    buffer << txt_file.rdbuf();
+	    std::string ct = buffer.str();
+	    _ctfc->parse_content(ct,p.second);
 	  }
       }
-    if (_ctfc->_train && initial_vocab_size != _ctfc->_vocab.size())
-      {
-	// update pos
-	int pos = 0;
-	auto vhit = _ctfc->_vocab.begin();
-	while(vhit!=_ctfc->_vocab.end())
-	  {
-	    (*vhit).second._pos = pos;
-	    ++pos;
-	    ++vhit;
-	  }
-      }
-
-    if (!_ctfc->_characters && (initial_vocab_size != _ctfc->_vocab.size() || _ctfc->_tfidf))
+    else
       {
-	// clearing up the corpus + tfidf
-	std::unordered_map<std::string,Word>::iterator whit;
-	for (TxtEntry<double> *te: _ctfc->_txt)
+	// files are read and tokenized in parallel, by blocks to bound memory,
+	// and words are added to the vocabulary in file order
+	const size_t block_size = 1024;
+	bool vocab_updates = _ctfc->_train && !_ctfc->_hashing;
+	for (size_t b=0;b<lfiles.size();b+=block_size)
 	  {
-	    TxtBowEntry *tbe = static_cast<TxtBowEntry*>(te);
-	    auto hit = tbe->_v.begin();
-	    while(hit!=tbe->_v.end())
+	    size_t nfiles = std::min(block_size,lfiles.size()-b);
+	    std::vector<std::vector<std::vector<std::string>>> docs(nfiles);
+	    std::vector<std::string> errors(nfiles);
+#pragma omp parallel for
+	    for (size_t f=0;f<nfiles;f++)
 	      {
-		if ((whit=_ctfc->_vocab.find((*hit).first))!=_ctfc->_vocab.end())
+		const std::pair<std::string,int> &p = lfiles[b+f];
+		std::ifstream txt_file(p.first);
+		if (!txt_file.is_open())
 		  {
-		    if (_ctfc->_tfidf)
-		      {
-			Word w = (*whit).second;
-			(*hit).second = (std::log(1.0+(*hit).second / static_cast<double>(w._total_count))) * std::log(_ctfc->_txt.size() / static_cast<double>(w._total_docs) + 1.0);
-			//std::cerr << "tfidf feature w=" << (*hit).first << " / val=" << (*hit).second << std::endl;
-		      }
-		    ++hit;
+		    errors[f] = "cannot open file " + p.first;
+		    continue;
 		  }
-		else 
+		std::stringstream buffer;
+		buffer << txt_file.rdbuf();
+		std::string ct = buffer.str();
+		if (!_ctfc->_train && ct.empty())
 		  {
-		    //std::cerr << "removing ws=" << (*hit).first << std::endl;
-		    hit = tbe->_v.erase(hit);
+		    errors[f] = "no text data found";
+		    continue;
 		  }
+		_ctfc->tokenize(ct,docs[f]);
 	      }
+	    for (const std::string &e: errors)
+	      if (!e.empty())
+		throw InputConnectorBadParamException(e);
+
+	    std::vector<std::vector<TxtBowEntry*>> entries(nfiles);
+#pragma omp parallel for if(!vocab_updates)
+	    for (size_t f=0;f<nfiles;f++)
+	      for (const std::vector<std::string> &words: docs[f])
+		entries[f].push_back(_ctfc->bow_entry(words,lfiles[b+f].second));
+	    for (const std::vector<TxtBowEntry*> &fentries: entries)
+	      _ctfc->_txt.insert(_ctfc->_txt.end(),fentries.begin(),fentries.end());
 	  }
+
+	// post-processing
+	_ctfc->prune_vocab();
       }
 
     // write corresp file
@@ -200,6 +195,14 @@ namespace dd
   {
     if (!_train && content.empty())
       throw InputConnectorBadParamException("no text data found");
+    if (!_characters)
+      {
+	std::vector<std::vector<std::string>> docs;
+	tokenize(content,docs);
+	for (const std::vector<std::string> &words: docs)
+	  _txt.push_back(bow_entry(words,target));
+	return;
+      }
     std::vector<std::string> cts;
     if (_sentences)
       {
@@ -212,95 +215,188 @@ namespace dd
       {
 	cts.push_back(content);
       }
-    for (std::string ct: cts)
+    for (std::string ct: cts) // character-level features
       {
 	std::transform(ct.begin(),ct.end(),ct.begin(),::tolower);
-	if (!_characters)
+	if (_seq_forward)
+	  std::reverse(ct.begin(),ct.end());
+	TxtCharEntry *tce = new TxtCharEntry(target);
+	std::unordered_map<uint32_t,int>::const_iterator whit;
+	boost::char_separator<char> sep("\n\t\f\r");
+	boost::tokenizer<boost::char_separator<char>> tokens(ct,sep);
+	int seq = 0;
+	bool prev_space = false;
+	for (std::string w: tokens)
 	  {
-	    TxtBowEntry *tbe = new TxtBowEntry(target);
-	    std::unordered_map<std::string,Word>::iterator vhit;
-	    boost::char_separator<char> sep("\n\t\f\r ,.;:`'!?)(-|><^·&\"\\/{}#$–=+");
-	    boost::tokenizer<boost::char_separator<char>> tokens(ct,sep);
-	    for (std::string w : tokens)
+	    char *str = (char*)w.c_str();
+	    char *str_i = str;
+	    char *end = str+strlen(str)+1;
+	    do
 	      {
-		if (static_cast<int>(w.length()) < _min_word_length)
+		uint32_t c = 0;
+		try
+		  {
+		    c = utf8::next(str_i,end);
+		  }
+		catch(...)
+		  {
+		    LOG(ERROR) << "Invalid UTF-8 character in " << w << std::endl;
+		    c = 0;
+		    ++str_i;
+		  }
+		if (c == 0)
 		  continue;
-		
-		// check and fillup vocab.
-		int pos = -1;
-		if ((vhit=_vocab.find(w))==_vocab.end())
+		if ((whit=_alphabet.find(c))==_alphabet.end())
 		  {
-		    if (_train)
+		    if (!prev_space)
 		      {
-			pos = _vocab.size();
-			_vocab.emplace(std::make_pair(w,Word(pos)));
+			tce->add_char(' ');
+			seq++;
+			prev_space = true;
 		      }
 		  }
-		else
+		else 
 		  {
-		    if (_train)
-		      {
-			(*vhit).second._total_count++;
-			if (!tbe->has_word(w))
-			  (*vhit).second._total_docs++;
-		      }
+		    tce->add_char(c);
+		    seq++;
+		    prev_space = false;
 		  }
-		tbe->add_word(w,1.0,_count);
 	      }
-	    _txt.push_back(tbe);
+	    while(str_i<end && seq < _sequence);
 	  }
-	else // character-level features
+	_txt.push_back(tce);
+	std::cerr << "\rloaded text samples=" << _txt.size();
+      }
+  }
+
+  void TxtInputFileConn::tokenize(const std::string &content,
+				  std::vector<std::vector<std::string>> &docs) const
+  {
+    std::vector<std::string> cts;
+    if (_sentences)
+      {
+	boost::char_separator<char> sep("\n");
+	boost::tokenizer<boost::char_separator<char>> tokens(content,sep);
+	for (std::string s: tokens)
+	  cts.push_back(s);
+      }
+    else
+      {
+	cts.push_back(content);
+      }
+    boost::char_separator<char> sep("\n\t\f\r ,.;:`'!?)(-|><^·&\"\\/{}#$–=+");
+    for (std::string &ct: cts)
+      {
+	std::transform(ct.begin(),ct.end(),ct.begin(),::tolower);
+	std::vector<std::string> words;
+	boost::tokenizer<boost::char_separator<char>> tokens(ct,sep);
+	for (const std::string &w : tokens)
+	  {
+	    if (static_cast<int>(w.length()) < _min_word_length)
+	      continue;
+	    words.push_back(w);
+	  }
+	docs.push_back(std::move(words));
+      }
+  }
+
+  TxtBowEntry* TxtInputFileConn::bow_entry(const std::vector<std::string> &words,
+					   const float &target)
+  {
+    std::vector<int> pos;
+    pos.reserve(words.size());
+    if (_hashing)
+      {
+	for (const std::string &w: words)
+	  pos.push_back(Vocab::hash(w) % _hashing);
+      }
+    else if (_train)
+      {
+	int first_new = _vocab.size(); // words added by this document get ids from there
+	for (const std::string &w: words)
+	  {
+	    std::pair<int,bool> ins = _vocab.insert(w);
+	    if (!ins.second)
+	      _vocab.at(ins.first)._total_count++;
+	    pos.push_back(ins.first);
+	  }
+	TxtBowEntry *tbe = new TxtBowEntry(target);
+	tbe->set_words(pos,_count);
+	for (int id: tbe->_ids)
+	  if (id < first_new)
+	    _vocab.at(id)._total_docs++;
+	return tbe;
+      }
+    else
+      {
+	const Vocab &vocab = _vocab;
+	for (const std::string &w: words)
+	  {
+	    int id = vocab.find(w);
+	    if (id >= 0)
+	      pos.push_back(id);
+	  }
+      }
+    TxtBowEntry *tbe = new TxtBowEntry(target);
+    tbe->set_words(pos,_count);
+    return tbe;
+  }
+
+  void TxtInputFileConn::prune_vocab()
+  {
+    if (_hashing)
+      return;
+
+    // words are kept in id order, so that positions in entries remain sorted
+    std::vector<int> new_ids; // empty when ids are unchanged
+    if (_train)
+      {
+	const Vocab &ovocab = _vocab;
+	Vocab vocab;
+	new_ids.resize(ovocab.size(),-1);
+	for (size_t id=0;id<ovocab.size();id++)
+	  {
+	    const Word &w = ovocab.at(id);
+	    if (w._total_count < _min_count)
+	      continue;
+	    int nid = vocab.insert(ovocab.word(id)).first;
+	    Word &nw = vocab.at(nid);
+	    nw._total_count = w._total_count;
+	    nw._total_docs = w._total_docs;
+	    new_ids[id] = nid;
+	  }
+	if (vocab.size() != _vocab.size())
+	  _vocab = vocab;
+	else new_ids.clear();
+      }
+    if (new_ids.empty() && !_tfidf)
+      return;
+
+    // clearing up the corpus + tfidf
+    const Vocab &cvocab = _vocab;
+    double ndocs = _txt.size();
+#pragma omp parallel for
+    for (size_t t=0;t<_txt.size();t++)
+      {
+	TxtBowEntry *tbe = static_cast<TxtBowEntry*>(_txt[t]);
+	size_t n = 0;
+	for (size_t i=0;i<tbe->_ids.size();i++)
 	  {
-	    if (_seq_forward)
-	      std::reverse(ct.begin(),ct.end());
-	    TxtCharEntry *tce = new TxtCharEntry(target);
-	    std::unordered_map<uint32_t,int>::const_iterator whit;
-	    boost::char_separator<char> sep("\n\t\f\r");
-	    boost::tokenizer<boost::char_separator<char>> tokens(ct,sep);
-	    int seq = 0;
-	    bool prev_space = false;
-	    for (std::string w: tokens)
+	    int id = new_ids.empty() ? tbe->_ids[i] : new_ids[tbe->_ids[i]];
+	    if (id < 0)
+	      continue;
+	    double val = tbe->_vals[i];
+	    if (_tfidf)
 	      {
-		char *str = (char*)w.c_str();
-		char *str_i = str;
-		char *end = str+strlen(str)+1;
-		do
-		{
-		  uint32_t c = 0;
-		  try
-		    {
-		      c = utf8::next(str_i,end);
-		    }
-		  catch(...)
-		    {
-		      LOG(ERROR) << "Invalid UTF-8 character in " << w << std::endl;
-		      c = 0;
-		      ++str_i;
-		    }
-		  if (c == 0)
-		    continue;
-		  if ((whit=_alphabet.find(c))==_alphabet.end())
-		    {
-		      if (!prev_space)
-			{
-			  tce->add_char(' ');
-			  seq++;
-			  prev_space = true;
-			}
-		    }
-		  else 
-		    {
-		      tce->add_char(c);
-		      seq++;
-		      prev_space = false;
-		    }
-		}
-		while(str_i<end && seq < _sequence);
+		const Word &w = cvocab.at(id);
+		val = (std::log(1.0+val / static_cast<double>(w._total_count))) * std::log(ndocs / static_cast<double>(w._total_docs) + 1.0);
 	      }
-	    _txt.push_back(tce);
-	    std::cerr << "\rloaded text samples=" << _txt.size();
+	    tbe->_ids[n] = id;
+	    tbe->_vals[n] = val;
+	    ++n;
 	  }
-
+	tbe->_ids.resize(n);
+	tbe->_vals.resize(n);
       }
   }
 
@@ -312,9 +408,10 @@ namespace dd
     out.open(vocabfname);
     if (!out.is_open())
       throw InputConnectorBadParamException("failed opening vocabulary file " + vocabfname);
-    for (auto const &p: _vocab)
+    out << _hashingkey << delim << _hashing << std::endl; // features do not match otherwise
+    for (size_t id=0;id<_vocab.size();id++)
       {
-	out << p.first << delim << p.second._pos << std::endl;
+	out << _vocab.word(id) << delim << id << std::endl;
       }
     out.close();
   }
@@ -333,16 +430,47 @@ namespace dd
     if (!in.is_open())
       throw InputConnectorBadParamException("failed opening vocabulary file " + vocabfname);
     std::string line;
+    std::vector<std::pair<int,std::string>> words;
+    _model_hashing = 0; // files without header come from vocabulary models
+    bool first = true;
     while(getline(in,line))
       {
 	std::vector<std::string> tokens = dd_utils::split(line,',');
+	if (first && tokens.at(0) == _hashingkey)
+	  {
+	    _model_hashing = std::atoi(tokens.at(1).c_str());
+	    first = false;
+	    continue;
+	  }
+	first = false;
 	std::string key = tokens.at(0);
 	int pos = std::atoi(tokens.at(1).c_str());
-	_vocab.emplace(std::make_pair(key,Word(pos)));
+	words.push_back(std::make_pair(pos,key));
+      }
+    // word ids are feature positions
+    std::sort(words.begin(),words.end());
+    _vocab.clear();
+    for (const std::pair<int,std::string> &w: words)
+      {
+	std::pair<int,bool> ins = _vocab.insert(w.second);
+	if (!ins.second || ins.first != w.first)
+	  throw InputConnectorBadParamException("inconsistent word positions in vocabulary file " + vocabfname);
       }
     std::cerr << "loaded vocabulary of size=" << _vocab.size() << std::endl;
   }
 
+  void TxtInputFileConn::restore_hashing(const bool &requested)
+  {
+    if (_model_hashing < 0) // no vocabulary file, e.g. models trained before it held the hashing
+      return;
+    if (!requested)
+      _hashing = _model_hashing;
+    else if (_hashing != _model_hashing)
+      throw InputConnectorBadParamException("hashing=" + std::to_string(_hashing) + " does not match the model, trained with hashing=" + std::to_string(_model_hashing));
+    if (_hashing && _tfidf)
+      throw InputConnectorBadParamException("tfidf requires word statistics, not available with hashing");
+  }
+
   void TxtInputFileConn::build_alphabet()
   {
     _alphabet.clear();
@@ -25,6 +25,8 @@
 #include "inputconnectorstrategy.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <memory>
 #include <random>
 #include "utf8.h"
 
@@ -63,6 +65,148 @@ namespace dd
     int _total_docs = 1;
   };
 
+  /**
+   * \brief interned vocabulary: every word gets a contiguous integer id, that is
+   *        also its feature position, and is found back through an open addressing
+   *        table with linear probing, so that a word is hashed once per lookup.
+   *        Copies share storage until modified, e.g. per-request copies of the
+   *        input connector do not duplicate the vocabulary.
+   */
+  class Vocab
+  {
+  public:
+    Vocab()
+      :_d(std::make_shared<Data>()) {}
+    ~Vocab() {}
+
+    /**
+     * \brief FNV-1a hash of a word, stable across builds and runs
+     */
+    static uint64_t hash(const std::string &w)
+    {
+      uint64_t h = 14695981039346656037ULL;
+      for (const char c: w)
+	{
+	  h ^= static_cast<unsigned char>(c);
+	  h *= 1099511628211ULL;
+	}
+      return h;
+    }
+
+    /**
+     * \brief looks up a word
+     * @return word id, -1 if not in vocabulary
+     */
+    int find(const std::string &w) const
+    {
+      return find(w,hash(w));
+    }
+
+    int find(const std::string &w,
+	     const uint64_t &h) const
+    {
+      const Data &d = *_d;
+      if (d._table.empty())
+	return -1;
+      size_t mask = d._table.size() - 1;
+      for (size_t i=h&mask;;i=(i+1)&mask)
+	{
+	  int id = d._table[i];
+	  if (id < 0)
+	    return -1;
+	  if (d._hashes[id] == h && d._words[id] == w)
+	    return id;
+	}
+    }
+
+    /**
+     * \brief adds a word if not already in vocabulary
+     * @return word id, and whether the word was added
+     */
+    std::pair<int,bool> insert(const std::string &w)
+    {
+      uint64_t h = hash(w);
+      int id = find(w,h);
+      if (id >= 0)
+	return std::make_pair(id,false);
+      detach();
+      Data &d = *_d;
+      id = d._words.size();
+      if (2 * (d._words.size() + 1) > d._table.size())
+	rehash(std::max(static_cast<size_t>(16),2 * d._table.size()));
+      d._words.push_back(w);
+      d._hashes.push_back(h);
+      d._stats.push_back(Word(id));
+      place(id);
+      return std::make_pair(id,true);
+    }
+
+    Word& at(const int &id)
+    {
+      detach();
+      return _d->_stats.at(id);
+    }
+
+    const Word& at(const int &id) const
+    {
+      return _d->_stats.at(id);
+    }
+
+    const std::string& word(const int &id) const
+    {
+      return _d->_words.at(id);
+    }
+
+    size_t size() const
+    {
+      return _d->_words.size();
+    }
+
+    bool empty() const
+    {
+      return _d->_words.empty();
+    }
+
+    void clear()
+    {
+      _d = std::make_shared<Data>();
+    }
+
+  private:
+    void detach()
+    {
+      if (_d.use_count() > 1)
+	_d = std::make_shared<Data>(*_d);
+    }
+
+    void place(const int &id)
+    {
+      Data &d = *_d;
+      size_t mask = d._table.size() - 1;
+      size_t i = d._hashes[id] & mask;
+      while(d._table[i] >= 0)
+	i = (i+1) & mask;
+      d._table[i] = id;
+    }
+
+    void rehash(const size_t &capacity)
+    {
+      _d->_table.assign(capacity,-1);
+      for (size_t id=0;id<_d->_words.size();id++)
+	place(id);
+    }
+
+    class Data
+    {
+    public:
+      std::vector<std::string> _words; /**< words by id. */
+      std::vector<uint64_t> _hashes; /**< word hashes by id. */
+      std::vector<Word> _stats; /**< word stats by id. */
+      std::vector<int> _table; /**< open addressing table of ids, -1 for empty slots, power of two sized. */
+    };
+    std::shared_ptr<Data> _d;
+  };
+
   template<typename T> class TxtEntry
   {
   public:
@@ -79,6 +223,9 @@ namespace dd
     std::string _uri;
   };
   
+  /**
+   * \brief bag of words, as (feature position,value) pairs sorted by position
+   */
   class TxtBowEntry: public TxtEntry<double>
   {
   public:
@@ -86,51 +233,44 @@ namespace dd
   TxtBowEntry(const float &target):TxtEntry<double>(target) {}
     virtual ~TxtBowEntry() {}
 
-    void add_word(const std::string &str,
-		  const double &v,
-		  const bool &count)
+    /**
+     * \brief fills up the entry from word positions, in any order and with repeats
+     * @param pos word positions, sorted in place
+     * @param count whether to add up repeated words, otherwise values are 1
+     */
+    void set_words(std::vector<int> &pos,
+		   const bool &count)
     {
-      std::unordered_map<std::string,double>::iterator hit;
-      if ((hit=_v.find(str))!=_v.end())
+      std::sort(pos.begin(),pos.end());
+      _ids.clear();
+      _vals.clear();
+      for (size_t i=0;i<pos.size();i++)
 	{
-	  if (count)
-	    (*hit).second += v;
+	  if (!_ids.empty() && _ids.back() == pos[i])
+	    {
+	      if (count)
+		_vals.back() += 1.0;
+	    }
+	  else
+	    {
+	      _ids.push_back(pos[i]);
+	      _vals.push_back(1.0);
+	    }
 	}
-      else _v.insert(std::pair<std::string,double>(str,v));
-    }
-
-    bool has_word(const std::string &str)
-    {
-      return _v.count(str);
     }
 
-    void reset()
+    bool has_word(const int &pos) const
     {
-      _vit = _v.begin();
+      return std::binary_search(_ids.begin(),_ids.end(),pos);
     }
 
-    void get_next_elt(std::string &key, double &val)
-    {
-      if (_vit!=_v.end())
-	{
-	  key = (*_vit).first;
-	  val = (*_vit).second;
-	  ++_vit;
-	}
-    }
-
-    bool has_elt() const
-    {
-      return _vit != _v.end();
-    }
-    
     size_t size() const
     {
-      return _v.size();
+      return _ids.size();
     }
 
-    std::unordered_map<std::string,double> _v; /**< words as (<pos,val>). */
-    std::unordered_map<std::string,double>::iterator _vit;
+    std::vector<int> _ids; /**< sorted word positions. */
+    std::vector<double> _vals; /**< word values, aligned with positions. */
   };
 
   class TxtCharEntry: public TxtEntry<double>
@@ -180,7 +320,7 @@ namespace dd
     TxtInputFileConn()
       :InputConnectorStrategy() {}
     TxtInputFileConn(const TxtInputFileConn &i)
-      :InputConnectorStrategy(i),_iterator(i._iterator),_tokenizer(i._tokenizer),_count(i._count),_tfidf(i._tfidf),_min_count(i._min_count),_min_word_length(i._min_word_length),_sentences(i._sentences),_characters(i._characters),_alphabet_str(i._alphabet_str),_alphabet(i._alphabet),_sequence(i._sequence),_seq_forward(i._seq_forward),_vocab(i._vocab) {}
+      :InputConnectorStrategy(i),_iterator(i._iterator),_tokenizer(i._tokenizer),_count(i._count),_tfidf(i._tfidf),_min_count(i._min_count),_min_word_length(i._min_word_length),_sentences(i._sentences),_characters(i._characters),_alphabet_str(i._alphabet_str),_alphabet(i._alphabet),_sequence(i._sequence),_seq_forward(i._seq_forward),_hashing(i._hashing),_model_hashing(i._model_hashing),_vocab(i._vocab) {}
     ~TxtInputFileConn()
       {
 	destroy_txt_entries(_txt);
@@ -191,7 +331,10 @@ namespace dd
     {
       fillup_parameters(ad);
       if (!_characters && !_train)
-	deserialize_vocab(false);
+	{
+	  deserialize_vocab(false);
+	  restore_hashing(ad.has("hashing"));
+	}
     }
 
     void fillup_parameters(const APIData &ad_input)
@@ -222,11 +365,19 @@ namespace dd
 	_sequence = ad_input.get("sequence").get<int>();
       if (ad_input.has("read_forward"))
 	_seq_forward = ad_input.get("read_forward").get<bool>();
+      if (ad_input.has("hashing"))
+	_hashing = ad_input.get("hashing").get<int>();
+      if (_hashing < 0)
+	throw InputConnectorBadParamException("hashing requires a positive number of buckets");
+      if (_hashing && _tfidf)
+	throw InputConnectorBadParamException("tfidf requires word statistics, not available with hashing");
     }
 
     int feature_size() const
     {
-      // total number of words in training set for BOW
+      // number of hashing buckets, or total number of words in training set for BOW
+      if (_hashing)
+	return _hashing;
       return _vocab.size();
     }
 
@@ -244,20 +395,27 @@ namespace dd
     {
       get_data(ad);
 
+      bool has_hashing = false;
       if (ad.has("parameters")) // hotplug of parameters, overriding the defaults
 	{
 	  APIData ad_param = ad.getobj("parameters");
 	  if (ad_param.has("input"))
 	    {
-	      fillup_parameters(ad_param.getobj("input"));
+	      APIData ad_input = ad_param.getobj("input");
+	      fillup_parameters(ad_input);
+	      has_hashing = ad_input.has("hashing");
 	    }
 	}
 
       if (_alphabet.empty() && _characters)
 	build_alphabet();
       
-      if (!_characters && !_train && _vocab.empty())
-	deserialize_vocab();
+      if (!_characters && !_train)
+	{
+	  if (_model_hashing < 0)
+	    deserialize_vocab(!_hashing);
+	  restore_hashing(has_hashing);
+	}
       
       for (std::string u: _uris)
 	{
@@ -319,10 +477,42 @@ namespace dd
     void parse_content(const std::string &content,
 		       const float &target=-1);
 
-    // serialization of vocabulary
+    /**
+     * \brief splits content into documents and documents into lower case words,
+     *        thread safe
+     * @param content raw text
+     * @param docs words of every document
+     */
+    void tokenize(const std::string &content,
+		  std::vector<std::vector<std::string>> &docs) const;
+
+    /**
+     * \brief bag of words from the words of a document, adds up to the vocabulary
+     *        in training mode. Thread safe unless training with a vocabulary.
+     * @param words document words
+     * @param target class target
+     * @return new entry
+     */
+    TxtBowEntry* bow_entry(const std::vector<std::string> &words,
+			   const float &target);
+
+    /**
+     * \brief in training mode, removes the words seen less than min_count times from
+     *        the vocabulary and the entries, then applies tfidf as required
+     */
+    void prune_vocab();
+
+    // serialization of vocabulary, along with the number of hashing buckets
     void serialize_vocab();
     void deserialize_vocab(const bool &required=true);
 
+    /**
+     * \brief uses the number of hashing buckets the model was trained with,
+     *        unless requested, in which case it must match
+     * @param requested whether the number of buckets was given with the call
+     */
+    void restore_hashing(const bool &requested);
+
     // alphabet for character-level features
     void build_alphabet();
 
@@ -345,10 +535,13 @@ namespace dd
     std::unordered_map<uint32_t,int> _alphabet; /**< character-level alphabet. */
     int _sequence = 60; /**< sequence size when using character-level features. */
     bool _seq_forward = false; /**< whether to read character-based sequences forward. */
+    int _hashing = 0; /**< number of buckets when hashing words into features instead of using a vocabulary, 0 for a vocabulary. */
+    int _model_hashing = -1; /**< number of hashing buckets read from the model's vocabulary file, -1 if none was read. */
     
     // internals
-    std::unordered_map<std::string,Word> _vocab; /**< string to word stats, including word */
+    Vocab _vocab; /**< interned words and their stats */
     std::string _vocabfname = "vocab.dat";
+    std::string _hashingkey = "#hashing"; /**< key of the vocabulary file header. */
     std::string _correspname = "corresp.txt";
     
     // data
@@ -66,6 +66,14 @@ namespace dd
       return false;
     }
     
+    static long int file_size(const std::string &fname)
+    {
+      struct stat bstat;
+      if (stat(fname.c_str(),&bstat)==0)
+	return bstat.st_size;
+      else return -1;
+    }
+
     static long int file_last_modif(const std::string &fname)
     {
       struct stat bstat;
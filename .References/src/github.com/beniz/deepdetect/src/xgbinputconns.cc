@@ -85,41 +85,40 @@ namespace dd
     bool nan_missing = xgboost::common::CheckNAN(_missing);
     mat.info.num_row = csvl.size();
     mat.info.num_col = feature_size()+1; // XXX: +1 otherwise there's a mismatch in xgboost's simple_dmatrix.cc:151
-    auto hit = csvl.begin();
-    while(hit!=csvl.end())
+
+    // column roles, looked up once instead of per value: -2 for a feature, -1 for the id,
+    // label index otherwise
+    size_t ncols = 0;
+    for (const CSVline &line: csvl)
+      ncols = std::max(ncols,line._v.size());
+    std::vector<int> roles(ncols,-2);
+    for (size_t i=0;i<_label_pos.size();i++)
+      if (_label_pos.at(i) >= 0 && _label_pos.at(i) < static_cast<int>(ncols))
+	roles.at(_label_pos.at(i)) = i;
+    if (_id_pos >= 0 && _id_pos < static_cast<int>(ncols) && roles.at(_id_pos) == -2)
+      roles.at(_id_pos) = -1;
+
+    // rows go straight into the CSR buffers, sized up front
+    mat.row_ptr_.reserve(csvl.size()+1);
+    mat.row_data_.reserve(csvl.size()*ncols);
+    mat.info.labels.reserve(csvl.size()*_label_pos.size());
+    _ids.reserve(_ids.size()+csvl.size());
+    for (const CSVline &line: csvl)
       {
-	long nelem = 0;
-	auto lit = _columns.begin();
-	for (int i=0;i<(int)(*hit)._v.size();i++)
+	const double *v = line._v.data();
+	int nv = line._v.size();
+	for (int i=0;i<nv;i++)
 	  {
-	    double v = (*hit)._v.at(i);
-	    if (xgboost::common::CheckNAN(v) && !nan_missing)
+	    if (xgboost::common::CheckNAN(v[i]) && !nan_missing)
 	      throw InputConnectorBadParamException("NaN value in input data matrix, and missing != NaN");
-	    std::vector<int>::iterator ipos;
-	    if (!_label_pos.empty()
-		&& (ipos = std::find(_label_pos.begin(),_label_pos.end(),i))!=_label_pos.end())
-	      {
-		int pos = std::distance(_label_pos.begin(),ipos);
-		mat.info.labels.push_back(v+_label_offset[pos]);
-	      }
-	    else if (i == _id_pos)
-	      {
-		++lit;
-		continue;
-	      }
-	    else if (std::find(_label_pos.begin(),_label_pos.end(),i)==_label_pos.end())
-	      {
-		if (nan_missing || v != _missing)
-		  {
-		    mat.row_data_.push_back(xgboost::RowBatch::Entry(i,v));
-		    ++nelem;
-		  }
-	      }
-	    ++lit;
+	    int role = roles[i];
+	    if (role >= 0)
+	      mat.info.labels.push_back(v[i]+_label_offset[role]);
+	    else if (role == -2 && (nan_missing || v[i] != _missing))
+	      mat.row_data_.push_back(xgboost::RowBatch::Entry(i,v[i]));
 	  }
-	mat.row_ptr_.push_back(mat.row_ptr_.back()+nelem);
-	_ids.push_back((*hit)._str);
-	++hit;
+	mat.row_ptr_.push_back(mat.row_data_.size());
+	_ids.push_back(line._str);
       }
     mat.info.num_nonzero = mat.row_data_.size();
     xgboost::DMatrix *out = xgboost::DMatrix::Create(std::move(source));
@@ -216,11 +215,15 @@ namespace dd
 	  }
 	else
 	  {
-	    xgboost::DMatrix *mtrain = XGDMatrixSliceDMatrix(_m.get(),&rindex[0],rindex.size());
-	    _m = std::shared_ptr<xgboost::DMatrix>(mtrain);
-	    std::vector<int> ids(_m->info().num_row);
-	    std::iota(std::begin(ids),std::end(ids),0);
-	    for (int i: ids)
+	    // the loaded matrix is used as is unless rows were shuffled,
+	    // e.g. no extra copy of the rows at predict time
+	    if (_shuffle)
+	      {
+		xgboost::DMatrix *mtrain = XGDMatrixSliceDMatrix(_m.get(),&rindex[0],rindex.size());
+		_m = std::shared_ptr<xgboost::DMatrix>(mtrain);
+	      }
+	    _ids.reserve(_m->info().num_row);
+	    for (size_t i=0;i<_m->info().num_row;i++)
 	      _ids.push_back(std::to_string(i));
 	  }
 	
@@ -268,15 +271,12 @@ namespace dd
 	long nelem = 0;
 	TxtBowEntry *tbe = static_cast<TxtBowEntry*>((*hit));
 	mat.info.labels.push_back(tbe->_target);
-	tbe->reset();
-	while(tbe->has_elt())
+	for (size_t i=0;i<tbe->_ids.size();i++)
 	  {
-	    std::string key;
-	    double v;
-	    tbe->get_next_elt(key,v);
+	    double v = tbe->_vals[i];
 	    if (xgboost::common::CheckNAN(v) && !nan_missing)
 	      throw InputConnectorBadParamException("NaN value in input data matrix, and missing != NaN");
-	    mat.row_data_.push_back(xgboost::RowBatch::Entry(_vocab[key]._pos,v));
+	    mat.row_data_.push_back(xgboost::RowBatch::Entry(tbe->_ids[i],v));
 	    ++nelem;
 	  }
 	mat.row_ptr_.push_back(mat.row_ptr_.back()+nelem);
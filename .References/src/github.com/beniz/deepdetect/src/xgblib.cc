@@ -22,6 +22,7 @@
 #include "xgblib.h"
 #include "csvinputfileconn.h"
 #include "outputconnectorstrategy.h"
+#include <omp.h>
 #include <iomanip>
 #include <iostream>
 
@@ -44,13 +45,13 @@ namespace dd
     _regression = cl._regression;
     _ntargets = cl._ntargets;
     _booster = cl._booster;
+    _nlearners = cl._nlearners;
+    _nthread = cl._nthread;
   }
 
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
   XGBLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::~XGBLib()
   {
-    if (_learner)
-      delete _learner;
   }
 
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
@@ -73,6 +74,10 @@ namespace dd
       throw MLLibBadParamException("number of classes is unknown (nclasses == 0)");
     if (_regression && _ntargets == 0)
       throw MLLibBadParamException("number of regression targets is unknown (ntargets == 0)");
+    if (ad.has("predict_learners"))
+      _nlearners = std::max(1,std::min(ad.get("predict_learners").get<int>(),NetPool<xgboost::Learner>::max_nets));
+    if (ad.has("nthread"))
+      _nthread = ad.get("nthread").get<int>();
     this->_mlmodel.read_from_repository();
   }
 
@@ -326,7 +331,7 @@ namespace dd
 	if (i > 0 && i % test_interval == 0 && !eval_datasets.empty())
 	  {
 	    APIData meas_out;
-	    test(ad,learner,eval_datasets.at(0).get(),meas_out);
+	    test(ad,learner.get(),eval_datasets.at(0).get(),meas_out);
 	    APIData meas_obj = meas_out.getobj("measure");
 	    std::vector<std::string> meas_str = meas_obj.list_keys();
 	    for (auto m: meas_str)
@@ -383,6 +388,7 @@ namespace dd
 	std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(os.str().c_str(), "w"));
 	learner->Save(fo.get());
       }
+      _learners.clear(); // predict learners are reloaded from the new model
 
       // bail on forced stop, i.e. not testing the model further.
       if (!this->_tjob_running.load())
@@ -391,7 +397,7 @@ namespace dd
 	}
       
       // test
-      test(ad,learner,inputc._mtest.get(),out);
+      test(ad,learner.get(),inputc._mtest.get(),out);
       
       // prepare model
       this->_mlmodel.read_from_repository();
@@ -403,38 +409,66 @@ namespace dd
       return 0;
   }
 
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
+  void XGBLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::load_learners()
+  {
+    std::string model_in = this->_mlmodel._weights;
+    LOG(INFO) << "loading XGBoost model file=" << model_in << " into " << _nlearners << " learner(s)";
+    // we can't read the objective function string name from the xgboost in-memory model,
+    // so let's read it from file
+    _objective = this->_mlmodel.lookup_objective(model_in);
+    if (_objective == "")
+      throw MLLibInternalException("failed to read the objective from XGBoost model file " + model_in);
+    // a learner keeps per-thread buffers while predicting, so concurrent calls
+    // each get their own copy of the model
+    std::vector<xgboost::Learner*> learners;
+    try
+      {
+	for (int l=0;l<_nlearners;l++)
+	  {
+	    std::unique_ptr<xgboost::Learner> learner(xgboost::Learner::Create({}));
+	    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(model_in.c_str(),"r"));
+	    learner->Load(fi.get());
+	    learners.push_back(learner.release());
+	  }
+      }
+    catch (...)
+      {
+	for (xgboost::Learner *learner: learners)
+	  delete learner;
+	throw;
+      }
+    _learners.reset(learners);
+  }
+
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
   int XGBLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::predict(const APIData &ad,
 										   APIData &out)
   {
-    // mutex since using in-memory learner
-    std::lock_guard<std::mutex> lock(_learner_mutex);
-    
-    // data
+    // data, transformed outside of the lock
     TInputConnectorStrategy inputc(this->_inputc);
-    APIData cad = ad;
     try
       {
-	inputc.transform(cad);
+	inputc.transform(ad);
       }
     catch (...)
       {
 	throw;
       }
     
-    // load existing model as needed
-    if (!_learner)
+    // load existing model as needed, and check out a learner
+    std::unique_ptr<typename NetPool<xgboost::Learner>::Lease> lease;
+    xgboost::Learner *learner = nullptr;
+    while(!learner)
       {
-	_learner = xgboost::Learner::Create({});
-	std::string model_in = this->_mlmodel._weights;
-        LOG(INFO) << "loading XGBoost model file=" << model_in;
-	std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(model_in.c_str(),"r"));
-	_learner->Load(fi.get());
-	// we can't read the objective function string name from the xgboost in-memory model,
-	// so let's read it from file
-	_objective = this->_mlmodel.lookup_objective(model_in);
-	if (_objective == "")
-	  throw MLLibInternalException("failed to read the objective from XGBoost model file " + model_in);
+	{
+	  std::lock_guard<std::mutex> lock(_learner_mutex);
+	  if (_learners.size() == 0)
+	    load_learners();
+	}
+	// waits for a free learner without the lock, retries if learners were cleared meanwhile
+	lease.reset(new typename NetPool<xgboost::Learner>::Lease(_learners));
+	learner = lease->get();
       }
 
     // test
@@ -443,9 +477,7 @@ namespace dd
       {
 	std::vector<std::shared_ptr<xgboost::DMatrix>> eval_datasets = { inputc._m };
 	APIData meas_out;
-	std::unique_ptr<xgboost::Learner> learner(_learner);
 	test(ad,learner,eval_datasets.at(0).get(),meas_out);
-	learner.release();
 	meas_out.erase("iteration");
 	out.add("measure",meas_out.getobj("measure"));
 	return 0;
@@ -453,7 +485,19 @@ namespace dd
     
     // predict
     std::vector<float> preds;
-    _learner->Predict(inputc._m.get(),_params.pred_margin,&preds,_params.ntree_limit);
+    int nthread = omp_get_max_threads();
+    if (_nthread > 0)
+      omp_set_num_threads(_nthread);
+    try
+      {
+	learner->Predict(inputc._m.get(),_params.pred_margin,&preds,_params.ntree_limit);
+      }
+    catch (...)
+      {
+	omp_set_num_threads(nthread);
+	throw;
+      }
+    omp_set_num_threads(nthread);
 
     // results
     //float loss = 0.0; // XXX: how to acquire loss ?
@@ -501,7 +545,7 @@ namespace dd
   
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy, class TMLModel>
   void XGBLib<TInputConnectorStrategy,TOutputConnectorStrategy,TMLModel>::test(const APIData &ad,
-									       std::unique_ptr<xgboost::Learner> &learner,
+									       xgboost::Learner *learner,
 									       xgboost::DMatrix *dtest,
 									       APIData &out)
   {
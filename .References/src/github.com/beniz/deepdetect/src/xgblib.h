@@ -24,6 +24,7 @@
 
 #include "mllibstrategy.h"
 #include "xgbmodel.h"
+#include "netpool.h"
 #include <xgboost/learner.h>
 
 namespace xgboost
@@ -94,8 +95,17 @@ namespace dd
     int predict(const APIData &ad, APIData &out);
 
     /*- local functions -*/
+    /**
+     * \brief loads the pool of predict learners from the model file
+     */
+    void load_learners();
+
+    /**
+     * \brief tests the model on given data
+     * @param learner learner to test, not owned
+     */
     void test(const APIData &ad,
-	      std::unique_ptr<xgboost::Learner> &learner,
+	      xgboost::Learner *learner,
 	      xgboost::DMatrix *dtest,
 	      APIData &out);
     
@@ -116,8 +126,10 @@ namespace dd
 
     bool _gpu = false; /**< whether to use GPU. */
     xgboost::CLIParam _params;
-    xgboost::Learner *_learner = nullptr; /**< learner for prediction. */
-    std::mutex _learner_mutex; /**< mutex around the learner, e.g.. no concurrent predict calls as learner is not re-instantiated. Use batches instead. */
+    int _nlearners = 1; /**< number of learners, i.e. of concurrent predict calls. */
+    int _nthread = 0; /**< number of xgboost predictor threads per predict call, 0 for OpenMP default. */
+    NetPool<xgboost::Learner> _learners; /**< learners for prediction, loaded on first predict call. */
+    std::mutex _learner_mutex; /**< mutex around training and the loading of predict learners. */
     };
 
 }
@@ -27,6 +27,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <iostream>
+#include <thread>
 
 using namespace dd;
 
@@ -339,6 +340,18 @@ TEST(caffeapi,service_predict)
   std::cerr << "uri=" << uri << std::endl;
   ASSERT_EQ("0",uri);
 
+  // predict with cheaper interpolation, and per-stage latencies
+  jpredictstr = "{\"service\":\""+ sname + "\",\"parameters\":{\"input\":{\"bw\":true,\"width\":28,\"height\":28,\"interp\":\"linear\"},\"output\":{\"best\":3}},\"data\":[\"" + mnist_repo + "/sample_digit.png\",\"" + mnist_repo + "/sample_digit2.png\"]}";
+  joutstr = japi.jrender(japi.service_predict(jpredictstr));
+  std::cout << "joutstr=" << joutstr << std::endl;
+  jd.Parse(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(200,jd["status"]["code"]);
+  ASSERT_EQ(2,jd["body"]["predictions"].Size());
+  ASSERT_TRUE(jd["head"]["timings"]["decode"].GetDouble() >= 0.0);
+  ASSERT_TRUE(jd["head"]["timings"]["preprocess"].GetDouble() >= 0.0);
+  ASSERT_TRUE(jd["head"]["timings"]["forward"].GetDouble() > 0.0);
+
   // predict non existing image
   jpredictstr = "{\"service\":\""+ sname + "\",\"parameters\":{\"input\":{\"bw\":true,\"width\":28,\"height\":28},\"output\":{\"best\":3}},\"data\":[\"http://example.com/my_image.png\"]}";
   joutstr = japi.jrender(japi.service_predict(jpredictstr));
@@ -462,6 +475,174 @@ TEST(caffeapi,service_train_csv)
   ASSERT_TRUE(!fileops::remove_directory_files(forest_repo,{".prototxt"}));
 }
 
+TEST(caffeapi,service_train_csv_batched_predict)
+{
+  // create service, concurrent predict calls share forward passes
+  JsonAPI japi;
+  std::string sname = "my_service";
+  std::string jstr = "{\"mllib\":\"caffe\",\"description\":\"my classifier\",\"type\":\"supervised\",\"model\":{\"repository\":\"" +  forest_repo + "\",\"templates\":\"" + model_templates_repo  + "\"},\"parameters\":{\"input\":{\"connector\":\"csv\"},\"mllib\":{\"template\":\"mlp\",\"nclasses\":7,\"activation\":\"prelu\",\"predict_batch_size\":8,\"predict_batch_timeout\":20}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname,jstr));
+  ASSERT_EQ(created_str,joutstr);
+
+  // train
+  std::string jtrainstr = "{\"service\":\"" + sname + "\",\"async\":false,\"parameters\":{\"input\":{\"label\":\"Cover_Type\",\"id\":\"Id\",\"scale\":true,\"test_split\":0.1,\"label_offset\":-1,\"shuffle\":true},\"mllib\":{\"gpu\":true,\"gpuid\":"+gpuid+",\"solver\":{\"iterations\":" + iterations_forest + ",\"base_lr\":0.05},\"net\":{\"batch_size\":512}},\"output\":{\"measure\":[\"acc\",\"mcll\",\"f1\"]}},\"data\":[\"" + forest_repo + "train.csv\"]}";
+  joutstr = japi.jrender(japi.service_train(jtrainstr));
+  JDoc jd;
+  jd.Parse(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(201,jd["status"]["code"].GetInt());
+
+  // concurrent predict calls, with one or two samples each
+  std::string mem_data = "2499,326,7,300,88,480,202,232,169,1676,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0";
+  std::string str_min_vals="[1863.0,0.0,0.0,0.0,-146.0,0.0,0.0,99.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,1.0]";
+  std::string str_max_vals="[3849.0,360.0,52.0,1343.0,554.0,6890.0,254.0,254.0,248.0,6993.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,0.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,0.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,7.0]";
+  const int ncalls = 12;
+  std::vector<std::string> jouts(ncalls);
+  std::vector<std::thread> calls;
+  for (int i=0;i<ncalls;i++)
+    {
+      std::string data = "\"" + mem_data + "\"";
+      if (i % 2)
+	data += ",\"" + mem_data + "\"";
+      std::string jpredictstr = "{\"service\":\""+ sname + "\",\"parameters\":{\"input\":{\"connector\":\"csv\",\"scale\":true,\"min_vals\":" + str_min_vals + ",\"max_vals\":" + str_max_vals + "},\"output\":{\"best\":3}},\"data\":[" + data + "]}";
+      calls.push_back(std::thread([&japi,&jouts,jpredictstr,i]()
+				  {
+				    jouts[i] = japi.jrender(japi.service_predict(jpredictstr));
+				  }));
+    }
+  for (auto &call: calls)
+    call.join();
+  for (int i=0;i<ncalls;i++)
+    {
+      std::cout << "joutstr=" << jouts[i] << std::endl;
+      jd.Parse(jouts[i].c_str());
+      ASSERT_TRUE(!jd.HasParseError());
+      ASSERT_EQ(200,jd["status"]["code"].GetInt());
+      ASSERT_EQ(i % 2 ? 2 : 1,jd["body"]["predictions"].Size());
+      std::string cat0 = jd["body"]["predictions"][0]["classes"][0]["cat"].GetString();
+      std::string cat1 = jd["body"]["predictions"][0]["classes"][1]["cat"].GetString();
+      ASSERT_TRUE("2"==cat0||"2"==cat1);
+    }
+
+  // remove service
+  jstr = "{\"clear\":\"lib\"}";
+  joutstr = japi.jrender(japi.service_delete(sname,jstr));
+  ASSERT_EQ(ok_str,joutstr);
+  ASSERT_TRUE(!fileops::remove_directory_files(forest_repo,{".prototxt"}));
+}
+
+TEST(caffeapi,service_train_csv_replicas_predict)
+{
+  // create service, concurrent predict calls run on net replicas
+  JsonAPI japi;
+  std::string sname = "my_service";
+  std::string jstr = "{\"mllib\":\"caffe\",\"description\":\"my classifier\",\"type\":\"supervised\",\"model\":{\"repository\":\"" +  forest_repo + "\",\"templates\":\"" + model_templates_repo  + "\"},\"parameters\":{\"input\":{\"connector\":\"csv\"},\"mllib\":{\"template\":\"mlp\",\"nclasses\":7,\"activation\":\"prelu\",\"predict_replicas\":3}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname,jstr));
+  ASSERT_EQ(created_str,joutstr);
+
+  // train
+  std::string jtrainstr = "{\"service\":\"" + sname + "\",\"async\":false,\"parameters\":{\"input\":{\"label\":\"Cover_Type\",\"id\":\"Id\",\"scale\":true,\"test_split\":0.1,\"label_offset\":-1,\"shuffle\":true},\"mllib\":{\"gpu\":true,\"gpuid\":"+gpuid+",\"solver\":{\"iterations\":" + iterations_forest + ",\"base_lr\":0.05},\"net\":{\"batch_size\":512}},\"output\":{\"measure\":[\"acc\",\"mcll\",\"f1\"]}},\"data\":[\"" + forest_repo + "train.csv\"]}";
+  joutstr = japi.jrender(japi.service_train(jtrainstr));
+  JDoc jd;
+  jd.Parse(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(201,jd["status"]["code"].GetInt());
+
+  // concurrent predict calls, with one or two samples each
+  std::string mem_data = "2499,326,7,300,88,480,202,232,169,1676,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0";
+  std::string str_min_vals="[1863.0,0.0,0.0,0.0,-146.0,0.0,0.0,99.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,1.0]";
+  std::string str_max_vals="[3849.0,360.0,52.0,1343.0,554.0,6890.0,254.0,254.0,248.0,6993.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,0.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,0.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,7.0]";
+  const int ncalls = 12;
+  std::vector<std::string> jouts(ncalls);
+  std::vector<std::thread> calls;
+  for (int i=0;i<ncalls;i++)
+    {
+      std::string data = "\"" + mem_data + "\"";
+      if (i % 2)
+	data += ",\"" + mem_data + "\"";
+      std::string jpredictstr = "{\"service\":\""+ sname + "\",\"parameters\":{\"input\":{\"connector\":\"csv\",\"scale\":true,\"min_vals\":" + str_min_vals + ",\"max_vals\":" + str_max_vals + "},\"output\":{\"best\":3}},\"data\":[" + data + "]}";
+      calls.push_back(std::thread([&japi,&jouts,jpredictstr,i]()
+				  {
+				    jouts[i] = japi.jrender(japi.service_predict(jpredictstr));
+				  }));
+    }
+  for (auto &call: calls)
+    call.join();
+  for (int i=0;i<ncalls;i++)
+    {
+      std::cout << "joutstr=" << jouts[i] << std::endl;
+      jd.Parse(jouts[i].c_str());
+      ASSERT_TRUE(!jd.HasParseError());
+      ASSERT_EQ(200,jd["status"]["code"].GetInt());
+      ASSERT_EQ(i % 2 ? 2 : 1,jd["body"]["predictions"].Size());
+      std::string cat0 = jd["body"]["predictions"][0]["classes"][0]["cat"].GetString();
+      std::string cat1 = jd["body"]["predictions"][0]["classes"][1]["cat"].GetString();
+      ASSERT_TRUE("2"==cat0||"2"==cat1);
+    }
+
+  // remove service
+  jstr = "{\"clear\":\"lib\"}";
+  joutstr = japi.jrender(japi.service_delete(sname,jstr));
+  ASSERT_EQ(ok_str,joutstr);
+  ASSERT_TRUE(!fileops::remove_directory_files(forest_repo,{".prototxt"}));
+}
+
+TEST(caffeapi,service_train_csv_batched_replicas_predict)
+{
+  // create service, concurrent predict calls share forward passes that run on net replicas
+  JsonAPI japi;
+  std::string sname = "my_service";
+  std::string jstr = "{\"mllib\":\"caffe\",\"description\":\"my classifier\",\"type\":\"supervised\",\"model\":{\"repository\":\"" +  forest_repo + "\",\"templates\":\"" + model_templates_repo  + "\"},\"parameters\":{\"input\":{\"connector\":\"csv\"},\"mllib\":{\"template\":\"mlp\",\"nclasses\":7,\"activation\":\"prelu\",\"predict_replicas\":3,\"predict_batch_size\":8,\"predict_batch_timeout\":20}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname,jstr));
+  ASSERT_EQ(created_str,joutstr);
+
+  // train
+  std::string jtrainstr = "{\"service\":\"" + sname + "\",\"async\":false,\"parameters\":{\"input\":{\"label\":\"Cover_Type\",\"id\":\"Id\",\"scale\":true,\"test_split\":0.1,\"label_offset\":-1,\"shuffle\":true},\"mllib\":{\"gpu\":true,\"gpuid\":"+gpuid+",\"solver\":{\"iterations\":" + iterations_forest + ",\"base_lr\":0.05},\"net\":{\"batch_size\":512}},\"output\":{\"measure\":[\"acc\",\"mcll\",\"f1\"]}},\"data\":[\"" + forest_repo + "train.csv\"]}";
+  joutstr = japi.jrender(japi.service_train(jtrainstr));
+  JDoc jd;
+  jd.Parse(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(201,jd["status"]["code"].GetInt());
+
+  // concurrent predict calls, with one or two samples each
+  std::string mem_data = "2499,326,7,300,88,480,202,232,169,1676,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0";
+  std::string str_min_vals="[1863.0,0.0,0.0,0.0,-146.0,0.0,0.0,99.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,0.0,1.0]";
+  std::string str_max_vals="[3849.0,360.0,52.0,1343.0,554.0,6890.0,254.0,254.0,248.0,6993.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,0.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,0.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,1.0,7.0]";
+  const int ncalls = 24;
+  std::vector<std::string> jouts(ncalls);
+  std::vector<std::thread> calls;
+  for (int i=0;i<ncalls;i++)
+    {
+      std::string data = "\"" + mem_data + "\"";
+      if (i % 2)
+	data += ",\"" + mem_data + "\"";
+      std::string jpredictstr = "{\"service\":\""+ sname + "\",\"parameters\":{\"input\":{\"connector\":\"csv\",\"scale\":true,\"min_vals\":" + str_min_vals + ",\"max_vals\":" + str_max_vals + "},\"output\":{\"best\":3}},\"data\":[" + data + "]}";
+      calls.push_back(std::thread([&japi,&jouts,jpredictstr,i]()
+				  {
+				    jouts[i] = japi.jrender(japi.service_predict(jpredictstr));
+				  }));
+    }
+  for (auto &call: calls)
+    call.join();
+  for (int i=0;i<ncalls;i++)
+    {
+      std::cout << "joutstr=" << jouts[i] << std::endl;
+      jd.Parse(jouts[i].c_str());
+      ASSERT_TRUE(!jd.HasParseError());
+      ASSERT_EQ(200,jd["status"]["code"].GetInt());
+      ASSERT_EQ(i % 2 ? 2 : 1,jd["body"]["predictions"].Size());
+      std::string cat0 = jd["body"]["predictions"][0]["classes"][0]["cat"].GetString();
+      std::string cat1 = jd["body"]["predictions"][0]["classes"][1]["cat"].GetString();
+      ASSERT_TRUE("2"==cat0||"2"==cat1);
+    }
+
+  // remove service
+  jstr = "{\"clear\":\"lib\"}";
+  joutstr = japi.jrender(japi.service_delete(sname,jstr));
+  ASSERT_EQ(ok_str,joutstr);
+  ASSERT_TRUE(!fileops::remove_directory_files(forest_repo,{".prototxt"}));
+}
+
 TEST(caffeapi,service_train_csv_in_memory)
 {
   // create service
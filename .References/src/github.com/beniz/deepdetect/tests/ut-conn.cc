@@ -427,19 +427,196 @@ TEST(inputconn,csv_ignore)
   remove("test.csv");
 }
 
-/*TEST(inputconn,txt_parse_content)
+TEST(inputconn,csv_chunks)
 {
-  std::string str = "everything runs fine, right?";
+  // large enough to be parsed in several chunks
+  const int nrows = 300000;
+  std::ofstream of("test.csv");
+  of << "target,val1,val2" << std::endl;
+  for (int i=0;i<nrows;i++)
+    of << i % 7 << "," << i << "," << i % 13 + 0.5 << std::endl;
+  of.close();
+  std::vector<std::string> vdata = { "test.csv" };
+  APIData ad;
+  ad.add("data",vdata);
+  APIData pad,pinp;
+  pinp.add("label","target");
+  std::vector<APIData> vpinp = { pinp };
+  pad.add("input",vpinp);
+  std::vector<APIData> vpad = { pad };
+  ad.add("parameters",vpad);
+  CSVInputFileConn cifc;
+  cifc._train = true;
+  try
+    {
+      cifc.transform(ad);
+    }
+  catch(InputConnectorBadParamException &e)
+    {
+      std::cerr << "exception=" << e.what() << std::endl;
+      ASSERT_FALSE(true);
+    }
+  ASSERT_EQ(nrows,cifc._csvdata.size());
+  for (int i=0;i<nrows;i+=997) // rows keep file order
+    {
+      ASSERT_EQ(std::to_string(i+1),cifc._csvdata.at(i)._str);
+      ASSERT_EQ(3,cifc._csvdata.at(i)._v.size());
+      ASSERT_EQ(i % 7,cifc._csvdata.at(i)._v.at(0));
+      ASSERT_EQ(i,cifc._csvdata.at(i)._v.at(1));
+      ASSERT_EQ(i % 13 + 0.5,cifc._csvdata.at(i)._v.at(2));
+    }
+
+  // malformed line in a later chunk is reported with its line number in the file
+  of.open("test.csv");
+  of << "target,val1,val2" << std::endl;
+  for (int i=0;i<nrows;i++)
+    {
+      if (i == nrows - 10)
+	of << i % 7 << ",abc," << i % 13 + 0.5 << std::endl;
+      else of << i % 7 << "," << i << "," << i % 13 + 0.5 << std::endl;
+    }
+  of.close();
+  CSVInputFileConn cifc2;
+  cifc2._train = true;
+  std::string error;
+  try
+    {
+      cifc2.transform(ad);
+    }
+  catch(InputConnectorBadParamException &e)
+    {
+      error = e.what();
+    }
+  ASSERT_EQ(0,error.find("line " + std::to_string(nrows - 10) + ": column val1 is not a number"));
+  remove("test.csv");
+}
+
+TEST(inputconn,csv_empty)
+{
+  // empty files are read as no data, not as unreadable files
+  std::ofstream of("test.csv");
+  of.close();
+  std::vector<std::string> vdata = { "test.csv" };
+  APIData ad;
+  ad.add("data",vdata);
+  CSVInputFileConn cifc;
+  cifc._train = false;
+  std::string error;
+  try
+    {
+      cifc.transform(ad);
+    }
+  catch(InputConnectorBadParamException &e)
+    {
+      error = e.what();
+    }
+  ASSERT_EQ("no data could be found",error);
+  ASSERT_EQ(0,cifc._csvdata.size());
+  remove("test.csv");
+}
+
+TEST(inputconn,txt_parse_content)
+{
+  std::string str = "everything runs fine, right? fine";
   TxtInputFileConn tifc;
+  tifc._train = true;
+  tifc._min_word_length = 4;
   tifc.parse_content(str,1);
   ASSERT_EQ(4,tifc._vocab.size());
-  ASSERT_EQ(4,tifc._rvocab.size());
-  Word w = tifc._vocab["fine"];
+  ASSERT_EQ(2,tifc._vocab.find("fine"));
+  ASSERT_EQ(-1,tifc._vocab.find("unknown"));
+  Word w = tifc._vocab.at(2);
   ASSERT_EQ(2,w._pos);
-  ASSERT_EQ(1,w._total_count);
-  ASSERT_EQ(1,w._total_classes);
+  ASSERT_EQ(2,w._total_count);
+  ASSERT_EQ(1,w._total_docs);
+  ASSERT_EQ(1,tifc._txt.size());
+  TxtBowEntry *tbe = static_cast<TxtBowEntry*>(tifc._txt.at(0));
+  ASSERT_EQ(4,tbe->size());
+  ASSERT_TRUE(std::is_sorted(tbe->_ids.begin(),tbe->_ids.end()));
+  ASSERT_EQ(2,tbe->_ids.at(2));
+  ASSERT_EQ(2.0,tbe->_vals.at(2));
+  ASSERT_EQ(1,tbe->_target);
+
+  // copies share the vocabulary until modified, unknown words are dropped
+  TxtInputFileConn pifc(tifc);
+  pifc._train = false;
+  pifc.parse_content("fine unknown fine",0);
+  ASSERT_EQ(1,pifc._txt.size());
+  tbe = static_cast<TxtBowEntry*>(pifc._txt.at(0));
+  ASSERT_EQ(1,tbe->size());
+  ASSERT_EQ(2,tbe->_ids.at(0));
+  ASSERT_EQ(2.0,tbe->_vals.at(0));
+  pifc._vocab.insert("other");
+  ASSERT_EQ(5,pifc._vocab.size());
+  ASSERT_EQ(4,tifc._vocab.size());
+}
+
+TEST(inputconn,txt_hashing)
+{
+  TxtInputFileConn tifc;
+  APIData ad;
+  ad.add("hashing",1024);
+  ad.add("min_word_length",1);
+  tifc.fillup_parameters(ad);
+  tifc._train = true;
+  tifc.parse_content("everything runs fine, right? fine",0);
+  ASSERT_TRUE(tifc._vocab.empty());
+  ASSERT_EQ(1024,tifc.feature_size());
   ASSERT_EQ(1,tifc._txt.size());
-  TxtBowEntry tbe = tifc._txt.at(0);
-  ASSERT_EQ(4,tbe._v.size());
-  ASSERT_EQ(1,tbe._target);
-  }*/
+  TxtBowEntry *tbe = static_cast<TxtBowEntry*>(tifc._txt.at(0));
+  ASSERT_EQ(4,tbe->size());
+  ASSERT_TRUE(std::is_sorted(tbe->_ids.begin(),tbe->_ids.end()));
+  int fine = Vocab::hash("fine") % 1024;
+  ASSERT_TRUE(tbe->has_word(fine));
+  double total = 0.0;
+  for (double v: tbe->_vals)
+    total += v;
+  ASSERT_EQ(5.0,total);
+
+  APIData ad_tfidf;
+  ad_tfidf.add("tfidf",true);
+  ASSERT_THROW(tifc.fillup_parameters(ad_tfidf),InputConnectorBadParamException);
+}
+
+TEST(inputconn,txt_hashing_model)
+{
+  // the number of buckets is saved with the model, restored and checked on predict
+  TxtInputFileConn tifc;
+  tifc._model_repo = ".";
+  tifc._hashing = 1024;
+  tifc.serialize_vocab();
+
+  APIData ad;
+  TxtInputFileConn pifc;
+  pifc._model_repo = ".";
+  pifc._train = false;
+  pifc.init(ad);
+  ASSERT_EQ(1024,pifc.feature_size());
+
+  std::vector<std::string> vdata = { "everything runs fine" };
+  APIData ad_pred;
+  ad_pred.add("data",vdata);
+  APIData ad_input;
+  ad_input.add("hashing",16);
+  APIData ad_param;
+  ad_param.add("input",ad_input);
+  ad_pred.add("parameters",ad_param);
+  TxtInputFileConn cifc(pifc);
+  ASSERT_THROW(cifc.transform(ad_pred),InputConnectorBadParamException);
+
+  APIData ad_hashing;
+  ad_hashing.add("hashing",512);
+  TxtInputFileConn hifc;
+  hifc._model_repo = ".";
+  hifc._train = false;
+  ASSERT_THROW(hifc.init(ad_hashing),InputConnectorBadParamException);
+
+  // vocabulary models do not take hashing
+  tifc._hashing = 0;
+  tifc.serialize_vocab();
+  TxtInputFileConn vifc;
+  vifc._model_repo = ".";
+  vifc._train = false;
+  ASSERT_THROW(vifc.init(ad_hashing),InputConnectorBadParamException);
+  remove("vocab.dat");
+}
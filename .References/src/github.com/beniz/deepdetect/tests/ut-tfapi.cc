@@ -27,6 +27,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <iostream>
+#include <chrono>
 
 using namespace dd;
 
@@ -95,3 +96,38 @@ TEST(tfapi,service_predict_unsup)
   ASSERT_EQ(200,jd["status"]["code"]);
   ASSERT_EQ(50176,jd["body"]["predictions"][0]["vals"].Size());
 }
+
+TEST(tfapi,service_predict_latency)
+{
+  // create service
+  JsonAPI japi;
+  std::string sname = "imgserv";
+  std::string jstr = "{\"mllib\":\"tensorflow\",\"description\":\"my classifier\",\"type\":\"supervised\",\"model\":{\"repository\":\"" +  incept_repo + "\"},\"parameters\":{\"input\":{\"connector\":\"image\",\"height\":224,\"width\":224,\"inputlayer\":\"InputImage\"},\"mllib\":{\"nclasses\":1001}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname,jstr));
+  ASSERT_EQ(created_str,joutstr);
+
+  // first call creates the session, next ones reuse it along with pooled batch inputs
+  std::string jpredictstr = "{\"service\":\"imgserv\",\"parameters\":{\"output\":{\"best\":3}},\"data\":[\"" + incept_repo + "grace_hopper.jpg\",\"" + incept_repo + "cat.jpg\"]}";
+  typedef MLService<TFLib,ImgTFInputFileConn,SupervisedOutput,TFModel> TFService;
+  TFService &tfs = japi._mlservices.at(sname).get<TFService>();
+  ASSERT_TRUE(tfs._session == nullptr);
+  const int ncalls = 10;
+  tensorflow::Session *session = nullptr;
+  JDoc jd;
+  for (int i=0;i<=ncalls;i++)
+    {
+      std::chrono::time_point<std::chrono::steady_clock> tstart = std::chrono::steady_clock::now();
+      joutstr = japi.jrender(japi.service_predict(jpredictstr));
+      double elapsed = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-tstart).count();
+      std::cout << "call " << i << "=" << elapsed << "ms\n";
+      jd.Parse(joutstr.c_str());
+      ASSERT_TRUE(!jd.HasParseError());
+      ASSERT_EQ(200,jd["status"]["code"]);
+      ASSERT_EQ(2,jd["body"]["predictions"].Size());
+      if (i == 0)
+	session = tfs._session.get();
+      ASSERT_TRUE(session != nullptr);
+      ASSERT_EQ(session,tfs._session.get());
+      ASSERT_EQ(1,tfs._input_pool.size());
+    }
+}
@@ -28,6 +28,8 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <iostream>
+#include <chrono>
+#include <thread>
 
 using namespace dd;
 
@@ -115,6 +117,63 @@ TEST(xgbapi,service_train_csv)
   ASSERT_TRUE(fileops::file_exists(forest_repo + "/" + JsonAPI::_json_blob_fname));
 }
 
+TEST(xgbapi,service_predict_concurrent)
+{
+  JsonAPI japi;
+  std::string sname = "my_service";
+  std::string jstr = "{\"mllib\":\"xgboost\",\"description\":\"my classifier\",\"type\":\"supervised\",\"model\":{\"repository\":\"" +  forest_repo + "\"},\"parameters\":{\"input\":{\"connector\":\"csv\"},\"mllib\":{\"nclasses\":7,\"predict_learners\":4,\"nthread\":1}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname,jstr));
+  ASSERT_EQ(created_str,joutstr);
+
+  // train
+  std::string jtrainstr = "{\"service\":\"" + sname + "\",\"async\":false,\"parameters\":{\"input\":{\"label\":\"Cover_Type\",\"id\":\"Id\",\"test_split\":0.1,\"label_offset\":-1,\"shuffle\":true},\"mllib\":{\"iterations\":" + iterations_forest + ",\"objective\":\"multi:softprob\"},\"output\":{\"measure\":[\"acc\",\"mcll\",\"f1\"]}},\"data\":[\"" + forest_repo + "train.csv\"]}";
+  joutstr = japi.jrender(japi.service_train(jtrainstr));
+  JDoc jd;
+  jd.Parse(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(201,jd["status"]["code"].GetInt());
+
+  // concurrent predict calls, reports requests per second
+  std::string mem_data = "2499,326,7,300,88,480,202,232,169,1676,0,0,0,1,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0";
+  std::string jpredictstr = "{\"service\":\""+ sname + "\",\"parameters\":{\"input\":{\"connector\":\"csv\",\"scale\":false},\"output\":{\"best\":3}},\"data\":[\"" + mem_data + "\"]}";
+  const int nthreads = 8;
+  const int ncalls = 50; // per thread
+  std::vector<int> failures(nthreads,0);
+  std::vector<std::thread> calls;
+  std::chrono::time_point<std::chrono::system_clock> tstart = std::chrono::system_clock::now();
+  for (int t=0;t<nthreads;t++)
+    {
+      calls.push_back(std::thread([&japi,&failures,jpredictstr,ncalls,t]()
+				  {
+				    for (int i=0;i<ncalls;i++)
+				      {
+					JDoc jdp;
+					jdp.Parse(japi.jrender(japi.service_predict(jpredictstr)).c_str());
+					if (jdp.HasParseError() || jdp["status"]["code"].GetInt() != 200)
+					  {
+					    ++failures[t];
+					    continue;
+					  }
+					std::string cat0 = jdp["body"]["predictions"][0]["classes"][0]["cat"].GetString();
+					std::string cat1 = jdp["body"]["predictions"][0]["classes"][1]["cat"].GetString();
+					if ("2"!=cat0 && "2"!=cat1)
+					  ++failures[t];
+				      }
+				  }));
+    }
+  for (auto &call: calls)
+    call.join();
+  double elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now()-tstart).count();
+  std::cout << "predict throughput=" << nthreads*ncalls / (elapsed / 1000.0) << " req/s over " << nthreads*ncalls << " calls" << std::endl;
+  for (int t=0;t<nthreads;t++)
+    ASSERT_EQ(0,failures[t]);
+
+  // remove service
+  jstr = "{\"clear\":\"lib\"}";
+  joutstr = japi.jrender(japi.service_delete(sname,jstr));
+  ASSERT_EQ(ok_str,joutstr);
+}
+
 TEST(xgbapi,service_train_txt)
 {
   // create service
@@ -6,7 +6,9 @@
 #include "QuadKey.hpp"
 #include "LodRange.hpp"
 #include "builders/BuilderContext.hpp"
+#include "builders/BuildProfiler.hpp"
 #include "builders/CacheBuilder.hpp"
+#include "builders/MeshBuilder.hpp"
 #include "builders/MeshCache.hpp"
 #include "builders/QuadKeyBuilder.hpp"
 #include "builders/buildings/BuildingBuilder.hpp"
@@ -17,19 +19,24 @@
 #include "heightmap/FlatElevationProvider.hpp"
 #include "heightmap/GridElevationProvider.hpp"
 #include "heightmap/SrtmElevationProvider.hpp"
+#include "index/CompactElementStore.hpp"
 #include "index/GeoStore.hpp"
 #include "index/InMemoryElementStore.hpp"
 #include "index/PersistentElementStore.hpp"
 #include "mapcss/MapCssParser.hpp"
 #include "mapcss/StyleSheet.hpp"
 #include "utils/CoreUtils.hpp"
+#include "utils/ThreadPool.hpp"
 
 #include "Callbacks.hpp"
 #include "ExportElementVisitor.hpp"
 
+#include <algorithm>
 #include <exception>
 #include <fstream>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 /// Exposes API for external usage.
@@ -59,6 +66,11 @@ class Application {
     geoStore_.registerStore(key, utymap::utils::make_unique<utymap::index::InMemoryElementStore>(stringTable_));
   }
 
+  /// Registers new in-memory store with compact element representation.
+  void registerCompactInMemoryStore(const char *key) {
+    geoStore_.registerStore(key, utymap::utils::make_unique<utymap::index::CompactElementStore>(stringTable_));
+  }
+
   /// Registers new persistent store.
   void registerPersistentStore(const char *key, const char *dataPath, OnNewDirectory *directoryCallback) {
     geoStore_
@@ -134,26 +146,123 @@ class Application {
                    utymap::CancellationToken *cancellationToken) {
     safeExecute([&]() {
       auto &styleProvider = getStyleProvider(styleFile);
-      auto &eleProvider = getElevationProvider(quadKey, eleDataType);
-      ExportElementVisitor elementVisitor(tag, quadKey, stringTable_, styleProvider, eleProvider, elementCallback);
-      quadKeyBuilder_.build(
-          quadKey, styleProvider, eleProvider,
-          [&meshCallback, tag](const utymap::math::Mesh &mesh) {
-            // NOTE do not notify if mesh is empty.
-            if (!mesh.vertices.empty()) {
-              meshCallback(tag, mesh.name.data(),
-                           mesh.vertices.data(), static_cast<int>(mesh.vertices.size()),
-                           mesh.triangles.data(), static_cast<int>(mesh.triangles.size()),
-                           mesh.colors.data(), static_cast<int>(mesh.colors.size()),
-                           mesh.uvs.data(), static_cast<int>(mesh.uvs.size()),
-                           mesh.uvMap.data(), static_cast<int>(mesh.uvMap.size()));
-            }
-          }, [&elementVisitor](const utymap::entities::Element &element) {
-            element.accept(elementVisitor);
-          }, *cancellationToken);
+      buildQuadKey(tag, quadKey, styleProvider, eleDataType,
+                   createMeshCallback(tag, meshCallback), elementCallback, *cancellationToken);
     }, errorCallback);
   }
 
+  /// Loads given quadKey passing meshes in compact form.
+  void loadQuadKey(int tag,
+                   const char *styleFile,
+                   const utymap::QuadKey &quadKey,
+                   const ElevationDataType &eleDataType,
+                   OnCompactMeshBuilt *meshCallback,
+                   OnElementLoaded *elementCallback,
+                   OnError *errorCallback,
+                   utymap::CancellationToken *cancellationToken) {
+    safeExecute([&]() {
+      auto &styleProvider = getStyleProvider(styleFile);
+      buildQuadKey(tag, quadKey, styleProvider, eleDataType,
+                   createMeshCallback(tag, meshCallback), elementCallback, *cancellationToken);
+    }, errorCallback);
+  }
+
+  /// Loads given quadKeys concurrently: quadkeys closest to given position are built first.
+  /// Callbacks are called from worker threads, but never simultaneously.
+  /// Returns when all quadkeys are processed.
+  void loadQuadKeys(const std::vector<int> &tags,
+                    const char *styleFile,
+                    const std::vector<utymap::QuadKey> &quadKeys,
+                    const utymap::GeoCoordinate &position,
+                    const ElevationDataType &eleDataType,
+                    OnMeshBuilt *meshCallback,
+                    OnElementLoaded *elementCallback,
+                    OnError *errorCallback,
+                    const std::vector<utymap::CancellationToken *> &cancellationTokens) {
+    const utymap::mapcss::StyleProvider *styleProvider = nullptr;
+    safeExecute([&]() { styleProvider = &getStyleProvider(styleFile); }, errorCallback);
+    if (styleProvider==nullptr) return;
+
+    std::vector<std::size_t> order(quadKeys.size());
+    std::vector<double> distances(quadKeys.size());
+    for (std::size_t i = 0; i < quadKeys.size(); ++i) {
+      order[i] = i;
+      auto center = utymap::utils::GeoUtils::quadKeyToBoundingBox(quadKeys[i]).center();
+      distances[i] = utymap::utils::GeoUtils::distance(position, center);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+      return distances[lhs] < distances[rhs];
+    });
+
+    std::mutex callbackLock;
+    std::vector<std::future<void>> results;
+    results.reserve(order.size());
+    for (auto i : order) {
+      results.push_back(threadPool_.enqueue([&, i]() {
+        if (cancellationTokens[i]->isCancelled()) return;
+        buildQuadKey(tags[i], quadKeys[i], *styleProvider, eleDataType,
+                     createMeshCallback(tags[i], meshCallback, &callbackLock),
+                     elementCallback, *cancellationTokens[i], &callbackLock);
+      }));
+    }
+
+    for (auto &result : results) {
+      safeExecute([&]() { result.get(); }, errorCallback);
+    }
+  }
+
+  /// Enables or disables profiling of quadkey builds. Previously collected data is discarded.
+  /// NOTE builds which are running keep profiler they have started with, so it stays alive until they finish.
+  void enableProfiling(bool enabled, bool isTraceEnabled) {
+    auto profiler = enabled ? std::make_shared<utymap::builders::BuildProfiler>(isTraceEnabled) : nullptr;
+    std::atomic_store(&profiler_, profiler);
+    quadKeyBuilder_.setProfiler(profiler);
+  }
+
+  /// Passes statistics of profiled build stages to callback.
+  void getProfilingStatistics(OnBuildStage *stageCallback) const {
+    auto profiler = std::atomic_load(&profiler_);
+    if (profiler==nullptr) return;
+
+    for (const auto &pair : profiler->getStatistics()) {
+      const auto &stage = pair.second;
+      stageCallback(pair.first.c_str(), stage.calls, stage.totalTime, stage.selfTime,
+                    stage.elements, stage.triangles, stage.bytes);
+    }
+  }
+
+  /// Writes profiled builds to file in chrome trace format.
+  void writeProfilingTrace(const char *path, OnError *errorCallback) const {
+    safeExecute([&]() {
+      auto profiler = std::atomic_load(&profiler_);
+      if (profiler==nullptr)
+        throw std::domain_error("Profiling is not enabled.");
+
+      std::ofstream traceFile(path);
+      if (!traceFile.good())
+        throw std::invalid_argument(std::string("Cannot write trace file:") + path);
+
+      profiler->writeTrace(traceFile);
+    }, errorCallback);
+  }
+
+  /// Removes collected profiling data.
+  void resetProfiling() {
+    auto profiler = std::atomic_load(&profiler_);
+    if (profiler!=nullptr)
+      profiler->reset();
+  }
+
+  /// Sets max size in bytes of processed terrain geometry kept between builds. Zero disables caching.
+  void setGeometryCacheSize(std::size_t size) {
+    quadKeyBuilder_.setGeometryCacheSize(size);
+  }
+
+  /// Removes processed terrain geometry kept between builds, e.g. after stylesheet is changed.
+  void clearGeometryCache() {
+    quadKeyBuilder_.clearGeometryCache();
+  }
+
   /// Gets id for the string.
   std::uint32_t getStringId(const char *str) const {
     return stringTable_.getId(str);
@@ -168,6 +277,63 @@ class Application {
 
  private:
 
+  typedef std::function<void(const utymap::math::Mesh &)> MeshCallback;
+
+  /// Creates callback which passes mesh buffers as they are.
+  static MeshCallback createMeshCallback(int tag, OnMeshBuilt *meshCallback, std::mutex *callbackLock = nullptr) {
+    return [meshCallback, tag, callbackLock](const utymap::math::Mesh &mesh) {
+      auto lock = lockCallback(callbackLock);
+      meshCallback(tag, mesh.name.data(),
+                   mesh.vertices.data(), static_cast<int>(mesh.vertices.size()),
+                   mesh.triangles.data(), static_cast<int>(mesh.triangles.size()),
+                   mesh.colors.data(), static_cast<int>(mesh.colors.size()),
+                   mesh.uvs.data(), static_cast<int>(mesh.uvs.size()),
+                   mesh.uvMap.data(), static_cast<int>(mesh.uvMap.size()));
+    };
+  }
+
+  /// Creates callback which converts mesh to compact form and passes pointers to its buffers.
+  static MeshCallback createMeshCallback(int tag, OnCompactMeshBuilt *meshCallback,
+                                         std::mutex *callbackLock = nullptr) {
+    return [meshCallback, tag, callbackLock](const utymap::math::Mesh &mesh) {
+      // NOTE conversion is done outside of lock.
+      auto compactMesh = utymap::builders::MeshBuilder::compact(mesh);
+      auto lock = lockCallback(callbackLock);
+      meshCallback(tag, compactMesh.name.data(), compactMesh.originX, compactMesh.originY,
+                   compactMesh.vertices.data(), static_cast<int>(compactMesh.vertices.size()),
+                   compactMesh.indexData(), static_cast<int>(compactMesh.indexCount()), compactMesh.indexSize(),
+                   compactMesh.uvMap.data(), static_cast<int>(compactMesh.uvMap.size()));
+    };
+  }
+
+  static std::unique_lock<std::mutex> lockCallback(std::mutex *callbackLock) {
+    return callbackLock!=nullptr ? std::unique_lock<std::mutex>(*callbackLock) : std::unique_lock<std::mutex>();
+  }
+
+  /// Builds quadkey notifying callbacks. Element callback is guarded by given lock if it is provided,
+  /// mesh callback is expected to be created with the same lock.
+  void buildQuadKey(int tag,
+                    const utymap::QuadKey &quadKey,
+                    const utymap::mapcss::StyleProvider &styleProvider,
+                    const ElevationDataType &eleDataType,
+                    const MeshCallback &meshCallback,
+                    OnElementLoaded *elementCallback,
+                    const utymap::CancellationToken &cancellationToken,
+                    std::mutex *callbackLock = nullptr) {
+    auto &eleProvider = getElevationProvider(quadKey, eleDataType);
+    ExportElementVisitor elementVisitor(tag, quadKey, stringTable_, styleProvider, eleProvider, elementCallback);
+    quadKeyBuilder_.build(
+        quadKey, styleProvider, eleProvider,
+        [&meshCallback](const utymap::math::Mesh &mesh) {
+          // NOTE do not notify if mesh is empty.
+          if (!mesh.vertices.empty())
+            meshCallback(mesh);
+        }, [&elementVisitor, callbackLock](const utymap::entities::Element &element) {
+          auto lock = lockCallback(callbackLock);
+          element.accept(elementVisitor);
+        }, cancellationToken);
+  }
+
   static void safeExecute(const std::function<void()> &action, OnError *errorCallback) {
     try {
       action();
@@ -209,19 +375,22 @@ class Application {
 
   void registerDefaultBuilders() {
     registerBuilder<utymap::builders::TerraBuilder>("terrain", true);
-    registerBuilder<utymap::builders::BuildingBuilder>("building");
-    registerBuilder<utymap::builders::TreeBuilder>("tree");
-    registerBuilder<utymap::builders::BarrierBuilder>("barrier");
-    registerBuilder<utymap::builders::LampBuilder>("lamp");
+    registerBuilder<utymap::builders::BuildingBuilder>("building", false, true);
+    registerBuilder<utymap::builders::TreeBuilder>("tree", false, true);
+    registerBuilder<utymap::builders::BarrierBuilder>("barrier", false, true);
+    registerBuilder<utymap::builders::LampBuilder>("lamp", false, true);
+    quadKeyBuilder_.setThreadPool(&threadPool_);
+    geoStore_.setThreadPool(&threadPool_);
   }
 
   template<typename Builder>
-  void registerBuilder(const std::string &name, bool useCache = false) {
+  void registerBuilder(const std::string &name, bool useCache = false, bool isParallel = false) {
     if (useCache)
       meshCaches_.emplace(name, utymap::utils::make_unique<utymap::builders::MeshCache>(indexPath_, name));
 
     quadKeyBuilder_
-        .registerElementBuilder(name, useCache ? createCacheFactory<Builder>(name) : createFactory<Builder>());
+        .registerElementBuilder(name, useCache ? createCacheFactory<Builder>(name) : createFactory<Builder>(),
+                                isParallel);
   }
 
   template<typename Builder>
@@ -257,8 +426,12 @@ class Application {
   utymap::heightmap::GridElevationProvider gridEleProvider_;
 
   utymap::builders::QuadKeyBuilder quadKeyBuilder_;
+  /// NOTE accessed only by atomic shared_ptr functions.
+  std::shared_ptr<utymap::builders::BuildProfiler> profiler_;
   std::unordered_map<std::string, std::unique_ptr<utymap::builders::MeshCache>> meshCaches_;
   std::unordered_map<std::string, std::unique_ptr<const utymap::mapcss::StyleProvider>> styleProviders_;
+
+  utymap::utils::ThreadPool threadPool_;
 };
 
 #endif // APPLICATION_HPP_DEFINED
@@ -16,6 +16,16 @@ typedef void OnMeshBuilt(int tag,                                // a request ta
                          const double *uvs, int uvSize,          // absolute texture uvs
                          const int *uvMap, int uvMapSize);       // map with info about used atlas and texture region
 
+/// Callback which is called when mesh is built in compact form.
+/// NOTE pointers refer to internal buffers and are valid only during the call.
+typedef void OnCompactMeshBuilt(int tag,                                // a request tag
+                                const char *name,                       // name
+                                double originX, double originY,         // origin of vertex positions
+                                const void *vertices, int vertexCount,  // interleaved float x, y, elevation, uint rgba color, float u, v
+                                const void *indices, int indexCount,    // triangle indices
+                                int indexSize,                          // index size in bytes: 2 or 4
+                                const int *uvMap, int uvMapSize);       // map with info about used atlas and texture region
+
 /// Callback which is called when element is loaded.
 typedef void OnElementLoaded(int tag,                                // a request tag
                              std::uint64_t id,                       // element id
@@ -23,6 +33,15 @@ typedef void OnElementLoaded(int tag,                                // a reques
                              const double *vertices, int vertexSize, // vertices (x, y, elevation)
                              const char **style, int styleSize);     // mapcss styles (key, value)
 
+/// Callback which is called for every profiled build stage.
+typedef void OnBuildStage(const char *name,        // stage name: builder name or build step
+                          std::uint64_t calls,     // amount of stage calls
+                          double totalTime,        // time including nested stages in microseconds
+                          double selfTime,         // time excluding nested stages in microseconds
+                          std::uint64_t elements,  // amount of processed elements
+                          std::uint64_t triangles, // amount of emitted triangles
+                          std::uint64_t bytes);    // size of emitted mesh buffers in bytes
+
 /// Callback which is called when error is occured.
 typedef void OnError(const char *errorMessage);
 
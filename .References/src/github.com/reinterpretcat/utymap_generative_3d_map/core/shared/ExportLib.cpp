@@ -38,6 +38,12 @@ void EXPORT_API registerInMemoryStore(const char *key) {
   applicationPtr->registerInMemoryStore(key);
 }
 
+/// Registers new in-memory store which packs elements compactly.
+/// It uses less memory, but coordinates are stored with 1e-7 degree precision.
+void EXPORT_API registerCompactInMemoryStore(const char *key) {
+  applicationPtr->registerCompactInMemoryStore(key);
+}
+
 /// Registers new persistent store.
 void EXPORT_API registerPersistentStore(const char *key,
                                         const char *dataPath,
@@ -50,6 +56,37 @@ void EXPORT_API enableMeshCache(int enabled) {
   applicationPtr->enableMeshCache(enabled > 0);
 }
 
+/// Enables or disables profiling of quadkey loading. Previously collected data is discarded.
+/// If trace is enabled, every build stage is kept to be written as chrome trace.
+void EXPORT_API enableProfiling(int enabled, int traceEnabled) {
+  applicationPtr->enableProfiling(enabled > 0, traceEnabled > 0);
+}
+
+/// Reports statistics of profiled build stages: one callback call per stage.
+void EXPORT_API getProfilingStatistics(OnBuildStage *stageCallback) {
+  applicationPtr->getProfilingStatistics(stageCallback);
+}
+
+/// Writes profiled build stages as chrome trace json which can be opened by chrome://tracing.
+void EXPORT_API writeProfilingTrace(const char *path, OnError *errorCallback) {
+  applicationPtr->writeProfilingTrace(path, errorCallback);
+}
+
+/// Removes collected profiling data.
+void EXPORT_API resetProfiling() {
+  applicationPtr->resetProfiling();
+}
+
+/// Sets max size in megabytes of processed terrain geometry kept between builds. Zero disables caching.
+void EXPORT_API setGeometryCacheSize(int sizeInMb) {
+  applicationPtr->setGeometryCacheSize(sizeInMb > 0 ? static_cast<std::size_t>(sizeInMb)*1024*1024 : 0);
+}
+
+/// Removes processed terrain geometry kept between builds.
+void EXPORT_API clearGeometryCache() {
+  applicationPtr->clearGeometryCache();
+}
+
 /// Adds data to store to specific level of details range.
 void EXPORT_API addToStoreInRange(const char *key,           // store key
                                   const char *styleFile,     // style file
@@ -153,6 +190,46 @@ void EXPORT_API loadQuadKey(int tag,                                 // request
                               meshCallback, elementCallback, errorCallback, cancellationToken);
 }
 
+/// Loads quadkey passing meshes in compact form: float interleaved vertices with
+/// merged duplicates and 16 or 32 bit indices. Pointers are valid only during callback call.
+void EXPORT_API loadQuadKeyCompact(int tag,                                 // request tag
+                                   const char *styleFile,                   // style file
+                                   int tileX, int tileY, int levelOfDetail, // quadkey info
+                                   int eleDataType,                         // elevation data type
+                                   OnCompactMeshBuilt *meshCallback,        // mesh callback
+                                   OnElementLoaded *elementCallback,        // element callback
+                                   OnError *errorCallback,                  // completion callback
+                                   utymap::CancellationToken *cancellationToken) {
+  utymap::QuadKey quadKey(levelOfDetail, tileX, tileY);
+  applicationPtr->loadQuadKey(tag, styleFile, quadKey, static_cast<Application::ElevationDataType>(eleDataType),
+                              meshCallback, elementCallback, errorCallback, cancellationToken);
+}
+
+/// Loads several quadkeys concurrently. Quadkeys closest to viewer position are built first.
+/// Returns when all quadkeys are loaded.
+void EXPORT_API loadQuadKeys(const int *tags,                         // request tags, one per quadkey
+                             const char *styleFile,                   // style file
+                             const int *quadKeys,                     // quadkey info: tileX, tileY, levelOfDetail
+                             int quadKeyCount,                        // amount of quadkeys
+                             double latitude,                         // viewer latitude
+                             double longitude,                        // viewer longitude
+                             int eleDataType,                         // elevation data type
+                             OnMeshBuilt *meshCallback,               // mesh callback
+                             OnElementLoaded *elementCallback,        // element callback
+                             OnError *errorCallback,                  // completion callback
+                             utymap::CancellationToken **cancellationTokens) { // tokens, one per quadkey
+  std::vector<int> requestTags(tags, tags + quadKeyCount);
+  std::vector<utymap::QuadKey> requestQuadKeys;
+  requestQuadKeys.reserve(static_cast<std::size_t>(quadKeyCount));
+  for (int i = 0; i < quadKeyCount; ++i)
+    requestQuadKeys.push_back(utymap::QuadKey(quadKeys[i*3 + 2], quadKeys[i*3], quadKeys[i*3 + 1]));
+  std::vector<utymap::CancellationToken *> tokens(cancellationTokens, cancellationTokens + quadKeyCount);
+
+  applicationPtr->loadQuadKeys(requestTags, styleFile, requestQuadKeys, utymap::GeoCoordinate(latitude, longitude),
+                               static_cast<Application::ElevationDataType>(eleDataType),
+                               meshCallback, elementCallback, errorCallback, tokens);
+}
+
 /// Checks whether there is data for given quadkey.
 bool EXPORT_API hasData(int tileX, int tileY, int levelOfDetail) {
   return applicationPtr->hasData(utymap::QuadKey(levelOfDetail, tileX, tileY));
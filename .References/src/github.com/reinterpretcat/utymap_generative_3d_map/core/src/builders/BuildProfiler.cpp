@@ -0,0 +1,139 @@
+#include "builders/BuildProfiler.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iomanip>
+
+using namespace utymap;
+using namespace utymap::builders;
+using namespace utymap::math;
+
+namespace {
+template<typename Duration>
+double toMicroseconds(const Duration &duration) {
+  return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(duration).count();
+}
+
+void writeString(std::ostream &stream, const std::string &str) {
+  stream << '"';
+  for (char c : str) {
+    if (c=='"' || c=='\\') stream << '\\';
+    if (static_cast<unsigned char>(c) >= 0x20) stream << c;
+  }
+  stream << '"';
+}
+}
+
+void BuildStageStatistics::merge(const BuildStageStatistics &other) {
+  calls += other.calls;
+  totalTime += other.totalTime;
+  selfTime += other.selfTime;
+  elements += other.elements;
+  triangles += other.triangles;
+  bytes += other.bytes;
+}
+
+BuildProfile::BuildProfile(const QuadKey &quadKey, bool isTraceEnabled) :
+    quadKey_(quadKey), isTraceEnabled_(isTraceEnabled) {
+}
+
+void BuildProfile::addElements(std::uint64_t count) {
+  if (!active_.empty())
+    active_.back().statistics->elements += count;
+}
+
+void BuildProfile::addMesh(const Mesh &mesh) {
+  if (active_.empty()) return;
+
+  auto &statistics = *active_.back().statistics;
+  statistics.triangles += mesh.triangles.size()/3;
+  statistics.bytes += mesh.vertices.size()*sizeof(double) + mesh.triangles.size()*sizeof(int) +
+      mesh.colors.size()*sizeof(int) + mesh.uvs.size()*sizeof(double) + mesh.uvMap.size()*sizeof(int);
+}
+
+void BuildProfile::merge(const BuildProfile &other) {
+  for (const auto &pair : other.stages_)
+    stages_[pair.first].merge(pair.second);
+
+  for (const auto &event : other.events_) {
+    const auto &name = stages_.find(*event.name)->first;
+    events_.push_back(TraceEvent{&name, event.start, event.duration, event.threadId});
+  }
+}
+
+void BuildProfile::start(const std::string &stage) {
+  auto &pair = *stages_.emplace(stage, BuildStageStatistics()).first;
+  active_.push_back(ActiveStage{&pair.second, &pair.first, Clock::now(), Clock::duration::zero()});
+}
+
+void BuildProfile::stop() {
+  auto end = Clock::now();
+  auto stage = active_.back();
+  active_.pop_back();
+
+  auto duration = end - stage.start;
+  ++stage.statistics->calls;
+  stage.statistics->totalTime += toMicroseconds(duration);
+  stage.statistics->selfTime += toMicroseconds(duration - stage.children);
+
+  if (!active_.empty())
+    active_.back().children += duration;
+
+  if (isTraceEnabled_)
+    events_.push_back(TraceEvent{stage.name, stage.start, duration, std::this_thread::get_id()});
+}
+
+BuildProfiler::BuildProfiler(bool isTraceEnabled) :
+    isTraceEnabled_(isTraceEnabled), origin_(Clock::now()), builds_(0) {
+}
+
+void BuildProfiler::merge(const BuildProfile &profile) {
+  std::string quadKey = utymap::utils::toString(profile.quadKey_.levelOfDetail) + '/' +
+      utymap::utils::toString(profile.quadKey_.tileX) + '/' + utymap::utils::toString(profile.quadKey_.tileY);
+  std::lock_guard<std::mutex> lock(lock_);
+  ++builds_;
+  for (const auto &pair : profile.stages_)
+    stages_[pair.first].merge(pair.second);
+
+  for (const auto &event : profile.events_) {
+    if (events_.size() >= MaxTraceEvents) break;
+    events_.push_back(TraceEvent{*event.name, quadKey, std::hash<std::thread::id>()(event.threadId),
+                                 toMicroseconds(event.start - origin_), toMicroseconds(event.duration)});
+  }
+}
+
+std::map<std::string, BuildStageStatistics> BuildProfiler::getStatistics() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return stages_;
+}
+
+std::uint64_t BuildProfiler::getBuildCount() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return builds_;
+}
+
+void BuildProfiler::writeTrace(std::ostream &stream) const {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto flags = stream.flags();
+  auto precision = stream.precision();
+  stream << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  for (std::size_t i = 0; i < events_.size(); ++i) {
+    const auto &event = events_[i];
+    stream << (i==0 ? "\n" : ",\n") << "{\"name\":";
+    writeString(stream, event.name);
+    stream << ",\"cat\":\"build\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+           << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+           << ",\"args\":{\"quadKey\":\"" << event.quadKey << "\"}}";
+  }
+  stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  stream.flags(flags);
+  stream.precision(precision);
+}
+
+void BuildProfiler::reset() {
+  std::lock_guard<std::mutex> lock(lock_);
+  stages_.clear();
+  events_.clear();
+  builds_ = 0;
+}
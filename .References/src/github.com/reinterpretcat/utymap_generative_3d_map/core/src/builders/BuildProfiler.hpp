@@ -0,0 +1,155 @@
+#ifndef BUILDERS_BUILDPROFILER_HPP_DEFINED
+#define BUILDERS_BUILDPROFILER_HPP_DEFINED
+
+#include "QuadKey.hpp"
+#include "math/Mesh.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace utymap {
+namespace builders {
+
+/// Statistics of one build stage.
+struct BuildStageStatistics final {
+  /// Amount of times stage was entered.
+  std::uint64_t calls = 0;
+  /// Time spent in stage including nested stages, in microseconds.
+  double totalTime = 0;
+  /// Time spent in stage excluding nested stages, in microseconds.
+  double selfTime = 0;
+  /// Amount of elements processed by stage.
+  std::uint64_t elements = 0;
+  /// Amount of triangles emitted by stage.
+  std::uint64_t triangles = 0;
+  /// Size of mesh buffers emitted by stage in bytes.
+  std::uint64_t bytes = 0;
+
+  void merge(const BuildStageStatistics &other);
+};
+
+/// Records stages of single quadkey build.
+/// NOTE it is not thread safe: each build uses its own profile.
+class BuildProfile final {
+  typedef std::chrono::steady_clock Clock;
+
+ public:
+  /// Measures stage until destroyed. Does nothing if profile is not set.
+  class Scope final {
+   public:
+    Scope(BuildProfile *profile, const std::string &stage) : profile_(profile) {
+      if (profile_!=nullptr) profile_->start(stage);
+    }
+
+    ~Scope() {
+      if (profile_!=nullptr) profile_->stop();
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    BuildProfile *profile_;
+  };
+
+  BuildProfile(const utymap::QuadKey &quadKey, bool isTraceEnabled);
+
+  /// Adds amount of processed elements to the current stage.
+  void addElements(std::uint64_t count);
+
+  /// Adds emitted mesh to the current stage.
+  void addMesh(const utymap::math::Mesh &mesh);
+
+  /// Adds stages of profile which was recorded in parallel, e.g. by other thread.
+  void merge(const BuildProfile &other);
+
+  bool isTraceEnabled() const { return isTraceEnabled_; }
+
+  /// Returns statistics of stages.
+  const std::unordered_map<std::string, BuildStageStatistics> &getStatistics() const { return stages_; }
+
+ private:
+  friend class BuildProfiler;
+
+  struct ActiveStage final {
+    BuildStageStatistics *statistics;
+    const std::string *name;
+    Clock::time_point start;
+    Clock::duration children;
+  };
+
+  struct TraceEvent final {
+    const std::string *name;
+    Clock::time_point start;
+    Clock::duration duration;
+    std::thread::id threadId;
+  };
+
+  void start(const std::string &stage);
+  void stop();
+
+  const utymap::QuadKey quadKey_;
+  const bool isTraceEnabled_;
+  std::unordered_map<std::string, BuildStageStatistics> stages_;
+  std::vector<ActiveStage> active_;
+  std::vector<TraceEvent> events_;
+};
+
+/// Aggregates profiles of quadkey builds and writes them as chrome trace.
+/// Stages are named "search", "style", "parallel", "triangulation", "meshCallback", "elementCallback"
+/// and after element builders, e.g. "terrain" or "building".
+class BuildProfiler final {
+  typedef std::chrono::steady_clock Clock;
+
+ public:
+  /// Creates profiler. If trace is enabled, every stage call is kept to be written as trace event.
+  explicit BuildProfiler(bool isTraceEnabled = false);
+
+  bool isTraceEnabled() const { return isTraceEnabled_; }
+
+  /// Adds results of finished build. Thread safe.
+  void merge(const BuildProfile &profile);
+
+  /// Returns statistics of all merged builds by stage name.
+  std::map<std::string, BuildStageStatistics> getStatistics() const;
+
+  /// Returns amount of merged builds.
+  std::uint64_t getBuildCount() const;
+
+  /// Writes trace events in chrome trace format which can be opened by chrome://tracing.
+  void writeTrace(std::ostream &stream) const;
+
+  /// Removes collected data.
+  void reset();
+
+ private:
+  /// Limits amount of kept trace events, newer events are dropped.
+  const static std::size_t MaxTraceEvents = 1 << 20;
+
+  struct TraceEvent final {
+    std::string name;
+    std::string quadKey;
+    std::size_t threadId;
+    double start;
+    double duration;
+  };
+
+  const bool isTraceEnabled_;
+  const Clock::time_point origin_;
+  mutable std::mutex lock_;
+  std::map<std::string, BuildStageStatistics> stages_;
+  std::vector<TraceEvent> events_;
+  std::uint64_t builds_;
+};
+
+}
+}
+
+#endif // BUILDERS_BUILDPROFILER_HPP_DEFINED
@@ -4,6 +4,7 @@
 #include "BoundingBox.hpp"
 #include "CancellationToken.hpp"
 #include "QuadKey.hpp"
+#include "builders/BuildProfiler.hpp"
 #include "builders/MeshBuilder.hpp"
 #include "heightmap/ElevationProvider.hpp"
 #include "mapcss/StyleProvider.hpp"
@@ -15,6 +16,8 @@
 namespace utymap {
 namespace builders {
 
+class RegionGeometryCache;
+
 /// Provides the way to access all dependencies needed by various element builders.
 struct BuilderContext final {
   typedef std::function<void(const utymap::math::Mesh &)> MeshCallback;
@@ -36,6 +39,10 @@ struct BuilderContext final {
   std::function<void(const utymap::entities::Element &)> elementCallback;
   /// Cancellation token.
   const utymap::CancellationToken &cancelToken;
+  /// Build profile. Null if profiling is disabled.
+  utymap::builders::BuildProfile *const profile;
+  /// Cache of processed terrain region geometry. Null if caching is disabled.
+  utymap::builders::RegionGeometryCache *const geometryCache;
   /// Mesh builder.
   const utymap::builders::MeshBuilder meshBuilder;
 
@@ -45,7 +52,9 @@ struct BuilderContext final {
                  const utymap::heightmap::ElevationProvider &eleProvider,
                  const MeshCallback &meshCallback,
                  const ElementCallback &elementCallback,
-                 const utymap::CancellationToken &cancelToken) :
+                 const utymap::CancellationToken &cancelToken,
+                 utymap::builders::BuildProfile *profile = nullptr,
+                 utymap::builders::RegionGeometryCache *geometryCache = nullptr) :
       quadKey(quadKey),
       boundingBox(utymap::utils::GeoUtils::quadKeyToBoundingBox(quadKey)),
       styleProvider(styleProvider),
@@ -54,7 +63,9 @@ struct BuilderContext final {
       meshCallback(meshCallback),
       elementCallback(elementCallback),
       cancelToken(cancelToken),
-      meshBuilder(quadKey, eleProvider) {
+      profile(profile),
+      geometryCache(geometryCache),
+      meshBuilder(quadKey, eleProvider, profile) {
   }
 };
 
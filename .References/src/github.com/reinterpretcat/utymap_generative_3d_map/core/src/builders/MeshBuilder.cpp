@@ -3,12 +3,16 @@
 
 #include "BoundingBox.hpp"
 #include "MeshBuilder.hpp"
+#include "builders/BuildProfiler.hpp"
 #include "triangle/triangle.h"
 #include "utils/CoreUtils.hpp"
 #include "utils/GeoUtils.hpp"
 #include "utils/GradientUtils.hpp"
 
+#include <cstring>
+#include <limits>
 #include <mutex>
+#include <unordered_map>
 
 using namespace utymap;
 using namespace utymap::builders;
@@ -20,6 +24,8 @@ namespace {
 // NOTE triangle library is not thread safe.
 std::mutex lock_;
 
+const std::string TriangulationStage = "triangulation";
+
 /// Creates texture mapping function.
 std::function<Vector2(double, double)> createMapFunc(const MeshBuilder::AppearanceOptions &appearanceOptions,
                                                      const BoundingBox &bbox) {
@@ -43,6 +49,45 @@ std::function<Vector2(double, double)> createMapFunc(const MeshBuilder::Appearan
   };
 }
 
+/// Key used to merge vertices: vertices from different texture regions are never merged.
+struct WeldKey final {
+  CompactVertex vertex;
+  std::uint32_t region;
+};
+
+static_assert(sizeof(WeldKey)==28, "Unexpected weld key size.");
+
+struct WeldKeyHash final {
+  std::size_t operator()(const WeldKey &key) const {
+    const auto *data = reinterpret_cast<const unsigned char *>(&key);
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < sizeof(WeldKey); ++i) {
+      hash ^= data[i];
+      hash *= 1099511628211ULL;
+    }
+    return static_cast<std::size_t>(hash);
+  }
+};
+
+struct WeldKeyEqual final {
+  bool operator()(const WeldKey &lhs, const WeldKey &rhs) const {
+    return std::memcmp(&lhs, &rhs, sizeof(WeldKey))==0;
+  }
+};
+
+/// Copies triangle indices into given buffer skipping triangles which became degenerate.
+template<typename T>
+void copyTriangles(const std::vector<int> &triangles, const std::vector<std::uint32_t> &remap, std::vector<T> &indices) {
+  indices.reserve(triangles.size());
+  for (std::size_t i = 0; i + 2 < triangles.size(); i += 3) {
+    auto i0 = remap[triangles[i]], i1 = remap[triangles[i + 1]], i2 = remap[triangles[i + 2]];
+    if (i0==i1 || i1==i2 || i0==i2) continue;
+    indices.push_back(static_cast<T>(i0));
+    indices.push_back(static_cast<T>(i1));
+    indices.push_back(static_cast<T>(i2));
+  }
+}
+
 void ensureMeshCapacity(Mesh &mesh, std::size_t pointCount, std::size_t triCount) {
   mesh.vertices.reserve(mesh.vertices.size() + pointCount*3/2);
   mesh.triangles.reserve(mesh.triangles.size() + triCount*3);
@@ -51,7 +96,7 @@ void ensureMeshCapacity(Mesh &mesh, std::size_t pointCount, std::size_t triCount
 }
 
 /// Fills mesh with all data needed to render object correctly outside core library.
-void fillMesh(triangulateio *io, QuadKey quadKey, const BoundingBox &bbox, Mesh &mesh,
+void fillMesh(const MeshBuilder::Triangulation &triangulation, QuadKey quadKey, const BoundingBox &bbox, Mesh &mesh,
               const ElevationProvider &eleProvider,
               const MeshBuilder::GeometryOptions &geometryOptions,
               const MeshBuilder::AppearanceOptions &appearanceOptions) {
@@ -60,22 +105,41 @@ void fillMesh(triangulateio *io, QuadKey quadKey, const BoundingBox &bbox, Mesh
   // prepare texture data
   const auto map = createMapFunc(appearanceOptions, bbox);
 
-  ensureMeshCapacity(mesh, static_cast<std::size_t>(io->numberofpoints),
-                     static_cast<std::size_t>(io->numberoftriangles));
+  const std::size_t pointCount = triangulation.points.size()/2;
+  const std::size_t triCount = triangulation.triangles.size()/3;
+  ensureMeshCapacity(mesh, pointCount, triCount);
+
+  // get elevations for all points at once
+  bool hasElevation = geometryOptions.elevation > std::numeric_limits<double>::lowest();
+  std::vector<double> elevations;
+  if (!hasElevation) {
+    std::vector<GeoCoordinate> coordinates;
+    coordinates.reserve(pointCount);
+    for (std::size_t i = 0; i < pointCount; i++)
+      coordinates.push_back(GeoCoordinate(triangulation.points[i*2 + 1], triangulation.points[i*2 + 0]));
+    elevations.resize(coordinates.size());
+    eleProvider.getElevations(quadKey, coordinates.data(), elevations.data(), coordinates.size());
+  }
+
+  // get noise for all points at once
+  std::vector<double> noises;
+  if (!triangulation.pointMarkers.empty()) {
+    noises.resize(pointCount);
+    NoiseUtils::perlin2D(triangulation.points.data(), triangulation.points.data() + 1, noises.data(), pointCount,
+                         geometryOptions.eleNoiseFreq, 2);
+  }
 
-  for (int i = 0; i < io->numberofpoints; i++) {
+  for (std::size_t i = 0; i < pointCount; i++) {
     // get coordinates
-    double x = io->pointlist[i*2 + 0];
-    double y = io->pointlist[i*2 + 1];
+    double x = triangulation.points[i*2 + 0];
+    double y = triangulation.points[i*2 + 1];
 
     double ele = geometryOptions.heightOffset +
-        (geometryOptions.elevation > std::numeric_limits<double>::lowest()
-         ? geometryOptions.elevation
-         : eleProvider.getElevation(quadKey, y, x));
+        (hasElevation ? geometryOptions.elevation : elevations[i]);
 
     // do no apply noise on boundaries
-    if (io->pointmarkerlist!=nullptr && io->pointmarkerlist[i]!=1)
-      ele += NoiseUtils::perlin2D(x, y, geometryOptions.eleNoiseFreq);
+    if (!triangulation.pointMarkers.empty() && triangulation.pointMarkers[i]!=1)
+      ele += noises[i];
 
     // set vertices
     mesh.vertices.push_back(x);
@@ -97,18 +161,33 @@ void fillMesh(triangulateio *io, QuadKey quadKey, const BoundingBox &bbox, Mesh
   int second = 0;
   int third = geometryOptions.flipSide ? 1 : 2;
 
-  for (int i = 0; i < io->numberoftriangles; i++) {
-    mesh.triangles.push_back(triStartIndex + io->trianglelist[i*io->numberofcorners + first]);
-    mesh.triangles.push_back(triStartIndex + io->trianglelist[i*io->numberofcorners + second]);
-    mesh.triangles.push_back(triStartIndex + io->trianglelist[i*io->numberofcorners + third]);
+  for (std::size_t i = 0; i < triCount; i++) {
+    mesh.triangles.push_back(triStartIndex + triangulation.triangles[i*3 + first]);
+    mesh.triangles.push_back(triStartIndex + triangulation.triangles[i*3 + second]);
+    mesh.triangles.push_back(triStartIndex + triangulation.triangles[i*3 + third]);
   }
 }
+
+/// Copies triangle library output which is owned by caller.
+MeshBuilder::Triangulation copyTriangulation(const triangulateio &io) {
+  MeshBuilder::Triangulation triangulation;
+  triangulation.points.assign(io.pointlist, io.pointlist + io.numberofpoints*2);
+  if (io.pointmarkerlist!=nullptr)
+    triangulation.pointMarkers.assign(io.pointmarkerlist, io.pointmarkerlist + io.numberofpoints);
+  triangulation.triangles.reserve(static_cast<std::size_t>(io.numberoftriangles*3));
+  for (int i = 0; i < io.numberoftriangles; i++)
+    for (int j = 0; j < 3; ++j)
+      triangulation.triangles.push_back(io.trianglelist[i*io.numberofcorners + j]);
+  return triangulation;
+}
 }
 
-MeshBuilder::MeshBuilder(const utymap::QuadKey &quadKey, const ElevationProvider &eleProvider) :
+MeshBuilder::MeshBuilder(const utymap::QuadKey &quadKey, const ElevationProvider &eleProvider,
+                         BuildProfile *profile) :
     quadKey_(quadKey),
     bbox_(GeoUtils::quadKeyToBoundingBox(quadKey)),
-    eleProvider_(eleProvider) {
+    eleProvider_(eleProvider),
+    profile_(profile) {
 }
 
 MeshBuilder::~MeshBuilder() {}
@@ -117,6 +196,19 @@ void MeshBuilder::addPolygon(Mesh &mesh,
                              Polygon &polygon,
                              const GeometryOptions &geometryOptions,
                              const AppearanceOptions &appearanceOptions) const {
+  addTriangulation(mesh, triangulate(polygon, geometryOptions), geometryOptions, appearanceOptions);
+}
+
+void MeshBuilder::addTriangulation(Mesh &mesh,
+                                   const Triangulation &triangulation,
+                                   const GeometryOptions &geometryOptions,
+                                   const AppearanceOptions &appearanceOptions) const {
+  fillMesh(triangulation, quadKey_, bbox_, mesh, eleProvider_, geometryOptions, appearanceOptions);
+}
+
+MeshBuilder::Triangulation MeshBuilder::triangulate(Polygon &polygon, const GeometryOptions &geometryOptions) const {
+  BuildProfile::Scope scope(profile_, TriangulationStage);
+  Triangulation triangulation;
   triangulateio in, mid;
 
   in.numberofpoints = static_cast<int>(polygon.points.size()/2);
@@ -144,7 +236,7 @@ void MeshBuilder::addPolygon(Mesh &mesh,
 
   // do not refine mesh if area is not set.
   if (std::abs(geometryOptions.area) < std::numeric_limits<double>::epsilon()) {
-    fillMesh(&mid, quadKey_, bbox_, mesh, eleProvider_, geometryOptions, appearanceOptions);
+    triangulation = copyTriangulation(mid);
     mid.trianglearealist = nullptr;
   } else {
 
@@ -170,7 +262,7 @@ void MeshBuilder::addPolygon(Mesh &mesh,
       ::triangulate(const_cast<char *>(triOptions.c_str()), &mid, &out, nullptr);
     }
 
-    fillMesh(&out, quadKey_, bbox_, mesh, eleProvider_, geometryOptions, appearanceOptions);
+    triangulation = copyTriangulation(out);
 
     free(out.pointlist);
     free(out.pointattributelist);
@@ -187,6 +279,8 @@ void MeshBuilder::addPolygon(Mesh &mesh,
   free(mid.trianglearealist);
   free(mid.segmentlist);
   free(mid.segmentmarkerlist);
+
+  return triangulation;
 }
 
 void MeshBuilder::addPlane(Mesh &mesh,
@@ -280,6 +374,56 @@ void MeshBuilder::writeTextureMappingInfo(Mesh &mesh, const AppearanceOptions &a
   mesh.uvMap.push_back(appearanceOptions.textureRegion.height);
 }
 
+CompactMesh MeshBuilder::compact(const Mesh &mesh) {
+  CompactMesh result(mesh.name);
+  const std::size_t vertexCount = mesh.vertices.size()/3;
+  if (vertexCount==0) return result;
+
+  result.originX = mesh.vertices[0];
+  result.originY = mesh.vertices[1];
+  result.vertices.reserve(vertexCount);
+
+  // texture region of the vertex is defined by uv offset stored as first value of each uv map entry.
+  const std::size_t regionCount = mesh.uvMap.size()/8;
+  std::vector<int> regionEnds(regionCount);
+  std::uint32_t region = 0;
+
+  std::vector<std::uint32_t> remap(vertexCount);
+  std::unordered_map<WeldKey, std::uint32_t, WeldKeyHash, WeldKeyEqual> welded(vertexCount);
+  for (std::size_t i = 0; i < vertexCount; ++i) {
+    while (region < regionCount && static_cast<int>(i*2) >= mesh.uvMap[region*8])
+      regionEnds[region++] = static_cast<int>(result.vertices.size()*2);
+
+    WeldKey key;
+    key.vertex.x = static_cast<float>(mesh.vertices[i*3] - result.originX);
+    key.vertex.y = static_cast<float>(mesh.vertices[i*3 + 1] - result.originY);
+    key.vertex.elevation = static_cast<float>(mesh.vertices[i*3 + 2]);
+    key.vertex.color = i < mesh.colors.size() ? static_cast<std::uint32_t>(mesh.colors[i]) : 0;
+    key.vertex.u = i*2 + 1 < mesh.uvs.size() ? static_cast<float>(mesh.uvs[i*2]) : 0;
+    key.vertex.v = i*2 + 1 < mesh.uvs.size() ? static_cast<float>(mesh.uvs[i*2 + 1]) : 0;
+    key.region = region;
+
+    auto index = static_cast<std::uint32_t>(result.vertices.size());
+    auto pair = welded.insert(std::make_pair(key, index));
+    if (pair.second)
+      result.vertices.push_back(key.vertex);
+    remap[i] = pair.first->second;
+  }
+  while (region < regionCount)
+    regionEnds[region++] = static_cast<int>(result.vertices.size()*2);
+
+  result.uvMap = mesh.uvMap;
+  for (std::size_t i = 0; i < regionCount; ++i)
+    result.uvMap[i*8] = regionEnds[i];
+
+  if (result.vertices.size() <= std::numeric_limits<std::uint16_t>::max() + std::size_t(1))
+    copyTriangles(mesh.triangles, remap, result.shortIndices);
+  else
+    copyTriangles(mesh.triangles, remap, result.longIndices);
+
+  return result;
+}
+
 void MeshBuilder::addVertex(Mesh &mesh, const Vector2 &p, double ele, int color, int triIndex, const Vector2 &uv) {
   mesh.vertices.push_back(p.x);
   mesh.vertices.push_back(p.y);
@@ -9,6 +9,7 @@
 #include "math/Polygon.hpp"
 #include "math/Vector2.hpp"
 #include "math/Vector3.hpp"
+#include "math/CompactMesh.hpp"
 #include "math/Mesh.hpp"
 
 #include <functional>
@@ -16,6 +17,8 @@
 namespace utymap {
 namespace builders {
 
+class BuildProfile;
+
 /// Provides the way to build mesh in 3D space.
 class MeshBuilder final {
  public:
@@ -87,9 +90,21 @@ class MeshBuilder final {
     }
   };
 
-  /// Creates builder with given elevation provider.
+  /// Represents result of polygon triangulation. It depends only on geometry options,
+  /// so it can be reused to build meshes with different appearance.
+  struct Triangulation final {
+    /// Point coordinates: x, y.
+    std::vector<double> points;
+    /// Boundary markers of points. Empty if not provided.
+    std::vector<int> pointMarkers;
+    /// Point indices of triangles.
+    std::vector<int> triangles;
+  };
+
+  /// Creates builder with given elevation provider. If profile is set, triangulation time is recorded.
   MeshBuilder(const utymap::QuadKey &quadKey,
-              const utymap::heightmap::ElevationProvider &eleProvider);
+              const utymap::heightmap::ElevationProvider &eleProvider,
+              utymap::builders::BuildProfile *profile = nullptr);
 
   ~MeshBuilder();
 
@@ -99,6 +114,16 @@ class MeshBuilder final {
                   const GeometryOptions &geometryOptions,
                   const AppearanceOptions &appearanceOptions) const;
 
+  /// Triangulates polygon using geometry options provided.
+  Triangulation triangulate(utymap::math::Polygon &polygon,
+                            const GeometryOptions &geometryOptions) const;
+
+  /// Adds triangulated polygon to existing mesh using options provided.
+  void addTriangulation(utymap::math::Mesh &mesh,
+                        const Triangulation &triangulation,
+                        const GeometryOptions &geometryOptions,
+                        const AppearanceOptions &appearanceOptions) const;
+
   /// Adds simple plane to existing mesh using options provided.
   void addPlane(utymap::math::Mesh &mesh,
                 const utymap::math::Vector2 &p1,
@@ -132,6 +157,10 @@ class MeshBuilder final {
   void writeTextureMappingInfo(utymap::math::Mesh &mesh,
                                const AppearanceOptions &appearanceOptions) const;
 
+  /// Converts mesh to compact form. Vertices with the same position, color and
+  /// texture coordinates inside one texture region are merged.
+  static utymap::math::CompactMesh compact(const utymap::math::Mesh &mesh);
+
  private:
 
   static void addVertex(utymap::math::Mesh &mesh,
@@ -147,6 +176,7 @@ class MeshBuilder final {
   const utymap::QuadKey quadKey_;
   const utymap::BoundingBox bbox_;
   const utymap::heightmap::ElevationProvider &eleProvider_;
+  utymap::builders::BuildProfile *const profile_;
 };
 
 }
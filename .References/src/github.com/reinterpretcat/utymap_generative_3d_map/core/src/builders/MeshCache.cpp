@@ -1,9 +1,14 @@
 #include "builders/MeshCache.hpp"
 #include "index/ElementStream.hpp"
-#include "index/MeshStream.hpp"
+#include "utils/MappedFile.hpp"
 
+#include <boost/crc.hpp>
+
+#include <cstring>
 #include <fstream>
 #include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 using namespace utymap;
 using namespace utymap::builders;
@@ -13,14 +18,144 @@ using namespace utymap::math;
 using namespace utymap::utils;
 
 namespace {
-const char ElementType = 0;
-const char MeshType = 1;
+const std::uint8_t ElementType = 0;
+const std::uint8_t MeshType = 1;
+
+const char CacheMagic[4] = {'U', 'M', 'C', 'H'};
+const std::uint32_t CacheVersion = 1;
+
+/// Header is written when all records are written, so incomplete file has no valid header.
+struct CacheHeader final {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t tagHash;
+  std::uint32_t recordCount;
+  std::uint32_t crc;
+  std::uint32_t reserved;
+};
+
+/// Precedes every record. Record data follows immediately.
+struct RecordHeader final {
+  std::uint8_t type;
+  std::uint8_t reserved[3];
+  std::uint32_t size;
+};
+
+static_assert(sizeof(CacheHeader)==24, "Unexpected cache header size.");
+static_assert(sizeof(RecordHeader)==8, "Unexpected record header size.");
+
+std::uint32_t getCrc(const char *data, std::size_t size) {
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+  return crc.checksum();
+}
+
+template<typename T>
+void append(std::string &buffer, const T &data) {
+  buffer.append(reinterpret_cast<const char *>(&data), sizeof(data));
+}
+
+template<typename T>
+void append(std::string &buffer, const std::vector<T> &data) {
+  append(buffer, static_cast<std::uint32_t>(data.size()));
+  buffer.append(reinterpret_cast<const char *>(data.data()), data.size()*sizeof(T));
+}
+
+/// Reads data from memory range checking bounds.
+class RecordReader final {
+ public:
+  RecordReader(const char *data, std::size_t size) : data_(data), end_(data + size) {}
+
+  template<typename T>
+  T read() {
+    T value;
+    std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  template<typename T>
+  void read(std::vector<T> &data) {
+    auto size = read<std::uint32_t>();
+    const char *source = take(size*sizeof(T));
+    data.resize(size);
+    if (size > 0) std::memcpy(data.data(), source, size*sizeof(T));
+  }
+
+  std::string readString() {
+    auto size = read<std::uint32_t>();
+    return std::string(take(size), size);
+  }
+
+ private:
+  const char *take(std::size_t size) {
+    if (static_cast<std::size_t>(end_ - data_) < size)
+      throw std::invalid_argument("Cannot read cache.");
+    const char *current = data_;
+    data_ += size;
+    return current;
+  }
+
+  const char *data_;
+  const char *end_;
+};
+
+/// Encodes mesh as plain arrays which can be copied back with memcpy.
+void writeMesh(std::string &buffer, const Mesh &mesh) {
+  append(buffer, static_cast<std::uint32_t>(mesh.name.size()));
+  buffer.append(mesh.name);
+  append(buffer, mesh.vertices);
+  append(buffer, mesh.triangles);
+  append(buffer, mesh.colors);
+  append(buffer, mesh.uvs);
+  append(buffer, mesh.uvMap);
+}
+
+Mesh readMesh(const char *data, std::size_t size) {
+  RecordReader reader(data, size);
+  Mesh mesh(reader.readString());
+  reader.read(mesh.vertices);
+  reader.read(mesh.triangles);
+  reader.read(mesh.colors);
+  reader.read(mesh.uvs);
+  reader.read(mesh.uvMap);
+  return mesh;
+}
 }
 
 class MeshCache::MeshCacheImpl {
   using MeshCallback = BuilderContext::MeshCallback;
   using ElementCallback = BuilderContext::ElementCallback;
 
+  /// State of cache file known by this instance.
+  /// Complete file has valid header, verified one has also passed data check.
+  /// Invalid file has failed data check and is removed once it has no readers.
+  enum class FileState { Missing, Writing, Complete, Verified, Invalid };
+
+  /// Accumulates records of one quadkey.
+  struct Writer final {
+    explicit Writer(const std::string &filePath) :
+        file(filePath, std::ios::out | std::ios::binary | std::ios::trunc), recordCount(0) {
+      // NOTE reserve space for header which is written on completion.
+      CacheHeader header = {};
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    void write(std::uint8_t type, const std::string &data) {
+      RecordHeader header = {type, {0, 0, 0}, static_cast<std::uint32_t>(data.size())};
+      std::lock_guard<std::mutex> lock(mutex);
+      file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      file.write(data.data(), data.size());
+      crc.process_bytes(&header, sizeof(header));
+      crc.process_bytes(data.data(), data.size());
+      ++recordCount;
+    }
+
+    std::ofstream file;
+    boost::crc_32_type crc;
+    std::uint32_t recordCount;
+    std::mutex mutex;
+  };
+
  public:
   explicit MeshCacheImpl(const std::string &dataPath, const std::string &extension) :
       dataPath_(dataPath),
@@ -30,57 +165,99 @@ class MeshCache::MeshCacheImpl {
     auto filePath = getFilePath(context);
 
     std::lock_guard<std::mutex> lock(lock_);
-    return isCacheHit(context.quadKey, filePath) ? context : wrap(context, filePath);
+    // NOTE invalid file cannot be rewritten until its readers unmap it.
+    return getState(filePath, context)!=FileState::Missing ? context : wrap(context, filePath);
   }
 
   bool fetch(const BuilderContext &context) {
     auto filePath = getFilePath(context);
 
+    bool checkData;
     {
       std::lock_guard<std::mutex> lock(lock_);
-      if (!isCacheHit(context.quadKey, filePath))
+      auto state = getState(filePath, context);
+      if (state!=FileState::Complete && state!=FileState::Verified)
         return false;
+      checkData = state==FileState::Complete;
+      ++readers_[filePath];
     }
 
-    readCache(filePath, context);
-
-    return true;
+    // NOTE file is read without lock: complete files are never modified or removed while they have readers.
+    try {
+      MappedFile file(filePath);
+      bool isFileValid = !checkData || isValid(file, getTagHash(context), true);
+      {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto &state = states_[filePath];
+        if (!isFileValid)
+          state = FileState::Invalid;
+        else if (state==FileState::Complete)
+          state = FileState::Verified;
+      }
+      if (isFileValid)
+        readCache(file, context);
+      release(filePath);
+      return isFileValid;
+    } catch (...) {
+      release(filePath);
+      throw;
+    }
   }
 
   void unwrap(const BuilderContext &context) {
-    std::lock_guard<std::mutex> lock(lock_);
-
-    auto entry = cachingQuads_.find(context.quadKey);
+    auto filePath = getFilePath(context);
 
-    if (entry==cachingQuads_.end()) return;
+    std::lock_guard<std::mutex> lock(lock_);
 
-    if (entry->second->good()) {
-      if (context.cancelToken.isCancelled()) {
-        // NOTE no guarantee that all data was processed and saved.
-        // So it is better to delete the whole file
-        entry->second->close();
-        std::remove(getFilePath(context).c_str());
-      } else {
-        entry->second->seekg(0, std::ios::beg);
-        *entry->second << static_cast<char>(1);
-        entry->second->close();
-      }
+    auto entry = writers_.find(filePath);
+    if (entry==writers_.end()) return;
+
+    auto &writer = *entry->second;
+    if (writer.file.good() && !context.cancelToken.isCancelled()) {
+      CacheHeader header = {{CacheMagic[0], CacheMagic[1], CacheMagic[2], CacheMagic[3]},
+                            CacheVersion, getTagHash(context), writer.recordCount, writer.crc.checksum(), 0};
+      writer.file.seekp(0, std::ios::beg);
+      writer.file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      writer.file.close();
+      states_[filePath] = writer.file.fail() ? FileState::Missing : FileState::Complete;
+    } else {
+      // NOTE no guarantee that all data was processed and saved.
+      // So it is better to delete the whole file. It has no readers as it is not complete.
+      writer.file.close();
+      std::remove(filePath.c_str());
+      states_[filePath] = FileState::Missing;
     }
 
-    cachingQuads_.erase(entry);
+    writers_.erase(entry);
   }
 
  private:
 
-  /// Checks whether the data associated with given context is already cached on disk.
-  bool isCacheHit(const QuadKey &quadKey, const std::string &filePath) const {
-    // NOTE if quadkey is preset in collection, then caching is in progress.
-    // in this case, we let app to behaviour as there is no cache at all
-    if (cachingQuads_.find(quadKey) != cachingQuads_.end()) return false;
-    // NOTE if file is on disk, it should be processed.
-    std::ifstream file(filePath, std::ios::in | std::ios::binary | std::ios::ate);
-    file.seekg(0, std::ios::beg);
-    return isGood(file);
+  /// Releases reader of cache file removing the file if it is invalid and has no readers left.
+  void release(const std::string &filePath) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto readers = readers_.find(filePath);
+    if (--readers->second > 0) return;
+
+    readers_.erase(readers);
+    auto &state = states_[filePath];
+    if (state==FileState::Invalid) {
+      std::remove(filePath.c_str());
+      state = FileState::Missing;
+    }
+  }
+
+  /// Gets state of cache file. File system is checked only once per file, then
+  /// the state is maintained in memory as all changes are done through this instance.
+  FileState getState(const std::string &filePath, const BuilderContext &context) {
+    auto state = states_.find(filePath);
+    if (state!=states_.end())
+      return state->second;
+
+    MappedFile file(filePath);
+    auto result = isValid(file, getTagHash(context), false) ? FileState::Complete : FileState::Missing;
+    states_.insert(std::make_pair(filePath, result));
+    return result;
   }
 
   /// Gets path to cache file on disk.
@@ -92,77 +269,110 @@ class MeshCache::MeshCacheImpl {
     return ss.str();
   }
 
+  static std::uint32_t getTagHash(const BuilderContext &context) {
+    const auto &tag = context.styleProvider.getTag();
+    return getCrc(tag.data(), tag.size());
+  }
+
   BuilderContext wrap(const BuilderContext &context, const std::string &filePath) {
-    auto file = std::make_shared<std::fstream>();
-    file->open(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
-    // NOTE marker that processing in progress
-    *file << static_cast<char>(0);
+    auto writer = std::make_shared<Writer>(filePath);
 
-    cachingQuads_.insert({context.quadKey, file});
+    writers_.insert({filePath, writer});
+    states_[filePath] = FileState::Writing;
 
     return BuilderContext(
         context.quadKey,
         context.styleProvider,
         context.stringTable,
         context.eleProvider,
-        wrap(*file, context.meshCallback, context.cancelToken),
-        wrap(*file, context.elementCallback, context.cancelToken),
-        context.cancelToken);
+        wrap(*writer, context.meshCallback, context.cancelToken),
+        wrap(*writer, context.elementCallback, context.cancelToken),
+        context.cancelToken,
+        context.profile,
+        context.geometryCache);
   }
 
-  static MeshCallback wrap(std::ostream &stream, const MeshCallback &callback, const CancellationToken &token) {
+  static MeshCallback wrap(Writer &writer, const MeshCallback &callback, const CancellationToken &token) {
     return [&](const Mesh &mesh) {
       if (token.isCancelled()) return;
-      stream << MeshType;
-      MeshStream::write(stream, mesh);
+      std::string data;
+      writeMesh(data, mesh);
+      writer.write(MeshType, data);
       callback(mesh);
     };
   }
 
-  static ElementCallback wrap(std::ostream &stream, const ElementCallback &callback, const CancellationToken &token) {
+  static ElementCallback wrap(Writer &writer, const ElementCallback &callback, const CancellationToken &token) {
     return [&](const Element &element) {
       if (token.isCancelled()) return;
-      stream << ElementType;
+      std::stringstream stream;
       stream.write(reinterpret_cast<const char *>(&element.id), sizeof(element.id));
       ElementStream::write(stream, element);
+      writer.write(ElementType, stream.str());
       callback(element);
     };
   }
 
-  static void readCache(std::string &filePath, const BuilderContext &context) {
-    std::fstream file;
-    file.open(filePath, std::ios::in | std::ios::binary | std::ios::app | std::ios::ate);
-    file.seekg(0, std::ios::beg);
-    
-    if (!isGood(file)) return;
+  static void readCache(const MappedFile &file, const BuilderContext &context) {
+    const char *data = file.data() + sizeof(CacheHeader);
+    const char *end = file.data() + file.size();
 
-    while (!context.cancelToken.isCancelled()) {
-      char type;
-      if (!(file >> type)) break;
+    while (data < end && !context.cancelToken.isCancelled()) {
+      RecordHeader header;
+      std::memcpy(&header, data, sizeof(header));
+      data += sizeof(header);
 
-      if (type==MeshType)
-        context.meshCallback(MeshStream::read(file));
-      else if (type==ElementType) {
+      if (header.type==MeshType)
+        context.meshCallback(readMesh(data, header.size));
+      else if (header.type==ElementType) {
+        MemoryStreamBuf buffer(data, header.size);
+        std::istream stream(&buffer);
         std::uint64_t id;
-        file.read(reinterpret_cast<char *>(&id), sizeof(id));
-        context.elementCallback(*ElementStream::read(file, id));
+        stream.read(reinterpret_cast<char *>(&id), sizeof(id));
+        context.elementCallback(*ElementStream::read(stream, id));
       } else
         throw std::invalid_argument("Cannot read cache.");
+
+      data += header.size;
     }
   }
 
-  static bool isGood(std::istream& stream) {
-    if (!stream.good()) return false;
-
-    char status;
-    stream >> status;
-    return status == 1;
+  /// Checks header and, optionally, record structure and checksum.
+  static bool isValid(const MappedFile &file, std::uint32_t tagHash, bool checkData) {
+    if (file.size() < sizeof(CacheHeader)) return false;
+
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic))!=0 ||
+        header.version!=CacheVersion || header.tagHash!=tagHash)
+      return false;
+
+    if (!checkData) return true;
+
+    const char *data = file.data() + sizeof(CacheHeader);
+    std::size_t size = file.size() - sizeof(CacheHeader);
+    if (getCrc(data, size)!=header.crc) return false;
+
+    // NOTE records are validated here, so replaying does not check bounds.
+    std::uint32_t count = 0;
+    for (std::size_t offset = 0; offset < size; ++count) {
+      if (size - offset < sizeof(RecordHeader)) return false;
+      RecordHeader record;
+      std::memcpy(&record, data + offset, sizeof(record));
+      offset += sizeof(record);
+      if (size - offset < record.size) return false;
+      offset += record.size;
+    }
+    return count==header.recordCount;
   }
 
   const std::string dataPath_;
   const std::string extension_;
   std::mutex lock_;
-  std::map<QuadKey, std::shared_ptr<std::fstream>, QuadKey::Comparator> cachingQuads_;
+  std::unordered_map<std::string, FileState> states_;
+  /// Amount of threads which have cache file mapped.
+  std::unordered_map<std::string, int> readers_;
+  std::unordered_map<std::string, std::shared_ptr<Writer>> writers_;
 };
 
 MeshCache::MeshCache(const std::string &directory, const std::string &extension) :
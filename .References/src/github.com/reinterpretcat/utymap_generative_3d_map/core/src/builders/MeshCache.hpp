@@ -9,6 +9,8 @@ namespace utymap {
 namespace builders {
 
 /// Provides the way to cache built meshes to speed up performance.
+/// Each quadkey is stored in separate binary file with checksummed records. Files which
+/// are complete are read concurrently while other quadkeys are being written.
 class MeshCache final {
  public:
   MeshCache(const std::string &directory, const std::string &extension);
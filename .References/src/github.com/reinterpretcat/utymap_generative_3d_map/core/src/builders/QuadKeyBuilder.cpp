@@ -1,7 +1,18 @@
 #include "builders/BuilderContext.hpp"
 #include "builders/ExternalBuilder.hpp"
 #include "builders/QuadKeyBuilder.hpp"
+#include "builders/terrain/RegionGeometryCache.hpp"
 
+#include "entities/Area.hpp"
+#include "entities/Node.hpp"
+#include "entities/Relation.hpp"
+#include "entities/Way.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <set>
 
 using namespace utymap;
@@ -13,13 +24,136 @@ using namespace utymap::mapcss;
 using namespace utymap::math;
 
 namespace {
-typedef std::unordered_map<std::string, QuadKeyBuilder::ElementBuilderFactory> BuilderFactoryMap;
+/// Registered element builder.
+struct BuilderRegistration final {
+  QuadKeyBuilder::ElementBuilderFactory factory;
+  bool isParallel;
+};
+
+typedef std::unordered_map<std::string, BuilderRegistration> BuilderFactoryMap;
+
+const std::string SearchStage = "search";
+const std::string StyleStage = "style";
+const std::string ParallelStage = "parallel";
+const std::string MeshCallbackStage = "meshCallback";
+const std::string ElementCallbackStage = "elementCallback";
+
+/// Minimal amount of elements in one partition of parallel builders.
+const std::size_t MinPartitionSize = 16;
+/// Amount of partitions per worker thread: smaller partitions balance load better.
+const std::size_t PartitionsPerThread = 4;
+/// Default max size in bytes of processed terrain region geometry kept between builds.
+const std::size_t DefaultGeometryCacheSize = 64*1024*1024;
+
+/// Copies visited element to keep it after visiting.
+class ElementCopier final : public ElementVisitor {
+ public:
+  void visitNode(const Node &node) override { element = std::make_shared<Node>(node); }
+
+  void visitWay(const Way &way) override { element = std::make_shared<Way>(way); }
+
+  void visitArea(const Area &area) override { element = std::make_shared<Area>(area); }
+
+  void visitRelation(const Relation &relation) override { element = std::make_shared<Relation>(relation); }
+
+  std::shared_ptr<const Element> element;
+};
+
+std::shared_ptr<const Element> copyElement(const Element &element) {
+  ElementCopier copier;
+  element.accept(copier);
+  return copier.element;
+}
+
+std::unique_ptr<Mesh> copyMesh(const Mesh &mesh) {
+  auto copy = utymap::utils::make_unique<Mesh>(mesh.name);
+  copy->vertices = mesh.vertices;
+  copy->triangles = mesh.triangles;
+  copy->colors = mesh.colors;
+  copy->uvs = mesh.uvs;
+  copy->uvMap = mesh.uvMap;
+  return copy;
+}
+
+/// Calls task for every index in [0, count) using thread pool. Calling thread processes indices too,
+/// so it never waits for tasks which are not started: the pool can be the same which runs builds.
+void runParallel(utymap::utils::ThreadPool *threadPool,
+                 std::size_t count,
+                 const std::function<void(std::size_t)> &task) {
+  struct State final {
+    std::function<void(std::size_t)> task;
+    std::size_t count;
+    std::atomic<std::size_t> next;
+    std::size_t done;
+    std::exception_ptr error;
+    std::mutex lock;
+    std::condition_variable condition;
+  };
+
+  auto state = std::make_shared<State>();
+  state->task = task;
+  state->count = count;
+  state->next = 0;
+  state->done = 0;
+
+  // NOTE workers which are started after all indices are taken exit without touching the task.
+  auto worker = [state]() {
+    std::size_t index;
+    while ((index = state->next++) < state->count) {
+      std::exception_ptr error;
+      try {
+        state->task(index);
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(state->lock);
+      if (error!=nullptr && state->error==nullptr)
+        state->error = error;
+      if (++state->done==state->count)
+        state->condition.notify_all();
+    }
+  };
+
+  std::size_t helpers = threadPool==nullptr ? 0 : std::min(threadPool->size(), count) - 1;
+  for (std::size_t i = 0; i < helpers; ++i)
+    threadPool->enqueue(worker);
+  worker();
+
+  std::unique_lock<std::mutex> lock(state->lock);
+  state->condition.wait(lock, [&]() { return state->done==state->count; });
+  if (state->error!=nullptr)
+    std::rethrow_exception(state->error);
+}
 
 /// Responsible for processing elements of quadkey in consistent way.
+/// Elements of parallel builders are kept until completion, then they are split into partitions
+/// which are built concurrently. Results of partitions are reported in the order of elements,
+/// so output does not depend on amount of threads.
 class BuilderElementVisitor : public ElementVisitor {
+  /// Element which should be built by parallel builder.
+  struct ParallelTask final {
+    std::shared_ptr<const Element> element;
+    const std::string *builder;
+  };
+
+  /// Mesh or element reported by parallel builder.
+  struct Output final {
+    std::unique_ptr<Mesh> mesh;
+    std::shared_ptr<const Element> element;
+  };
+
+  /// Results of one partition of parallel tasks.
+  struct Partition final {
+    std::unique_ptr<BuildProfile> profile;
+    std::vector<Output> outputs;
+  };
+
  public:
-  BuilderElementVisitor(const BuilderContext &context, BuilderFactoryMap &builderFactoryMap) :
-    context_(context), builderFactoryMap_(builderFactoryMap) { }
+  BuilderElementVisitor(const BuilderContext &context,
+                        BuilderFactoryMap &builderFactoryMap,
+                        utymap::utils::ThreadPool *threadPool) :
+    context_(context), builderFactoryMap_(builderFactoryMap), threadPool_(threadPool), profile_(context.profile) { }
 
   void visitNode(const Node &node) override {
     visitElement(node);
@@ -44,7 +178,11 @@ class BuilderElementVisitor : public ElementVisitor {
   }
 
   void complete() {
+    // NOTE meshes of parallel builders go before ones reported by completion of sequential builders.
+    buildParallel();
+
     for (const auto &builder : builders_) {
+      BuildProfile::Scope scope(profile_, builder.first);
       builder.second->complete();
     }
   }
@@ -52,18 +190,41 @@ class BuilderElementVisitor : public ElementVisitor {
  private:
   /// Calls appropriate visitor for given element
   void visitElement(const Element &element) {
-    Style style = context_.styleProvider.forElement(element, context_.quadKey.levelOfDetail);
+    addElement();
+    Style style = getStyle(element);
 
     if (canBuild(element, style)) {
 
       ids_.insert(element.id);
 
+      std::shared_ptr<const Element> copy;
       for (const auto &name : style.getBuilders()) {
+        auto registration = builderFactoryMap_.find(name);
+        if (registration!=builderFactoryMap_.end() && registration->second.isParallel) {
+          if (copy==nullptr) copy = copyElement(element);
+          tasks_.push_back(ParallelTask{copy, &registration->first});
+          continue;
+        }
+
+        BuildProfile::Scope scope(profile_, name);
+        addElement();
         element.accept(getBuilder(name));
       }
     }
   }
 
+  Style getStyle(const Element &element) {
+    BuildProfile::Scope scope(profile_, StyleStage);
+    addElement();
+    return context_.styleProvider.forElement(element, context_.quadKey.levelOfDetail);
+  }
+
+  /// Counts element in the current profile stage.
+  void addElement() {
+    if (profile_!=nullptr)
+      profile_->addElements(1);
+  }
+
   bool canBuild(const Element &element, const Style &style) {
     // check do we know how to build it and prevent multiple building
     return !style.empty() && (element.id==0 || ids_.find(element.id)==ids_.end());
@@ -74,31 +235,123 @@ class BuilderElementVisitor : public ElementVisitor {
     if (builderPair!=builders_.end())
       return *builderPair->second;
 
-    auto factory = builderFactoryMap_.find(name);
-    builders_.emplace(name, factory==builderFactoryMap_.end()
-      ? utymap::utils::make_unique<ExternalBuilder>(context_) // use external builder by default
-      : factory->second(context_));
-
-    auto &builder = *builders_[name];
+    auto &builder = *builders_.emplace(name, createBuilder(name, context_)).first->second;
     builder.prepare();
 
     return builder;
   }
 
+  std::unique_ptr<ElementBuilder> createBuilder(const std::string &name, const BuilderContext &context) const {
+    auto registration = builderFactoryMap_.find(name);
+    return registration==builderFactoryMap_.end()
+           ? utymap::utils::make_unique<ExternalBuilder>(context) // use external builder by default
+           : registration->second.factory(context);
+  }
+
+  /// Builds elements of parallel builders and reports results in the order of elements.
+  void buildParallel() {
+    if (tasks_.empty()) return;
+
+    std::size_t threadCount = threadPool_==nullptr ? 1 : threadPool_->size();
+    std::size_t count = std::max<std::size_t>(1, std::min(tasks_.size()/MinPartitionSize,
+                                                          threadCount*PartitionsPerThread));
+    std::vector<Partition> partitions(count);
+    {
+      BuildProfile::Scope scope(profile_, ParallelStage);
+      runParallel(threadPool_, count, [&](std::size_t index) {
+        buildPartition(index*tasks_.size()/count, (index + 1)*tasks_.size()/count, partitions[index]);
+      });
+    }
+
+    for (const auto &partition : partitions) {
+      if (profile_!=nullptr)
+        profile_->merge(*partition.profile);
+
+      for (const auto &output : partition.outputs) {
+        if (output.mesh!=nullptr)
+          context_.meshCallback(*output.mesh);
+        else
+          context_.elementCallback(*output.element);
+      }
+    }
+    tasks_.clear();
+  }
+
+  /// Builds range of parallel tasks by own builder instances keeping their results.
+  void buildPartition(std::size_t begin, std::size_t end, Partition &partition) const {
+    if (profile_!=nullptr)
+      partition.profile = utymap::utils::make_unique<BuildProfile>(context_.quadKey, profile_->isTraceEnabled());
+
+    auto profile = partition.profile.get();
+    auto &outputs = partition.outputs;
+    BuilderContext context(context_.quadKey, context_.styleProvider, context_.stringTable, context_.eleProvider,
+      [profile, &outputs](const Mesh &mesh) {
+        if (profile!=nullptr) profile->addMesh(mesh);
+        outputs.push_back(Output{copyMesh(mesh), nullptr});
+      },
+      [&outputs](const Element &element) {
+        outputs.push_back(Output{nullptr, copyElement(element)});
+      }, context_.cancelToken, profile, context_.geometryCache);
+
+    // NOTE vector keeps the order of builder completion deterministic.
+    std::vector<std::pair<const std::string *, std::unique_ptr<ElementBuilder>>> builders;
+    for (std::size_t i = begin; i < end && !context_.cancelToken.isCancelled(); ++i) {
+      const auto &task = tasks_[i];
+      auto builder = std::find_if(builders.begin(), builders.end(),
+                                  [&](const std::pair<const std::string *, std::unique_ptr<ElementBuilder>> &pair) {
+                                    return pair.first==task.builder;
+                                  });
+      if (builder==builders.end()) {
+        builders.push_back(std::make_pair(task.builder, createBuilder(*task.builder, context)));
+        builder = builders.end() - 1;
+        builder->second->prepare();
+      }
+
+      BuildProfile::Scope scope(profile, *task.builder);
+      if (profile!=nullptr) profile->addElements(1);
+      task.element->accept(*builder->second);
+    }
+
+    for (const auto &builder : builders) {
+      BuildProfile::Scope scope(profile, *builder.first);
+      builder.second->complete();
+    }
+  }
+
   const BuilderContext &context_;
   BuilderFactoryMap &builderFactoryMap_;
+  utymap::utils::ThreadPool *threadPool_;
+  BuildProfile *profile_;
   std::set<std::uint64_t> ids_;
   std::unordered_map<std::string, std::unique_ptr<ElementBuilder>> builders_;
+  std::vector<ParallelTask> tasks_;
 };
 }
 
 class QuadKeyBuilder::QuadKeyBuilderImpl {
  public:
   QuadKeyBuilderImpl(GeoStore &geoStore, StringTable &stringTable) :
-      geoStore_(geoStore), stringTable_(stringTable), builderFactory_() {}
+      geoStore_(geoStore), stringTable_(stringTable), builderFactory_(), threadPool_(nullptr), profiler_(),
+      geometryCache_(DefaultGeometryCacheSize) {}
+
+  void registerElementVisitor(const std::string &name, ElementBuilderFactory factory, bool isParallel) {
+    builderFactory_[name] = BuilderRegistration{factory, isParallel};
+  }
+
+  void setThreadPool(utymap::utils::ThreadPool *threadPool) {
+    threadPool_ = threadPool;
+  }
+
+  void setProfiler(std::shared_ptr<BuildProfiler> profiler) {
+    std::atomic_store(&profiler_, profiler);
+  }
+
+  void setGeometryCacheSize(std::size_t size) {
+    geometryCache_.setMaxSize(size);
+  }
 
-  void registerElementVisitor(const std::string &name, ElementBuilderFactory factory) {
-    builderFactory_[name] = factory;
+  void clearGeometryCache() {
+    geometryCache_.clear();
   }
 
   void build(const QuadKey &quadKey,
@@ -107,21 +360,78 @@ class QuadKeyBuilder::QuadKeyBuilderImpl {
              const BuilderContext::MeshCallback &meshCallback,
              const BuilderContext::ElementCallback &elementCallback,
              const utymap::CancellationToken &cancelToken) {
+    auto profiler = std::atomic_load(&profiler_);
+    std::unique_ptr<BuildProfile> profile = profiler!=nullptr
+        ? utymap::utils::make_unique<BuildProfile>(quadKey, profiler->isTraceEnabled())
+        : nullptr;
+
     auto context = BuilderContext(quadKey, styleProvider, stringTable_, eleProvider,
-      meshCallback, elementCallback, cancelToken);
-    auto visitor = BuilderElementVisitor(context, builderFactory_);
-    geoStore_.search(quadKey, styleProvider, visitor, cancelToken);
+      profileCallback(profile.get(), meshCallback), profileCallback(profile.get(), elementCallback),
+      cancelToken, profile.get(), &geometryCache_);
+    auto visitor = BuilderElementVisitor(context, builderFactory_, threadPool_);
+    {
+      BuildProfile::Scope scope(profile.get(), SearchStage);
+      geoStore_.search(quadKey, styleProvider, visitor, cancelToken);
+    }
     visitor.complete();
+
+    if (profile!=nullptr)
+      profiler->merge(*profile);
   }
 
  private:
+  /// Wraps mesh callback to measure it and to count mesh of the current stage.
+  static BuilderContext::MeshCallback profileCallback(BuildProfile *profile,
+                                                      const BuilderContext::MeshCallback &callback) {
+    if (profile==nullptr || callback==nullptr)
+      return callback;
+
+    return [profile, callback](const Mesh &mesh) {
+      profile->addMesh(mesh);
+      BuildProfile::Scope scope(profile, MeshCallbackStage);
+      callback(mesh);
+    };
+  }
+
+  /// Wraps element callback to measure it.
+  static BuilderContext::ElementCallback profileCallback(BuildProfile *profile,
+                                                         const BuilderContext::ElementCallback &callback) {
+    if (profile==nullptr || callback==nullptr)
+      return callback;
+
+    return [profile, callback](const Element &element) {
+      BuildProfile::Scope scope(profile, ElementCallbackStage);
+      callback(element);
+    };
+  }
+
   GeoStore &geoStore_;
   StringTable &stringTable_;
   BuilderFactoryMap builderFactory_;
+  utymap::utils::ThreadPool *threadPool_;
+  /// NOTE accessed only by atomic shared_ptr functions.
+  std::shared_ptr<BuildProfiler> profiler_;
+  RegionGeometryCache geometryCache_;
 };
 
-void QuadKeyBuilder::registerElementBuilder(const std::string &name, ElementBuilderFactory factory) {
-  pimpl_->registerElementVisitor(name, factory);
+void QuadKeyBuilder::registerElementBuilder(const std::string &name, ElementBuilderFactory factory, bool isParallel) {
+  pimpl_->registerElementVisitor(name, factory, isParallel);
+}
+
+void QuadKeyBuilder::setThreadPool(utymap::utils::ThreadPool *threadPool) {
+  pimpl_->setThreadPool(threadPool);
+}
+
+void QuadKeyBuilder::setProfiler(std::shared_ptr<BuildProfiler> profiler) {
+  pimpl_->setProfiler(std::move(profiler));
+}
+
+void QuadKeyBuilder::setGeometryCacheSize(std::size_t size) {
+  pimpl_->setGeometryCacheSize(size);
+}
+
+void QuadKeyBuilder::clearGeometryCache() {
+  pimpl_->clearGeometryCache();
 }
 
 void QuadKeyBuilder::build(const QuadKey &quadKey,
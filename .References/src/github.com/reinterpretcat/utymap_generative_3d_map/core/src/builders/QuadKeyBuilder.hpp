@@ -4,12 +4,15 @@
 #include "CancellationToken.hpp"
 #include "QuadKey.hpp"
 #include "builders/BuilderContext.hpp"
+#include "builders/BuildProfiler.hpp"
 #include "builders/ElementBuilder.hpp"
 #include "heightmap/ElevationProvider.hpp"
 #include "index/GeoStore.hpp"
 #include "mapcss/StyleProvider.hpp"
+#include "utils/ThreadPool.hpp"
 
 #include <functional>
+#include <memory>
 #include <string>
 
 namespace utymap {
@@ -27,8 +30,29 @@ class QuadKeyBuilder final {
 
   ~QuadKeyBuilder();
 
-  /// Registers factory method for element builder.
-  void registerElementBuilder(const std::string &name, ElementBuilderFactory factory);
+  /// Registers factory method for element builder. Parallel builder should build every element
+  /// independently from others: elements are split into partitions which are built concurrently
+  /// by own builder instances. Their meshes are reported in the order of elements at completion.
+  /// NOTE this changes emission order comparing to sequential building: meshes of parallel builders
+  /// are reported after all elements are visited, i.e. after meshes which sequential builders report
+  /// while visiting and before meshes which they report on completion (e.g. terrain).
+  /// NOTE parallel builder should not be wrapped into cache builder.
+  void registerElementBuilder(const std::string &name, ElementBuilderFactory factory, bool isParallel = false);
+
+  /// Sets thread pool used to run parallel builders. Null runs them on calling thread.
+  /// The pool can be the same which runs builds: calling thread processes partitions too.
+  void setThreadPool(utymap::utils::ThreadPool *threadPool);
+
+  /// Sets profiler which collects statistics of builds. Null disables profiling.
+  /// Can be called while builds are running: they keep profiler which they have started with.
+  void setProfiler(std::shared_ptr<utymap::builders::BuildProfiler> profiler);
+
+  /// Sets max size in bytes of cache which keeps processed terrain region geometry
+  /// between builds. Zero disables caching.
+  void setGeometryCacheSize(std::size_t size);
+
+  /// Removes processed terrain region geometry kept between builds.
+  void clearGeometryCache();
 
   /// Builds tile for given quadkey.
   void build(const utymap::QuadKey &quadKey,
@@ -33,5 +33,7 @@ void ExteriorGenerator::generateFrom(const std::vector<Layer> &layers) {
 ExteriorGenerator::~ExteriorGenerator() {
 }
 
-void ExteriorGenerator::addGeometry(int level, Polygon &polygon, const RegionContext &regionContext) {
+void ExteriorGenerator::addGeometry(int level,
+                                    const MeshBuilder::Triangulation &triangulation,
+                                    const RegionContext &regionContext) {
 }
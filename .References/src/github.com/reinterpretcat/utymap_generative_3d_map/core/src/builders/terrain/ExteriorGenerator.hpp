@@ -25,7 +25,9 @@ class ExteriorGenerator final : public TerraGenerator {
   ~ExteriorGenerator();
 
  protected:
-  void addGeometry(int level, utymap::math::Polygon &polygon, const RegionContext &regionContext) override;
+  void addGeometry(int level,
+                   const utymap::builders::MeshBuilder::Triangulation &triangulation,
+                   const RegionContext &regionContext) override;
 
  private:
   class ExteriorGeneratorImpl;
@@ -0,0 +1,185 @@
+#ifndef BUILDERS_TERRAIN_REGIONGEOMETRYCACHE_HPP_DEFINED
+#define BUILDERS_TERRAIN_REGIONGEOMETRYCACHE_HPP_DEFINED
+
+#include "QuadKey.hpp"
+#include "clipper/clipper.hpp"
+#include "builders/MeshBuilder.hpp"
+#include "math/Vector2.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace utymap {
+namespace builders {
+
+/// Keeps results of terrain region geometry processing which do not depend on
+/// region appearance or elevation: simplified contours and their triangulation.
+/// Size of cache is bounded in bytes: least recently used entries are evicted first.
+class RegionGeometryCache final {
+ public:
+  /// Specifies everything what geometry processing result depends on.
+  struct Key final {
+    utymap::QuadKey quadKey;
+    double cellSize;
+    double area;
+    int segmentSplit;
+    ClipperLib::Paths geometry;
+  };
+
+  /// Processed region geometry.
+  struct Entry final {
+    /// Contours which passed simplification and filtering.
+    ClipperLib::Paths paths;
+    /// Contours restored to original coordinates and split by grid.
+    std::vector<std::vector<utymap::math::Vector2>> contours;
+    /// Triangulation of all contours.
+    utymap::builders::MeshBuilder::Triangulation triangulation;
+  };
+
+  /// Creates cache which keeps entries up to given size in bytes. Zero size disables caching.
+  explicit RegionGeometryCache(std::size_t maxSize) : maxSize_(maxSize), size_(0) {}
+
+  RegionGeometryCache(const RegionGeometryCache &) = delete;
+  RegionGeometryCache &operator=(const RegionGeometryCache &) = delete;
+
+  /// Returns cached entry or nullptr.
+  std::shared_ptr<const Entry> get(const Key &key) {
+    auto hash = getHash(key);
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = index_.find(hash);
+    if (it==index_.end()) return nullptr;
+
+    // NOTE hash collision is possible, so key is compared too.
+    if (!isEqual(it->second->key, key)) return nullptr;
+    items_.splice(items_.begin(), items_, it->second);
+    return it->second->entry;
+  }
+
+  /// Stores entry associated with the given key evicting least recently used ones
+  /// if cache size is exceeded. Entry bigger than cache is not stored.
+  void put(const Key &key, const std::shared_ptr<const Entry> &entry) {
+    auto hash = getHash(key);
+    auto size = getSize(key, *entry);
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = index_.find(hash);
+    if (it!=index_.end()) erase(it->second);
+    if (size > maxSize_) return;
+
+    items_.push_front(Item{hash, key, entry, size});
+    index_[hash] = items_.begin();
+    size_ += size;
+    shrink();
+  }
+
+  /// Sets max size of cache in bytes evicting entries if necessary.
+  void setMaxSize(std::size_t maxSize) {
+    std::lock_guard<std::mutex> lock(lock_);
+    maxSize_ = maxSize;
+    shrink();
+  }
+
+  /// Removes all entries.
+  void clear() {
+    std::lock_guard<std::mutex> lock(lock_);
+    items_.clear();
+    index_.clear();
+    size_ = 0;
+  }
+
+  /// Returns approximate size of stored entries in bytes.
+  std::size_t size() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return size_;
+  }
+
+ private:
+  static std::uint64_t getHash(const Key &key) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    combine(hash, key.quadKey.levelOfDetail);
+    combine(hash, key.quadKey.tileX);
+    combine(hash, key.quadKey.tileY);
+    combine(hash, key.cellSize);
+    combine(hash, key.area);
+    combine(hash, key.segmentSplit);
+    for (const auto &path : key.geometry) {
+      combine(hash, path.size());
+      for (const auto &point : path) {
+        combine(hash, point.X);
+        combine(hash, point.Y);
+      }
+    }
+    return hash;
+  }
+
+  template<typename T>
+  static void combine(std::uint64_t &hash, const T &value) {
+    unsigned char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (auto byte : bytes) {
+      hash ^= byte;
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  /// Estimates memory used by key and entry.
+  static std::size_t getSize(const Key &key, const Entry &entry) {
+    std::size_t size = sizeof(Item) + sizeof(Entry);
+    for (const auto &path : key.geometry)
+      size += sizeof(path) + path.size()*sizeof(ClipperLib::IntPoint);
+    for (const auto &path : entry.paths)
+      size += sizeof(path) + path.size()*sizeof(ClipperLib::IntPoint);
+    for (const auto &contour : entry.contours)
+      size += sizeof(contour) + contour.size()*sizeof(utymap::math::Vector2);
+    size += entry.triangulation.points.size()*sizeof(double);
+    size += entry.triangulation.pointMarkers.size()*sizeof(int);
+    size += entry.triangulation.triangles.size()*sizeof(int);
+    return size;
+  }
+
+  static bool isEqual(const Key &lhs, const Key &rhs) {
+    return lhs.quadKey.levelOfDetail==rhs.quadKey.levelOfDetail &&
+        lhs.quadKey.tileX==rhs.quadKey.tileX &&
+        lhs.quadKey.tileY==rhs.quadKey.tileY &&
+        lhs.cellSize==rhs.cellSize &&
+        lhs.area==rhs.area &&
+        lhs.segmentSplit==rhs.segmentSplit &&
+        lhs.geometry==rhs.geometry;
+  }
+
+  struct Item final {
+    std::uint64_t hash;
+    Key key;
+    std::shared_ptr<const Entry> entry;
+    std::size_t size;
+  };
+
+  /// Removes item. Should be called under lock.
+  void erase(std::list<Item>::iterator it) {
+    size_ -= it->size;
+    index_.erase(it->hash);
+    items_.erase(it);
+  }
+
+  /// Evicts least recently used items until cache fits max size. Should be called under lock.
+  void shrink() {
+    while (size_ > maxSize_ && !items_.empty())
+      erase(std::prev(items_.end()));
+  }
+
+  std::mutex lock_;
+  std::size_t maxSize_;
+  std::size_t size_;
+  /// Items in order of use: the most recently used first.
+  std::list<Item> items_;
+  std::unordered_map<std::uint64_t, std::list<Item>::iterator> index_;
+};
+
+}
+}
+
+#endif // BUILDERS_TERRAIN_REGIONGEOMETRYCACHE_HPP_DEFINED
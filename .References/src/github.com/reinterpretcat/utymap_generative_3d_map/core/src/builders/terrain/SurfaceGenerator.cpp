@@ -73,21 +73,23 @@ void SurfaceGenerator::buildRegion(const Region &region) {
   });
 }
 
-void SurfaceGenerator::addGeometry(int level, Polygon &polygon, const RegionContext &regionContext) {
+void SurfaceGenerator::addGeometry(int level,
+                                   const MeshBuilder::Triangulation &triangulation,
+                                   const RegionContext &regionContext) {
   std::string meshName = regionContext.style.getString(regionContext.prefix + StyleConsts::MeshNameKey());
   if (!meshName.empty()) {
     Mesh polygonMesh(meshName);
     TerraExtras::Context extrasContext(polygonMesh, regionContext.style);
-    context_.meshBuilder.addPolygon(polygonMesh, polygon,
-                                    regionContext.geometryOptions, regionContext.appearanceOptions);
+    context_.meshBuilder.addTriangulation(polygonMesh, triangulation,
+                                          regionContext.geometryOptions, regionContext.appearanceOptions);
     context_.meshBuilder.writeTextureMappingInfo(polygonMesh, regionContext.appearanceOptions);
 
     addExtrasIfNecessary(polygonMesh, extrasContext, regionContext);
     context_.meshCallback(polygonMesh);
   } else {
     TerraExtras::Context extrasContext(mesh_, regionContext.style);
-    context_.meshBuilder.addPolygon(mesh_, polygon,
-                                    regionContext.geometryOptions, regionContext.appearanceOptions);
+    context_.meshBuilder.addTriangulation(mesh_, triangulation,
+                                          regionContext.geometryOptions, regionContext.appearanceOptions);
     context_.meshBuilder.writeTextureMappingInfo(mesh_, regionContext.appearanceOptions);
 
     addExtrasIfNecessary(mesh_, extrasContext, regionContext);
@@ -26,7 +26,9 @@ class SurfaceGenerator final : public TerraGenerator {
 
  protected:
   /// Adds geometry to mesh.
-  void addGeometry(int level, utymap::math::Polygon &polygon, const RegionContext &regionContext) override;
+  void addGeometry(int level,
+                   const utymap::builders::MeshBuilder::Triangulation &triangulation,
+                   const RegionContext &regionContext) override;
 
  private:
   /// Builds foreground surface.
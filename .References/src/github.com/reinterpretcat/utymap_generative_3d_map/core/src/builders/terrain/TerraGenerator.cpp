@@ -1,4 +1,5 @@
 #include "builders/terrain/TerraGenerator.hpp"
+#include "builders/terrain/RegionGeometryCache.hpp"
 
 using namespace ClipperLib;
 using namespace utymap::builders;
@@ -27,19 +28,49 @@ TerraGenerator::TerraGenerator(const utymap::builders::BuilderContext &context,
   auto relativeQuadKey =
       utymap::utils::GeoUtils::GeoCoordinateToQuadKey(GeoCoordinate(0, 0), context.quadKey.levelOfDetail);
   auto relativeBbox = utymap::utils::GeoUtils::quadKeyToBoundingBox(relativeQuadKey);
-  auto size = style_.getValue(StyleConsts::GridCellSize(), relativeBbox);
+  cellSize_ = style_.getValue(StyleConsts::GridCellSize(), relativeBbox);
 
-  splitter_.setParams(Scale, size);
+  splitter_.setParams(Scale, cellSize_);
 }
 
 void TerraGenerator::addGeometry(int level,
                                  Paths &geometry,
                                  const RegionContext &regionContext,
                                  const std::function<void(const Path &)> &geometryVisitor) {
+  // NOTE geometry processing result is the same for the same quadkey if only appearance of region is changed.
+  std::shared_ptr<const RegionGeometryCache::Entry> entry;
+  auto cache = context_.geometryCache;
+  if (cache!=nullptr) {
+    RegionGeometryCache::Key key{context_.quadKey, cellSize_, regionContext.geometryOptions.area,
+                                 regionContext.geometryOptions.segmentSplit, geometry};
+    entry = cache->get(key);
+    if (entry==nullptr) {
+      entry = processGeometry(geometry, regionContext);
+      cache->put(key, entry);
+    }
+  } else {
+    entry = processGeometry(geometry, regionContext);
+  }
+
+  for (const auto &path : entry->paths)
+    geometryVisitor(path);
+
+  if (std::abs(regionContext.geometryOptions.heightOffset) > 0) {
+    for (const auto &contour : entry->contours)
+      buildHeightOffset(contour, regionContext);
+  }
+
+  if (!entry->triangulation.triangles.empty())
+    addGeometry(level, entry->triangulation, regionContext);
+}
+
+std::shared_ptr<const RegionGeometryCache::Entry> TerraGenerator::processGeometry(Paths &geometry,
+                                                                                  const RegionContext &regionContext) const {
   ClipperLib::SimplifyPolygons(geometry);
   ClipperLib::CleanPolygons(geometry);
 
-  bool hasHeightOffset = std::abs(regionContext.geometryOptions.heightOffset) > 0;
+  auto entry = std::make_shared<RegionGeometryCache::Entry>();
+
   // calculate approximate size of overall points
   double size = 0;
   for (std::size_t i = 0; i < geometry.size(); ++i)
@@ -52,7 +83,7 @@ void TerraGenerator::addGeometry(int level,
     if (std::abs(area) < AreaTolerance)
       continue;
 
-    geometryVisitor(path);
+    entry->paths.push_back(path);
 
     auto points = restoreGeometry(path);
     if (isHole)
@@ -60,12 +91,13 @@ void TerraGenerator::addGeometry(int level,
     else
       polygon.addContour(points);
 
-    if (hasHeightOffset)
-      buildHeightOffset(points, regionContext);
+    entry->contours.push_back(std::move(points));
   }
 
   if (!polygon.points.empty())
-    addGeometry(level, polygon, regionContext);
+    entry->triangulation = context_.meshBuilder.triangulate(polygon, regionContext.geometryOptions);
+
+  return entry;
 }
 
 void TerraGenerator::buildHeightOffset(const std::vector<Vector2> &points, const RegionContext &regionContext) {
@@ -2,6 +2,7 @@
 #define BUILDERS_TERRAIN_TERRAGENERATOR_HPP_DEFINED
 
 #include "builders/BuilderContext.hpp"
+#include "builders/terrain/RegionGeometryCache.hpp"
 #include "builders/terrain/RegionTypes.hpp"
 #include "builders/terrain/LineGridSplitter.hpp"
 
@@ -31,15 +32,15 @@ class TerraGenerator {
   virtual ~TerraGenerator() = default;
 
  protected:
-  /// Adds geometry to mesh.
+  /// Adds geometry to mesh. Processed geometry is reused when the same region is built again.
   void addGeometry(int level,
                    ClipperLib::Paths &paths,
                    const RegionContext &regionContext,
                    const std::function<void(const ClipperLib::Path &)> &geometryVisitor);
 
-  /// Adds geometry to mesh.
+  /// Adds triangulated geometry to mesh.
   virtual void addGeometry(int level,
-                           utymap::math::Polygon &polygon,
+                           const utymap::builders::MeshBuilder::Triangulation &triangulation,
                            const RegionContext &regionContext) = 0;
 
   const utymap::builders::BuilderContext &context_;
@@ -52,6 +53,10 @@ class TerraGenerator {
   /// Checks whether given point is on tile border.
   inline bool isOnBorder(const utymap::math::Vector2 &p) const { return rect_.isOnBorder(p); }
 
+  /// Simplifies, splits and triangulates geometry.
+  std::shared_ptr<const RegionGeometryCache::Entry> processGeometry(ClipperLib::Paths &geometry,
+                                                                    const RegionContext &regionContext) const;
+
   /// Builds height contour shape.
   void buildHeightOffset(const std::vector<utymap::math::Vector2> &points, const RegionContext &regionContext);
 
@@ -60,6 +65,7 @@ class TerraGenerator {
 
   const utymap::math::Rectangle rect_;
   utymap::builders::LineGridSplitter splitter_;
+  double cellSize_;
 };
 
 }
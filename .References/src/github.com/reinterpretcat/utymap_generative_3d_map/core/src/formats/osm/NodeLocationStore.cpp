@@ -0,0 +1,171 @@
+#include "formats/osm/NodeLocationStore.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <boost/interprocess/anonymous_shared_memory.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace utymap;
+using namespace utymap::formats;
+
+namespace {
+const double CoordinateScale = 1E7;
+/// Shifts fixed point latitude to positive range.
+const std::int64_t LatitudeShift = 900000001;
+
+/// Fixed point location. Latitude is shifted to be always positive, so zero means no location.
+struct Location final {
+  std::uint32_t latitude;
+  std::int32_t longitude;
+
+  bool isValid() const { return latitude!=0; }
+
+  static Location create(const GeoCoordinate &coordinate) {
+    return Location{static_cast<std::uint32_t>(std::llround(coordinate.latitude*CoordinateScale) + LatitudeShift),
+                    static_cast<std::int32_t>(std::llround(coordinate.longitude*CoordinateScale))};
+  }
+
+  GeoCoordinate toCoordinate() const {
+    // NOTE integer division result is the closest double to decimal value, the same as parsed from text.
+    return GeoCoordinate((static_cast<std::int64_t>(latitude) - LatitudeShift)/CoordinateScale,
+                         longitude/CoordinateScale);
+  }
+};
+
+static_assert(sizeof(Location)==8, "Unexpected location size.");
+}
+
+class NodeLocationStore::NodeLocationStoreImpl {
+ public:
+  virtual ~NodeLocationStoreImpl() {}
+  virtual void add(std::uint64_t id, const Location &location) = 0;
+  virtual bool get(std::uint64_t id, Location &location) const = 0;
+  virtual std::size_t size() const = 0;
+  virtual std::size_t getMemoryUsage() const = 0;
+};
+
+class NodeLocationStore::SparseImpl final : public NodeLocationStore::NodeLocationStoreImpl {
+  typedef std::pair<std::uint64_t, Location> Entry;
+
+ public:
+  SparseImpl() : isSorted_(true) {}
+
+  void add(std::uint64_t id, const Location &location) override {
+    if (!entries_.empty() && entries_.back().first >= id)
+      isSorted_ = false;
+    entries_.push_back(std::make_pair(id, location));
+  }
+
+  bool get(std::uint64_t id, Location &location) const override {
+    // NOTE sorting is deferred until the first lookup: elements are usually added before they are queried.
+    if (!isSorted_) {
+      std::stable_sort(entries_.begin(), entries_.end(), [](const Entry &lhs, const Entry &rhs) {
+        return lhs.first < rhs.first;
+      });
+      isSorted_ = true;
+    }
+
+    // NOTE the last added location of duplicated id wins.
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), id, [](std::uint64_t id, const Entry &entry) {
+      return id < entry.first;
+    });
+    if (it==entries_.begin() || (--it)->first!=id)
+      return false;
+
+    location = it->second;
+    return true;
+  }
+
+  std::size_t size() const override { return entries_.size(); }
+
+  std::size_t getMemoryUsage() const override { return entries_.capacity()*sizeof(Entry); }
+
+ private:
+  mutable std::vector<Entry> entries_;
+  mutable bool isSorted_;
+};
+
+class NodeLocationStore::DenseImpl final : public NodeLocationStore::NodeLocationStoreImpl {
+  /// Amount of locations in one chunk: 128 MB of address space which is committed page by page on write.
+  const static std::uint64_t ChunkSize = 1 << 24;
+
+ public:
+  DenseImpl() : size_(0) {}
+
+  void add(std::uint64_t id, const Location &location) override {
+    auto index = static_cast<std::size_t>(id/ChunkSize);
+    if (index >= chunks_.size())
+      chunks_.resize(index + 1);
+
+    auto &chunk = chunks_[index];
+    if (chunk==nullptr)
+      chunk = utymap::utils::make_unique<boost::interprocess::mapped_region>(
+          boost::interprocess::anonymous_shared_memory(ChunkSize*sizeof(Location)));
+
+    Location &target = getLocations(*chunk)[id%ChunkSize];
+    if (!target.isValid()) ++size_;
+    target = location;
+  }
+
+  bool get(std::uint64_t id, Location &location) const override {
+    auto index = static_cast<std::size_t>(id/ChunkSize);
+    if (index >= chunks_.size() || chunks_[index]==nullptr)
+      return false;
+
+    location = getLocations(*chunks_[index])[id%ChunkSize];
+    return location.isValid();
+  }
+
+  std::size_t size() const override { return size_; }
+
+  /// NOTE returns reserved address space: resident memory depends on id distribution.
+  std::size_t getMemoryUsage() const override {
+    std::size_t count = std::count_if(chunks_.begin(), chunks_.end(), [](const ChunkPtr &chunk) {
+      return chunk!=nullptr;
+    });
+    return chunks_.capacity()*sizeof(ChunkPtr) + count*ChunkSize*sizeof(Location);
+  }
+
+ private:
+  typedef std::unique_ptr<boost::interprocess::mapped_region> ChunkPtr;
+
+  static Location *getLocations(const boost::interprocess::mapped_region &chunk) {
+    return static_cast<Location *>(chunk.get_address());
+  }
+
+  std::vector<ChunkPtr> chunks_;
+  std::size_t size_;
+};
+
+NodeLocationStore::NodeLocationStore(Type type) {
+  if (type==Type::Dense)
+    pimpl_ = utymap::utils::make_unique<DenseImpl>();
+  else
+    pimpl_ = utymap::utils::make_unique<SparseImpl>();
+}
+
+NodeLocationStore::~NodeLocationStore() {
+}
+
+void NodeLocationStore::add(std::uint64_t id, const GeoCoordinate &coordinate) {
+  pimpl_->add(id, Location::create(coordinate));
+}
+
+bool NodeLocationStore::get(std::uint64_t id, GeoCoordinate &coordinate) const {
+  Location location;
+  if (!pimpl_->get(id, location))
+    return false;
+
+  coordinate = location.toCoordinate();
+  return true;
+}
+
+std::size_t NodeLocationStore::size() const {
+  return pimpl_->size();
+}
+
+std::size_t NodeLocationStore::getMemoryUsage() const {
+  return pimpl_->getMemoryUsage();
+}
@@ -0,0 +1,53 @@
+#ifndef FORMATS_OSM_NODELOCATIONSTORE_HPP_DEFINED
+#define FORMATS_OSM_NODELOCATIONSTORE_HPP_DEFINED
+
+#include "GeoCoordinate.hpp"
+
+#include <cstdint>
+#include <memory>
+
+namespace utymap {
+namespace formats {
+
+/// Stores node locations keyed by osm id using 8 bytes per location.
+/// NOTE coordinates are stored with 1e-7 degree precision as in osm database.
+class NodeLocationStore final {
+ public:
+  enum class Type {
+    /// Sorted vector of id and location pairs: memory is proportional to amount of nodes.
+    Sparse,
+    /// Array indexed by id which is allocated in lazily mapped memory chunks: memory is
+    /// proportional to id range touched, so it suits only dense ids, e.g. planet file.
+    Dense
+  };
+
+  explicit NodeLocationStore(Type type = Type::Sparse);
+
+  ~NodeLocationStore();
+
+  NodeLocationStore(const NodeLocationStore &) = delete;
+  NodeLocationStore &operator=(const NodeLocationStore &) = delete;
+
+  /// Stores location of node. Adding nodes in id order avoids sorting.
+  void add(std::uint64_t id, const utymap::GeoCoordinate &coordinate);
+
+  /// Gets location of node. Returns false if node is unknown.
+  bool get(std::uint64_t id, utymap::GeoCoordinate &coordinate) const;
+
+  /// Returns amount of stored locations.
+  std::size_t size() const;
+
+  /// Returns amount of bytes used by store.
+  std::size_t getMemoryUsage() const;
+
+ private:
+  class NodeLocationStoreImpl;
+  class SparseImpl;
+  class DenseImpl;
+  std::unique_ptr<NodeLocationStoreImpl> pimpl_;
+};
+
+}
+}
+
+#endif // FORMATS_OSM_NODELOCATIONSTORE_HPP_DEFINED
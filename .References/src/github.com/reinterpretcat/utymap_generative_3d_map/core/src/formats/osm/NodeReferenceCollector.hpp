@@ -0,0 +1,83 @@
+#ifndef FORMATS_OSM_NODEREFERENCECOLLECTOR_HPP_DEFINED
+#define FORMATS_OSM_NODEREFERENCECOLLECTOR_HPP_DEFINED
+
+#include "BoundingBox.hpp"
+#include "GeoCoordinate.hpp"
+#include "formats/FormatTypes.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace utymap {
+namespace formats {
+
+/// Collects ids of nodes referenced by ways and relations. Used by the first pass of
+/// two pass import to find out which nodes should be kept in memory by the second one.
+class NodeReferenceCollector final {
+ public:
+  NodeReferenceCollector() : wayNodesLimit_(InitialLimit), relationNodesLimit_(InitialLimit) {}
+
+  void visitBounds(utymap::BoundingBox bbox) {}
+
+  void visitNode(std::uint64_t id, utymap::GeoCoordinate &coordinate, utymap::formats::Tags &tags) {}
+
+  void visitWay(std::uint64_t id, std::vector<std::uint64_t> &nodeIds, utymap::formats::Tags &tags) {
+    wayNodes_.insert(wayNodes_.end(), nodeIds.begin(), nodeIds.end());
+    compact(wayNodes_, wayNodesLimit_);
+  }
+
+  void visitRelation(std::uint64_t id, utymap::formats::RelationMembers &members, utymap::formats::Tags &tags) {
+    for (const auto &member : members) {
+      if (member.type=="n")
+        relationNodes_.push_back(member.refId);
+    }
+    compact(relationNodes_, relationNodesLimit_);
+  }
+
+  /// Prepares collected ids for lookup.
+  void complete() {
+    compact(wayNodes_);
+    compact(relationNodes_);
+  }
+
+  /// Checks whether node is used by any way.
+  bool isWayNode(std::uint64_t id) const {
+    return std::binary_search(wayNodes_.begin(), wayNodes_.end(), id);
+  }
+
+  /// Checks whether node is member of any relation.
+  bool isRelationNode(std::uint64_t id) const {
+    return std::binary_search(relationNodes_.begin(), relationNodes_.end(), id);
+  }
+
+  /// Returns amount of bytes used to store ids.
+  std::size_t getMemoryUsage() const {
+    return (wayNodes_.capacity() + relationNodes_.capacity())*sizeof(std::uint64_t);
+  }
+
+ private:
+  const static std::size_t InitialLimit = 1 << 16;
+
+  /// Removes duplicates when ids vector grows above the limit: ways share a lot of nodes.
+  static void compact(std::vector<std::uint64_t> &ids, std::size_t &limit) {
+    if (ids.size() < limit) return;
+    compact(ids);
+    limit = std::max(limit, ids.size()*2);
+  }
+
+  static void compact(std::vector<std::uint64_t> &ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  }
+
+  std::vector<std::uint64_t> wayNodes_;
+  std::vector<std::uint64_t> relationNodes_;
+  std::size_t wayNodesLimit_;
+  std::size_t relationNodesLimit_;
+};
+
+}
+}
+
+#endif // FORMATS_OSM_NODEREFERENCECOLLECTOR_HPP_DEFINED
@@ -19,18 +19,25 @@ void OsmDataVisitor::visitBounds(BoundingBox bbox) {
 }
 
 void OsmDataVisitor::visitNode(std::uint64_t id, GeoCoordinate &coordinate, utymap::formats::Tags &tags) {
-  auto node = std::make_shared<Node>();
-  node->id = id;
-  node->coordinate = coordinate;
-  utymap::utils::setTags(stringTable_, *node, tags);
-  context_.nodeMap[id] = node;
+  if (references_==nullptr || references_->isWayNode(id))
+    nodeLocations_.add(id, coordinate);
+
+  // NOTE untagged nodes are reported only as relation members: without references, they are
+  // created from node locations once relation which refers to them is visited.
+  if (tags.empty() && (references_==nullptr || !references_->isRelationNode(id)))
+    return;
+
+  addNode(id, coordinate, tags);
 }
 
 void OsmDataVisitor::visitWay(std::uint64_t id, std::vector<std::uint64_t> &nodeIds, utymap::formats::Tags &tags) {
   std::vector<GeoCoordinate> coordinates;
   coordinates.reserve(nodeIds.size());
+  GeoCoordinate coordinate;
   for (auto nodeId : nodeIds) {
-    coordinates.push_back(context_.nodeMap[nodeId]->coordinate);
+    // NOTE extracts may contain ways which refer to nodes outside of extract boundaries.
+    if (nodeLocations_.get(nodeId, coordinate))
+      coordinates.push_back(coordinate);
   }
   auto size = coordinates.size();
   if (size > 3 && coordinates[0]==coordinates[size - 1]) {
@@ -63,6 +70,25 @@ void OsmDataVisitor::visitRelation(std::uint64_t id, RelationMembers &members, u
   // So, store all relation members to resolve them once all relations are visited.
   relationMembers_[id] = members;
   context_.relationMap[id] = relation;
+
+  if (references_!=nullptr)
+    return;
+
+  utymap::formats::Tags noTags;
+  GeoCoordinate coordinate;
+  for (const auto &member : members) {
+    if (member.type=="n" && context_.nodeMap.find(member.refId)==context_.nodeMap.end() &&
+        nodeLocations_.get(member.refId, coordinate))
+      addNode(member.refId, coordinate, noTags);
+  }
+}
+
+void OsmDataVisitor::addNode(std::uint64_t id, const GeoCoordinate &coordinate, utymap::formats::Tags &tags) {
+  auto node = std::make_shared<Node>();
+  node->id = id;
+  node->coordinate = coordinate;
+  utymap::utils::setTags(stringTable_, *node, tags);
+  context_.nodeMap[id] = node;
 }
 
 void OsmDataVisitor::add(utymap::entities::Element &element) {
@@ -109,7 +135,9 @@ void OsmDataVisitor::complete() {
   }
 
   for (const auto &pair : context_.wayMap) {
-    add_(*pair.second);
+    // NOTE ways which lost nodes outside of extract boundaries are kept only as relation members.
+    if (pair.second->coordinates.size() > 1)
+      add_(*pair.second);
   }
 
   for (const auto &pair : context_.areaMap) {
@@ -118,6 +146,9 @@ void OsmDataVisitor::complete() {
 
 }
 
-OsmDataVisitor::OsmDataVisitor(const StringTable &stringTable, std::function<bool(Element &)> add)
-    : stringTable_(stringTable), add_(add), context_() {
+OsmDataVisitor::OsmDataVisitor(const StringTable &stringTable,
+                               std::function<bool(Element &)> add,
+                               NodeLocationStore::Type nodeStoreType,
+                               const NodeReferenceCollector *references)
+    : stringTable_(stringTable), add_(add), context_(), nodeLocations_(nodeStoreType), references_(references) {
 }
@@ -5,6 +5,8 @@
 #include "GeoCoordinate.hpp"
 #include "entities/Element.hpp"
 #include "formats/FormatTypes.hpp"
+#include "formats/osm/NodeLocationStore.hpp"
+#include "formats/osm/NodeReferenceCollector.hpp"
 #include "formats/osm/OsmDataContext.hpp"
 #include "index/StringTable.hpp"
 
@@ -16,11 +18,17 @@
 namespace utymap {
 namespace formats {
 
+/// Builds elements from osm data. Way geometry is resolved using node location store.
+/// Untagged nodes are not reported unless they are relation members. If node references
+/// collected by the first pass are given, only locations of nodes used by ways are stored.
+/// Ways with less than two resolved nodes are not reported, but can be used by relations.
 class OsmDataVisitor final {
  public:
 
   OsmDataVisitor(const utymap::index::StringTable &stringTable,
-                 std::function<bool(utymap::entities::Element &)> add);
+                 std::function<bool(utymap::entities::Element &)> add,
+                 utymap::formats::NodeLocationStore::Type nodeStoreType = NodeLocationStore::Type::Sparse,
+                 const utymap::formats::NodeReferenceCollector *references = nullptr);
 
   void visitBounds(utymap::BoundingBox bbox);
 
@@ -36,12 +44,15 @@ class OsmDataVisitor final {
 
  private:
 
+  void addNode(std::uint64_t id, const utymap::GeoCoordinate &coordinate, utymap::formats::Tags &tags);
   bool hasTag(const std::string &key, const std::string &value, const std::vector<utymap::entities::Tag> &tags) const;
   void resolve(utymap::entities::Relation &relation);
 
   const utymap::index::StringTable &stringTable_;
   std::function<bool(utymap::entities::Element &)> add_;
   utymap::formats::OsmDataContext context_;
+  utymap::formats::NodeLocationStore nodeLocations_;
+  const utymap::formats::NodeReferenceCollector *references_;
   std::unordered_map<std::uint64_t, utymap::formats::RelationMembers> relationMembers_;
 };
 
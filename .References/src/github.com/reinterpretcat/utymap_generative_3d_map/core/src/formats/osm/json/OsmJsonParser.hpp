@@ -8,9 +8,13 @@
 #include "index/StringTable.hpp"
 #include "utils/ElementUtils.hpp"
 
-#include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <cctype>
+#include <cstdlib>
+#include <streambuf>
+#include <string>
+
 namespace utymap {
 namespace formats {
 
@@ -48,34 +52,195 @@ class OsmJsonParser {
       featureKey_(stringTable.getId(FeatureAttributeName)) {
   }
 
-  /// Parses osm json data from stream calling visitor.
+  /// Parses osm json data from stream calling visitor. Features are read and visited one by one,
+  /// so only the feature being processed is kept in memory.
   void parse(std::istream &istream, Visitor &visitor) const {
-    ptree pt;
-    read_json(istream, pt);
-
-    for (const ptree::value_type &feature : pt) {
-      std::string featureName = feature.first;
+    if (istream.rdbuf()==nullptr)
+      throw std::invalid_argument("Cannot read json.");
+
+    JsonReader reader(*istream.rdbuf());
+    std::string featureName, key;
+    reader.expect('{');
+    while (reader.next('}')) {
+      reader.readString(featureName);
+      reader.expect(':');
       std::uint32_t featureId = stringTable_.getId(featureName);
-      for (const ptree::value_type &f : pt.get_child(featureName).get_child("features")) {
-        const auto &type = f.second.get_child("geometry.type").data();
-        if (type=="Point")
-          parsePoint(visitor, featureId, f.second);
-        else if (type=="LineString")
-          parseLineString(visitor, featureId, f.second);
-        else if (type=="Polygon")
-          parsePolygon(visitor, featureId, f.second);
-        else if (type=="MultiLineString")
-          parseMultiLineString(visitor, featureId, f.second);
-        else if (type=="MultiPolygon")
-          parseMultiPolygon(visitor, featureId, f.second);
-        else
-          throw std::invalid_argument(std::string("Unknown geometry type:") + type);
+
+      reader.expect('{');
+      while (reader.next('}')) {
+        reader.readString(key);
+        reader.expect(':');
+        if (key!="features") {
+          reader.readValue(nullptr);
+          continue;
+        }
+
+        reader.expect('[');
+        while (reader.next(']')) {
+          ptree feature;
+          reader.readValue(&feature);
+          parseFeature(visitor, featureId, feature);
+        }
       }
     }
   }
 
  private:
 
+  /// Reads json tokens directly from stream buffer. Values are stored in the same
+  /// way as boost json parser does: arrays are children with empty keys, primitives are strings.
+  class JsonReader final {
+   public:
+    explicit JsonReader(std::streambuf &buffer) : buffer_(buffer), isFirst_(true) {}
+
+    /// Checks whether the next item of object or array exists consuming separator or terminator.
+    bool next(char terminator) {
+      skipSpaces();
+      if (buffer_.sgetc()==terminator) {
+        buffer_.sbumpc();
+        isFirst_ = false;
+        return false;
+      }
+      if (!isFirst_) expect(',');
+      isFirst_ = false;
+      return true;
+    }
+
+    void expect(char expected) {
+      skipSpaces();
+      if (get()!=expected)
+        throw std::invalid_argument(std::string("Invalid json: expecting ") + expected);
+      isFirst_ = expected=='{' || expected=='[';
+    }
+
+    void readString(std::string &value) {
+      skipSpaces();
+      if (get()!='"')
+        throw std::invalid_argument("Invalid json: expecting string.");
+
+      value.clear();
+      int c;
+      while ((c = get())!='"') {
+        if (c!='\\') {
+          value.push_back(static_cast<char>(c));
+          continue;
+        }
+        switch (c = get()) {
+          case 'b': value.push_back('\b'); break;
+          case 'f': value.push_back('\f'); break;
+          case 'n': value.push_back('\n'); break;
+          case 'r': value.push_back('\r'); break;
+          case 't': value.push_back('\t'); break;
+          case 'u': appendUtf8(value, readCodePoint()); break;
+          default: value.push_back(static_cast<char>(c));
+        }
+      }
+    }
+
+    /// Reads any value into given tree or skips it if tree is null.
+    void readValue(ptree *tree) {
+      skipSpaces();
+      int c = buffer_.sgetc();
+      if (c=='{') {
+        expect('{');
+        std::string key;
+        while (next('}')) {
+          readString(key);
+          expect(':');
+          readValue(tree ? &tree->push_back(std::make_pair(key, ptree()))->second : nullptr);
+        }
+      } else if (c=='[') {
+        expect('[');
+        while (next(']'))
+          readValue(tree ? &tree->push_back(std::make_pair(std::string(), ptree()))->second : nullptr);
+      } else if (c=='"') {
+        readString(value_);
+        if (tree) tree->data() = value_;
+      } else {
+        value_.clear();
+        while ((c = buffer_.sgetc())!=EOF && c!=',' && c!='}' && c!=']' && !std::isspace(c))
+          value_.push_back(static_cast<char>(buffer_.sbumpc()));
+        if (value_.empty())
+          throw std::invalid_argument("Invalid json: expecting value.");
+        if (tree) tree->data() = value_;
+      }
+      isFirst_ = false;
+    }
+
+   private:
+    int get() {
+      int c = buffer_.sbumpc();
+      if (c==EOF)
+        throw std::invalid_argument("Invalid json: unexpected end.");
+      return c;
+    }
+
+    void skipSpaces() {
+      int c;
+      while ((c = buffer_.sgetc())!=EOF && std::isspace(c))
+        buffer_.sbumpc();
+    }
+
+    unsigned long readCodePoint() {
+      auto readHex = [&]() {
+        char digits[5] = {};
+        for (int i = 0; i < 4; ++i)
+          digits[i] = static_cast<char>(get());
+        return std::strtoul(digits, nullptr, 16);
+      };
+
+      unsigned long code = readHex();
+      // NOTE surrogate pair encodes code point outside of basic plane.
+      if (code >= 0xD800 && code <= 0xDBFF && buffer_.sgetc()=='\\') {
+        get();
+        if (get()!='u')
+          throw std::invalid_argument("Invalid json: expecting low surrogate.");
+        code = 0x10000 + ((code - 0xD800) << 10) + (readHex() - 0xDC00);
+      }
+      return code;
+    }
+
+    static void appendUtf8(std::string &value, unsigned long code) {
+      if (code < 0x80) {
+        value.push_back(static_cast<char>(code));
+      } else if (code < 0x800) {
+        value.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        value.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+      } else if (code < 0x10000) {
+        value.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        value.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        value.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+      } else {
+        value.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        value.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        value.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        value.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+      }
+    }
+
+    std::streambuf &buffer_;
+    std::string value_;
+    /// True if no item of current object or array is read yet.
+    bool isFirst_;
+  };
+
+  /// Parses single feature and notifies visitor.
+  void parseFeature(Visitor &visitor, std::uint32_t featureId, const ptree &feature) const {
+    const auto &type = feature.get_child("geometry.type").data();
+    if (type=="Point")
+      parsePoint(visitor, featureId, feature);
+    else if (type=="LineString")
+      parseLineString(visitor, featureId, feature);
+    else if (type=="Polygon")
+      parsePolygon(visitor, featureId, feature);
+    else if (type=="MultiLineString")
+      parseMultiLineString(visitor, featureId, feature);
+    else if (type=="MultiPolygon")
+      parseMultiPolygon(visitor, featureId, feature);
+    else
+      throw std::invalid_argument(std::string("Unknown geometry type:") + type);
+  }
+
   /// Parses relation with relations from multipolygon and notifies visitor.
   void parseMultiPolygon(Visitor &visitor, std::uint32_t featureId, const ptree &feature) const {
     utymap::entities::Relation relation;
@@ -3,109 +3,168 @@
 
 #include "BoundingBox.hpp"
 #include "formats/FormatTypes.hpp"
+#include "utils/ThreadPool.hpp"
 
 #include <fileformat.pb.h>
 #include <osmformat.pb.h>
 #include <zlib.h>
 
 #include <cstdint>
+#include <deque>
+#include <future>
 #include <istream>
+#include <memory>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace utymap {
 namespace formats {
 
+/// Parses osm pbf stream. Blobs are read sequentially from stream, but can be inflated and decoded
+/// by thread pool workers. Decoded blocks are passed to visitor in file order on caller thread, so
+/// visitor sees elements in the same order as in sequential mode.
 template<typename Visitor>
 class OsmPbfParser final {
   const static int MaxBlobHeaderSize = 64*1024;
   const static int MaxUncompressedBlobSize = 32*1024*1024;
+  /// Amount of blocks decoded ahead per worker: limits memory consumption.
+  const static std::size_t BlocksPerWorker = 2;
 
- public:
+  /// Blob which is read from stream but not decoded yet.
+  struct RawBlob final {
+    std::string type;
+    std::string data;
+  };
+
+  typedef std::shared_ptr<OSMPBF::PrimitiveBlock> BlockPtr;
 
-  OsmPbfParser() :
-      buffer_(MaxUncompressedBlobSize),
-      unpack_buffer_(MaxUncompressedBlobSize),
-      finished_(false) {
+ public:
+  /// Creates parser. If thread pool is specified, blobs are decoded on its workers.
+  explicit OsmPbfParser(utymap::utils::ThreadPool *threadPool = nullptr) :
+      threadPool_(threadPool) {
   }
 
   void parse(std::istream &stream, Visitor &visitor) {
-    finished_ = false;
-
-    while (!stream.eof() && !stream.fail() && !finished_) {
-      OSMPBF::BlobHeader header = readHeader(stream);
-      if (!finished_) {
-        std::int32_t sz = readBlob(header, stream);
-        if (header.type()=="OSMData") {
-          parsePrimitiveBlock(sz, visitor);
-        } else if (header.type()=="OSMHeader") {
-          // used to be skipped
-        }
-      }
-    }
+    if (threadPool_==nullptr)
+      parseSequential(stream, visitor);
+    else
+      parseParallel(stream, visitor);
   }
 
  private:
+  utymap::utils::ThreadPool *threadPool_;
+
+  void parseSequential(std::istream &stream, Visitor &visitor) {
+    RawBlob raw;
+    while (readBlob(stream, raw)) {
+      BlockPtr block = decode(raw);
+      if (block!=nullptr)
+        parsePrimitiveBlock(*block, visitor);
+    }
+  }
 
-  std::vector<char> buffer_;
-  std::vector<char> unpack_buffer_;
-  bool finished_;
+  void parseParallel(std::istream &stream, Visitor &visitor) {
+    typedef std::pair<std::future<void>, std::shared_ptr<BlockPtr>> PendingBlock;
+    std::deque<PendingBlock> pending;
+    const std::size_t maxPending = threadPool_->size()*BlocksPerWorker;
+
+    try {
+      auto raw = std::make_shared<RawBlob>();
+      while (readBlob(stream, *raw)) {
+        auto result = std::make_shared<BlockPtr>();
+        pending.push_back(std::make_pair(threadPool_->enqueue([raw, result]() {
+          *result = decode(*raw);
+        }), result));
+        raw = std::make_shared<RawBlob>();
+
+        if (pending.size() >= maxPending)
+          visitFront(pending, visitor);
+      }
+
+      while (!pending.empty())
+        visitFront(pending, visitor);
+    } catch (...) {
+      // NOTE tasks refer only to own data, but they should not outlive parser's caller.
+      for (auto &block : pending)
+        block.first.wait();
+      throw;
+    }
+  }
 
-  OSMPBF::BlobHeader readHeader(std::istream &stream) {
+  /// Waits for the oldest block and passes it to visitor.
+  template<typename Queue>
+  void visitFront(Queue &pending, Visitor &visitor) {
+    pending.front().first.get();
+    BlockPtr block = std::move(*pending.front().second);
+    pending.pop_front();
+    if (block!=nullptr)
+      parsePrimitiveBlock(*block, visitor);
+  }
+
+  /// Reads next blob from stream. Returns false if stream is finished.
+  static bool readBlob(std::istream &stream, RawBlob &raw) {
     std::int32_t sz;
-    OSMPBF::BlobHeader result;
 
     // read size of blob-header
-    if (!stream.read(reinterpret_cast<char *>(&sz), 4)) {
-      finished_ = true;
-      return result;
-    }
+    if (!stream.read(reinterpret_cast<char *>(&sz), 4))
+      return false;
 
     // little endian to big endian
     sz = (((sz & 0xff) << 24) + ((sz & 0xff00) << 8) + ((sz & 0xff0000) >> 8) + ((sz >> 24) & 0xff));
 
-    if (sz > MaxBlobHeaderSize)
+    if (sz < 0 || sz > MaxBlobHeaderSize)
       throw std::domain_error("Blob header size is bigger than allowed");
 
-    stream.read(buffer_.data(), sz);
-    if (!stream.good())
+    std::string buffer(static_cast<std::size_t>(sz), '\0');
+    if (!stream.read(&buffer[0], sz))
       throw std::domain_error("Unable to read blob header from file");
 
-    if (!result.ParseFromArray(buffer_.data(), sz))
+    OSMPBF::BlobHeader header;
+    if (!header.ParseFromString(buffer))
       throw std::domain_error("Unable to parse blob header");
 
-    return result;
-  }
-
-  std::int32_t readBlob(const OSMPBF::BlobHeader &header, std::istream &stream) {
-    OSMPBF::Blob blob;
-
-    std::int32_t sz = header.datasize();
-
-    if (sz > MaxUncompressedBlobSize)
+    sz = header.datasize();
+    if (sz < 0 || sz > MaxUncompressedBlobSize)
       throw std::domain_error("Blob size is bigger then allowed");
 
-    if (!stream.read(buffer_.data(), sz))
+    raw.type = header.type();
+    raw.data.resize(static_cast<std::size_t>(sz));
+    if (!stream.read(&raw.data[0], sz))
       throw std::domain_error("Unable to read blob from file");
 
-    if (!blob.ParseFromArray(buffer_.data(), sz))
+    return true;
+  }
+
+  /// Inflates and decodes blob. Returns nullptr for blobs which do not contain osm data.
+  static BlockPtr decode(const RawBlob &raw) {
+    if (raw.type!="OSMData")
+      return nullptr;
+
+    OSMPBF::Blob blob;
+    if (!blob.ParseFromString(raw.data))
       throw std::domain_error("Unable to parse blob");
 
+    auto block = std::make_shared<OSMPBF::PrimitiveBlock>();
+
     // uncompressed
     if (blob.has_raw()) {
-      sz = static_cast<std::int32_t>(blob.raw().size());
-      memcpy(unpack_buffer_.data(), buffer_.data(), sz);
-      return sz;
+      if (!block->ParseFromString(blob.raw()))
+        throw std::domain_error("Unable to parse primitive block");
+      return block;
     }
 
     if (blob.has_zlib_data()) {
-      sz = static_cast<std::int32_t>(blob.zlib_data().size());
+      if (blob.raw_size() < 0 || blob.raw_size() > MaxUncompressedBlobSize)
+        throw std::domain_error("Blob size is bigger then allowed");
+
+      std::string data(static_cast<std::size_t>(blob.raw_size()), '\0');
 
       z_stream z;
       z.next_in = (unsigned char *) blob.zlib_data().c_str();
-      z.avail_in = sz;
-      z.next_out = reinterpret_cast<unsigned char *>(unpack_buffer_.data());
-      z.avail_out = blob.raw_size();
+      z.avail_in = static_cast<uInt>(blob.zlib_data().size());
+      z.next_out = reinterpret_cast<unsigned char *>(&data[0]);
+      z.avail_out = static_cast<uInt>(data.size());
       z.zalloc = Z_NULL;
       z.zfree = Z_NULL;
       z.opaque = Z_NULL;
@@ -113,33 +172,32 @@ class OsmPbfParser final {
       if (inflateInit(&z)!=Z_OK)
         throw std::domain_error("Failed to init zlib stream");
 
-      if (inflate(&z, Z_FINISH)!=Z_STREAM_END)
+      if (inflate(&z, Z_FINISH)!=Z_STREAM_END) {
+        inflateEnd(&z);
         throw std::domain_error("Failed to inflate zlib stream");
+      }
 
       if (inflateEnd(&z)!=Z_OK)
         throw std::domain_error("Failed to deinit zlib stream");
 
-      return z.total_out;
+      if (!block->ParseFromArray(data.data(), static_cast<int>(z.total_out)))
+        throw std::domain_error("Unable to parse primitive block");
+      return block;
     }
 
     if (blob.has_lzma_data())
       throw std::domain_error("Lzma-decompression is not supported");
 
-    return 0;
+    return nullptr;
   }
 
-  void parsePrimitiveBlock(int32_t sz, Visitor &visitor) {
-    OSMPBF::PrimitiveBlock primblock;
-
-    if (!primblock.ParseFromArray(unpack_buffer_.data(), sz))
-      throw std::domain_error("Unable to parse primitive block");
-
+  void parsePrimitiveBlock(const OSMPBF::PrimitiveBlock &primblock, Visitor &visitor) {
     for (int i = 0, l = primblock.primitivegroup_size(); i < l; i++) {
-      OSMPBF::PrimitiveGroup pg = primblock.primitivegroup(i);
+      const OSMPBF::PrimitiveGroup &pg = primblock.primitivegroup(i);
 
       // simple nodes
       for (int i = 0; i < pg.nodes_size(); ++i) {
-        OSMPBF::Node n = pg.nodes(i);
+        const OSMPBF::Node &n = pg.nodes(i);
         GeoCoordinate coordinate;
         coordinate.latitude = 0.000000001*(primblock.lat_offset() + (primblock.granularity()*n.lat()));
         coordinate.longitude = 0.000000001*(primblock.lon_offset() + (primblock.granularity()*n.lon()));
@@ -151,7 +209,7 @@ class OsmPbfParser final {
 
       // dense nodes
       if (pg.has_dense()) {
-        OSMPBF::DenseNodes dn = pg.dense();
+        const OSMPBF::DenseNodes &dn = pg.dense();
         uint64_t id = 0;
         double lon = 0;
         double lat = 0;
@@ -181,7 +239,7 @@ class OsmPbfParser final {
       }
 
       for (int i = 0; i < pg.ways_size(); ++i) {
-        OSMPBF::Way w = pg.ways(i);
+        const OSMPBF::Way &w = pg.ways(i);
 
         uint64_t ref = 0;
         std::vector<uint64_t> nodeIds;
@@ -197,7 +255,7 @@ class OsmPbfParser final {
       }
 
       for (int i = 0; i < pg.relations_size(); ++i) {
-        OSMPBF::Relation rel = pg.relations(i);
+        const OSMPBF::Relation &rel = pg.relations(i);
         uint64_t id = 0;
         RelationMembers refs;
         refs.reserve(rel.memids_size());
@@ -218,7 +276,7 @@ class OsmPbfParser final {
     }
   }
 
-  static std::string parseType(OSMPBF::Relation &rel, int index) {
+  static std::string parseType(const OSMPBF::Relation &rel, int index) {
     switch (rel.types(index)) {
       case OSMPBF::Relation::NODE:return "n";
       case OSMPBF::Relation::WAY:return "w";
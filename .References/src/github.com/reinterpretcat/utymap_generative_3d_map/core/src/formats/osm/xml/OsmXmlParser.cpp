@@ -1,297 +1,331 @@
-#define BOOST_SPIRIT_USE_PHOENIX_V3
-#include <boost/fusion/include/io.hpp>
-#include <boost/bind.hpp>
-#include <boost/config/warning_disable.hpp>
-#include <boost/spirit/include/qi.hpp>
-#include <boost/spirit/include/phoenix_core.hpp>
-#include <boost/spirit/include/phoenix_operator.hpp>
-#include <boost/spirit/include/phoenix_object.hpp>
-#include <boost/fusion/include/adapt_struct.hpp>
-#include <boost/fusion/include/boost_tuple.hpp>
-
 #include "formats/FormatTypes.hpp"
 #include "formats/osm/xml/OsmXmlParser.hpp"
 
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
 using namespace utymap;
 using namespace utymap::formats;
 
-namespace qi = boost::spirit::qi;
-namespace ascii = boost::spirit::ascii;
-namespace phoenix = boost::phoenix;
-
-BOOST_FUSION_ADAPT_STRUCT(
-  Tag,
-  (std::string, key)
-  (std::string, value)
-)
-
-BOOST_FUSION_ADAPT_STRUCT(
-  RelationMember,
-  (std::string, type)
-  (std::uint64_t, refId)
-  (std::string, role)
-)
-
 namespace {
-typedef boost::tuple<double, double, double, double> BoundsType;
-typedef Tag TagType;
-typedef boost::tuple<std::uint64_t, double, double, std::vector<TagType>> NodeType;
-typedef boost::tuple<std::uint64_t, std::vector<std::uint64_t>, std::vector<TagType>> WayType;
-typedef RelationMember MemberType;
-typedef boost::tuple<std::uint64_t, std::vector<MemberType>, std::vector<TagType>> RelationType;
-
-template <typename Iterator>
-struct AttributeSkipper : qi::grammar <Iterator> {
-  AttributeSkipper() : AttributeSkipper::base_type(attributeSkipper, "attr_skipper") {
-      knownKey =
-        ascii::string("id=") |
-        ascii::string("lat=") |
-        ascii::string("lon=")
-          ;
-
-      attributeSkipper =
-        ascii::space |
-        ((+qi::alnum - knownKey) >> "=\"" >> +(qi::char_ - '"') >> '"');
-      ;
-
-      BOOST_SPIRIT_DEBUG_NODE(knownKey);
-      BOOST_SPIRIT_DEBUG_NODE(attributeSkipper);
-  }
 
-  qi::rule<Iterator> knownKey;
-  qi::rule<Iterator> attributeSkipper;
-};
-
-template <typename Iterator>
-struct StringValueGrammar : qi::grammar < Iterator, std::string()> {
-  StringValueGrammar() : StringValueGrammar::base_type(stringValue, "string") {
-    stringValue =
-        '"' > *(qi::char_ - '"') > '"';
+/// Reads xml markup from stream buffer character by character without keeping document in memory.
+class XmlReader final {
+ public:
+  explicit XmlReader(std::streambuf &buffer) : buffer_(buffer) {}
 
-    BOOST_SPIRIT_DEBUG_NODE(stringValue);
+  /// Skips text until the next markup. Returns false if stream is over.
+  bool skipText() {
+    int c;
+    while ((c = buffer_.sbumpc())!=EOF) {
+      if (c=='<') return true;
+    }
+    return false;
   }
 
-  qi::rule<Iterator, std::string()> stringValue;
-};
-
-template <typename Iterator>
-struct DoubleValueGrammar : qi::grammar < Iterator, double()> {
-  DoubleValueGrammar() : DoubleValueGrammar::base_type(doubleValue, "double") {
-    doubleValue =
-        '"' > qi::double_ > '"';
+  int peek() { return buffer_.sgetc(); }
 
-    BOOST_SPIRIT_DEBUG_NODE(doubleValue);
+  int get() {
+    int c = buffer_.sbumpc();
+    if (c==EOF)
+      throw std::domain_error("Unexpected end of osm xml.");
+    return c;
   }
 
-  qi::rule<Iterator, double()> doubleValue;
-};
-
-template <typename Iterator>
-struct IdGrammar : qi::grammar < Iterator, std::uint64_t()> {
-  IdGrammar() : IdGrammar::base_type(id, "id") {
-    id =
-        qi::skip(qi::space)["id=\"" > qi::ulong_long > '"'];
+  void skipSpaces() {
+    int c;
+    while ((c = buffer_.sgetc())!=EOF && std::isspace(c))
+      buffer_.sbumpc();
+  }
 
-    BOOST_SPIRIT_DEBUG_NODE(id);
+  /// Skips everything until given terminator inclusively.
+  void skipUntil(const char *terminator) {
+    std::size_t length = std::strlen(terminator), matched = 0;
+    while (matched < length) {
+      char c = static_cast<char>(get());
+      matched = c==terminator[matched] ? matched + 1 : (c==terminator[0] ? 1 : 0);
+    }
   }
 
-  qi::rule<Iterator, std::uint64_t()> id;
-};
+  /// Reads name of element or attribute.
+  void readName(std::string &name) {
+    name.clear();
+    int c;
+    while ((c = buffer_.sgetc())!=EOF && !std::isspace(c) && c!='=' && c!='>' && c!='/')
+      name.push_back(static_cast<char>(buffer_.sbumpc()));
+  }
 
-template <typename Iterator>
-struct RefGrammar : qi::grammar < Iterator, std::uint64_t()> {
-  RefGrammar() : RefGrammar::base_type(ref, "ref") {
-    ref =
-        qi::skip(qi::space)["ref=\"" > qi::ulong_long > '"'];
+  /// Reads attributes until end of start tag calling handler for each of them.
+  /// Returns true if element is self closed.
+  template<typename Handler>
+  bool readAttributes(Handler &&handler) {
+    while (true) {
+      skipSpaces();
+      int c = peek();
+      if (c=='>' || c=='/') {
+        get();
+        if (c=='/') expect('>');
+        return c=='/';
+      }
+
+      readName(name_);
+      if (name_.empty())
+        throw std::domain_error("Cannot parse osm xml: expecting attribute.");
+
+      skipSpaces();
+      expect('=');
+      skipSpaces();
+      readValue(value_);
+      handler(name_, value_);
+    }
+  }
 
-    BOOST_SPIRIT_DEBUG_NODE(ref);
+ private:
+  void expect(char expected) {
+    if (get()!=expected)
+      throw std::domain_error(std::string("Cannot parse osm xml: expecting ") + expected);
   }
 
-  qi::rule<Iterator, std::uint64_t()> ref;
-};
+  /// Reads quoted attribute value decoding entities.
+  void readValue(std::string &value) {
+    value.clear();
+    int quote = get();
+    if (quote!='"' && quote!='\'')
+      throw std::domain_error("Cannot parse osm xml: expecting quoted value.");
+
+    int c;
+    while ((c = get())!=quote) {
+      if (c=='&') readEntity(value, quote);
+      else value.push_back(static_cast<char>(c));
+    }
+  }
 
-template <typename Iterator>
-struct BoundsGrammar : qi::grammar < Iterator, BoundsType()> {
-  BoundsGrammar() : BoundsGrammar::base_type(bounds, "bounds") {
-    bounds =
-        qi::skip(qi::space)[("<bounds" > (("minlat=" > value) ^ ("minlon=" > value) ^ ("maxlat=" > value) ^ ("maxlon=" > value)) > "/>")]
-        ;
+  /// Decodes entity after ampersand. Malformed entity, e.g. bare ampersand, is kept as is:
+  /// reading stops before closing quote, so the value still ends there.
+  void readEntity(std::string &value, int quote) {
+    std::string entity;
+    int c;
+    while ((c = peek())!=EOF && c!=';' && c!=quote && entity.size() < 10)
+      entity.push_back(static_cast<char>(get()));
+
+    if (c!=';') {
+      value.append("&").append(entity);
+      return;
+    }
+    get();
+
+    if (entity=="amp") value.push_back('&');
+    else if (entity=="quot") value.push_back('"');
+    else if (entity=="apos") value.push_back('\'');
+    else if (entity=="lt") value.push_back('<');
+    else if (entity=="gt") value.push_back('>');
+    else if (entity.size() > 1 && entity[0]=='#') {
+      bool isHex = entity[1]=='x' || entity[1]=='X';
+      appendUtf8(value, std::strtoul(entity.c_str() + (isHex ? 2 : 1), nullptr, isHex ? 16 : 10));
+    } else
+      value.append("&").append(entity).append(";");
+  }
 
-    BOOST_SPIRIT_DEBUG_NODE(bounds);
+  static void appendUtf8(std::string &value, unsigned long code) {
+    if (code < 0x80) {
+      value.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+      value.push_back(static_cast<char>(0xC0 | (code >> 6)));
+      value.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+      value.push_back(static_cast<char>(0xE0 | (code >> 12)));
+      value.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      value.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+      value.push_back(static_cast<char>(0xF0 | (code >> 18)));
+      value.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      value.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      value.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
   }
 
-  DoubleValueGrammar<Iterator> value;
-  qi::rule<Iterator, BoundsType()> bounds;
+  std::streambuf &buffer_;
+  std::string name_;
+  std::string value_;
 };
 
-template <typename Iterator>
-struct TagGrammar : qi::grammar < Iterator, TagType(), AttributeSkipper<Iterator>> {
-  TagGrammar() : TagGrammar::base_type(tag, "tag") {
-    tag =
-        qi::skip(qi::space)["<tag" > ("k=" > value) > ("v=" > value) > "/>"]
-        ;
+/// Builds osm elements from markup and passes them to visitor once they are complete.
+/// Only the element which is being read is kept in memory.
+template<typename Visitor>
+class OsmXmlHandler final {
+  enum class ElementType { None, Node, Way, Relation };
 
-    BOOST_SPIRIT_DEBUG_NODE(tag);
+ public:
+  OsmXmlHandler(XmlReader &reader, Visitor &visitor) :
+      reader_(reader), visitor_(visitor), type_(ElementType::None) {
+    numberStream_.imbue(std::locale::classic());
   }
 
-  StringValueGrammar<Iterator> value;
-  qi::rule<Iterator, TagType(), AttributeSkipper<Iterator>> tag;
-};
+  void parse() {
+    while (reader_.skipText()) {
+      int c = reader_.peek();
+      if (c=='?') reader_.skipUntil("?>");
+      else if (c=='!') skipDeclaration();
+      else if (c=='/') endElement();
+      else startElement();
+    }
 
-template <typename Iterator>
-struct NodeGrammar : qi::grammar < Iterator, NodeType(), AttributeSkipper<Iterator> > {
-  NodeGrammar() : NodeGrammar::base_type(node, "node") {
-    lat = qi::skip(qi::space)["lat=" > doubleValue];
-    lon = qi::skip(qi::space)["lon=" > doubleValue];
-
-    node =
-        "<node" > id > lat > lon >
-        (
-          ('>' > *tag > "</node>") | (qi::eps > "/>")
-        );
-
-    BOOST_SPIRIT_DEBUG_NODE(lat);
-    BOOST_SPIRIT_DEBUG_NODE(lon);
-    BOOST_SPIRIT_DEBUG_NODE(node);
+    if (type_!=ElementType::None)
+      throw std::domain_error("Unexpected end of osm xml.");
   }
 
-  TagGrammar<Iterator> tag;
-  IdGrammar<Iterator> id;
-  qi::rule<Iterator, double()> lat;
-  qi::rule<Iterator, double()> lon;
+ private:
 
-  DoubleValueGrammar<Iterator> doubleValue;
-  qi::rule<Iterator, NodeType(), AttributeSkipper<Iterator>> node;
-};
-
-template <typename Iterator>
-struct WayGrammar : qi::grammar < Iterator, WayType(), AttributeSkipper<Iterator> > {
-  WayGrammar() : WayGrammar::base_type(way, "way") {
-    nodeRef = qi::skip(qi::space)["<nd" > ref > "/>"];
-
-    way =
-        "<way" > id > '>' > +nodeRef > *tag > "</way>";
-
-    BOOST_SPIRIT_DEBUG_NODE(nodeRef);
-    BOOST_SPIRIT_DEBUG_NODE(way);
+  void skipDeclaration() {
+    reader_.get();
+    if (reader_.peek()=='-') reader_.skipUntil("-->");
+    else reader_.skipUntil(">");
   }
 
-  IdGrammar<Iterator> id;
-  TagGrammar<Iterator> tag;
-  RefGrammar<Iterator> ref;
-  qi::rule<Iterator, std::uint64_t(), AttributeSkipper<Iterator>> nodeRef;
-  qi::rule<Iterator, WayType(), AttributeSkipper<Iterator>> way;
-};
-
-template <typename Iterator>
-struct RelationGrammar : qi::grammar < Iterator, RelationType(), AttributeSkipper<Iterator> > {
-  RelationGrammar() : RelationGrammar::base_type(relation, "relation") {
-    memberRef = qi::skip(qi::space)["<member" > ("type=" > value) > ref > ("role=" > value) > "/>"];
-
-    relation =
-        "<relation" > id > '>' > +memberRef > *tag > "</relation>";
-
-    BOOST_SPIRIT_DEBUG_NODE(memberRef);
-    BOOST_SPIRIT_DEBUG_NODE(relation);
+  void startElement() {
+    reader_.readName(name_);
+
+    if (name_=="node") {
+      start(ElementType::Node);
+      bool isClosed = reader_.readAttributes([&](const std::string &name, const std::string &value) {
+        if (name=="id") id_ = parseId(value);
+        else if (name=="lat") coordinate_.latitude = parseDouble(value);
+        else if (name=="lon") coordinate_.longitude = parseDouble(value);
+      });
+      if (isClosed) complete();
+    } else if (name_=="way" || name_=="relation") {
+      start(name_=="way" ? ElementType::Way : ElementType::Relation);
+      bool isClosed = reader_.readAttributes([&](const std::string &name, const std::string &value) {
+        if (name=="id") id_ = parseId(value);
+      });
+      if (isClosed) complete();
+    } else if (name_=="tag") {
+      Tag tag;
+      reader_.readAttributes([&](const std::string &name, const std::string &value) {
+        if (name=="k") tag.key = value;
+        else if (name=="v") tag.value = value;
+      });
+      if (type_!=ElementType::None) tags_.push_back(std::move(tag));
+    } else if (name_=="nd") {
+      std::uint64_t ref = 0;
+      reader_.readAttributes([&](const std::string &name, const std::string &value) {
+        if (name=="ref") ref = parseId(value);
+      });
+      if (type_==ElementType::Way) nodeIds_.push_back(ref);
+    } else if (name_=="member") {
+      RelationMember member;
+      member.refId = 0;
+      reader_.readAttributes([&](const std::string &name, const std::string &value) {
+        if (name=="type") member.type = mapType(value);
+        else if (name=="ref") member.refId = parseId(value);
+        else if (name=="role") member.role = value;
+      });
+      if (type_==ElementType::Relation) members_.push_back(std::move(member));
+    } else if (name_=="bounds") {
+      BoundingBox bbox;
+      reader_.readAttributes([&](const std::string &name, const std::string &value) {
+        if (name=="minlat") bbox.minPoint.latitude = parseDouble(value);
+        else if (name=="minlon") bbox.minPoint.longitude = parseDouble(value);
+        else if (name=="maxlat") bbox.maxPoint.latitude = parseDouble(value);
+        else if (name=="maxlon") bbox.maxPoint.longitude = parseDouble(value);
+      });
+      visitor_.visitBounds(bbox);
+    } else {
+      reader_.readAttributes([](const std::string &, const std::string &) {});
+    }
   }
 
-  IdGrammar<Iterator> id;
-  TagGrammar<Iterator> tag;
-  RefGrammar<Iterator> ref;
-  StringValueGrammar<Iterator> value;
-  qi::rule<Iterator, MemberType(), AttributeSkipper<Iterator>> memberRef;
-  qi::rule<Iterator, RelationType(), AttributeSkipper<Iterator>> relation;
-};
+  void endElement() {
+    reader_.get();
+    reader_.readName(name_);
+    reader_.skipUntil(">");
 
-template <typename Visitor, typename Iterator>
-struct OsmGrammar : qi::grammar < Iterator, int(), AttributeSkipper<Iterator> > {
-  OsmGrammar(Visitor& visitor) : OsmGrammar::base_type(osm, "osm"), visitor(visitor) {
-    osm =
-      ascii::string("<?") > *(qi::char_ - '>') > '>' >
-      "<osm" > '>' >
-          -(qi::lexeme[+(qi::char_ - (ascii::string("<node") | "<bounds"))]) >
-          -qi::omit[bounds[boost::bind(&OsmGrammar::onBounds, this, _1)]] >
-          *qi::omit[node[boost::bind(&OsmGrammar::onNode, this, _1)]] >
-          *qi::omit[way[boost::bind(&OsmGrammar::onWay, this, _1)]] >
-          *qi::omit[relation[boost::bind(&OsmGrammar::onRelation, this, _1)]] >
-      "</osm>" > qi::eps;
-
-    BOOST_SPIRIT_DEBUG_NODE(osm);
-    qi::on_error<qi::fail>(
-      osm,
-      error
-      << phoenix::val("Error! Expecting ")
-      << qi::_4
-      << phoenix::val(" here: \"")
-      << phoenix::construct<std::string>(qi::_3, qi::_2)
-      << phoenix::val("\"")
-      << std::endl);
+    if ((name_=="node" && type_==ElementType::Node) ||
+        (name_=="way" && type_==ElementType::Way) ||
+        (name_=="relation" && type_==ElementType::Relation))
+      complete();
   }
 
-  Visitor& visitor;
-  std::stringstream error;
-  BoundsGrammar<Iterator> bounds;
-  NodeGrammar<Iterator> node;
-  WayGrammar<Iterator> way;
-  RelationGrammar<Iterator> relation;
-  qi::rule<Iterator, int(), AttributeSkipper<Iterator>> osm;
-
-private:
-  void onBounds(BoundsType& bounds) {
-    utymap::BoundingBox boundingBox(
-        utymap::GeoCoordinate(boost::get<0>(bounds), boost::get<1>(bounds)),
-        utymap::GeoCoordinate(boost::get<2>(bounds), boost::get<3>(bounds)));
-    visitor.visitBounds(boundingBox);
+  void start(ElementType type) {
+    if (type_!=ElementType::None)
+      throw std::domain_error("Cannot parse osm xml: nested element " + name_);
+    type_ = type;
+    id_ = 0;
+    coordinate_ = GeoCoordinate();
   }
 
-  void onNode(NodeType& node) {
-    utymap::GeoCoordinate coordinate(boost::get<1>(node), boost::get<2>(node));
-    Tags& tags = boost::get<3>(node);
-    visitor.visitNode(boost::get<0>(node), coordinate, tags);
+  void complete() {
+    switch (type_) {
+      case ElementType::Node:visitor_.visitNode(id_, coordinate_, tags_);
+        break;
+      case ElementType::Way:visitor_.visitWay(id_, nodeIds_, tags_);
+        break;
+      case ElementType::Relation:visitor_.visitRelation(id_, members_, tags_);
+        break;
+      default:break;
+    }
+
+    type_ = ElementType::None;
+    tags_.clear();
+    nodeIds_.clear();
+    members_.clear();
   }
 
-  void onWay(WayType& way) {
-    auto& ids = boost::get<1>(way);
-    Tags& tags = boost::get<2>(way);
-    visitor.visitWay(boost::get<0>(way), ids, tags);
+  static std::uint64_t parseId(const std::string &value) {
+    return std::strtoull(value.c_str(), nullptr, 10);
   }
 
-  void onRelation(RelationType& relation) {
-    auto& members = boost::get<1>(relation);
-    for (auto& member : members) {
-        member.type = mapType(member.type);
-    }
-    Tags& tags = boost::get<2>(relation);
-    visitor.visitRelation(boost::get<0>(relation), members, tags);
+  /// Parses number using classic locale: osm xml always uses dot as decimal separator.
+  double parseDouble(const std::string &value) {
+    double result = 0;
+    numberStream_.clear();
+    numberStream_.str(value);
+    numberStream_ >> result;
+    return result;
   }
 
-  static std::string mapType(const std::string& type) {
-    if (type == "node")
-        return "n";
-    if (type == "way")
-        return "w";
+  static std::string mapType(const std::string &type) {
+    if (type=="node")
+      return "n";
+    if (type=="way")
+      return "w";
     return "r";
   }
+
+  XmlReader &reader_;
+  Visitor &visitor_;
+
+  std::string name_;
+  ElementType type_;
+  std::uint64_t id_;
+  GeoCoordinate coordinate_;
+  Tags tags_;
+  std::vector<std::uint64_t> nodeIds_;
+  RelationMembers members_;
+  std::istringstream numberStream_;
 };
 }
 
 namespace utymap { namespace formats {
 
-template <typename Visitor>
-void OsmXmlParser<Visitor>::parse(std::istream& istream, Visitor& visitor) {
-  boost::spirit::istream_iterator begin(istream);
-  boost::spirit::istream_iterator end;
-
-  OsmGrammar<Visitor, boost::spirit::istream_iterator> grammar(visitor);
-  AttributeSkipper<boost::spirit::istream_iterator> skipper;
-  int result;
+template<typename Visitor>
+void OsmXmlParser<Visitor>::parse(std::istream &istream, Visitor &visitor) {
+  if (istream.rdbuf()==nullptr)
+    throw std::domain_error("Cannot read osm xml.");
 
-  if (!phrase_parse(begin, end, grammar, skipper, result))
-      throw std::domain_error(grammar.error.str());
+  XmlReader reader(*istream.rdbuf());
+  OsmXmlHandler<Visitor>(reader, visitor).parse();
 }
 
 template class OsmXmlParser<OsmDataVisitor>;
 template class OsmXmlParser<CountableOsmDataVisitor>;
+template class OsmXmlParser<NodeReferenceCollector>;
 
 }
 }
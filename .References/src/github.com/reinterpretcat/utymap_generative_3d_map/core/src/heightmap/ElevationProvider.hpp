@@ -4,6 +4,8 @@
 #include "GeoCoordinate.hpp"
 #include "QuadKey.hpp"
 
+#include <cstddef>
+
 namespace utymap {
 namespace heightmap {
 
@@ -16,6 +18,15 @@ class ElevationProvider {
   /// Gets elevation for given geocoordinate.
   virtual double getElevation(const QuadKey &quadkey, double latitude, double longitude) const = 0;
 
+  /// Gets elevations for given geocoordinates.
+  virtual void getElevations(const QuadKey &quadkey,
+                             const utymap::GeoCoordinate *coordinates,
+                             double *elevations,
+                             std::size_t count) const {
+    for (std::size_t i = 0; i < count; ++i)
+      elevations[i] = getElevation(quadkey, coordinates[i]);
+  }
+
   virtual ~ElevationProvider() = default;
 };
 
@@ -2,6 +2,7 @@
 #define HEIGHTMAP_GRIDELEVATIONPROVIDER_HPP_DEFINED
 
 #include "heightmap/ElevationProvider.hpp"
+#include "utils/ConcurrentLruCache.hpp"
 #include "utils/CoreUtils.hpp"
 #include "utils/GeoUtils.hpp"
 
@@ -11,15 +12,15 @@
 #include <string>
 #include <stdexcept>
 #include <sstream>
-#include <map>
-#include <mutex>
+#include <memory>
 #include <vector>
 
 namespace utymap {
 namespace heightmap {
 
 /// Provides the way to get elevation for given location from grid 
-/// represented by comma separated list of integers
+/// represented by comma separated list of integers.
+/// Parsed grids are kept in LRU cache bounded by size of height data.
 class GridElevationProvider final : public ElevationProvider {
   /// Holds elevation data information.
   struct EleData {
@@ -32,11 +33,26 @@ class GridElevationProvider final : public ElevationProvider {
     std::vector<int> heights;
   };
 
+  typedef std::shared_ptr<const EleData> EleDataPtr;
+
+  struct QuadKeyHash {
+    std::size_t operator()(const QuadKey &quadKey) const {
+      return (static_cast<std::size_t>(quadKey.tileX)*31 + quadKey.tileY)*31 + quadKey.levelOfDetail;
+    }
+  };
+
   const double Scale = 1E7;
 
  public:
-  GridElevationProvider(const std::string& indexPath) :
-      dataPath_(indexPath + "data/") {
+  /// Default cache size in bytes.
+  static const std::size_t DefaultCacheSize = 64*1024*1024;
+
+  /// Creates provider which keeps up to maxCacheSize bytes of parsed grids.
+  GridElevationProvider(const std::string& indexPath, std::size_t maxCacheSize = DefaultCacheSize) :
+      dataPath_(indexPath + "data/"),
+      data_(maxCacheSize, 16, [](const QuadKey &, const EleDataPtr &data) {
+        return sizeof(EleData) + data->heights.capacity()*sizeof(int);
+      }) {
   }
 
   /// Gets elevation for given geocoordinate.
@@ -46,31 +62,27 @@ class GridElevationProvider final : public ElevationProvider {
 
   /// Gets elevation for given geocoordinate.
   double getElevation(const utymap::QuadKey &quadKey, double latitude, double longitude) const override {
-    auto data = data_.find(quadKey);
-    if (data==data_.end()) {
-      preload(quadKey);
-      data = data_.find(quadKey);
-    }
+    auto data = data_.getOrAdd(quadKey, [&]() { return load(quadKey); });
 
-    int resolution = data->second.resolution;
+    int resolution = data->resolution;
 
-    int x = static_cast<int>(longitude*Scale) - data->second.xStart;
-    int y = static_cast<int>(latitude*Scale) - data->second.yStart;
+    int x = static_cast<int>(longitude*Scale) - data->xStart;
+    int y = static_cast<int>(latitude*Scale) - data->yStart;
 
-    int x0 = clamp(x/data->second.xStep, 0, resolution);
-    int y0 = clamp(y/data->second.yStep, 0, resolution);
+    int x0 = clamp(x/data->xStep, 0, resolution);
+    int y0 = clamp(y/data->yStep, 0, resolution);
 
     int x1 = std::min(x0 + 1, resolution);
     int y1 = std::min(y0 + 1, resolution);
 
-    double dx = static_cast<double>(x - x0*data->second.xStep)/data->second.xStep;
-    double dy = static_cast<double>(y - y0*data->second.yStep)/data->second.yStep;
+    double dx = static_cast<double>(x - x0*data->xStep)/data->xStep;
+    double dy = static_cast<double>(y - y0*data->yStep)/data->yStep;
 
     int cellSize = resolution + 1;
-    int height2 = data->second.heights[x0 + y0*cellSize];
-    int height0 = data->second.heights[x0 + y1*cellSize];
-    int height3 = data->second.heights[x1 + y0*cellSize];
-    int height1 = data->second.heights[x1 + y1*cellSize];
+    int height2 = data->heights[x0 + y0*cellSize];
+    int height0 = data->heights[x0 + y1*cellSize];
+    int height3 = data->heights[x1 + y0*cellSize];
+    int height1 = data->heights[x1 + y1*cellSize];
 
     // Bilinear interpolation
     // h0------------h1
@@ -84,47 +96,47 @@ class GridElevationProvider final : public ElevationProvider {
     return height0*dy*(1 - dx) + height1*dy*(dx) + height2*(1 - dy)*(1 - dx) + height3*(1 - dy)*dx;
   }
 
+  /// Returns usage statistics of grid cache. Size is in bytes.
+  utymap::utils::CacheStatistics getCacheStatistics() const {
+    return data_.getStatistics();
+  }
+
  private:
 
   static int clamp(int n, int lower, int upper) {
     return std::max(lower, std::min(n, upper));
   }
 
-  /// Preloads data for given quadkey.
-  void preload(const utymap::QuadKey &quadKey) const {
-    std::lock_guard<std::mutex> lock(lock_);
-
-    if (data_.find(quadKey)!=data_.end())
-      return;
-
+  /// Loads data for given quadkey.
+  EleDataPtr load(const utymap::QuadKey &quadKey) const {
     std::string filePath = getFilePath(quadKey);
     std::fstream file(filePath);
     if (!file.good())
       throw std::invalid_argument(std::string("Cannot find elevation file:") + filePath);
 
-    EleData data;
+    auto data = std::make_shared<EleData>();
 
     std::transform(std::istream_iterator<std::string>(file),
                    std::istream_iterator<std::string>(),
-                   std::back_inserter(data.heights),
+                   std::back_inserter(data->heights),
                    [&](const std::string &heightString) {
                      return utymap::utils::lexicalCast<int>(heightString);
                    });
 
-    data.heights.shrink_to_fit();
+    data->heights.shrink_to_fit();
 
-    if (data.heights.empty())
+    if (data->heights.empty())
       throw std::domain_error("Cannot get elevation data from:" + filePath);
 
     BoundingBox bbox = utymap::utils::GeoUtils::quadKeyToBoundingBox(quadKey);
 
-    data.resolution = static_cast<int>(std::sqrt(data.heights.size())) - 1;
-    data.xStart = static_cast<int>(bbox.minPoint.longitude*Scale);
-    data.yStart = static_cast<int>(bbox.minPoint.latitude*Scale);
-    data.xStep = static_cast<int>(bbox.width()/data.resolution*Scale);
-    data.yStep = static_cast<int>(bbox.height()/data.resolution*Scale);
+    data->resolution = static_cast<int>(std::sqrt(data->heights.size())) - 1;
+    data->xStart = static_cast<int>(bbox.minPoint.longitude*Scale);
+    data->yStart = static_cast<int>(bbox.minPoint.latitude*Scale);
+    data->xStep = static_cast<int>(bbox.width()/data->resolution*Scale);
+    data->yStep = static_cast<int>(bbox.height()/data->resolution*Scale);
 
-    data_.emplace(quadKey, std::move(data));
+    return data;
   }
 
   std::string getFilePath(const QuadKey &quadKey) const {
@@ -133,9 +145,8 @@ class GridElevationProvider final : public ElevationProvider {
     return ss.str();
   }
 
-  mutable std::map<const QuadKey, EleData, QuadKey::Comparator> data_;
-  mutable std::mutex lock_;
   const std::string dataPath_;
+  mutable utymap::utils::ConcurrentLruCache<QuadKey, EleDataPtr, QuadKeyHash> data_;
 };
 
 }
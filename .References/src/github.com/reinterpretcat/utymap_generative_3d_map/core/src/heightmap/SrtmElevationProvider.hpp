@@ -4,15 +4,17 @@
 #include "BoundingBox.hpp"
 #include "heightmap/ElevationProvider.hpp"
 #include "utils/GeoUtils.hpp"
+#include "utils/ConcurrentLruCache.hpp"
+#include "utils/MappedFile.hpp"
 
+#include <algorithm>
 #include <cmath>
-#include <fstream>
+#include <cstdint>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <stdexcept>
-#include <map>
 #include <memory>
-#include <mutex>
 #include <iomanip>
 #include <vector>
 
@@ -20,6 +22,7 @@ namespace utymap {
 namespace heightmap {
 
 /// Provides the way to get elevation for given location from SRTM data.
+/// Hgt files are memory mapped and kept in LRU cache bounded by total file size.
 class SrtmElevationProvider final : public ElevationProvider {
   struct HgtCellKey {
     int lat, lon;
@@ -29,24 +32,60 @@ class SrtmElevationProvider final : public ElevationProvider {
     bool operator<(const HgtCellKey &other) const {
       return lat < other.lat || (!(other.lat < lat) && lon < other.lon);
     }
+
+    bool operator==(const HgtCellKey &other) const {
+      return lat==other.lat && lon==other.lon;
+    }
+
+    struct Hash {
+      std::size_t operator()(const HgtCellKey &key) const {
+        return static_cast<std::size_t>(key.lat)*397 ^ static_cast<std::size_t>(key.lon);
+      }
+    };
   };
 
   struct HgtCell {
     int totalPx, secondsPerPx, offset;
-    std::vector<char> data;
-
-    HgtCell(int totalPx, int secondsPerPx, std::vector<char> &data) :
-        totalPx(totalPx),
-        secondsPerPx(secondsPerPx),
-        offset((totalPx*totalPx - totalPx)*2),
-        data(std::move(data)) {
+    utymap::utils::MappedFile file;
+    const unsigned char *data;
+
+    explicit HgtCell(const std::string &path) :
+        totalPx(0), secondsPerPx(0), offset(0), file(path),
+        data(reinterpret_cast<const unsigned char *>(file.data())) {
+      switch (file.size()) {
+        case 1201*1201*2: // SRTM-3
+          totalPx = 1201;
+          secondsPerPx = 3;
+          break;
+        case MaxCellSize: // SRTM-1
+          totalPx = 3601;
+          secondsPerPx = 1;
+          break;
+        default:throw std::domain_error(std::string("Cannot load srtm file:") + path);
+      }
+      offset = (totalPx*totalPx - totalPx)*2;
     }
   };
 
+  typedef std::shared_ptr<const HgtCell> HgtCellPtr;
+
+  /// Describes neighbour pixels of the point and its position between them.
+  struct Sample {
+    int height0, height1, height2, height3;
+    double dx, dy;
+  };
+
  public:
+  /// Size of the largest (SRTM-1) hgt file in bytes.
+  static const std::size_t MaxCellSize = 3601*3601*2;
 
+  /// Creates provider which keeps up to maxCacheSize hgt files mapped. Cache is bounded by bytes
+  /// of SRTM-1 files, so more of smaller SRTM-3 files can be kept.
   SrtmElevationProvider(const std::string& indexPath, int maxCacheSize = 4) :
-      dataPath_(indexPath + "data/"), maxCacheSize_(maxCacheSize) {
+      dataPath_(indexPath + "data/"),
+      // NOTE cells are few and large, so they are not split between shards.
+      cells_(static_cast<std::size_t>(std::max(maxCacheSize, 1))*MaxCellSize, 1,
+             [](const HgtCellKey &, const HgtCellPtr &cell) { return cell->file.size(); }) {
   }
 
   double getElevation(const utymap::QuadKey &quadKey, const utymap::GeoCoordinate &coordinate) const override {
@@ -57,52 +96,69 @@ class SrtmElevationProvider final : public ElevationProvider {
     return getElevationImpl(quadKey, latitude, longitude);
   }
 
- private:
-
-  void preload(const utymap::QuadKey &quadKey, HgtCellKey &hgtCellKey) const {
-    std::lock_guard<std::mutex> lock(lock_);
+  void getElevations(const utymap::QuadKey &quadKey,
+                     const utymap::GeoCoordinate *coordinates,
+                     double *elevations,
+                     std::size_t count) const override {
+    // Gather neighbour pixels: cell is resolved only when point moves to another one.
+    std::vector<double> buffer(count*6);
+    double *h0 = buffer.data(), *h1 = h0 + count, *h2 = h1 + count, *h3 = h2 + count;
+    double *dx = h3 + count, *dy = dx + count;
+
+    HgtCellKey lastKey(std::numeric_limits<int>::min(), std::numeric_limits<int>::min());
+    HgtCellPtr cell;
+    for (std::size_t i = 0; i < count; ++i) {
+      HgtCellKey key = getCellKey(coordinates[i].latitude, coordinates[i].longitude);
+      if (!(key==lastKey)) {
+        cell = getCell(key);
+        lastKey = key;
+      }
 
-    if (cells_.find(hgtCellKey)!=cells_.end())
-      return;
+      Sample sample = getSample(*cell, coordinates[i].latitude, coordinates[i].longitude);
+      h0[i] = sample.height0;
+      h1[i] = sample.height1;
+      h2[i] = sample.height2;
+      h3[i] = sample.height3;
+      dx[i] = sample.dx;
+      dy[i] = sample.dy;
+    }
 
-    BoundingBox bbox = utymap::utils::GeoUtils::quadKeyToBoundingBox(quadKey);
-    int minLat = static_cast<int>(bbox.minPoint.latitude);
-    int minLon = static_cast<int>(bbox.minPoint.longitude);
-    int maxLat = static_cast<int>(bbox.maxPoint.latitude);
-    int maxLon = static_cast<int>(bbox.maxPoint.longitude);
+    // Branch free loop over contiguous arrays: compiler vectorizes it using available SIMD lanes.
+    for (std::size_t i = 0; i < count; ++i)
+      elevations[i] = interpolate(h0[i], h1[i], h2[i], h3[i], dx[i], dy[i]);
+  }
 
-    int latDiff = maxLat - minLat;
-    int lonDiff = maxLon - minLon;
+  /// Returns usage statistics of hgt file cache. Size is in bytes.
+  utymap::utils::CacheStatistics getCacheStatistics() const {
+    return cells_.getStatistics();
+  }
 
-    for (int j = 0; j <= latDiff; j++)
-      for (int i = 0; i <= lonDiff; i++) {
-        HgtCellKey cellKey(minLat + j, minLon + i);
+ private:
 
-        if (cells_.find(cellKey)!=cells_.end())
-          continue;
+  /// Returns cell from cache or loads it from disk.
+  HgtCellPtr getCell(const HgtCellKey &key) const {
+    return cells_.getOrAdd(key, [&]() {
+      return std::make_shared<const HgtCell>(getFilePath(key));
+    });
+  }
 
-        std::string path = getFilePath(cellKey);
-        HgtCell cell = readCell(path);
-        cells_.emplace(cellKey, readCell(path));
-      }
+  static HgtCellKey getCellKey(double latitude, double longitude) {
+    return HgtCellKey(static_cast<int>(latitude), static_cast<int>(longitude));
   }
 
   double getElevationImpl(const utymap::QuadKey &quadKey, double latitude, double longitude) const {
+    auto cell = getCell(getCellKey(latitude, longitude));
+    Sample sample = getSample(*cell, latitude, longitude);
+    return interpolate(sample.height0, sample.height1, sample.height2, sample.height3, sample.dx, sample.dy);
+  }
+
+  static Sample getSample(const HgtCell &cell, double latitude, double longitude) {
     int latDec = static_cast<int>(latitude);
     int lonDec = static_cast<int>(longitude);
 
     double secondsLat = (latitude - latDec)*3600;
     double secondsLon = (longitude - lonDec)*3600;
 
-    HgtCellKey hgtCellKey(latDec, lonDec);
-    auto cellPtr = cells_.find(hgtCellKey);
-    if (cellPtr==cells_.end()) {
-      preload(quadKey, hgtCellKey);
-      cellPtr = cells_.find(hgtCellKey);
-    }
-
-    const auto &cell = cellPtr->second;
-
     // load tile
     //X corresponds to x/y values,
     //everything easter/norther (< S) is rounded to X.
@@ -118,16 +174,20 @@ class SrtmElevationProvider final : public ElevationProvider {
     int y = static_cast<int>(secondsLat/cell.secondsPerPx);
     int x = static_cast<int>(secondsLon/cell.secondsPerPx);
 
+    Sample sample;
     //get norther and easter points
-    int height2 = readPx(cell, y, x);
-    int height0 = readPx(cell, y + 1, x);
-    int height3 = readPx(cell, y, x + 1);
-    int height1 = readPx(cell, y + 1, x + 1);
+    sample.height2 = readPx(cell, y, x);
+    sample.height0 = readPx(cell, y + 1, x);
+    sample.height3 = readPx(cell, y, x + 1);
+    sample.height1 = readPx(cell, y + 1, x + 1);
 
     //ratio where X lays
-    double dy = std::fmod(secondsLat, cell.secondsPerPx)/cell.secondsPerPx;
-    double dx = std::fmod(secondsLon, cell.secondsPerPx)/cell.secondsPerPx;
+    sample.dy = std::fmod(secondsLat, cell.secondsPerPx)/cell.secondsPerPx;
+    sample.dx = std::fmod(secondsLon, cell.secondsPerPx)/cell.secondsPerPx;
+    return sample;
+  }
 
+  static double interpolate(double height0, double height1, double height2, double height3, double dx, double dy) {
     // Bilinear interpolation
     // h0------------h1
     // |
@@ -140,36 +200,10 @@ class SrtmElevationProvider final : public ElevationProvider {
     return height0*dy*(1 - dx) + height1*dy*(dx) + height2*(1 - dy)*(1 - dx) + height3*(1 - dy)*dx;
   }
 
+  /// Reads pixel stored as big endian signed 16 bit integer.
   static int readPx(const HgtCell &cell, int y, int x) {
     int pos = cell.offset + 2*(x - cell.totalPx*y);
-    return (cell.data[pos]) << 8 | (cell.data[pos + 1]);
-  }
-
-  static HgtCell readCell(const std::string &path) {
-    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::app);
-    file.seekg(0, std::ios::end);
-    auto size = file.tellg();
-
-    int totalPx, secondsPerPx;
-    switch (size) {
-      case 1201*1201*2: // SRTM-3
-        totalPx = 1201;
-        secondsPerPx = 3;
-        break;
-      case 3601*3601*2: // SRTM-1
-        totalPx = 3601;
-        secondsPerPx = 1;
-        break;
-      default:file.close();
-        throw std::domain_error(std::string("Cannot load srtm file:") + path);
-    }
-
-    file.seekg(0, std::ios::beg);
-
-    std::vector<char> data((std::istreambuf_iterator<char>(file)),
-                           (std::istreambuf_iterator<char>()));
-
-    return HgtCell(totalPx, secondsPerPx, data);
+    return static_cast<std::int16_t>(cell.data[pos] << 8 | cell.data[pos + 1]);
   }
 
   std::string getFilePath(const HgtCellKey &key) const {
@@ -184,10 +218,8 @@ class SrtmElevationProvider final : public ElevationProvider {
     return stream.str();
   }
 
-  mutable std::map<HgtCellKey, HgtCell> cells_;
-  mutable std::mutex lock_;
   std::string dataPath_;
-  int maxCacheSize_;
+  mutable utymap::utils::ConcurrentLruCache<HgtCellKey, HgtCellPtr, HgtCellKey::Hash> cells_;
 };
 
 }
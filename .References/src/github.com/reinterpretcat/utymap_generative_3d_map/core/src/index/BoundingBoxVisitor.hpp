@@ -0,0 +1,41 @@
+#ifndef INDEX_BOUNDINGBOXVISITOR_HPP_DEFINED
+#define INDEX_BOUNDINGBOXVISITOR_HPP_DEFINED
+
+#include "BoundingBox.hpp"
+#include "entities/Area.hpp"
+#include "entities/ElementVisitor.hpp"
+#include "entities/Node.hpp"
+#include "entities/Relation.hpp"
+#include "entities/Way.hpp"
+
+namespace utymap {
+namespace index {
+
+/// Creates bounding box of given element.
+class BoundingBoxVisitor final : public utymap::entities::ElementVisitor {
+ public:
+  utymap::BoundingBox boundingBox;
+
+  void visitNode(const utymap::entities::Node &node) override {
+    boundingBox.expand(node.coordinate);
+  }
+
+  void visitWay(const utymap::entities::Way &way) override {
+    boundingBox.expand(way.coordinates.cbegin(), way.coordinates.cend());
+  }
+
+  void visitArea(const utymap::entities::Area &area) override {
+    boundingBox.expand(area.coordinates.cbegin(), area.coordinates.cend());
+  }
+
+  void visitRelation(const utymap::entities::Relation &relation) override {
+    for (const auto &element: relation.elements) {
+      element->accept(*this);
+    }
+  }
+};
+
+}
+}
+
+#endif // INDEX_BOUNDINGBOXVISITOR_HPP_DEFINED
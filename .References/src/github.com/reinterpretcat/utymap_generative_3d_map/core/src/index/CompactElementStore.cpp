@@ -0,0 +1,311 @@
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "index/CompactElementStore.hpp"
+
+#include <array>
+#include <cmath>
+#include <mutex>
+
+using namespace utymap;
+using namespace utymap::index;
+using namespace utymap::entities;
+
+namespace {
+/// Amount of independently locked buckets: allows to store elements from many threads.
+const std::size_t ShardCount = 16;
+/// Scale of fixed point coordinates.
+const double CoordinateScale = 1E7;
+
+enum class ElementType : std::uint8_t { Node, Way, Area, Relation };
+
+/// Describes element stored in arena: all data is referenced by offsets.
+struct Record final {
+  std::uint64_t id;
+  /// Index of first tag pair.
+  std::uint32_t tagOffset;
+  /// Index of first coordinate pair or relation member.
+  std::uint32_t dataOffset;
+  std::uint32_t dataCount;
+  std::uint16_t tagCount;
+  ElementType type;
+  std::uint8_t reserved;
+};
+
+static_assert(sizeof(Record)==24, "Unexpected record size.");
+
+/// Keeps all elements of one quadkey.
+struct Arena final {
+  /// Latitude and longitude pairs in fixed point.
+  std::vector<std::int32_t> coordinates;
+  /// Key and value id pairs.
+  std::vector<std::uint32_t> tags;
+  /// Record indices of relation members.
+  std::vector<std::uint32_t> members;
+  std::vector<Record> records;
+  /// Records of elements which were stored directly, not as relation members.
+  std::vector<std::uint32_t> roots;
+
+  std::size_t getMemoryUsage() const {
+    return coordinates.capacity()*sizeof(std::int32_t) + tags.capacity()*sizeof(std::uint32_t) +
+        members.capacity()*sizeof(std::uint32_t) + records.capacity()*sizeof(Record) +
+        roots.capacity()*sizeof(std::uint32_t);
+  }
+};
+
+typedef std::map<QuadKey, Arena, QuadKey::Comparator> ArenaMap;
+
+/// Packs element into arena.
+class ArenaWriter final : public ElementVisitor {
+ public:
+  explicit ArenaWriter(Arena &arena) : arena_(arena), index_(0) {}
+
+  /// Writes element and returns its record index.
+  std::uint32_t write(const Element &element) {
+    element.accept(*this);
+    return index_;
+  }
+
+  void visitNode(const Node &node) override {
+    std::uint32_t offset = addCoordinate(node.coordinate);
+    addRecord(node, ElementType::Node, offset, 1);
+  }
+
+  void visitWay(const Way &way) override {
+    addRecord(way, ElementType::Way, addCoordinates(way.coordinates), way.coordinates.size());
+  }
+
+  void visitArea(const Area &area) override {
+    addRecord(area, ElementType::Area, addCoordinates(area.coordinates), area.coordinates.size());
+  }
+
+  void visitRelation(const Relation &relation) override {
+    // NOTE members are written first, so their indices are contiguous in members buffer.
+    std::vector<std::uint32_t> members;
+    members.reserve(relation.elements.size());
+    for (const auto &element : relation.elements)
+      members.push_back(write(*element));
+
+    auto offset = static_cast<std::uint32_t>(arena_.members.size());
+    arena_.members.insert(arena_.members.end(), members.begin(), members.end());
+    addRecord(relation, ElementType::Relation, offset, members.size());
+  }
+
+ private:
+  std::uint32_t addCoordinate(const GeoCoordinate &coordinate) {
+    auto offset = static_cast<std::uint32_t>(arena_.coordinates.size()/2);
+    arena_.coordinates.push_back(static_cast<std::int32_t>(std::round(coordinate.latitude*CoordinateScale)));
+    arena_.coordinates.push_back(static_cast<std::int32_t>(std::round(coordinate.longitude*CoordinateScale)));
+    return offset;
+  }
+
+  std::uint32_t addCoordinates(const std::vector<GeoCoordinate> &coordinates) {
+    auto offset = static_cast<std::uint32_t>(arena_.coordinates.size()/2);
+    arena_.coordinates.reserve(arena_.coordinates.size() + coordinates.size()*2);
+    for (const auto &coordinate : coordinates)
+      addCoordinate(coordinate);
+    return offset;
+  }
+
+  void addRecord(const Element &element, ElementType type, std::uint32_t dataOffset, std::size_t dataCount) {
+    Record record;
+    record.id = element.id;
+    record.tagOffset = static_cast<std::uint32_t>(arena_.tags.size()/2);
+    record.tagCount = static_cast<std::uint16_t>(element.tags.size());
+    record.dataOffset = dataOffset;
+    record.dataCount = static_cast<std::uint32_t>(dataCount);
+    record.type = type;
+    record.reserved = 0;
+
+    for (const auto &tag : element.tags) {
+      arena_.tags.push_back(tag.key);
+      arena_.tags.push_back(tag.value);
+    }
+
+    index_ = static_cast<std::uint32_t>(arena_.records.size());
+    arena_.records.push_back(record);
+  }
+
+  Arena &arena_;
+  std::uint32_t index_;
+};
+
+/// Restores elements from arena. Node, way and area instances are reused between calls.
+class ArenaReader final {
+ public:
+  const Element &read(const Arena &arena, std::uint32_t index) {
+    const Record &record = arena.records[index];
+    switch (record.type) {
+      case ElementType::Node:
+        fill(arena, record, node_);
+        return node_;
+      case ElementType::Way:
+        fill(arena, record, way_);
+        return way_;
+      case ElementType::Area:
+        fill(arena, record, area_);
+        return area_;
+      default:
+        relation_ = createRelation(arena, record);
+        return *relation_;
+    }
+  }
+
+ private:
+  static std::shared_ptr<Element> create(const Arena &arena, std::uint32_t index) {
+    const Record &record = arena.records[index];
+    switch (record.type) {
+      case ElementType::Node: {
+        auto node = std::make_shared<Node>();
+        fill(arena, record, *node);
+        return node;
+      }
+      case ElementType::Way: {
+        auto way = std::make_shared<Way>();
+        fill(arena, record, *way);
+        return way;
+      }
+      case ElementType::Area: {
+        auto area = std::make_shared<Area>();
+        fill(arena, record, *area);
+        return area;
+      }
+      default:
+        return createRelation(arena, record);
+    }
+  }
+
+  static std::shared_ptr<Relation> createRelation(const Arena &arena, const Record &record) {
+    auto relation = std::make_shared<Relation>();
+    fillElement(arena, record, *relation);
+    relation->elements.reserve(record.dataCount);
+    for (std::uint32_t i = 0; i < record.dataCount; ++i)
+      relation->elements.push_back(create(arena, arena.members[record.dataOffset + i]));
+    return relation;
+  }
+
+  static void fill(const Arena &arena, const Record &record, Node &node) {
+    fillElement(arena, record, node);
+    node.coordinate = getCoordinate(arena, record.dataOffset);
+  }
+
+  template<typename T>
+  static void fill(const Arena &arena, const Record &record, T &element) {
+    fillElement(arena, record, element);
+    element.coordinates.clear();
+    element.coordinates.reserve(record.dataCount);
+    for (std::uint32_t i = 0; i < record.dataCount; ++i)
+      element.coordinates.push_back(getCoordinate(arena, record.dataOffset + i));
+  }
+
+  static void fillElement(const Arena &arena, const Record &record, Element &element) {
+    element.id = record.id;
+    element.tags.clear();
+    element.tags.reserve(record.tagCount);
+    for (std::uint32_t i = 0; i < record.tagCount; ++i) {
+      auto offset = (record.tagOffset + i)*2;
+      element.tags.push_back(Tag(arena.tags[offset], arena.tags[offset + 1]));
+    }
+  }
+
+  static GeoCoordinate getCoordinate(const Arena &arena, std::uint32_t index) {
+    return GeoCoordinate(arena.coordinates[index*2]/CoordinateScale,
+                         arena.coordinates[index*2 + 1]/CoordinateScale);
+  }
+
+  Node node_;
+  Way way_;
+  Area area_;
+  std::shared_ptr<Relation> relation_;
+};
+}
+
+class CompactElementStore::CompactElementStoreImpl {
+  /// Keeps arenas of quadkeys which belong to the same bucket.
+  struct Shard {
+    mutable std::mutex lock;
+    ArenaMap arenas;
+  };
+
+ public:
+  void store(const Element &element, const QuadKey &quadKey) {
+    auto &shard = getShard(quadKey);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto &arena = shard.arenas[quadKey];
+    arena.roots.push_back(ArenaWriter(arena).write(element));
+  }
+
+  void search(const QuadKey &quadKey, ElementVisitor &visitor, const CancellationToken &cancelToken) {
+    auto &shard = getShard(quadKey);
+    const Arena *arena = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      auto it = shard.arenas.find(quadKey);
+      if (it==shard.arenas.end()) return;
+      // NOTE map nodes are stable, so arena can be accessed later under lock.
+      arena = &it->second;
+    }
+
+    ArenaReader reader;
+    for (std::size_t i = 0; !cancelToken.isCancelled(); ++i) {
+      const Element *element = nullptr;
+      {
+        // NOTE element is restored under lock, but visited without it.
+        std::lock_guard<std::mutex> lock(shard.lock);
+        if (i >= arena->roots.size()) break;
+        element = &reader.read(*arena, arena->roots[i]);
+      }
+      element->accept(visitor);
+    }
+  }
+
+  bool hasData(const QuadKey &quadKey) const {
+    auto &shard = getShard(quadKey);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    return shard.arenas.find(quadKey)!=shard.arenas.end();
+  }
+
+  std::size_t getMemoryUsage() const {
+    std::size_t size = 0;
+    for (const auto &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      for (const auto &pair : shard.arenas)
+        size += sizeof(pair) + pair.second.getMemoryUsage();
+    }
+    return size;
+  }
+
+ private:
+  Shard &getShard(const QuadKey &quadKey) const {
+    std::size_t hash = (static_cast<std::size_t>(quadKey.tileX)*31 + quadKey.tileY)*31 + quadKey.levelOfDetail;
+    return shards_[hash%ShardCount];
+  }
+
+  mutable std::array<Shard, ShardCount> shards_;
+};
+
+CompactElementStore::CompactElementStore(const StringTable &stringTable) :
+    ElementStore(stringTable), pimpl_(utymap::utils::make_unique<CompactElementStoreImpl>()) {
+}
+
+CompactElementStore::~CompactElementStore() {
+}
+
+void CompactElementStore::storeImpl(const Element &element, const QuadKey &quadKey) {
+  pimpl_->store(element, quadKey);
+}
+
+bool CompactElementStore::hasData(const QuadKey &quadKey) const {
+  return pimpl_->hasData(quadKey);
+}
+
+void CompactElementStore::search(const QuadKey &quadKey,
+                                 ElementVisitor &visitor,
+                                 const CancellationToken &cancelToken) {
+  pimpl_->search(quadKey, visitor, cancelToken);
+}
+
+std::size_t CompactElementStore::getMemoryUsage() const {
+  return pimpl_->getMemoryUsage();
+}
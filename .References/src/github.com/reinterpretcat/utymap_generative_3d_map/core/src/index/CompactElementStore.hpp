@@ -0,0 +1,46 @@
+#ifndef INDEX_COMPACTELEMENTSTORE_HPP_DEFINED
+#define INDEX_COMPACTELEMENTSTORE_HPP_DEFINED
+
+#include "QuadKey.hpp"
+#include "entities/Element.hpp"
+#include "index/ElementStore.hpp"
+
+#include <memory>
+
+namespace utymap {
+namespace index {
+
+/// Provides API to store elements in memory using compact representation: elements of
+/// each quadkey are packed into arena with fixed point coordinates and tag id pairs.
+/// Elements are restored on search, so visitor should not keep references to them.
+/// NOTE coordinates are stored with 1e-7 degree precision.
+class CompactElementStore final : public ElementStore {
+ public:
+  explicit CompactElementStore(const utymap::index::StringTable &stringTable);
+
+  virtual ~CompactElementStore();
+
+  using ElementStore::search;
+  using ElementStore::hasData;
+
+  void search(const utymap::QuadKey &quadKey,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken) override;
+
+  bool hasData(const utymap::QuadKey &quadKey) const override;
+
+  /// Returns amount of bytes reserved by arenas.
+  std::size_t getMemoryUsage() const;
+
+ protected:
+  void storeImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) override;
+
+ private:
+  class CompactElementStoreImpl;
+  std::unique_ptr<CompactElementStoreImpl> pimpl_;
+};
+
+}
+}
+
+#endif // INDEX_COMPACTELEMENTSTORE_HPP_DEFINED
@@ -8,6 +8,9 @@
 #include "index/ElementStore.hpp"
 #include "index/ElementGeometryClipper.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace utymap;
 using namespace utymap::entities;
 
@@ -19,6 +22,49 @@ const double Scale = 1E7;
 
 using PointLocation = utymap::index::ElementGeometryClipper::PointLocation;
 
+/// Clip rectangle in clipper's integer coordinates.
+struct ClipRect final {
+  ClipperLib::cInt minX, minY, maxX, maxY;
+
+  bool operator==(const ClipRect &rhs) const {
+    return minX==rhs.minX && minY==rhs.minY && maxX==rhs.maxX && maxY==rhs.maxY;
+  }
+
+  static ClipRect create(const BoundingBox &bbox) {
+    return ClipRect{static_cast<ClipperLib::cInt>(bbox.minPoint.longitude*Scale),
+                    static_cast<ClipperLib::cInt>(bbox.minPoint.latitude*Scale),
+                    static_cast<ClipperLib::cInt>(bbox.maxPoint.longitude*Scale),
+                    static_cast<ClipperLib::cInt>(bbox.maxPoint.latitude*Scale)};
+  }
+};
+}
+
+namespace utymap {
+namespace index {
+
+struct ElementGeometryClipper::ClipContext final {
+  ClipContext() : clipPathRect(), hasClipPath(false), rect() {}
+
+  ClipperLib::ClipperEx clipper;
+  /// Rectangle which is added to clipper as clip path.
+  ClipRect clipPathRect;
+  bool hasClipPath;
+  /// Rectangle of current quadkey.
+  ClipRect rect;
+
+  ClipperLib::Path shape;
+  ClipperLib::Path buffer;
+  ClipperLib::Paths pieces;
+  ClipperLib::PolyTree solution;
+};
+
+}
+}
+
+namespace {
+
+using ClipContext = utymap::index::ElementGeometryClipper::ClipContext;
+
 template<typename T, typename std::enable_if<std::is_same<T, Way>::value, std::size_t>::type = 0>
 bool areConnected(const BoundingBox &, const BoundingBox &, bool allOutside) {
   return !allOutside;
@@ -30,8 +76,7 @@ bool areConnected(const BoundingBox &quadKeyBbox, const BoundingBox &elementBbox
 }
 
 template<typename T>
-PointLocation checkElement(const BoundingBox &quadKeyBbox, const T &element, ClipperLib::Path &elementShape) {
-  elementShape.reserve(element.coordinates.size());
+PointLocation checkElement(const BoundingBox &quadKeyBbox, const T &element) {
   bool allInside = true;
   bool allOutside = true;
   BoundingBox elementBbox;
@@ -40,16 +85,23 @@ PointLocation checkElement(const BoundingBox &quadKeyBbox, const T &element, Cli
     allInside &= contains;
     allOutside &= !contains;
     elementBbox.expand(coord);
-
-    auto x = static_cast<ClipperLib::cInt>(coord.longitude*Scale);
-    auto y = static_cast<ClipperLib::cInt>(coord.latitude*Scale);
-    elementShape.push_back(ClipperLib::IntPoint(x, y));
   }
 
   return allInside ? PointLocation::AllInside :
          (areConnected<T>(quadKeyBbox, elementBbox, allOutside) ? PointLocation::Mixed : PointLocation::AllOutside);
 }
 
+template<typename T>
+void createPath(const T &element, ClipperLib::Path &path) {
+  path.clear();
+  path.reserve(element.coordinates.size());
+  for (const GeoCoordinate &coord : element.coordinates) {
+    auto x = static_cast<ClipperLib::cInt>(coord.longitude*Scale);
+    auto y = static_cast<ClipperLib::cInt>(coord.latitude*Scale);
+    path.push_back(ClipperLib::IntPoint(x, y));
+  }
+}
+
 template<typename T>
 void setCoordinates(T &t, const ClipperLib::Path &path) {
   t.coordinates.reserve(path.size());
@@ -58,71 +110,246 @@ void setCoordinates(T &t, const ClipperLib::Path &path) {
   }
 }
 
-ClipperLib::Path createPathFromBoundingBox(const BoundingBox &quadKeyBbox) {
-  double xMin = quadKeyBbox.minPoint.longitude, yMin = quadKeyBbox.minPoint.latitude,
-      xMax = quadKeyBbox.maxPoint.longitude, yMax = quadKeyBbox.maxPoint.latitude;
-  ClipperLib::Path rect;
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMin*Scale),
-                                      static_cast<ClipperLib::cInt>(yMin*Scale)));
+template<typename T>
+std::shared_ptr<T> createElement(const T &element, std::uint64_t id, const ClipperLib::Path &path) {
+  auto clippedElement = std::make_shared<T>();
+  clippedElement->id = id;
+  clippedElement->tags = element.tags;
+  setCoordinates(*clippedElement, path);
+  return clippedElement;
+}
+
+std::shared_ptr<Relation> createRelation(std::uint64_t id, std::size_t count) {
+  auto relation = std::make_shared<Relation>();
+  relation->id = id;
+  relation->elements.reserve(count);
+  return relation;
+}
 
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMax*Scale),
-                                      static_cast<ClipperLib::cInt>(yMin*Scale)));
+// region Polyline clipping
 
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMax*Scale),
-                                      static_cast<ClipperLib::cInt>(yMax*Scale)));
+/// Updates parametric range of segment using Liang-Barsky algorithm for one rectangle side.
+bool clipParameter(double p, double q, double &t0, double &t1) {
+  if (p==0)
+    return q >= 0;
 
-  rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(xMin*Scale),
-                                      static_cast<ClipperLib::cInt>(yMax*Scale)));
-  return std::move(rect);
+  double r = q/p;
+  if (p < 0) {
+    if (r > t1) return false;
+    t0 = std::max(t0, r);
+  } else {
+    if (r < t0) return false;
+    t1 = std::min(t1, r);
+  }
+  return true;
 }
 
-template<typename T>
-std::shared_ptr<Element> clipElement(ClipperLib::ClipperEx &clipper,
-                                     const BoundingBox &bbox,
-                                     const T &element,
-                                     bool isClosed) {
-  ClipperLib::Path elementShape;
-  PointLocation pointLocation = checkElement(bbox, element, elementShape);
-  // 1. all geometry inside current quadkey: no need to truncate.
-  if (pointLocation==PointLocation::AllInside) {
-    return std::make_shared<T>(element);
-  }
-
-  // 2. all geometry outside : way should be skipped
-  if (pointLocation==PointLocation::AllOutside) {
-    return nullptr;
+ClipperLib::IntPoint interpolate(const ClipperLib::IntPoint &start,
+                                 const ClipperLib::IntPoint &end,
+                                 double t,
+                                 const ClipRect &rect) {
+  auto x = static_cast<ClipperLib::cInt>(std::llround(start.X + t*(end.X - start.X)));
+  auto y = static_cast<ClipperLib::cInt>(std::llround(start.Y + t*(end.Y - start.Y)));
+  return ClipperLib::IntPoint(std::min(std::max(x, rect.minX), rect.maxX),
+                              std::min(std::max(y, rect.minY), rect.maxY));
+}
+
+/// Clips polyline by rectangle keeping its direction. Stores pieces into given paths
+/// reusing their memory and returns amount of pieces.
+std::size_t clipPolyline(const ClipperLib::Path &path, const ClipRect &rect, ClipperLib::Paths &pieces) {
+  std::size_t count = 0;
+  bool isOpen = false;
+  for (std::size_t i = 1; i < path.size(); ++i) {
+    const auto &start = path[i - 1];
+    const auto &end = path[i];
+    double t0 = 0, t1 = 1;
+    double dx = static_cast<double>(end.X - start.X), dy = static_cast<double>(end.Y - start.Y);
+    if (!clipParameter(-dx, static_cast<double>(start.X - rect.minX), t0, t1) ||
+        !clipParameter(dx, static_cast<double>(rect.maxX - start.X), t0, t1) ||
+        !clipParameter(-dy, static_cast<double>(start.Y - rect.minY), t0, t1) ||
+        !clipParameter(dy, static_cast<double>(rect.maxY - start.Y), t0, t1)) {
+      isOpen = false;
+      continue;
+    }
+
+    auto clippedStart = t0 > 0 ? interpolate(start, end, t0, rect) : start;
+    auto clippedEnd = t1 < 1 ? interpolate(start, end, t1, rect) : end;
+
+    if (!isOpen || pieces[count - 1].back()!=clippedStart) {
+      // NOTE piece which only touches rectangle is replaced.
+      if (count > 0 && pieces[count - 1].size() < 2) --count;
+      if (count==pieces.size()) pieces.emplace_back();
+      pieces[count].clear();
+      pieces[count++].push_back(clippedStart);
+    }
+
+    if (pieces[count - 1].back()!=clippedEnd)
+      pieces[count - 1].push_back(clippedEnd);
+
+    isOpen = t1==1;
   }
 
-  ClipperLib::PolyTree solution;
-  clipper.AddPath(elementShape, ClipperLib::ptSubject, isClosed);
-  clipper.Execute(ClipperLib::ctIntersection, solution);
-  clipper.removeSubject();
-
-  std::size_t count = static_cast<std::size_t>(solution.Total());
-
-  // 3. way intersects border only once: store a copy with clipped geometry
-  if (count==1) {
-    auto clippedElement = std::make_shared<T>();
-    clippedElement->id = element.id;
-    clippedElement->tags = element.tags;
-    setCoordinates(*clippedElement, solution.GetFirst()->Contour);
-    
-    return clippedElement;
-  }
-  // 4. in this case, result should be stored as relation (collection of ways)
-  if (count > 1) {
-    auto relation = std::make_shared<Relation>();
-    relation->id = element.id;
-    relation->elements.reserve(count);
-    ClipperLib::PolyNode *polyNode = solution.GetFirst();
-    while (polyNode) {
-      auto clippedElement = std::make_shared<T>();
-      clippedElement->id = 0;
-      clippedElement->tags = element.tags;
-      setCoordinates(*clippedElement, polyNode->Contour);
-      relation->elements.push_back(clippedElement);
-      polyNode = polyNode->GetNext();
+  if (count > 0 && pieces[count - 1].size() < 2) --count;
+
+  return count;
+}
+
+// endregion
+
+// region Polygon clipping
+
+long double cross(const ClipperLib::IntPoint &a, const ClipperLib::IntPoint &b, const ClipperLib::IntPoint &c) {
+  return static_cast<long double>(b.X - a.X)*(c.Y - b.Y) - static_cast<long double>(b.Y - a.Y)*(c.X - b.X);
+}
+
+int sign(long double value) {
+  return (value > 0) - (value < 0);
+}
+
+/// Checks whether polygon is convex and does not wind more than once, so it can be clipped
+/// by Sutherland-Hodgman algorithm.
+bool isConvex(const ClipperLib::Path &path) {
+  std::size_t size = path.size();
+  if (size < 3) return false;
+
+  // find the last edge with non zero length to start from.
+  std::size_t last = size;
+  while (last > 0 && path[last - 1]==path[last%size]) --last;
+  if (last==0) return false;
+
+  ClipperLib::IntPoint previous(path[last%size].X - path[last - 1].X, path[last%size].Y - path[last - 1].Y);
+  int xSign = sign(previous.X), ySign = sign(previous.Y);
+  int direction = 0, xFlips = 0, yFlips = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    ClipperLib::IntPoint edge(path[(i + 1)%size].X - path[i].X, path[(i + 1)%size].Y - path[i].Y);
+    if (edge.X==0 && edge.Y==0) continue;
+
+    int turn = sign(static_cast<long double>(previous.X)*edge.Y - static_cast<long double>(previous.Y)*edge.X);
+    if (turn!=0) {
+      if (direction!=0 && direction!=turn) return false;
+      direction = turn;
+    }
+
+    if (edge.X!=0) {
+      if (xSign!=0 && xSign!=sign(edge.X)) ++xFlips;
+      xSign = sign(edge.X);
     }
+    if (edge.Y!=0) {
+      if (ySign!=0 && ySign!=sign(edge.Y)) ++yFlips;
+      ySign = sign(edge.Y);
+    }
+    previous = edge;
+  }
+
+  return direction!=0 && xFlips <= 2 && yFlips <= 2;
+}
+
+template<typename Inside, typename Intersect>
+void clipByEdge(const ClipperLib::Path &input, ClipperLib::Path &output, Inside inside, Intersect intersect) {
+  output.clear();
+  if (input.empty()) return;
+
+  const ClipperLib::IntPoint *previous = &input.back();
+  for (const auto &current : input) {
+    bool isInside = inside(current);
+    if (isInside!=inside(*previous))
+      output.push_back(intersect(*previous, current));
+    if (isInside)
+      output.push_back(current);
+    previous = &current;
+  }
+}
+
+ClipperLib::IntPoint intersectX(const ClipperLib::IntPoint &a, const ClipperLib::IntPoint &b, ClipperLib::cInt x) {
+  double t = static_cast<double>(x - a.X)/(b.X - a.X);
+  return ClipperLib::IntPoint(x, a.Y + static_cast<ClipperLib::cInt>(std::llround(t*(b.Y - a.Y))));
+}
+
+ClipperLib::IntPoint intersectY(const ClipperLib::IntPoint &a, const ClipperLib::IntPoint &b, ClipperLib::cInt y) {
+  double t = static_cast<double>(y - a.Y)/(b.Y - a.Y);
+  return ClipperLib::IntPoint(a.X + static_cast<ClipperLib::cInt>(std::llround(t*(b.X - a.X))), y);
+}
+
+/// Removes duplicated and collinear points, makes orientation positive and starts polygon
+/// from its top right point in the same way as clipper outputs polygons.
+void normalizePolygon(ClipperLib::Path &path) {
+  bool hasChanges = true;
+  while (hasChanges && path.size() >= 3) {
+    hasChanges = false;
+    for (std::size_t i = 0; i < path.size() && path.size() >= 3;) {
+      const auto &previous = path[(i + path.size() - 1)%path.size()];
+      const auto &next = path[(i + 1)%path.size()];
+      if (cross(previous, path[i], next)==0) {
+        path.erase(path.begin() + i);
+        hasChanges = true;
+      } else
+        ++i;
+    }
+  }
+
+  if (path.size() < 3) {
+    path.clear();
+    return;
+  }
+
+  if (!ClipperLib::Orientation(path))
+    ClipperLib::ReversePath(path);
+
+  auto top = std::max_element(path.begin(), path.end(),
+                              [](const ClipperLib::IntPoint &lhs, const ClipperLib::IntPoint &rhs) {
+                                return lhs.Y < rhs.Y || (lhs.Y==rhs.Y && lhs.X < rhs.X);
+                              });
+  std::rotate(path.begin(), top, path.end());
+}
+
+/// Clips convex polygon by rectangle using Sutherland-Hodgman algorithm. Result is stored in path.
+void clipConvexPolygon(ClipperLib::Path &path, ClipperLib::Path &buffer, const ClipRect &rect) {
+  using ClipperLib::IntPoint;
+  clipByEdge(path, buffer, [&](const IntPoint &p) { return p.X >= rect.minX; },
+             [&](const IntPoint &a, const IntPoint &b) { return intersectX(a, b, rect.minX); });
+  clipByEdge(buffer, path, [&](const IntPoint &p) { return p.X <= rect.maxX; },
+             [&](const IntPoint &a, const IntPoint &b) { return intersectX(a, b, rect.maxX); });
+  clipByEdge(path, buffer, [&](const IntPoint &p) { return p.Y >= rect.minY; },
+             [&](const IntPoint &a, const IntPoint &b) { return intersectY(a, b, rect.minY); });
+  clipByEdge(buffer, path, [&](const IntPoint &p) { return p.Y <= rect.maxY; },
+             [&](const IntPoint &a, const IntPoint &b) { return intersectY(a, b, rect.maxY); });
+  normalizePolygon(path);
+}
+
+/// Adds rectangle as clip path unless clipper has it already.
+void setClipPath(ClipContext &context) {
+  if (context.hasClipPath && context.clipPathRect==context.rect)
+    return;
+
+  const ClipRect &rect = context.rect;
+  context.buffer.clear();
+  context.buffer.push_back(ClipperLib::IntPoint(rect.minX, rect.minY));
+  context.buffer.push_back(ClipperLib::IntPoint(rect.maxX, rect.minY));
+  context.buffer.push_back(ClipperLib::IntPoint(rect.maxX, rect.maxY));
+  context.buffer.push_back(ClipperLib::IntPoint(rect.minX, rect.maxY));
+
+  context.clipper.Clear();
+  context.clipper.AddPath(context.buffer, ClipperLib::ptClip, true);
+  context.clipPathRect = rect;
+  context.hasClipPath = true;
+}
+
+// endregion
+
+/// Clips way which crosses quadkey border.
+std::shared_ptr<Element> clipMixed(ClipContext &context, const Way &way) {
+  createPath(way, context.shape);
+  std::size_t count = clipPolyline(context.shape, context.rect, context.pieces);
+
+  // way intersects border only once: store a copy with clipped geometry
+  if (count==1)
+    return createElement(way, way.id, context.pieces[0]);
+
+  // in this case, result should be stored as relation (collection of ways)
+  if (count > 1) {
+    auto relation = createRelation(way.id, count);
+    for (std::size_t i = 0; i < count; ++i)
+      relation->elements.push_back(createElement(way, 0, context.pieces[i]));
     return relation;
   }
 
@@ -130,22 +357,58 @@ std::shared_ptr<Element> clipElement(ClipperLib::ClipperEx &clipper,
   return nullptr;
 }
 
-std::shared_ptr<Element> clipWay(ClipperLib::ClipperEx &clipper, const BoundingBox &bbox, const Way &way) {
-  return clipElement(clipper, bbox, way, false);
+/// Clips area which crosses quadkey border.
+std::shared_ptr<Element> clipMixed(ClipContext &context, const Area &area) {
+  createPath(area, context.shape);
+
+  // convex polygon is clipped without clipper: the result is always one polygon.
+  if (isConvex(context.shape)) {
+    clipConvexPolygon(context.shape, context.buffer, context.rect);
+    return context.shape.empty() ? nullptr : createElement(area, area.id, context.shape);
+  }
+
+  setClipPath(context);
+  context.clipper.AddPath(context.shape, ClipperLib::ptSubject, true);
+  context.clipper.Execute(ClipperLib::ctIntersection, context.solution);
+  context.clipper.removeSubject();
+
+  std::size_t count = static_cast<std::size_t>(context.solution.Total());
+
+  if (count==1)
+    return createElement(area, area.id, context.solution.GetFirst()->Contour);
+
+  if (count > 1) {
+    auto relation = createRelation(area.id, count);
+    ClipperLib::PolyNode *polyNode = context.solution.GetFirst();
+    while (polyNode) {
+      relation->elements.push_back(createElement(area, 0, polyNode->Contour));
+      polyNode = polyNode->GetNext();
+    }
+    return relation;
+  }
+
+  return nullptr;
 }
 
-std::shared_ptr<Element> clipArea(ClipperLib::ClipperEx &clipper, const BoundingBox &bbox, const Area &area) {
-  return clipElement(clipper, bbox, area, true);
+template<typename T>
+std::shared_ptr<Element> clipElement(ClipContext &context, const BoundingBox &bbox, const T &element) {
+  switch (checkElement(bbox, element)) {
+    // all geometry inside current quadkey: no need to truncate.
+    case PointLocation::AllInside: return std::make_shared<T>(element);
+    // all geometry outside : element should be skipped
+    case PointLocation::AllOutside: return nullptr;
+    default: return clipMixed(context, element);
+  }
 }
 
-std::shared_ptr<Element> clipRelation(ClipperLib::ClipperEx &clipper,
+std::shared_ptr<Element> clipRelation(ClipContext &context,
                                       const BoundingBox &bbox,
                                       const Relation &relation);
 
 /// Visits relation and collects clipped elements
 struct RelationVisitor : public ElementVisitor {
-  RelationVisitor(ClipperLib::ClipperEx &clipper, const BoundingBox &quadKeyBbox) :
-      relation(nullptr), clipper_(clipper), bbox_(quadKeyBbox) {
+  RelationVisitor(ClipContext &context, const BoundingBox &quadKeyBbox) :
+      relation(nullptr), context_(context), bbox_(quadKeyBbox) {
   }
 
   void visitNode(const Node &node) override {
@@ -156,15 +419,15 @@ struct RelationVisitor : public ElementVisitor {
   }
 
   void visitWay(const Way &way) override {
-    addElement(clipWay(clipper_, bbox_, way));
+    addElement(clipElement(context_, bbox_, way));
   }
 
   void visitArea(const Area &area) override {
-    addElement(clipArea(clipper_, bbox_, area));
+    addElement(clipElement(context_, bbox_, area));
   }
 
   void visitRelation(const Relation &relation) override {
-    addElement(clipRelation(clipper_, bbox_, relation));
+    addElement(clipRelation(context_, bbox_, relation));
   }
 
   std::shared_ptr<Relation> relation;
@@ -184,14 +447,14 @@ struct RelationVisitor : public ElementVisitor {
     relation->elements.push_back(element);
   }
 
-  ClipperLib::ClipperEx &clipper_;
+  ClipContext &context_;
   const BoundingBox &bbox_;
 };
 
-std::shared_ptr<Element> clipRelation(ClipperLib::ClipperEx &clipper,
+std::shared_ptr<Element> clipRelation(ClipContext &context,
                                       const BoundingBox &bbox,
                                       const Relation &relation) {
-  RelationVisitor visitor(clipper, bbox);
+  RelationVisitor visitor(context, bbox);
 
   for (const auto &element : relation.elements)
     element->accept(visitor);
@@ -208,13 +471,39 @@ std::shared_ptr<Element> clipRelation(ClipperLib::ClipperEx &clipper,
 
   return element;
 }
+
+/// Calls callback with clipped element. Element inside quadkey is passed as is without copying.
+template<typename T, typename Callback>
+void clipAndCallElement(ClipContext &context,
+                        const BoundingBox &bbox,
+                        const T &element,
+                        const QuadKey &quadKey,
+                        const Callback &callback) {
+  switch (checkElement(bbox, element)) {
+    case PointLocation::AllInside:
+      callback(element, quadKey);
+      break;
+    case PointLocation::Mixed: {
+      auto clippedElement = clipMixed(context, element);
+      if (clippedElement!=nullptr)
+        callback(*clippedElement, quadKey);
+      break;
+    }
+    default: break;
+  }
+}
 }
 
 namespace utymap {
 namespace index {
 
 ElementGeometryClipper::ElementGeometryClipper(Callback callback) :
-    callback_(callback), quadKey_(), quadKeyBbox_(), clipper_() {
+    callback_(callback), quadKey_(), quadKeyBbox_(), context_(getContext()) {
+}
+
+ElementGeometryClipper::ClipContext &ElementGeometryClipper::getContext() {
+  thread_local ClipContext context;
+  return context;
 }
 
 void ElementGeometryClipper::clipAndCall(const Element &element,
@@ -222,8 +511,7 @@ void ElementGeometryClipper::clipAndCall(const Element &element,
                                          const BoundingBox &quadKeyBbox) {
   quadKey_ = quadKey;
   quadKeyBbox_ = quadKeyBbox;
-  clipper_.Clear();
-  clipper_.AddPath(createPathFromBoundingBox(quadKeyBbox_), ClipperLib::ptClip, true);
+  context_.rect = ClipRect::create(quadKeyBbox);
   element.accept(*this);
 }
 
@@ -233,19 +521,15 @@ void ElementGeometryClipper::visitNode(const Node &node) {
 }
 
 void ElementGeometryClipper::visitWay(const Way &way) {
-  auto element = clipWay(clipper_, quadKeyBbox_, way);
-  if (element!=nullptr)
-    callback_(*element, quadKey_);
+  clipAndCallElement(context_, quadKeyBbox_, way, quadKey_, callback_);
 }
 
 void ElementGeometryClipper::visitArea(const Area &area) {
-  auto element = clipArea(clipper_, quadKeyBbox_, area);
-  if (element!=nullptr)
-    callback_(*element, quadKey_);
+  clipAndCallElement(context_, quadKeyBbox_, area, quadKey_, callback_);
 }
 
 void ElementGeometryClipper::visitRelation(const Relation &relation) {
-  auto element = clipRelation(clipper_, quadKeyBbox_, relation);
+  auto element = clipRelation(context_, quadKeyBbox_, relation);
   if (element!=nullptr)
     callback_(*element, quadKey_);
 }
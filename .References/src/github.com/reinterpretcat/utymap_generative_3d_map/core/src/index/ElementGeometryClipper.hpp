@@ -13,12 +13,15 @@ namespace utymap {
 namespace index {
 
 /// Modifies geometry of element by bounding box clipping.
+/// NOTE clipper and point buffers are shared by all instances created on the same thread.
 class ElementGeometryClipper final : private utymap::entities::ElementVisitor {
  public:
   /// Defines callback
   typedef std::function<void(const utymap::entities::Element &element, const utymap::QuadKey &quadKey)> Callback;
   /// Defines polygon points location relative to current quadkey.
   enum class PointLocation { AllInside, AllOutside, Mixed };
+  /// Keeps clipper and buffers reused between clip operations.
+  struct ClipContext;
 
   explicit ElementGeometryClipper(Callback callback);
 
@@ -34,10 +37,13 @@ class ElementGeometryClipper final : private utymap::entities::ElementVisitor {
 
   void visitRelation(const utymap::entities::Relation &relation) override;
 
+  /// Returns clip context of current thread.
+  static ClipContext &getContext();
+
   Callback callback_;
   QuadKey quadKey_;
   BoundingBox quadKeyBbox_;
-  ClipperLib::ClipperEx clipper_;
+  ClipContext &context_;
 };
 
 }
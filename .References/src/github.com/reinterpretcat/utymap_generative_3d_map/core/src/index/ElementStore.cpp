@@ -6,10 +6,14 @@
 #include "entities/Area.hpp"
 #include "entities/Relation.hpp"
 #include "formats/FormatTypes.hpp"
+#include "index/BoundingBoxVisitor.hpp"
 #include "index/ElementGeometryClipper.hpp"
 #include "index/ElementStore.hpp"
 #include <mapcss/StyleConsts.hpp>
 
+#include <algorithm>
+#include <set>
+
 using namespace utymap;
 using namespace utymap::entities;
 using namespace utymap::formats;
@@ -17,30 +21,45 @@ using namespace utymap::mapcss;
 
 namespace {
 const std::string TrueValue = "true";
+/// Minimal amount of pending entries of one level of detail which triggers merging them into index.
+/// Limit grows with index size, so rebuilding of packed index stays amortized.
+const std::size_t PendingEntriesLimit = 1 << 16;
 
-/// Creates bounding box of given element.
-class BoundingBoxVisitor : public ElementVisitor {
+/// Passes to visitor only elements which intersect given bounding box.
+class BoundingBoxFilter final : public ElementVisitor {
  public:
-  BoundingBox boundingBox;
-
-  void visitNode(const Node &node) override {
-    boundingBox.expand(node.coordinate);
+  BoundingBoxFilter(const BoundingBox &bbox, ElementVisitor &visitor) :
+      bbox_(bbox), visitor_(visitor) {
   }
 
-  void visitWay(const Way &way) override {
-    boundingBox.expand(way.coordinates.cbegin(), way.coordinates.cend());
-  }
+  void visitNode(const Node &node) override { filter(node); }
 
-  void visitArea(const Area &area) override {
-    boundingBox.expand(area.coordinates.cbegin(), area.coordinates.cend());
-  }
+  void visitWay(const Way &way) override { filter(way); }
 
-  void visitRelation(const Relation &relation) override {
-    for (const auto &element: relation.elements) {
-      element->accept(*this);
-    }
+  void visitArea(const Area &area) override { filter(area); }
+
+  void visitRelation(const Relation &relation) override { filter(relation); }
+
+ private:
+  void filter(const Element &element) {
+    utymap::index::BoundingBoxVisitor bboxVisitor;
+    element.accept(bboxVisitor);
+    if (bboxVisitor.boundingBox.intersects(bbox_))
+      element.accept(visitor_);
   }
+
+  const BoundingBox &bbox_;
+  ElementVisitor &visitor_;
 };
+
+/// Returns intersection of two bounding boxes.
+BoundingBox intersection(const BoundingBox &lhs, const BoundingBox &rhs) {
+  return BoundingBox(
+      GeoCoordinate(std::max(lhs.minPoint.latitude, rhs.minPoint.latitude),
+                    std::max(lhs.minPoint.longitude, rhs.minPoint.longitude)),
+      GeoCoordinate(std::min(lhs.maxPoint.latitude, rhs.maxPoint.latitude),
+                    std::min(lhs.maxPoint.longitude, rhs.maxPoint.longitude)));
+}
 }
 
 namespace utymap {
@@ -80,6 +99,112 @@ bool ElementStore::store(const Element &element,
                });
 }
 
+void ElementStore::search(const BoundingBox &bbox,
+                          int levelOfDetail,
+                          ElementVisitor &visitor,
+                          const CancellationToken &cancelToken) {
+  std::shared_ptr<const SpatialIndex> index;
+  std::set<QuadKey, QuadKey::Comparator> quadKeys;
+  {
+    std::lock_guard<std::mutex> lock(indexLock_);
+    index = getIndex(levelOfDetail);
+    auto pending = pendingEntries_.find(levelOfDetail);
+    if (pending!=pendingEntries_.end()) {
+      for (const auto &entry : pending->second) {
+        if (entry.bbox.intersects(bbox))
+          quadKeys.insert(entry.quadKey);
+      }
+    }
+  }
+
+  // NOTE index is immutable, so it can be read without lock.
+  index->search(bbox, [&](const SpatialIndex::Entry &entry) {
+    quadKeys.insert(entry.quadKey);
+  });
+
+  BoundingBoxFilter filter(bbox, visitor);
+  for (const auto &quadKey : quadKeys) {
+    if (cancelToken.isCancelled())
+      break;
+    search(quadKey, filter, cancelToken);
+  }
+}
+
+bool ElementStore::hasData(const BoundingBox &bbox, int levelOfDetail) {
+  std::shared_ptr<const SpatialIndex> index;
+  {
+    std::lock_guard<std::mutex> lock(indexLock_);
+    index = getIndex(levelOfDetail);
+    auto pending = pendingEntries_.find(levelOfDetail);
+    if (pending!=pendingEntries_.end()) {
+      for (const auto &entry : pending->second) {
+        if (entry.bbox.intersects(bbox))
+          return true;
+      }
+    }
+  }
+  return index->intersects(bbox);
+}
+
+void ElementStore::commit() {
+  std::unique_lock<std::mutex> lock(indexLock_);
+  // NOTE merges started by store should finish first, otherwise their entries would be skipped.
+  mergeCondition_.wait(lock, [&]() { return merging_.empty(); });
+
+  std::vector<int> levelOfDetails;
+  for (const auto &pair : pendingEntries_)
+    levelOfDetails.push_back(pair.first);
+  for (int levelOfDetail : levelOfDetails)
+    mergeEntries(lock, levelOfDetail);
+}
+
+void ElementStore::mergeEntries(std::unique_lock<std::mutex> &lock, int levelOfDetail) {
+  if (!merging_.insert(levelOfDetail).second)
+    return;
+
+  // NOTE pending entries stay visible to search until merged index replaces old one.
+  auto oldIndex = getIndex(levelOfDetail);
+  const auto &pending = pendingEntries_[levelOfDetail];
+  std::vector<SpatialIndex::Entry> merged(pending.begin(), pending.end());
+  std::shared_ptr<const SpatialIndex> index;
+
+  lock.unlock();
+  try {
+    // Packed tree cannot be modified, so it is rebuilt from old and new entries.
+    std::vector<SpatialIndex::Entry> entries = oldIndex->entries();
+    entries.insert(entries.end(), merged.begin(), merged.end());
+    index = std::make_shared<const SpatialIndex>(std::move(entries));
+    saveIndex(levelOfDetail, *index);
+    lock.lock();
+    replaceIndex(levelOfDetail);
+  } catch (...) {
+    if (!lock.owns_lock()) lock.lock();
+    merging_.erase(levelOfDetail);
+    mergeCondition_.notify_all();
+    throw;
+  }
+
+  indices_[levelOfDetail] = index;
+  // NOTE entries stored during merge are kept for the next one.
+  auto &remaining = pendingEntries_[levelOfDetail];
+  remaining.erase(remaining.begin(), remaining.begin() + merged.size());
+  if (remaining.empty())
+    pendingEntries_.erase(levelOfDetail);
+  merging_.erase(levelOfDetail);
+  mergeCondition_.notify_all();
+}
+
+const std::shared_ptr<const SpatialIndex> &ElementStore::getIndex(int levelOfDetail) {
+  auto it = indices_.find(levelOfDetail);
+  if (it!=indices_.end())
+    return it->second;
+
+  auto index = loadIndex(levelOfDetail);
+  if (index==nullptr)
+    index = std::make_shared<const SpatialIndex>();
+  return indices_.emplace(levelOfDetail, index).first->second;
+}
+
 template<typename Visitor>
 bool ElementStore::store(const Element &element,
                          const LodRange &range,
@@ -88,6 +213,7 @@ bool ElementStore::store(const Element &element,
   BoundingBoxVisitor bboxVisitor;
   using namespace std::placeholders;
   ElementGeometryClipper geometryClipper(std::bind(&ElementStore::storeImpl, this, _1, _2));
+  std::vector<SpatialIndex::Entry> entries;
   bool wasStored = false;
   for (int lod = range.start; lod <= range.end; ++lod) {
     Style style = styleProvider.forElement(element, lod);
@@ -108,10 +234,23 @@ bool ElementStore::store(const Element &element,
         else
           storeImpl(element, quadKey);
 
+        entries.push_back(SpatialIndex::Entry{intersection(bboxVisitor.boundingBox, quadKeyBbox), quadKey});
         wasStored = true;
       });
   }
 
+  if (!entries.empty()) {
+    std::unique_lock<std::mutex> lock(indexLock_);
+    for (const auto &entry : entries) {
+      int levelOfDetail = entry.quadKey.levelOfDetail;
+      auto &pending = pendingEntries_[levelOfDetail];
+      pending.push_back(entry);
+      // NOTE keeps memory used by pending entries bounded during long imports.
+      if (pending.size() >= std::max(PendingEntriesLimit, getIndex(levelOfDetail)->entries().size()))
+        mergeEntries(lock, levelOfDetail);
+    }
+  }
+
   // NOTE still might be clipped and then skipped
   return wasStored;
 }
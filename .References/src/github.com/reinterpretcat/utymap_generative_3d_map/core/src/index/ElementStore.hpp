@@ -7,8 +7,16 @@
 #include "QuadKey.hpp"
 #include "entities/Element.hpp"
 #include "entities/ElementVisitor.hpp"
+#include "index/SpatialIndex.hpp"
 #include "mapcss/StyleProvider.hpp"
 
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
 namespace utymap {
 namespace index {
 
@@ -27,6 +35,20 @@ class ElementStore {
   /// Checks whether there is data for given quadkey.
   virtual bool hasData(const utymap::QuadKey &quadKey) const = 0;
 
+  /// Searches for elements which bounding box intersects given one at given level of detail.
+  /// NOTE element which is stored in several quadkeys is visited once per quadkey.
+  void search(const utymap::BoundingBox &bbox,
+              int levelOfDetail,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken);
+
+  /// Checks whether there is data which intersects given bounding box at given level of detail.
+  bool hasData(const utymap::BoundingBox &bbox, int levelOfDetail);
+
+  /// Flushes pending changes to underlying storage. Called when import is finished.
+  /// Rebuilds spatial index of all levels of detail which got new elements.
+  virtual void commit();
+
   /// Stores element in storage in all affected tiles at given level of details range.
   bool store(const utymap::entities::Element &element,
              const utymap::LodRange &range,
@@ -46,7 +68,25 @@ class ElementStore {
   /// Stores element in given quadkey.
   virtual void storeImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) = 0;
 
+  /// Reads spatial index of given level of detail from underlying storage. Returns nullptr if there is none.
+  virtual std::shared_ptr<const SpatialIndex> loadIndex(int levelOfDetail) { return nullptr; }
+
+  /// Writes spatial index of given level of detail to underlying storage aside of current one.
+  /// Called without index lock.
+  virtual void saveIndex(int levelOfDetail, const SpatialIndex &index) {}
+
+  /// Makes index written by saveIndex current one. Called under index lock.
+  virtual void replaceIndex(int levelOfDetail) {}
+
  private:
+  /// Returns spatial index of given level of detail. Should be called under index lock.
+  const std::shared_ptr<const SpatialIndex> &getIndex(int levelOfDetail);
+
+  /// Rebuilds spatial index of given level of detail with its pending entries and removes them.
+  /// Should be called under index lock which is released while index is built and saved.
+  /// Does nothing if this level of detail is already being merged.
+  void mergeEntries(std::unique_lock<std::mutex> &lock, int levelOfDetail);
+
   template<typename Visitor>
   bool store(const utymap::entities::Element &element,
              const utymap::LodRange &range,
@@ -54,6 +94,16 @@ class ElementStore {
              const Visitor &visitor);
 
   const std::uint32_t clipKeyId_, skipKeyId_;
+
+  std::mutex indexLock_;
+  /// Signals that merge of some level of detail is finished.
+  std::condition_variable mergeCondition_;
+  /// Levels of detail which are being merged.
+  std::set<int> merging_;
+  /// Spatial indices built on commit.
+  std::map<int, std::shared_ptr<const SpatialIndex>> indices_;
+  /// Entries of elements stored since last commit or merge.
+  std::map<int, std::vector<SpatialIndex::Entry>> pendingEntries_;
 };
 
 }
@@ -7,19 +7,78 @@
 #ifdef PBF_SUPPORTED_ENABLED
 #include "formats/osm/pbf/OsmPbfParser.hpp"
 #endif
+#include "index/BoundingBoxVisitor.hpp"
 #include "index/GeoStore.hpp"
 #include "index/InMemoryElementStore.hpp"
 
+#include "utils/ThreadPool.hpp"
+
+#include <cmath>
+#include <fstream>
+#include <future>
+
+using namespace utymap;
 using namespace utymap::entities;
 using namespace utymap::formats;
 using namespace utymap::index;
 using namespace utymap::mapcss;
+using namespace utymap::utils;
+
+namespace {
+/// Amount of elements stored by one thread pool task.
+const std::size_t StoreBatchSize = 512;
+
+/// Passes to visitor only elements which have at least one point of bounding box inside given circle.
+class RadiusFilter final : public ElementVisitor {
+ public:
+  RadiusFilter(const GeoCoordinate &center, double radius, ElementVisitor &visitor) :
+      center_(center), radius_(radius), visitor_(visitor) {
+  }
+
+  void visitNode(const Node &node) override { filter(node); }
+
+  void visitWay(const Way &way) override { filter(way); }
+
+  void visitArea(const Area &area) override { filter(area); }
+
+  void visitRelation(const Relation &relation) override { filter(relation); }
+
+ private:
+  void filter(const Element &element) {
+    BoundingBoxVisitor bboxVisitor;
+    element.accept(bboxVisitor);
+    const BoundingBox &bbox = bboxVisitor.boundingBox;
+    if (!bbox.isValid())
+      return;
+
+    // Closest to center point of bounding box.
+    GeoCoordinate closest(
+        std::max(bbox.minPoint.latitude, std::min(center_.latitude, bbox.maxPoint.latitude)),
+        std::max(bbox.minPoint.longitude, std::min(center_.longitude, bbox.maxPoint.longitude)));
+    if (GeoUtils::distance(center_, closest) <= radius_)
+      element.accept(visitor_);
+  }
+
+  const GeoCoordinate center_;
+  const double radius_;
+  ElementVisitor &visitor_;
+};
+}
 
 class GeoStore::GeoStoreImpl final {
  public:
 
   explicit GeoStoreImpl(const StringTable &stringTable) :
-      stringTable_(stringTable) {
+      stringTable_(stringTable), threadPool_(nullptr), isTwoPassImport_(false), nodeStoreType_(NodeLocationStore::Type::Sparse) {
+  }
+
+  void setImportMode(bool isTwoPass, NodeLocationStore::Type nodeStoreType) {
+    isTwoPassImport_ = isTwoPass;
+    nodeStoreType_ = nodeStoreType;
+  }
+
+  void setThreadPool(ThreadPool *threadPool) {
+    threadPool_ = threadPool;
   }
 
   void registerStore(const std::string &storeKey, std::unique_ptr<ElementStore> store) {
@@ -42,6 +101,7 @@ class GeoStore::GeoStoreImpl final {
     add(path, styleProvider, [&](Element &element) {
       return elementStore->store(element, quadKey, styleProvider);
     });
+    elementStore->commit();
   }
 
   void add(const std::string &storeKey,
@@ -52,6 +112,7 @@ class GeoStore::GeoStoreImpl final {
     add(path, styleProvider, [&](Element &element) {
       return elementStore->store(element, range, styleProvider);
     });
+    elementStore->commit();
   }
 
   void add(const std::string &storeKey,
@@ -63,11 +124,12 @@ class GeoStore::GeoStoreImpl final {
     add(path, styleProvider, [&](Element &element) {
       return elementStore->store(element, bbox, range, styleProvider);
     });
+    elementStore->commit();
   }
 
   void add(const std::string &path,
            const StyleProvider &styleProvider,
-           const std::function<bool(Element &)> &functor) const {
+           const std::function<bool(Element &)> &functor) {
     switch (getFormatTypeFromPath(path)) {
       case FormatType::Shape: {
         ShapeParser<ShapeDataVisitor> parser;
@@ -77,20 +139,39 @@ class GeoStore::GeoStoreImpl final {
         break;
       }
       case FormatType::Xml: {
+        NodeReferenceCollector references;
+        if (isTwoPassImport_) {
+          std::ifstream xmlFile(path);
+          OsmXmlParser<NodeReferenceCollector>().parse(xmlFile, references);
+          references.complete();
+        }
         OsmXmlParser<OsmDataVisitor> parser;
         std::ifstream xmlFile(path);
-        OsmDataVisitor visitor(stringTable_, functor);
+        OsmDataVisitor visitor(stringTable_, functor, nodeStoreType_, isTwoPassImport_ ? &references : nullptr);
         parser.parse(xmlFile, visitor);
         visitor.complete();
         break;
       }
 #ifdef PBF_SUPPORTED_ENABLED
       case FormatType::Pbf: {
-        OsmPbfParser<OsmDataVisitor> parser;
+        // Blobs are decoded by pool workers, elements are resolved on this thread and then
+        // clipped and stored in parallel: they are owned by visitor, so it should outlive storing.
+        NodeReferenceCollector references;
+        if (isTwoPassImport_) {
+          std::ifstream pbfFile(path, std::ios::in | std::ios::binary);
+          OsmPbfParser<NodeReferenceCollector>(threadPool_).parse(pbfFile, references);
+          references.complete();
+        }
+        std::vector<Element *> elements;
+        OsmPbfParser<OsmDataVisitor> parser(threadPool_);
         std::ifstream pbfFile(path, std::ios::in | std::ios::binary);
-        OsmDataVisitor visitor(stringTable_, functor);
+        OsmDataVisitor visitor(stringTable_, [&](Element &element) {
+          elements.push_back(&element);
+          return true;
+        }, nodeStoreType_, isTwoPassImport_ ? &references : nullptr);
         parser.parse(pbfFile, visitor);
         visitor.complete();
+        storeParallel(elements, functor);
         break;
       }
 #endif
@@ -117,12 +198,51 @@ class GeoStore::GeoStoreImpl final {
     }
   }
 
+  void search(const BoundingBox &bbox,
+              int levelOfDetail,
+              const StyleProvider &styleProvider,
+              ElementVisitor &visitor,
+              const CancellationToken &cancelToken) {
+    for (const auto &pair : storeMap_) {
+      // Spatial index allows to skip stores without intersecting elements.
+      if (pair.second->hasData(bbox, levelOfDetail))
+        pair.second->search(bbox, levelOfDetail, visitor, cancelToken);
+    }
+  }
+
   void search(const GeoCoordinate &coordinate,
               double radius,
+              int levelOfDetail,
               const StyleProvider &styleProvider,
               ElementVisitor &visitor,
-              const CancellationToken &cancelToken) const {
-    throw std::domain_error("Not implemented.");
+              const CancellationToken &cancelToken) {
+    double latOffset = GeoUtils::getOffset(coordinate, radius);
+    double lonOffset = latOffset/std::max(std::cos(deg2Rad(coordinate.latitude)), 1E-6);
+    double minLatitude = std::max(-90., coordinate.latitude - latOffset);
+    double maxLatitude = std::min(90., coordinate.latitude + latOffset);
+    double minLongitude = coordinate.longitude - lonOffset;
+    double maxLongitude = coordinate.longitude + lonOffset;
+
+    RadiusFilter filter(coordinate, radius, visitor);
+    auto searchRange = [&](double fromLongitude, double toLongitude) {
+      search(BoundingBox(GeoCoordinate(minLatitude, fromLongitude), GeoCoordinate(maxLatitude, toLongitude)),
+             levelOfDetail, styleProvider, filter, cancelToken);
+    };
+
+    if (lonOffset >= 180) {
+      searchRange(-180, 180);
+      return;
+    }
+
+    // NOTE bounding box which crosses antimeridian is split into two ones.
+    if (minLongitude < -180) {
+      searchRange(minLongitude + 360, 180);
+      minLongitude = -180;
+    } else if (maxLongitude > 180) {
+      searchRange(-180, maxLongitude - 360);
+      maxLongitude = 180;
+    }
+    searchRange(minLongitude, maxLongitude);
   }
 
   bool hasData(const QuadKey &quadKey) {
@@ -134,8 +254,34 @@ class GeoStore::GeoStoreImpl final {
   }
 
  private:
+  /// Passes elements to functor using thread pool. Waits for all of them even if some batch fails.
+  void storeParallel(const std::vector<Element *> &elements, const std::function<bool(Element &)> &functor) {
+    if (threadPool_==nullptr) {
+      for (auto *element : elements)
+        functor(*element);
+      return;
+    }
+
+    std::vector<std::future<void>> results;
+    for (std::size_t start = 0; start < elements.size(); start += StoreBatchSize) {
+      std::size_t end = std::min(start + StoreBatchSize, elements.size());
+      results.push_back(threadPool_->enqueue([&, start, end]() {
+        for (std::size_t i = start; i < end; ++i)
+          functor(*elements[i]);
+      }));
+    }
+
+    for (auto &result : results)
+      result.wait();
+    for (auto &result : results)
+      result.get();
+  }
+
   const StringTable &stringTable_;
   std::map<std::string, std::unique_ptr<ElementStore>> storeMap_;
+  ThreadPool *threadPool_;
+  bool isTwoPassImport_;
+  NodeLocationStore::Type nodeStoreType_;
 
   static FormatType getFormatTypeFromPath(const std::string &path) {
     if (utymap::utils::endsWith(path, "pbf"))
@@ -159,6 +305,14 @@ void utymap::index::GeoStore::registerStore(const std::string &storeKey, std::un
   pimpl_->registerStore(storeKey, std::move(store));
 }
 
+void utymap::index::GeoStore::setImportMode(bool isTwoPass, NodeLocationStore::Type nodeStoreType) {
+  pimpl_->setImportMode(isTwoPass, nodeStoreType);
+}
+
+void utymap::index::GeoStore::setThreadPool(ThreadPool *threadPool) {
+  pimpl_->setThreadPool(threadPool);
+}
+
 void utymap::index::GeoStore::add(const std::string &storeKey,
                                   const Element &element,
                                   const LodRange &range,
@@ -195,12 +349,21 @@ void utymap::index::GeoStore::search(const QuadKey &quadKey,
   pimpl_->search(quadKey, styleProvider, visitor, cancelToken);
 }
 
+void utymap::index::GeoStore::search(const BoundingBox &bbox,
+                                     int levelOfDetail,
+                                     const StyleProvider &styleProvider,
+                                     ElementVisitor &visitor,
+                                     const utymap::CancellationToken &cancelToken) {
+  pimpl_->search(bbox, levelOfDetail, styleProvider, visitor, cancelToken);
+}
+
 void utymap::index::GeoStore::search(const GeoCoordinate &coordinate,
                                      double radius,
+                                     int levelOfDetail,
                                      const StyleProvider &styleProvider,
                                      ElementVisitor &visitor,
                                      const utymap::CancellationToken &cancelToken) {
-  pimpl_->search(coordinate, radius, styleProvider, visitor, cancelToken);
+  pimpl_->search(coordinate, radius, levelOfDetail, styleProvider, visitor, cancelToken);
 }
 
 bool utymap::index::GeoStore::hasData(const QuadKey &quadKey) const {
@@ -8,9 +8,11 @@
 #include "QuadKey.hpp"
 #include "entities/Element.hpp"
 #include "entities/ElementVisitor.hpp"
+#include "formats/osm/NodeLocationStore.hpp"
 #include "index/ElementStore.hpp"
 #include "index/StringTable.hpp"
 #include "mapcss/StyleProvider.hpp"
+#include "utils/ThreadPool.hpp"
 
 #include <memory>
 
@@ -28,6 +30,16 @@ class GeoStore final {
   void registerStore(const std::string &storeKey,
                      std::unique_ptr<ElementStore> store);
 
+  /// Specifies how osm xml and pbf files are imported. In two pass mode, the first pass collects
+  /// nodes referenced by ways and relations, so the second one keeps in memory only their locations
+  /// and tagged nodes. Dense node store suits only files with dense ids, e.g. planet file.
+  void setImportMode(bool isTwoPass,
+                     utymap::formats::NodeLocationStore::Type nodeStoreType =
+                         utymap::formats::NodeLocationStore::Type::Sparse);
+
+  /// Sets thread pool used to decode pbf files and store their elements. Null imports on calling thread.
+  void setThreadPool(utymap::utils::ThreadPool *threadPool);
+
   /// Adds element to selected store.
   void add(const std::string &storeKey,
            const utymap::entities::Element &element,
@@ -59,9 +71,17 @@ class GeoStore final {
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken);
 
-  /// Searches for elements inside circle with given parameters.
+  /// Searches for elements which intersect bounding box at given level of detail.
+  void search(const BoundingBox &bbox,
+              int levelOfDetail,
+              const utymap::mapcss::StyleProvider &styleProvider,
+              utymap::entities::ElementVisitor &visitor,
+              const utymap::CancellationToken &cancelToken);
+
+  /// Searches for elements inside circle with given center and radius in meters at given level of detail.
   void search(const GeoCoordinate &coordinate,
               double radius,
+              int levelOfDetail,
               const utymap::mapcss::StyleProvider &styleProvider,
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken);
@@ -4,6 +4,9 @@
 #include "entities/Relation.hpp"
 #include "index/InMemoryElementStore.hpp"
 
+#include <array>
+#include <mutex>
+
 using namespace utymap;
 using namespace utymap::index;
 using namespace utymap::entities;
@@ -13,6 +16,9 @@ namespace {
 typedef std::vector<std::shared_ptr<Element>> Elements;
 typedef std::map<QuadKey, Elements, QuadKey::Comparator> ElementMap;
 
+/// Amount of independently locked buckets: allows to store elements from many threads.
+const std::size_t ShardCount = 16;
+
 class ElementMapVisitor : public ElementVisitor {
  public:
   ElementMapVisitor(const QuadKey &quadKey, ElementMap &elementsMap) :
@@ -41,20 +47,41 @@ class ElementMapVisitor : public ElementVisitor {
 }
 
 class InMemoryElementStore::InMemoryElementStoreImpl {
+  /// Keeps elements of quadkeys which belong to the same bucket.
+  struct Shard {
+    std::mutex lock;
+    ElementMap elementsMap;
+  };
+
  public:
-  ElementMap elementsMap;
+  void store(const Element &element, const QuadKey &quadKey) {
+    auto &shard = getShard(quadKey);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    ElementMapVisitor visitor(quadKey, shard.elementsMap);
+    element.accept(visitor);
+  }
 
-  ElementMap::const_iterator begin(const utymap::QuadKey &quadKey) const {
-    return elementsMap.find(quadKey);
+  /// Returns copy of element list, so it can be visited without lock.
+  Elements get(const QuadKey &quadKey) {
+    auto &shard = getShard(quadKey);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.elementsMap.find(quadKey);
+    return it!=shard.elementsMap.end() ? it->second : Elements();
   }
 
-  ElementMap::const_iterator end() const {
-    return elementsMap.cend();
+  bool hasData(const utymap::QuadKey &quadKey) {
+    auto &shard = getShard(quadKey);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    return shard.elementsMap.find(quadKey)!=shard.elementsMap.end();
   }
 
-  bool hasData(const utymap::QuadKey &quadKey) const {
-    return elementsMap.find(quadKey)!=elementsMap.end();
+ private:
+  Shard &getShard(const QuadKey &quadKey) {
+    std::size_t hash = (static_cast<std::size_t>(quadKey.tileX)*31 + quadKey.tileY)*31 + quadKey.levelOfDetail;
+    return shards_[hash%ShardCount];
   }
+
+  std::array<Shard, ShardCount> shards_;
 };
 
 InMemoryElementStore::InMemoryElementStore(const StringTable &stringTable) :
@@ -65,8 +92,7 @@ InMemoryElementStore::~InMemoryElementStore() {
 }
 
 void InMemoryElementStore::storeImpl(const utymap::entities::Element &element, const QuadKey &quadKey) {
-  ElementMapVisitor visitor(quadKey, pimpl_->elementsMap);
-  element.accept(visitor);
+  pimpl_->store(element, quadKey);
 }
 
 bool InMemoryElementStore::hasData(const utymap::QuadKey &quadKey) const {
@@ -76,13 +102,7 @@ bool InMemoryElementStore::hasData(const utymap::QuadKey &quadKey) const {
 void InMemoryElementStore::search(const utymap::QuadKey &quadKey,
                                   utymap::entities::ElementVisitor &visitor,
                                   const utymap::CancellationToken &cancelToken) {
-  auto it = pimpl_->begin(quadKey);
-
-  // No elements for this quadkey
-  if (it==pimpl_->end())
-    return;
-
-  for (const auto &element : it->second) {
+  for (const auto &element : pimpl_->get(quadKey)) {
     if (cancelToken.isCancelled())
       break;
 
@@ -17,6 +17,9 @@ class InMemoryElementStore final : public ElementStore {
 
   virtual ~InMemoryElementStore();
 
+  using ElementStore::search;
+  using ElementStore::hasData;
+
   void search(const utymap::QuadKey &quadKey,
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken) override;
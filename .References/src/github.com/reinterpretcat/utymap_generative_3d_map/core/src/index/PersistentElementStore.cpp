@@ -1,8 +1,17 @@
 #include "index/ElementStream.hpp"
 #include "index/PersistentElementStore.hpp"
+#include "utils/MappedFile.hpp"
+#include "utils/SharedMutex.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <mutex>
+#include <set>
+#include <vector>
 
 using namespace utymap;
 using namespace utymap::index;
@@ -13,9 +22,132 @@ using namespace utymap::utils;
 namespace {
 const std::string IndexFileExtension = ".idf";
 const std::string DataFileExtension = ".dat";
+const std::string SegmentFileName = "elements.seg";
+const std::string JournalFileName = "staging.jrn";
+const std::string SpatialIndexFileName = "elements.rtree";
+const std::string TempFileExtension = ".tmp";
+const std::string BackupFileExtension = ".bak";
+/// Maximum amount of quadkeys of one level of detail which are remembered as probed for staging files.
+const std::size_t ProbedQuadKeysLimit = 1 << 16;
+/// Amount of locks which guard staging files: quadkeys are distributed between them by hash.
+const std::size_t FileLockCount = 16;
+
+const char SegmentMagic[4] = {'U', 'S', 'E', 'G'};
+const std::uint32_t SegmentVersion = 1;
+
+/// Segment file starts with header followed by directory of entries sorted by
+/// tile coordinates and packed element blobs. Each blob is a sequence of
+/// element id followed by element serialized with ElementStream.
+struct SegmentHeader final {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t count;
+  std::uint32_t reserved;
+};
+
+/// Describes elements of one quadkey inside segment.
+struct SegmentEntry final {
+  std::uint32_t tileX;
+  std::uint32_t tileY;
+  std::uint32_t elements;
+  std::uint32_t reserved;
+  std::uint64_t offset;
+  std::uint64_t size;
+};
+
+static_assert(sizeof(SegmentHeader)==16, "Unexpected segment header size.");
+static_assert(sizeof(SegmentEntry)==32, "Unexpected segment entry size.");
+
+/// Sealed, memory mapped set of elements for one level of detail.
+class Segment final {
+ public:
+  explicit Segment(const std::string &path) : file_(path), entries_(nullptr), count_(0) {
+    if (file_.empty()) return;
+
+    if (file_.size() < sizeof(SegmentHeader))
+      throw std::invalid_argument("Corrupted segment file: " + path);
+
+    const auto *header = reinterpret_cast<const SegmentHeader *>(file_.data());
+    if (std::memcmp(header->magic, SegmentMagic, sizeof(SegmentMagic))!=0 || header->version!=SegmentVersion)
+      throw std::invalid_argument("Unsupported segment file: " + path);
+
+    if (sizeof(SegmentHeader) + header->count*sizeof(SegmentEntry) > file_.size())
+      throw std::invalid_argument("Corrupted segment file: " + path);
+
+    entries_ = reinterpret_cast<const SegmentEntry *>(file_.data() + sizeof(SegmentHeader));
+    count_ = header->count;
+  }
+
+  /// Returns entry for given quadkey or nullptr.
+  const SegmentEntry *find(const QuadKey &quadKey) const {
+    auto tileX = static_cast<std::uint32_t>(quadKey.tileX);
+    auto tileY = static_cast<std::uint32_t>(quadKey.tileY);
+    auto end = entries_ + count_;
+    auto it = std::lower_bound(entries_, end, quadKey, [&](const SegmentEntry &entry, const QuadKey &) {
+      return entry.tileX==tileX ? entry.tileY < tileY : entry.tileX < tileX;
+    });
+    return it!=end && it->tileX==tileX && it->tileY==tileY ? it : nullptr;
+  }
+
+  /// Visits elements of given entry directly from mapped memory.
+  void visit(const SegmentEntry &entry, ElementVisitor &visitor, const CancellationToken &cancelToken) const {
+    MemoryStreamBuf buffer(file_.data() + entry.offset, static_cast<std::size_t>(entry.size));
+    std::istream stream(&buffer);
+    for (std::uint32_t i = 0; i < entry.elements; ++i) {
+      if (cancelToken.isCancelled()) break;
+
+      std::uint64_t id;
+      stream.read(reinterpret_cast<char *>(&id), sizeof(id));
+      ElementStream::read(stream, id)->accept(visitor);
+    }
+  }
+
+  /// Returns raw bytes of entry's blob.
+  const char *data(const SegmentEntry &entry) const {
+    return file_.data() + entry.offset;
+  }
+
+  const SegmentEntry *begin() const { return entries_; }
+
+  const SegmentEntry *end() const { return entries_ + count_; }
+
+ private:
+  MappedFile file_;
+  const SegmentEntry *entries_;
+  std::uint32_t count_;
+};
+
+typedef std::set<QuadKey, QuadKey::Comparator> QuadKeySet;
+
+/// Replaces file with given temporary one, so failure at any point leaves either old or new file.
+/// Returns false if file cannot be replaced: old one is kept then.
+bool replaceFile(const std::string &tempPath, const std::string &path) {
+#ifdef _WIN32
+  // NOTE rename cannot overwrite existing file on Windows, so old one is kept as backup
+  // until new one is in place.
+  auto backupPath = path + BackupFileExtension;
+  std::remove(backupPath.c_str());
+  bool hasBackup = std::rename(path.c_str(), backupPath.c_str())==0;
+  if (std::rename(tempPath.c_str(), path.c_str())!=0) {
+    if (hasBackup) std::rename(backupPath.c_str(), path.c_str());
+    return false;
+  }
+  std::remove(backupPath.c_str());
+  return true;
+#else
+  return std::rename(tempPath.c_str(), path.c_str())==0;
+#endif
+}
+
+/// Restores file from backup left by interrupted replaceFile, if any.
+void restoreFile(const std::string &path) {
+  auto backupPath = path + BackupFileExtension;
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file.good())
+    std::rename(backupPath.c_str(), path.c_str());
+}
 }
 
-// TODO improve thread safety!
 class PersistentElementStore::PersistentElementStoreImpl final {
   struct QuadKeyData {
     std::unique_ptr<std::fstream> dataFile;
@@ -43,12 +175,29 @@ class PersistentElementStore::PersistentElementStoreImpl final {
     }
   };
 
+  /// Keeps sealed segment and list of staged quadkeys for one level of detail.
+  struct LodData {
+    std::shared_ptr<const Segment> segment;
+    QuadKeySet staged;
+    /// Quadkeys checked for staging files written without journal. Bounded by ProbedQuadKeysLimit.
+    QuadKeySet probed;
+  };
+
  public:
   explicit PersistentElementStoreImpl(const std::string &dataPath) :
       dataPath_(dataPath) {
   }
 
   void store(const Element &element, const QuadKey &quadKey) {
+    {
+      std::lock_guard<SharedMutex> lock(lock_);
+      auto &lodData = getLodData(quadKey.levelOfDetail);
+      if (lodData.staged.insert(quadKey).second)
+        appendJournal(quadKey);
+    }
+
+    // NOTE staging files of different quadkeys can be written concurrently.
+    std::lock_guard<std::mutex> fileLock(getFileLock(quadKey));
     auto quadKeyData = createQuadKeyData(quadKey);
     auto offset = static_cast<std::uint32_t>(quadKeyData.dataFile->tellg());
 
@@ -63,30 +212,291 @@ class PersistentElementStore::PersistentElementStoreImpl final {
   }
 
   void search(const QuadKey &quadKey, ElementVisitor &visitor, const utymap::CancellationToken &cancelToken) {
-    auto quadKeyData = createQuadKeyData(quadKey);
-    auto count = static_cast<std::uint32_t>(quadKeyData.indexFile->tellg()/
+    prepareData(quadKey);
+
+    // NOTE shared lock is held across reading of both segment and staging files, so
+    // commit cannot replace segment or remove staged files in the middle of search.
+    SharedLock lock(lock_);
+    const auto &lodData = lods_.at(quadKey.levelOfDetail);
+    const auto *entry = lodData.segment->find(quadKey);
+    if (entry!=nullptr)
+      lodData.segment->visit(*entry, visitor, cancelToken);
+
+    if (lodData.staged.find(quadKey)!=lodData.staged.end()) {
+      std::lock_guard<std::mutex> fileLock(getFileLock(quadKey));
+      searchStaged(quadKey, visitor, cancelToken);
+    }
+  }
+
+  bool hasData(const QuadKey &quadKey) {
+    prepareData(quadKey);
+
+    SharedLock lock(lock_);
+    const auto &lodData = lods_.at(quadKey.levelOfDetail);
+    return lodData.segment->find(quadKey)!=nullptr ||
+        lodData.staged.find(quadKey)!=lodData.staged.end();
+  }
+
+  /// NOTE should not be called concurrently with store.
+  void commit() {
+    std::lock_guard<SharedMutex> lock(lock_);
+    for (int lod = GeoUtils::MinLevelOfDetails; lod <= GeoUtils::MaxLevelOfDetails; ++lod)
+      compact(lod);
+  }
+
+  std::shared_ptr<const SpatialIndex> loadIndex(int levelOfDetail) const {
+    restoreFile(getSpatialIndexPath(levelOfDetail));
+    std::ifstream file(getSpatialIndexPath(levelOfDetail), std::ios::in | std::ios::binary);
+    if (!file.good())
+      return nullptr;
+    return std::make_shared<const SpatialIndex>(SpatialIndex::read(file));
+  }
+
+  /// Writes index to temporary file which is swapped in by replaceIndex.
+  void saveIndex(int levelOfDetail, const SpatialIndex &index) const {
+    auto tempPath = getSpatialIndexPath(levelOfDetail) + TempFileExtension;
+    std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.good())
+      throw std::domain_error("Cannot create spatial index file: " + tempPath);
+    index.write(file);
+    file.close();
+    if (!file)
+      throw std::domain_error("Cannot write spatial index file: " + tempPath);
+  }
+
+  void replaceIndex(int levelOfDetail) const {
+    auto path = getSpatialIndexPath(levelOfDetail);
+    if (!replaceFile(path + TempFileExtension, path))
+      throw std::domain_error("Cannot replace spatial index file: " + path);
+  }
+
+ private:
+  /// Returns lock which guards staging files of given quadkey.
+  std::mutex &getFileLock(const QuadKey &quadKey) {
+    std::size_t hash = (static_cast<std::size_t>(quadKey.tileX)*31 + quadKey.tileY)*31 + quadKey.levelOfDetail;
+    return fileLocks_[hash%FileLockCount];
+  }
+
+  /// Ensures that data of given quadkey's level of detail is loaded, so it can be read under shared lock.
+  /// Staging files written by previous versions without journal are adopted as staged on first access,
+  /// so they stay visible and are merged into segment on next commit.
+  void prepareData(const QuadKey &quadKey) {
+    {
+      SharedLock lock(lock_);
+      auto it = lods_.find(quadKey.levelOfDetail);
+      if (it!=lods_.end() && isKnown(it->second, quadKey))
+        return;
+    }
+
+    std::lock_guard<SharedMutex> lock(lock_);
+    auto &lodData = getLodData(quadKey.levelOfDetail);
+    if (isKnown(lodData, quadKey))
+      return;
+
+    // NOTE forgetting probed quadkeys only costs one more probe of each.
+    if (lodData.probed.size() >= ProbedQuadKeysLimit)
+      lodData.probed.clear();
+    lodData.probed.insert(quadKey);
+    std::ifstream dataFile(getFilePath(quadKey, DataFileExtension), std::ios::in | std::ios::binary);
+    if (dataFile.good() && lodData.staged.insert(quadKey).second)
+      appendJournal(quadKey);
+  }
+
+  /// Checks whether store already knows where data of given quadkey are.
+  static bool isKnown(const LodData &lodData, const QuadKey &quadKey) {
+    return lodData.probed.find(quadKey)!=lodData.probed.end() ||
+        lodData.staged.find(quadKey)!=lodData.staged.end() ||
+        lodData.segment->find(quadKey)!=nullptr;
+  }
+
+  /// Returns data for given level of detail loading it from disk if necessary.
+  /// NOTE should be called under exclusive lock.
+  LodData &getLodData(int levelOfDetail) {
+    auto it = lods_.find(levelOfDetail);
+    if (it!=lods_.end())
+      return it->second;
+
+    LodData lodData;
+    restoreFile(getSegmentPath(levelOfDetail));
+    lodData.segment = std::make_shared<const Segment>(getSegmentPath(levelOfDetail));
+    lodData.staged = readJournal(levelOfDetail);
+    return lods_.emplace(levelOfDetail, std::move(lodData)).first->second;
+  }
+
+  /// Reads elements from staging files.
+  void searchStaged(const QuadKey &quadKey, ElementVisitor &visitor, const utymap::CancellationToken &cancelToken) const {
+    // NOTE files are opened for reading only: search must not create empty staging files.
+    std::ifstream indexFile(getFilePath(quadKey, IndexFileExtension), std::ios::in | std::ios::binary | std::ios::ate);
+    std::ifstream dataFile(getFilePath(quadKey, DataFileExtension), std::ios::in | std::ios::binary);
+    if (!indexFile.good() || !dataFile.good())
+      return;
+
+    auto count = static_cast<std::uint32_t>(indexFile.tellg()/
         (sizeof(std::uint64_t) + sizeof(std::uint32_t)));
 
-    quadKeyData.indexFile->seekg(0, std::ios::beg);
+    indexFile.seekg(0, std::ios::beg);
     for (std::uint32_t i = 0; i < count; ++i) {
       if (cancelToken.isCancelled()) break;
 
       std::uint64_t id;
       std::uint32_t offset;
-      quadKeyData.indexFile->read(reinterpret_cast<char *>(&id), sizeof(id));
-      quadKeyData.indexFile->read(reinterpret_cast<char *>(&offset), sizeof(offset));
-      quadKeyData.dataFile->seekg(offset, std::ios::beg);
+      indexFile.read(reinterpret_cast<char *>(&id), sizeof(id));
+      indexFile.read(reinterpret_cast<char *>(&offset), sizeof(offset));
+      dataFile.seekg(offset, std::ios::beg);
+
+      ElementStream::read(dataFile, id)->accept(visitor);
+    }
+  }
+
+  /// Merges staged quadkeys of given level of detail into new segment.
+  void compact(int levelOfDetail) {
+    auto &lodData = getLodData(levelOfDetail);
+    lodData.probed.clear();
+    if (lodData.staged.empty())
+      return;
+
+    QuadKeySet quadKeys;
+    for (const auto &quadKey : lodData.staged) {
+      std::ifstream indexFile(getFilePath(quadKey, IndexFileExtension), std::ios::in | std::ios::binary | std::ios::ate);
+      if (indexFile.good() && indexFile.tellg() > 0)
+        quadKeys.insert(quadKey);
+    }
 
-      ElementStream::read(*quadKeyData.dataFile, id)->accept(visitor);
+    if (!quadKeys.empty()) {
+      auto path = getSegmentPath(levelOfDetail);
+      auto tempPath = path + TempFileExtension;
+      writeSegment(levelOfDetail, tempPath, *lodData.segment, quadKeys);
+
+      // NOTE segment should be unmapped before replacing: mapped file cannot be renamed on Windows.
+      lodData.segment.reset();
+      bool isReplaced = replaceFile(tempPath, path);
+      lodData.segment = std::make_shared<const Segment>(path);
+      if (!isReplaced)
+        throw std::domain_error("Cannot replace segment file: " + path);
+    }
+
+    for (const auto &quadKey : lodData.staged) {
+      std::remove(getFilePath(quadKey, DataFileExtension).c_str());
+      std::remove(getFilePath(quadKey, IndexFileExtension).c_str());
     }
+    std::remove(getJournalPath(levelOfDetail).c_str());
+    lodData.staged.clear();
   }
 
-  bool hasData(const QuadKey &quadKey) const {
-    std::ifstream file(getFilePath(quadKey, DataFileExtension));
-    return file.good();
+  /// Writes segment which contains elements from old one and given staged quadkeys.
+  /// Staged elements are streamed from staging files, so only one element is kept in memory.
+  void writeSegment(int levelOfDetail,
+                    const std::string &path,
+                    const Segment &oldSegment,
+                    const QuadKeySet &quadKeys) const {
+    // Merge directories: both are sorted by tile coordinates.
+    std::vector<SegmentEntry> entries;
+    for (const auto *it = oldSegment.begin(); it!=oldSegment.end(); ++it)
+      entries.push_back(*it);
+    for (const auto &quadKey : quadKeys) {
+      if (oldSegment.find(quadKey)==nullptr)
+        entries.push_back(SegmentEntry{static_cast<std::uint32_t>(quadKey.tileX),
+                                       static_cast<std::uint32_t>(quadKey.tileY), 0, 0, 0, 0});
+    }
+    std::sort(entries.begin(), entries.end(), [](const SegmentEntry &lhs, const SegmentEntry &rhs) {
+      return lhs.tileX==rhs.tileX ? lhs.tileY < rhs.tileY : lhs.tileX < rhs.tileX;
+    });
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.good())
+      throw std::domain_error("Cannot create segment file: " + path);
+
+    SegmentHeader header{{SegmentMagic[0], SegmentMagic[1], SegmentMagic[2], SegmentMagic[3]},
+                         SegmentVersion, static_cast<std::uint32_t>(entries.size()), 0};
+    std::uint64_t offset = sizeof(SegmentHeader) + entries.size()*sizeof(SegmentEntry);
+    file.seekp(static_cast<std::streamoff>(offset), std::ios::beg);
+
+    std::vector<char> buffer;
+    for (auto &entry : entries) {
+      QuadKey quadKey(levelOfDetail, static_cast<int>(entry.tileX), static_cast<int>(entry.tileY));
+      std::uint32_t elements = 0;
+      std::uint64_t size = 0;
+
+      // Old elements go first to preserve insertion order.
+      const auto *oldEntry = oldSegment.find(quadKey);
+      if (oldEntry!=nullptr) {
+        file.write(oldSegment.data(*oldEntry), static_cast<std::streamsize>(oldEntry->size));
+        elements += oldEntry->elements;
+        size += oldEntry->size;
+      }
+
+      if (quadKeys.find(quadKey)!=quadKeys.end())
+        elements += writeStaged(quadKey, file, buffer, size);
+
+      entry.elements = elements;
+      entry.offset = offset;
+      entry.size = size;
+      offset += size;
+    }
+
+    file.seekp(0, std::ios::beg);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()),
+               static_cast<std::streamsize>(entries.size()*sizeof(SegmentEntry)));
+    file.close();
+    if (!file)
+      throw std::domain_error("Cannot write segment file: " + path);
+  }
+
+  /// Copies staged elements of given quadkey to segment file in blob format.
+  /// Returns amount of copied elements and increases size by amount of written bytes.
+  std::uint32_t writeStaged(const QuadKey &quadKey, std::ostream &file,
+                            std::vector<char> &buffer, std::uint64_t &size) const {
+    std::ifstream indexFile(getFilePath(quadKey, IndexFileExtension), std::ios::in | std::ios::binary);
+    std::ifstream dataFile(getFilePath(quadKey, DataFileExtension), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!indexFile.good() || !dataFile.good())
+      return 0;
+
+    auto dataSize = static_cast<std::uint64_t>(dataFile.tellg());
+    dataFile.seekg(0, std::ios::beg);
+
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> index;
+    std::uint64_t id;
+    std::uint32_t offset;
+    while (indexFile.read(reinterpret_cast<char *>(&id), sizeof(id)) &&
+        indexFile.read(reinterpret_cast<char *>(&offset), sizeof(offset))) {
+      index.push_back(std::make_pair(id, offset));
+    }
+
+    for (std::size_t i = 0; i < index.size(); ++i) {
+      std::uint64_t start = index[i].second;
+      std::uint64_t end = i + 1 < index.size() ? index[i + 1].second : dataSize;
+      if (start > end || end > dataSize)
+        throw std::domain_error("Corrupted staging data: " + GeoUtils::quadKeyToString(quadKey));
+
+      buffer.resize(static_cast<std::size_t>(end - start));
+      dataFile.seekg(static_cast<std::streamoff>(start), std::ios::beg);
+      dataFile.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+
+      file.write(reinterpret_cast<const char *>(&index[i].first), sizeof(index[i].first));
+      file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+      size += sizeof(index[i].first) + buffer.size();
+    }
+    return static_cast<std::uint32_t>(index.size());
+  }
+
+  /// Reads list of staged quadkeys.
+  QuadKeySet readJournal(int levelOfDetail) const {
+    QuadKeySet staged;
+    std::ifstream file(getJournalPath(levelOfDetail), std::ios::in | std::ios::binary);
+    std::int32_t tile[2];
+    while (file.read(reinterpret_cast<char *>(tile), sizeof(tile)))
+      staged.insert(QuadKey(levelOfDetail, tile[0], tile[1]));
+    return staged;
+  }
+
+  /// Records quadkey as staged.
+  void appendJournal(const QuadKey &quadKey) const {
+    std::ofstream file(getJournalPath(quadKey.levelOfDetail), std::ios::out | std::ios::binary | std::ios::app);
+    std::int32_t tile[2] = {quadKey.tileX, quadKey.tileY};
+    file.write(reinterpret_cast<const char *>(tile), sizeof(tile));
   }
 
- private:
   /// Creates quadkey data.
   QuadKeyData createQuadKeyData(const QuadKey &quadKey) const {
     return QuadKeyData(getFilePath(quadKey, DataFileExtension), getFilePath(quadKey, IndexFileExtension));
@@ -99,7 +509,29 @@ class PersistentElementStore::PersistentElementStoreImpl final {
     return ss.str();
   }
 
+  /// Gets full path of file with given name for given level of detail.
+  std::string getLodFilePath(int levelOfDetail, const std::string &name) const {
+    std::stringstream ss;
+    ss << dataPath_ << "data/" << levelOfDetail << "/" << name;
+    return ss.str();
+  }
+
+  std::string getSegmentPath(int levelOfDetail) const {
+    return getLodFilePath(levelOfDetail, SegmentFileName);
+  }
+
+  std::string getJournalPath(int levelOfDetail) const {
+    return getLodFilePath(levelOfDetail, JournalFileName);
+  }
+
+  std::string getSpatialIndexPath(int levelOfDetail) const {
+    return getLodFilePath(levelOfDetail, SpatialIndexFileName);
+  }
+
   const std::string dataPath_;
+  SharedMutex lock_;
+  std::array<std::mutex, FileLockCount> fileLocks_;
+  std::map<int, LodData> lods_;
 };
 
 PersistentElementStore::PersistentElementStore(const std::string &dataPath, const StringTable &stringTable) :
@@ -122,3 +554,20 @@ void PersistentElementStore::search(const QuadKey &quadKey,
 bool PersistentElementStore::hasData(const QuadKey &quadKey) const {
   return pimpl_->hasData(quadKey);
 }
+
+void PersistentElementStore::commit() {
+  pimpl_->commit();
+  ElementStore::commit();
+}
+
+std::shared_ptr<const SpatialIndex> PersistentElementStore::loadIndex(int levelOfDetail) {
+  return pimpl_->loadIndex(levelOfDetail);
+}
+
+void PersistentElementStore::saveIndex(int levelOfDetail, const SpatialIndex &index) {
+  pimpl_->saveIndex(levelOfDetail, index);
+}
+
+void PersistentElementStore::replaceIndex(int levelOfDetail) {
+  pimpl_->replaceIndex(levelOfDetail);
+}
@@ -11,6 +11,10 @@ namespace utymap {
 namespace index {
 
 /// Provides API to store elements in persistent store.
+/// Elements are appended to per quadkey staging files first. On commit, staging
+/// files are compacted into sealed per level of detail segment which is memory
+/// mapped and read without copying. Spatial index of each level of detail is
+/// persisted next to its segment.
 class PersistentElementStore final : public ElementStore {
  public:
   explicit PersistentElementStore(const std::string &path,
@@ -18,15 +22,27 @@ class PersistentElementStore final : public ElementStore {
 
   virtual ~PersistentElementStore();
 
+  using ElementStore::search;
+  using ElementStore::hasData;
+
   void search(const utymap::QuadKey &quadKey,
               utymap::entities::ElementVisitor &visitor,
               const utymap::CancellationToken &cancelToken) override;
 
   bool hasData(const utymap::QuadKey &quadKey) const override;
 
+  /// Compacts staged elements into segments and rebuilds spatial indices.
+  void commit() override;
+
  protected:
   void storeImpl(const utymap::entities::Element &element, const utymap::QuadKey &quadKey) override;
 
+  std::shared_ptr<const SpatialIndex> loadIndex(int levelOfDetail) override;
+
+  void saveIndex(int levelOfDetail, const SpatialIndex &index) override;
+
+  void replaceIndex(int levelOfDetail) override;
+
  private:
   class PersistentElementStoreImpl;
   std::unique_ptr<PersistentElementStoreImpl> pimpl_;
@@ -0,0 +1,195 @@
+#include "index/SpatialIndex.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+using namespace utymap;
+using namespace utymap::index;
+
+namespace {
+/// Max amount of children of one tree node.
+const std::size_t NodeSize = 16;
+/// Side of grid used to calculate hilbert values.
+const std::uint32_t HilbertSize = 1 << 16;
+
+const char IndexMagic[4] = {'U', 'R', 'T', 'R'};
+const std::uint32_t IndexVersion = 1;
+
+struct IndexHeader final {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t count;
+  std::uint32_t reserved;
+};
+
+/// Binary representation of entry.
+struct IndexRecord final {
+  double minLatitude;
+  double minLongitude;
+  double maxLatitude;
+  double maxLongitude;
+  std::int32_t levelOfDetail;
+  std::int32_t tileX;
+  std::int32_t tileY;
+  std::int32_t reserved;
+};
+
+static_assert(sizeof(IndexHeader)==16, "Unexpected index header size.");
+static_assert(sizeof(IndexRecord)==48, "Unexpected index record size.");
+
+/// Calculates distance of point along hilbert curve which fills HilbertSize x HilbertSize grid.
+std::uint64_t hilbertValue(std::uint32_t x, std::uint32_t y) {
+  std::uint64_t d = 0;
+  for (std::uint32_t s = HilbertSize/2; s > 0; s /= 2) {
+    std::uint32_t rx = (x & s) > 0 ? 1 : 0;
+    std::uint32_t ry = (y & s) > 0 ? 1 : 0;
+    d += static_cast<std::uint64_t>(s)*s*((3*rx) ^ ry);
+    if (ry==0) {
+      if (rx==1) {
+        x = HilbertSize - 1 - x;
+        y = HilbertSize - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+/// Maps value from [min, max] range to hilbert grid coordinate.
+std::uint32_t toGrid(double value, double min, double max) {
+  if (max <= min) return 0;
+  double scaled = (value - min)/(max - min)*(HilbertSize - 1);
+  return static_cast<std::uint32_t>(std::max(0., std::min(scaled, double(HilbertSize - 1))));
+}
+}
+
+SpatialIndex::SpatialIndex(std::vector<Entry> entries) : entries_(std::move(entries)) {
+  BoundingBox extent;
+  for (const auto &entry : entries_)
+    extent.expand(entry.bbox);
+
+  std::vector<std::pair<std::uint64_t, std::size_t>> order;
+  order.reserve(entries_.size());
+  for (std::size_t i = 0; i < entries_.size(); ++i) {
+    GeoCoordinate center = entries_[i].bbox.center();
+    order.push_back(std::make_pair(hilbertValue(
+        toGrid(center.longitude, extent.minPoint.longitude, extent.maxPoint.longitude),
+        toGrid(center.latitude, extent.minPoint.latitude, extent.maxPoint.latitude)), i));
+  }
+  // NOTE stable order keeps insertion order for entries with the same hilbert value.
+  std::sort(order.begin(), order.end());
+
+  std::vector<Entry> sorted;
+  sorted.reserve(entries_.size());
+  for (const auto &pair : order)
+    sorted.push_back(entries_[pair.second]);
+  entries_.swap(sorted);
+
+  pack();
+}
+
+void SpatialIndex::search(const BoundingBox &bbox, const std::function<void(const Entry &)> &visitor) const {
+  traverse(bbox, [&](const Entry &entry) {
+    visitor(entry);
+    return true;
+  });
+}
+
+bool SpatialIndex::intersects(const BoundingBox &bbox) const {
+  return !traverse(bbox, [](const Entry &) { return false; });
+}
+
+void SpatialIndex::write(std::ostream &stream) const {
+  IndexHeader header{{IndexMagic[0], IndexMagic[1], IndexMagic[2], IndexMagic[3]},
+                     IndexVersion, static_cast<std::uint32_t>(entries_.size()), 0};
+  stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  for (const auto &entry : entries_) {
+    IndexRecord record{entry.bbox.minPoint.latitude, entry.bbox.minPoint.longitude,
+                       entry.bbox.maxPoint.latitude, entry.bbox.maxPoint.longitude,
+                       entry.quadKey.levelOfDetail, entry.quadKey.tileX, entry.quadKey.tileY, 0};
+    stream.write(reinterpret_cast<const char *>(&record), sizeof(record));
+  }
+}
+
+SpatialIndex SpatialIndex::read(std::istream &stream) {
+  IndexHeader header;
+  if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    throw std::invalid_argument("Corrupted spatial index.");
+  if (std::memcmp(header.magic, IndexMagic, sizeof(IndexMagic))!=0 || header.version!=IndexVersion)
+    throw std::invalid_argument("Unsupported spatial index.");
+
+  SpatialIndex index;
+  index.entries_.reserve(header.count);
+  for (std::uint32_t i = 0; i < header.count; ++i) {
+    IndexRecord record;
+    if (!stream.read(reinterpret_cast<char *>(&record), sizeof(record)))
+      throw std::invalid_argument("Corrupted spatial index.");
+
+    index.entries_.push_back(Entry{
+        BoundingBox(GeoCoordinate(record.minLatitude, record.minLongitude),
+                    GeoCoordinate(record.maxLatitude, record.maxLongitude)),
+        QuadKey(record.levelOfDetail, record.tileX, record.tileY)});
+  }
+  // Entries are written in hilbert order, so only tree levels have to be restored.
+  index.pack();
+  return index;
+}
+
+void SpatialIndex::pack() {
+  levels_.clear();
+  if (entries_.empty()) return;
+
+  std::vector<BoundingBox> level;
+  for (std::size_t i = 0; i < entries_.size(); i += NodeSize) {
+    BoundingBox bbox;
+    for (std::size_t j = i; j < std::min(i + NodeSize, entries_.size()); ++j)
+      bbox.expand(entries_[j].bbox);
+    level.push_back(bbox);
+  }
+  levels_.push_back(std::move(level));
+
+  while (levels_.back().size() > 1) {
+    const auto &children = levels_.back();
+    std::vector<BoundingBox> parents;
+    for (std::size_t i = 0; i < children.size(); i += NodeSize) {
+      BoundingBox bbox;
+      for (std::size_t j = i; j < std::min(i + NodeSize, children.size()); ++j)
+        bbox.expand(children[j]);
+      parents.push_back(bbox);
+    }
+    levels_.push_back(std::move(parents));
+  }
+}
+
+template<typename Visitor>
+bool SpatialIndex::traverse(const BoundingBox &bbox, const Visitor &visitor) const {
+  if (levels_.empty()) return true;
+
+  // Stack of (level, node) pairs to visit.
+  std::vector<std::pair<std::size_t, std::size_t>> stack;
+  stack.push_back(std::make_pair(levels_.size() - 1, 0));
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    if (!levels_[node.first][node.second].intersects(bbox))
+      continue;
+
+    std::size_t start = node.second*NodeSize;
+    if (node.first==0) {
+      for (std::size_t i = start; i < std::min(start + NodeSize, entries_.size()); ++i) {
+        if (entries_[i].bbox.intersects(bbox) && !visitor(entries_[i]))
+          return false;
+      }
+      continue;
+    }
+
+    // NOTE children are pushed in reverse order to visit them in hilbert order.
+    std::size_t end = std::min(start + NodeSize, levels_[node.first - 1].size());
+    for (std::size_t i = end; i > start; --i)
+      stack.push_back(std::make_pair(node.first - 1, i - 1));
+  }
+  return true;
+}
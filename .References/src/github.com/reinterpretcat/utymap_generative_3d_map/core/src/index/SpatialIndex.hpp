@@ -0,0 +1,65 @@
+#ifndef INDEX_SPATIALINDEX_HPP_DEFINED
+#define INDEX_SPATIALINDEX_HPP_DEFINED
+
+#include "BoundingBox.hpp"
+#include "QuadKey.hpp"
+
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace utymap {
+namespace index {
+
+/// Packed Hilbert R-tree which maps bounding boxes of stored elements to quadkeys they are stored in.
+/// Tree is static: it is bulk loaded from entries sorted by hilbert value of their centers
+/// and is rebuilt from scratch when new entries are added.
+class SpatialIndex final {
+ public:
+  /// Describes element stored in given quadkey.
+  struct Entry final {
+    utymap::BoundingBox bbox;
+    utymap::QuadKey quadKey;
+  };
+
+  /// Creates empty index.
+  SpatialIndex() = default;
+
+  /// Builds index from given entries.
+  explicit SpatialIndex(std::vector<Entry> entries);
+
+  /// Visits all entries which bounding box intersects given one.
+  void search(const utymap::BoundingBox &bbox, const std::function<void(const Entry &)> &visitor) const;
+
+  /// Checks whether there is at least one entry which intersects given bounding box.
+  bool intersects(const utymap::BoundingBox &bbox) const;
+
+  /// Returns all entries in hilbert order.
+  const std::vector<Entry> &entries() const { return entries_; }
+
+  bool empty() const { return entries_.empty(); }
+
+  /// Writes index in binary form.
+  void write(std::ostream &stream) const;
+
+  /// Reads index written by write. Throws std::invalid_argument if data is corrupted.
+  static SpatialIndex read(std::istream &stream);
+
+ private:
+  /// Creates tree levels over entries which are already sorted.
+  void pack();
+
+  /// Visits intersecting entries until visitor returns false. Returns false if visiting was stopped.
+  template<typename Visitor>
+  bool traverse(const utymap::BoundingBox &bbox, const Visitor &visitor) const;
+
+  std::vector<Entry> entries_;
+  /// Bounding boxes of tree nodes: first level groups entries, the last one is the root level.
+  std::vector<std::vector<utymap::BoundingBox>> levels_;
+};
+
+}
+}
+
+#endif // INDEX_SPATIALINDEX_HPP_DEFINED
@@ -1,115 +1,232 @@
 #include "hashing/MurmurHash3.h"
 #include "index/StringTable.hpp"
 #include "utils/CoreUtils.hpp"
+#include "utils/MappedFile.hpp"
 
+#include <atomic>
+#include <cstring>
 #include <fstream>
 #include <mutex>
-#include <unordered_map>
+#include <vector>
 
 using std::ios;
 using namespace utymap::index;
+using namespace utymap::utils;
+
+namespace {
+/// Amount of entries in one chunk of entry directory.
+const std::uint32_t ChunkBits = 16;
+const std::uint32_t ChunkSize = 1 << ChunkBits;
+const std::uint32_t ChunkMask = ChunkSize - 1;
+/// Maximum amount of chunks: allows to address whole uint32 id range.
+const std::uint32_t MaxChunks = 1 << (32 - ChunkBits);
+/// Size of arena block used to keep strings inserted at runtime.
+const std::size_t ArenaBlockSize = 64*1024;
+/// Initial capacity of hash table.
+const std::size_t MinHashCapacity = 4096;
+
+/// Describes interned string.
+struct Entry final {
+  const char *data;
+  std::uint32_t size;
+  std::uint32_t hash;
+};
 
-/// Naive implementation of string table: reads all the time string from file; acquires lock
-/// TODO optimize it to avoid locks and expensive file reads.
-class StringTable::StringTableImpl {
-  typedef std::vector<std::uint32_t> IdList;
-  typedef std::unordered_map<std::uint32_t, IdList> HashIdMap;
+/// Open addressing table which maps string hash to id. Slot value is id + 1, zero means empty slot.
+struct HashTable final {
+  explicit HashTable(std::size_t capacity) :
+      mask(capacity - 1),
+      slots(new std::atomic<std::uint32_t>[capacity]) {
+    for (std::size_t i = 0; i < capacity; ++i)
+      slots[i].store(0, std::memory_order_relaxed);
+  }
 
+  std::size_t capacity() const { return mask + 1; }
+
+  const std::size_t mask;
+  std::unique_ptr<std::atomic<std::uint32_t>[]> slots;
+};
+}
+
+/// String table keeps all strings in memory: strings which exist on startup are read directly
+/// from memory mapped data file, new ones are copied into arena and appended to the files.
+/// Reads are wait-free; lookups of present strings are lock-free; insertions are serialized.
+class StringTable::StringTableImpl {
  public:
   StringTableImpl(const std::string &indexPath, const std::string &dataPath, std::uint32_t seed) :
-      indexFile_(indexPath, ios::in | ios::out | ios::binary | ios::ate | ios::app),
-      dataFile_(dataPath, ios::in | ios::out | ios::binary | ios::app),
+      indexFile_(indexPath, ios::out | ios::binary | ios::app),
+      dataFile_(dataPath, ios::out | ios::binary | ios::app),
+      mappedData_(dataPath),
       seed_(seed),
-      nextId_(0),
-      map_(),
-      offsets_() {
-    nextId_ = static_cast<std::uint32_t>(indexFile_.tellg()/(sizeof(std::uint32_t)*2));
-    if (nextId_ > 0) {
-      std::uint32_t count = nextId_;
-      indexFile_.seekg(0, ios::beg);
-
-      // NOTE reserve some extra size for possible insertions
-      std::size_t capacity = count + 2048;
-      offsets_.reserve(capacity);
-      map_.reserve(capacity);
-
-      for (std::uint32_t i = 0; i < count; ++i) {
-        std::uint32_t hash, offset;
-        indexFile_.read(reinterpret_cast<char *>(&hash), sizeof(hash));
-        indexFile_.read(reinterpret_cast<char *>(&offset), sizeof(offset));
-        offsets_.push_back(offset);
-        map_[hash].push_back(i);
-      }
+      count_(0),
+      dataSize_(mappedData_.size()),
+      chunks_(new std::atomic<Entry *>[MaxChunks]),
+      arenaBlockUsed_(ArenaBlockSize) {
+    for (std::uint32_t i = 0; i < MaxChunks; ++i)
+      chunks_[i].store(nullptr, std::memory_order_relaxed);
+
+    std::ifstream indexFile(indexPath, ios::in | ios::binary | ios::ate);
+    auto count = indexFile.good()
+                 ? static_cast<std::uint32_t>(indexFile.tellg()/(sizeof(std::uint32_t)*2))
+                 : 0;
+
+    std::size_t capacity = MinHashCapacity;
+    while (capacity < count*2) capacity <<= 1;
+    table_.store(new HashTable(capacity), std::memory_order_relaxed);
+    tables_.emplace_back(table_.load(std::memory_order_relaxed));
+
+    indexFile.seekg(0, ios::beg);
+    for (std::uint32_t i = 0; i < count; ++i) {
+      std::uint32_t hash, offset;
+      indexFile.read(reinterpret_cast<char *>(&hash), sizeof(hash));
+      indexFile.read(reinterpret_cast<char *>(&offset), sizeof(offset));
+      if (offset >= mappedData_.size())
+        throw std::domain_error("String table is corrupted.");
+
+      const char *data = mappedData_.data() + offset;
+      auto size = static_cast<std::uint32_t>(strnlen(data, mappedData_.size() - offset));
+      publish(Entry{data, size, hash});
     }
   }
 
+  ~StringTableImpl() {
+    for (std::uint32_t i = 0; i < MaxChunks; ++i)
+      delete[] chunks_[i].load(std::memory_order_relaxed);
+  }
+
   std::uint32_t getId(const std::string &str) {
     std::uint32_t hash;
     MurmurHash3_x86_32(str.c_str(), static_cast<int>(str.size()), seed_, &hash);
 
-    // TODO avoid lock there
+    std::uint32_t id;
+    if (find(*table_.load(std::memory_order_acquire), str, hash, id))
+      return id;
+
     std::lock_guard<std::mutex> lock(lock_);
-    HashIdMap::iterator hashLookupResult = map_.find(hash);
-    if (hashLookupResult!=map_.end()) {
-      std::string data;
-      for (std::uint32_t id : hashLookupResult->second) {
-        data.clear();
-        readString(id, data);
-        if (str==data)
-          return id;
-      }
-    }
+    // NOTE string can be inserted by another thread or table can be grown meanwhile.
+    if (find(*table_.load(std::memory_order_acquire), str, hash, id))
+      return id;
 
-    writeString(hash, str);
-    return nextId_++;
+    return insert(str, hash);
   }
 
-  std::string getString(std::uint32_t id) {
-    std::string str;
-    // TODO avoid lock there
-    std::lock_guard<std::mutex> lock(lock_);
-    readString(id, str);
-    return str;
+  std::string getString(std::uint32_t id) const {
+    if (id >= count_.load(std::memory_order_acquire))
+      return std::string();
+
+    const Entry &entry = getEntry(id);
+    return std::string(entry.data, entry.size);
   }
 
  private:
+  /// Gets entry by id. NOTE id should be less than published count.
+  const Entry &getEntry(std::uint32_t id) const {
+    return chunks_[id >> ChunkBits].load(std::memory_order_acquire)[id & ChunkMask];
+  }
 
-  /// Reads string by id.
-  void readString(std::uint32_t id, std::string &data) {
-    if (id < offsets_.size()) {
-      std::uint32_t offset = offsets_[id];
-      dataFile_.seekg(offset, ios::beg);
-      std::getline(dataFile_, data, '\0');
+  /// Tries to find id of given string in hash table.
+  bool find(const HashTable &table, const std::string &str, std::uint32_t hash, std::uint32_t &id) const {
+    for (std::size_t i = hash & table.mask;; i = (i + 1) & table.mask) {
+      std::uint32_t slot = table.slots[i].load(std::memory_order_acquire);
+      if (slot==0)
+        return false;
+
+      const Entry &entry = getEntry(slot - 1);
+      if (entry.hash==hash && entry.size==str.size() && std::memcmp(entry.data, str.data(), str.size())==0) {
+        id = slot - 1;
+        return true;
+      }
     }
   }
 
-  /// Writes string to index.
-  void writeString(std::uint32_t hash, const std::string &data) {
-    // get offset as file size
-    dataFile_.seekg(0, ios::end);
-    std::uint32_t offset = static_cast<std::uint32_t>(dataFile_.tellg());
+  /// Inserts new string. Should be called under lock.
+  std::uint32_t insert(const std::string &str, std::uint32_t hash) {
+    auto offset = static_cast<std::uint32_t>(dataSize_);
+    dataFile_.write(str.c_str(), static_cast<std::streamsize>(str.size() + 1));
+    dataFile_.flush();
+    dataSize_ += str.size() + 1;
+
+    indexFile_.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+    indexFile_.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+    indexFile_.flush();
+
+    return publish(Entry{allocate(str), static_cast<std::uint32_t>(str.size()), hash});
+  }
+
+  /// Makes entry visible for readers. Should be called under lock or from constructor.
+  std::uint32_t publish(const Entry &entry) {
+    std::uint32_t id = count_.load(std::memory_order_relaxed);
+    auto &chunk = chunks_[id >> ChunkBits];
+    if (chunk.load(std::memory_order_relaxed)==nullptr)
+      chunk.store(new Entry[ChunkSize], std::memory_order_release);
+    chunk.load(std::memory_order_relaxed)[id & ChunkMask] = entry;
+    count_.store(id + 1, std::memory_order_release);
+
+    HashTable *table = table_.load(std::memory_order_relaxed);
+    if ((id + 1)*2 > table->capacity())
+      table = grow(*table);
+    else
+      insertSlot(*table, entry.hash, id);
+
+    return id;
+  }
+
+  /// Creates new hash table with doubled capacity. Old table is kept alive for concurrent readers.
+  HashTable *grow(const HashTable &old) {
+    auto table = utymap::utils::make_unique<HashTable>(old.capacity()*2);
+    std::uint32_t count = count_.load(std::memory_order_relaxed);
+    for (std::uint32_t id = 0; id < count; ++id)
+      insertSlot(*table, getEntry(id).hash, id);
+
+    table_.store(table.get(), std::memory_order_release);
+    tables_.push_back(std::move(table));
+    return tables_.back().get();
+  }
+
+  static void insertSlot(HashTable &table, std::uint32_t hash, std::uint32_t id) {
+    std::size_t i = hash & table.mask;
+    while (table.slots[i].load(std::memory_order_relaxed)!=0)
+      i = (i + 1) & table.mask;
+    table.slots[i].store(id + 1, std::memory_order_release);
+  }
 
-    // write string
-    dataFile_.seekp(0, ios::end);
-    dataFile_ << data.c_str() << '\0';
+  /// Copies string into arena.
+  const char *allocate(const std::string &str) {
+    std::size_t size = str.size() + 1;
+    if (size > ArenaBlockSize) {
+      arena_.emplace_back(new char[size]);
+      std::memcpy(arena_.back().get(), str.c_str(), size);
+      return arena_.back().get();
+    }
 
-    // write index entry
-    indexFile_.seekp(0, ios::end);
-    indexFile_.write(reinterpret_cast<char *>(&hash), sizeof(hash));
-    indexFile_.write(reinterpret_cast<char *>(&offset), sizeof(offset));
+    if (arenaBlockUsed_ + size > ArenaBlockSize) {
+      arenaBlocks_.emplace_back(new char[ArenaBlockSize]);
+      arenaBlockUsed_ = 0;
+    }
 
-    map_[hash].push_back(nextId_);
-    offsets_.push_back(offset);
+    char *data = arenaBlocks_.back().get() + arenaBlockUsed_;
+    std::memcpy(data, str.c_str(), size);
+    arenaBlockUsed_ += size;
+    return data;
   }
 
-  std::fstream indexFile_;
-  std::fstream dataFile_;
-  std::uint32_t seed_;
-  std::uint32_t nextId_;
+  std::ofstream indexFile_;
+  std::ofstream dataFile_;
+  const MappedFile mappedData_;
+  const std::uint32_t seed_;
+
+  std::atomic<std::uint32_t> count_;
+  std::size_t dataSize_;
+
+  /// Two level directory of entries: chunks are never moved once allocated.
+  std::unique_ptr<std::atomic<Entry *>[]> chunks_;
+
+  std::atomic<HashTable *> table_;
+  std::vector<std::unique_ptr<HashTable>> tables_;
 
-  /// TODO think about better data structure alternatives
-  HashIdMap map_;
-  std::vector<std::uint32_t> offsets_;
+  std::vector<std::unique_ptr<char[]>> arenaBlocks_;
+  std::vector<std::unique_ptr<char[]>> arena_;
+  std::size_t arenaBlockUsed_;
 
   std::mutex lock_;
 };
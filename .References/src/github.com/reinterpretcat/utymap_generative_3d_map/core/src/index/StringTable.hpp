@@ -12,6 +12,7 @@ namespace index {
 /// Index file consists of id-offset pairs where id - string id,
 /// offset - first character of the string inside data file.
 /// data file contains list of null terminated strings.
+/// All strings are kept in memory, so reads do not touch files and are thread safe.
 class StringTable final {
  public:
 
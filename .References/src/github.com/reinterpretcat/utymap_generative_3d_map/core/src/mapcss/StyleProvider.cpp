@@ -7,7 +7,9 @@
 #include "mapcss/Style.hpp"
 #include "mapcss/StyleProvider.hpp"
 #include "utils/GradientUtils.hpp"
+#include "utils/SharedMutex.hpp"
 
+#include <array>
 #include <mutex>
 
 using namespace utymap::entities;
@@ -33,8 +35,44 @@ struct ConditionFilter final {
 };
 
 typedef std::vector<std::shared_ptr<const StyleDeclaration>> StyleDeclarations;
+
+/// Keeps condition filters of one level of detail in stylesheet order together with inverted index
+/// which maps tag key and key-value pair to filters which require it.
+struct ConditionFilterIndex final {
+  std::vector<ConditionFilter> filters;
+  /// Filters without conditions: they match any element.
+  std::vector<std::uint32_t> unconditional;
+  /// Filters which are indexed by required key.
+  std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> byKey;
+  /// Filters which are indexed by required key and value.
+  std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> byKeyValue;
+
+  void add(const ConditionFilter &filter) {
+    auto index = static_cast<std::uint32_t>(filters.size());
+    filters.push_back(filter);
+
+    // NOTE every condition requires tag's key, so any of them can be used as index key.
+    // Equals condition is preferred as it is the most selective.
+    if (filter.conditions.empty()) {
+      unconditional.push_back(index);
+      return;
+    }
+    for (const auto &condition : filter.conditions) {
+      if (condition.type==OpType::Equals) {
+        byKeyValue[toKeyValue(condition.key, condition.value)].push_back(index);
+        return;
+      }
+    }
+    byKey[filter.conditions.front().key].push_back(index);
+  }
+
+  static std::uint64_t toKeyValue(std::uint32_t key, std::uint32_t value) {
+    return (static_cast<std::uint64_t>(key) << 32) | value;
+  }
+};
+
 /// Key: level of details, value: filters for specific element type.
-typedef std::unordered_map<int, std::vector<ConditionFilter>> ConditionFilterMap;
+typedef std::unordered_map<int, ConditionFilterIndex> ConditionFilterMap;
 typedef std::unordered_map<std::uint64_t, StyleDeclarations> IdentifierFilter;
 typedef std::unordered_map<int, IdentifierFilter> IdentifierFilterMap;
 
@@ -74,7 +112,7 @@ void addTo(std::string &tag, const OpType &type) {
 void addTo(std::string &tag, const ConditionFilterMap &filterMap) {
   for (const auto &pair : filterMap) {
     tag.append(utymap::utils::toString(pair.first));
-    for (const auto &filter : pair.second) {
+    for (const auto &filter : pair.second.filters) {
       for (const auto &cond : filter.conditions) {
         tag.append(utymap::utils::toString(cond.key));
         addTo(tag, cond.type);
@@ -111,37 +149,143 @@ std::string getHashTag(const FilterCollection &filterCollection) {
   return MD5(tag).hexdigest();
 }
 
+/// Element types which have own condition filters.
+enum class ElementType { Node, Way, Area, Relation };
+
+typedef std::vector<const StyleDeclaration *> DeclarationList;
+
+/// Memoizes declarations matched by condition filters. Elements with the same type and tags
+/// get the same declarations at given level of detail, so matching is done only once for them.
+class DeclarationCache final {
+  /// Max size of cached entries in bytes.
+  const static std::size_t MaxSize = 16*1024*1024;
+
+  /// Cache key. Key used for lookup only refers to element's tags, so they are not copied
+  /// on every lookup: tags are copied only when key is stored in cache.
+  struct Key final {
+    ElementType type;
+    int levelOfDetail;
+    std::size_t hash;
+
+    Key(ElementType type, int levelOfDetail, const std::vector<Tag> &tags) :
+        type(type), levelOfDetail(levelOfDetail), hash(calculateHash(type, levelOfDetail, tags)), tagsRef_(&tags) {
+    }
+
+    Key(const Key &other) :
+        type(other.type), levelOfDetail(other.levelOfDetail), hash(other.hash),
+        tags_(other.tags()), tagsRef_(nullptr) {
+    }
+
+    Key &operator=(const Key &) = delete;
+
+    const std::vector<Tag> &tags() const { return tagsRef_!=nullptr ? *tagsRef_ : tags_; }
+
+    bool operator==(const Key &other) const {
+      const auto &lhs = tags(), &rhs = other.tags();
+      return hash==other.hash && type==other.type && levelOfDetail==other.levelOfDetail &&
+          lhs.size()==rhs.size() &&
+          std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const Tag &l, const Tag &r) {
+            return l.key==r.key && l.value==r.value;
+          });
+    }
+
+   private:
+    /// FNV-1a over type, level of detail and tag ids.
+    static std::size_t calculateHash(ElementType type, int levelOfDetail, const std::vector<Tag> &tags) {
+      std::uint64_t hash = 14695981039346656037ULL;
+      auto mix = [&](std::uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+      };
+      mix(static_cast<std::uint64_t>(type));
+      mix(static_cast<std::uint64_t>(levelOfDetail));
+      for (const auto &tag : tags) {
+        mix(tag.key);
+        mix(tag.value);
+      }
+      return static_cast<std::size_t>(hash);
+    }
+
+    std::vector<Tag> tags_;
+    const std::vector<Tag> *tagsRef_;
+  };
+
+  struct KeyHash final {
+    std::size_t operator()(const Key &key) const { return key.hash; }
+  };
+
+  typedef utymap::utils::ConcurrentLruCache<Key, DeclarationList, KeyHash> Cache;
+
+ public:
+  DeclarationCache() : entries_(MaxSize, 16, [](const Key &key, const DeclarationList &declarations) {
+    return sizeof(Key) + sizeof(DeclarationList) +
+        key.tags().size()*sizeof(Tag) + declarations.size()*sizeof(const StyleDeclaration *);
+  }) {
+  }
+
+  bool get(ElementType type, int levelOfDetail, const std::vector<Tag> &tags, DeclarationList &declarations) {
+    return entries_.get(Key(type, levelOfDetail, tags), declarations);
+  }
+
+  void put(ElementType type, int levelOfDetail, const std::vector<Tag> &tags, const DeclarationList &declarations) {
+    entries_.put(Key(type, levelOfDetail, tags), declarations);
+  }
+
+  utymap::utils::CacheStatistics getStatistics() const {
+    return entries_.getStatistics();
+  }
+
+ private:
+  Cache entries_;
+};
+
+/// Collects declarations of rules which match element.
 class StyleBuilder final : public ElementVisitor {
   typedef std::vector<Tag>::const_iterator TagIterator;
  public:
 
-  StyleBuilder(std::vector<Tag> tags, StringTable &stringTable,
-               const FilterCollection &filters, int levelOfDetail, bool onlyCheck = false) :
-      style(tags, stringTable),
+  StyleBuilder(StringTable &stringTable, const FilterCollection &filters, int levelOfDetail,
+               bool onlyCheck = false, DeclarationCache *cache = nullptr) :
       filters_(filters),
       levelOfDetail_(levelOfDetail),
       onlyCheck_(onlyCheck),
       canBuild_(false),
-      stringTable_(stringTable) {
+      stringTable_(stringTable),
+      cache_(cache) {
   }
 
-  void visitNode(const Node &node) override { checkOrBuild(node, filters_.nodes); }
+  void visitNode(const Node &node) override { checkOrBuild(node, filters_.nodes, ElementType::Node); }
 
-  void visitWay(const Way &way) override { checkOrBuild(way, filters_.ways); }
+  void visitWay(const Way &way) override { checkOrBuild(way, filters_.ways, ElementType::Way); }
 
-  void visitArea(const Area &area) override { checkOrBuild(area, filters_.areas); }
+  void visitArea(const Area &area) override { checkOrBuild(area, filters_.areas, ElementType::Area); }
 
-  void visitRelation(const Relation &relation) override { checkOrBuild(relation, filters_.relations); }
+  void visitRelation(const Relation &relation) override {
+    checkOrBuild(relation, filters_.relations, ElementType::Relation);
+  }
 
   bool canBuild() const { return canBuild_; }
 
-  Style style;
+  /// Declarations of matched rules in order they should be applied.
+  DeclarationList declarations;
 
  private:
 
-  void checkOrBuild(const Element &element, const ConditionFilterMap &filters) {
-    if (!buildFromIdentifier(element))
+  void checkOrBuild(const Element &element, const ConditionFilterMap &filters, ElementType type) {
+    if (buildFromIdentifier(element))
+      return;
+
+    if (cache_==nullptr) {
       buildFromCondition(element.tags, filters);
+      return;
+    }
+
+    if (cache_->get(type, levelOfDetail_, element.tags, declarations)) {
+      canBuild_ = !declarations.empty();
+      return;
+    }
+    buildFromCondition(element.tags, filters);
+    cache_->put(type, levelOfDetail_, element.tags, declarations);
   }
 
   /// Checks tag's value assuming that the key is already checked.
@@ -179,11 +323,39 @@ class StyleBuilder final : public ElementVisitor {
     return false;
   }
 
-  /// Builds style object from regular mapcss rule encapsulated by condition filter.
+  /// Marks filters with given indices as candidates.
+  static void mark(const std::vector<std::uint32_t> &indices, std::vector<std::uint64_t> &candidates) {
+    for (auto index : indices)
+      candidates[index >> 6] |= std::uint64_t(1) << (index & 63);
+  }
+
+  /// Builds style object from regular mapcss rules encapsulated by condition filters. Only filters
+  /// which are found in inverted index by element's tags are checked.
   void buildFromCondition(const std::vector<Tag> &tags, const ConditionFilterMap &filters) {
     ConditionFilterMap::const_iterator iter = filters.find(levelOfDetail_);
-    if (iter!=filters.end()) {
-      for (const ConditionFilter &filter : iter->second) {
+    if (iter==filters.end())
+      return;
+
+    const ConditionFilterIndex &index = iter->second;
+    std::vector<std::uint64_t> candidates((index.filters.size() + 63)/64, 0);
+    mark(index.unconditional, candidates);
+    for (const auto &tag : tags) {
+      auto byKey = index.byKey.find(tag.key);
+      if (byKey!=index.byKey.end())
+        mark(byKey->second, candidates);
+
+      auto byKeyValue = index.byKeyValue.find(ConditionFilterIndex::toKeyValue(tag.key, tag.value));
+      if (byKeyValue!=index.byKeyValue.end())
+        mark(byKeyValue->second, candidates);
+    }
+
+    // NOTE candidates are visited in stylesheet order, so declarations are overridden as before.
+    for (std::size_t word = 0; word < candidates.size(); ++word) {
+      for (std::uint64_t bits = candidates[word]; bits!=0; bits &= bits - 1) {
+        std::size_t bit = 0;
+        while (((bits >> bit) & 1)==0) ++bit;
+        const ConditionFilter &filter = index.filters[word*64 + bit];
+
         bool isMatched = true;
         for (auto it = filter.conditions.cbegin(); it!=filter.conditions.cend() && isMatched; ++it) {
           isMatched &= matchTags(tags.cbegin(), tags.cend(), *it);
@@ -194,7 +366,7 @@ class StyleBuilder final : public ElementVisitor {
           if (onlyCheck_) return;
 
           for (const auto &d : filter.declarations) {
-            style.put(*d);
+            declarations.push_back(d.get());
           }
         }
       }
@@ -210,7 +382,7 @@ class StyleBuilder final : public ElementVisitor {
         canBuild_ = true;
         if (!onlyCheck_) {
           for (const auto &d : elementStyle->second)
-            style.put(*d);
+            declarations.push_back(d.get());
         }
         return true;
       }
@@ -223,6 +395,7 @@ class StyleBuilder final : public ElementVisitor {
   bool onlyCheck_;
   bool canBuild_;
   StringTable &stringTable_;
+  DeclarationCache *cache_;
 };
 
 }
@@ -233,6 +406,7 @@ class StyleProvider::StyleProviderImpl {
 
   FilterCollection filters;
   StringTable &stringTable;
+  DeclarationCache cache;
 
   StyleProviderImpl(const StyleSheet &stylesheet, StringTable &stringTable) :
       filters(),
@@ -282,17 +456,22 @@ class StyleProvider::StyleProviderImpl {
     return hashTag_;
   }
 
+  /// Returns gradient for given key. Gradients of stylesheet are parsed in advance, other ones
+  /// are parsed on first use. NOTE can be called from multiple threads.
   const ColorGradient &getGradient(const std::string &key) {
-    auto gradientPair = gradients.find(key);
-    if (gradientPair==gradients.end()) {
-      auto gradient = utymap::utils::GradientUtils::parseGradient(key);
-      if (gradient->empty())
-        throw MapCssException("Invalid gradient: " + key);
-      std::lock_guard<std::mutex> lock(lock_);
-      gradients.emplace(key, std::move(gradient));
-      gradientPair = gradients.find(key);
+    {
+      utymap::utils::SharedLock lock(gradientLock_);
+      auto gradientPair = gradients.find(key);
+      if (gradientPair!=gradients.end())
+        return *gradientPair->second;
     }
-    return *gradientPair->second;
+
+    auto gradient = utymap::utils::GradientUtils::parseGradient(key);
+    if (gradient->empty())
+      throw MapCssException("Invalid gradient: " + key);
+
+    std::lock_guard<utymap::utils::SharedMutex> lock(gradientLock_);
+    return *gradients.emplace(key, std::move(gradient)).first->second;
   }
 
   const TextureGroup &getTexture(std::uint16_t index, const std::string &key) const {
@@ -368,7 +547,7 @@ class StyleProvider::StyleProviderImpl {
     std::sort(filter.conditions.begin(), filter.conditions.end(),
               [](const ConditionType &c1, const ConditionType &c2) { return c1.key > c2.key; });
     for (int i = selector.zoom.start; i <= selector.zoom.end; ++i) {
-      (*filtersPtr)[i].push_back(filter);
+      (*filtersPtr)[i].add(filter);
     }
   }
 
@@ -380,7 +559,7 @@ class StyleProvider::StyleProviderImpl {
     }
   }
 
-  std::mutex lock_;
+  utymap::utils::SharedMutex gradientLock_;
   std::string hashTag_;
 
   std::unordered_map<std::string, std::unique_ptr<const ColorGradient>> gradients;
@@ -403,20 +582,29 @@ const std::string &StyleProvider::getTag() const {
 }
 
 bool StyleProvider::hasStyle(const utymap::entities::Element &element, int levelOfDetails) const {
-  StyleBuilder builder(element.tags, pimpl_->stringTable, pimpl_->filters, levelOfDetails, true);
+  StyleBuilder builder(pimpl_->stringTable, pimpl_->filters, levelOfDetails, true);
   element.accept(builder);
   return builder.canBuild();
 }
 
 Style StyleProvider::forElement(const Element &element, int levelOfDetails) const {
-  StyleBuilder builder(element.tags, pimpl_->stringTable, pimpl_->filters, levelOfDetails);
+  StyleBuilder builder(pimpl_->stringTable, pimpl_->filters, levelOfDetails, false, &pimpl_->cache);
   element.accept(builder);
-  return std::move(builder.style);
+
+  Style style(element.tags, pimpl_->stringTable);
+  for (const auto *declaration : builder.declarations)
+    style.put(*declaration);
+  return std::move(style);
 }
 
 Style StyleProvider::forCanvas(int levelOfDetails) const {
   Style style({}, pimpl_->stringTable);
-  for (const auto &filter : pimpl_->filters.canvases[levelOfDetails]) {
+  // NOTE can be called from multiple threads, so filter map is not modified here.
+  auto canvas = pimpl_->filters.canvases.find(levelOfDetails);
+  if (canvas==pimpl_->filters.canvases.end())
+    return std::move(style);
+
+  for (const auto &filter : canvas->second.filters) {
     for (const auto &declaration : filter.declarations) {
       style.put(*declaration);
     }
@@ -435,3 +623,7 @@ const TextureGroup &StyleProvider::getTexture(std::uint16_t index, const std::st
 const utymap::lsys::LSystem &StyleProvider::getLsystem(const std::string &key) const {
   return pimpl_->getLsystem(key);
 }
+
+utymap::utils::CacheStatistics StyleProvider::getCacheStatistics() const {
+  return pimpl_->cache.getStatistics();
+}
@@ -7,6 +7,7 @@
 #include "mapcss/StyleSheet.hpp"
 #include "mapcss/Style.hpp"
 #include "lsys/LSystem.hpp"
+#include "utils/ConcurrentLruCache.hpp"
 
 #include <string>
 #include <memory>
@@ -49,6 +50,9 @@ class StyleProvider final {
   /// Returns lsystem with given id.
   const utymap::lsys::LSystem &getLsystem(const std::string &key) const;
 
+  /// Returns usage statistics of matched declarations cache. Size is in bytes.
+  utymap::utils::CacheStatistics getCacheStatistics() const;
+
  private:
   class StyleProviderImpl;
   std::unique_ptr<StyleProviderImpl> pimpl_;
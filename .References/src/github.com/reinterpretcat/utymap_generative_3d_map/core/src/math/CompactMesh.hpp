@@ -0,0 +1,78 @@
+#ifndef MATH_COMPACTMESH_HPP_DEFINED
+#define MATH_COMPACTMESH_HPP_DEFINED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace utymap {
+namespace math {
+
+/// Represents vertex of compact mesh. Position is relative to mesh origin.
+struct CompactVertex final {
+  float x;
+  float y;
+  float elevation;
+  std::uint32_t color;
+  float u;
+  float v;
+};
+
+static_assert(sizeof(CompactVertex)==24, "Unexpected compact vertex size.");
+
+/// Represents mesh with interleaved single precision vertex data and the smallest
+/// index type which can address all vertices.
+struct CompactMesh final {
+  std::string name;
+
+  /// Origin of vertex positions: float cannot store absolute coordinates precisely.
+  double originX;
+  double originY;
+
+  std::vector<CompactVertex> vertices;
+
+  /// Triangle indices: only one of these is used depending on vertex count.
+  std::vector<std::uint16_t> shortIndices;
+  std::vector<std::uint32_t> longIndices;
+
+  /// Texture mapping info in the same format as in Mesh: uv offset is twice vertex index.
+  std::vector<int> uvMap;
+
+  explicit CompactMesh(const std::string &name) : name(name), originX(0), originY(0) {
+  }
+
+  CompactMesh(CompactMesh &&other) :
+      name(std::move(other.name)),
+      originX(other.originX),
+      originY(other.originY),
+      vertices(std::move(other.vertices)),
+      shortIndices(std::move(other.shortIndices)),
+      longIndices(std::move(other.longIndices)),
+      uvMap(std::move(other.uvMap)) {
+  }
+
+  /// Disable copying to prevent accidental copy
+  CompactMesh(const CompactMesh &) = delete;
+  CompactMesh &operator=(const CompactMesh &) = delete;
+
+  /// Returns size of one index in bytes.
+  int indexSize() const {
+    return longIndices.empty() ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+  }
+
+  /// Returns amount of indices.
+  std::size_t indexCount() const {
+    return shortIndices.size() + longIndices.size();
+  }
+
+  /// Returns pointer to index buffer.
+  const void *indexData() const {
+    return longIndices.empty()
+           ? static_cast<const void *>(shortIndices.data())
+           : static_cast<const void *>(longIndices.data());
+  }
+};
+
+}
+}
+#endif //MATH_COMPACTMESH_HPP_DEFINED
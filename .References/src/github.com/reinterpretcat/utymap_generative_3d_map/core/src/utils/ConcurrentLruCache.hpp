@@ -0,0 +1,177 @@
+#ifndef UTILS_CONCURRENTLRUCACHE_HPP_DEFINED
+#define UTILS_CONCURRENTLRUCACHE_HPP_DEFINED
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace utymap {
+namespace utils {
+
+/// Describes cache usage.
+struct CacheStatistics final {
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  std::size_t evictions = 0;
+  /// Amount of cached entries.
+  std::size_t count = 0;
+  /// Size of cached entries as reported by size function.
+  std::size_t size = 0;
+
+  double hitRate() const {
+    auto total = hits + misses;
+    return total==0 ? 0 : static_cast<double>(hits)/total;
+  }
+};
+
+/// Thread safe LRU cache. Entries are distributed between independently locked shards,
+/// each shard evicts its least recently used entries when its part of capacity is exceeded.
+/// Capacity is expressed in units of size function: by default, each entry has size of one.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class ConcurrentLruCache final {
+  struct Entry final {
+    Key key;
+    Value value;
+    std::size_t size;
+  };
+
+  typedef typename std::list<Entry>::iterator ListIterator;
+
+  struct Shard final {
+    std::mutex lock;
+    std::list<Entry> items;
+    std::unordered_map<Key, ListIterator, Hash, KeyEqual> index;
+    CacheStatistics statistics;
+  };
+
+ public:
+  typedef std::function<std::size_t(const Key &, const Value &)> SizeFunction;
+
+  explicit ConcurrentLruCache(std::size_t capacity,
+                              std::size_t shardCount = 16,
+                              const SizeFunction &sizeFunction = nullptr) :
+      shards_(std::max<std::size_t>(std::min(shardCount, capacity), 1)),
+      shardCapacity_(std::max<std::size_t>(capacity/shards_.size(), 1)),
+      sizeFunction_(sizeFunction) {
+  }
+
+  ConcurrentLruCache(const ConcurrentLruCache &) = delete;
+  ConcurrentLruCache &operator=(const ConcurrentLruCache &) = delete;
+
+  /// Copies cached value and marks it as recently used. Returns false if there is no such key.
+  bool get(const Key &key, Value &value) {
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.index.find(key);
+    if (it==shard.index.end()) {
+      ++shard.statistics.misses;
+      return false;
+    }
+
+    ++shard.statistics.hits;
+    shard.items.splice(shard.items.begin(), shard.items, it->second);
+    value = it->second->value;
+    return true;
+  }
+
+  /// Returns cached value or creates it using factory. Factory is called without lock,
+  /// so it can be called by more than one thread: the first stored value wins.
+  template<typename Factory>
+  Value getOrAdd(const Key &key, Factory factory) {
+    Value value;
+    if (get(key, value))
+      return value;
+
+    value = factory();
+
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.index.find(key);
+    if (it!=shard.index.end())
+      return it->second->value;
+
+    add(shard, key, value);
+    return value;
+  }
+
+  /// Stores value replacing existing one.
+  void put(const Key &key, const Value &value) {
+    auto &shard = getShard(key);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    auto it = shard.index.find(key);
+    if (it!=shard.index.end())
+      remove(shard, it);
+
+    add(shard, key, value);
+  }
+
+  /// Removes all entries. Statistics counters are kept.
+  void clear() {
+    for (auto &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      shard.items.clear();
+      shard.index.clear();
+      shard.statistics.count = 0;
+      shard.statistics.size = 0;
+    }
+  }
+
+  /// Returns statistics aggregated over all shards.
+  CacheStatistics getStatistics() const {
+    CacheStatistics result;
+    for (auto &shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.lock);
+      result.hits += shard.statistics.hits;
+      result.misses += shard.statistics.misses;
+      result.evictions += shard.statistics.evictions;
+      result.count += shard.statistics.count;
+      result.size += shard.statistics.size;
+    }
+    return result;
+  }
+
+ private:
+  Shard &getShard(const Key &key) const {
+    std::size_t hash = Hash()(key);
+    // NOTE mix bits as unordered_map uses the same hash for buckets.
+    hash ^= hash >> 16;
+    hash *= 0x45d9f3b;
+    hash ^= hash >> 16;
+    return shards_[hash%shards_.size()];
+  }
+
+  void add(Shard &shard, const Key &key, const Value &value) {
+    std::size_t size = sizeFunction_ ? sizeFunction_(key, value) : 1;
+    shard.items.push_front(Entry{key, value, size});
+    shard.index.emplace(key, shard.items.begin());
+    ++shard.statistics.count;
+    shard.statistics.size += size;
+
+    // NOTE the newest entry is kept even if it exceeds capacity alone.
+    while (shard.statistics.size > shardCapacity_ && shard.items.size() > 1) {
+      auto last = shard.items.end();
+      remove(shard, shard.index.find((--last)->key));
+      ++shard.statistics.evictions;
+    }
+  }
+
+  static void remove(Shard &shard, typename std::unordered_map<Key, ListIterator, Hash, KeyEqual>::iterator it) {
+    --shard.statistics.count;
+    shard.statistics.size -= it->second->size;
+    shard.items.erase(it->second);
+    shard.index.erase(it);
+  }
+
+  mutable std::vector<Shard> shards_;
+  const std::size_t shardCapacity_;
+  const SizeFunction sizeFunction_;
+};
+
+}
+}
+#endif // UTILS_CONCURRENTLRUCACHE_HPP_DEFINED
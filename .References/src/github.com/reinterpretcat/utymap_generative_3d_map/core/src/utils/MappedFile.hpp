@@ -0,0 +1,65 @@
+#ifndef UTILS_MAPPEDFILE_HPP_DEFINED
+#define UTILS_MAPPEDFILE_HPP_DEFINED
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <streambuf>
+#include <string>
+
+namespace utymap {
+namespace utils {
+
+/// Maps existing file into memory in read only mode.
+/// NOTE empty or missing file results in empty mapping.
+class MappedFile final {
+ public:
+  explicit MappedFile(const std::string &path) : data_(nullptr), size_(0) {
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.good() || file.tellg() <= 0) return;
+    file.close();
+
+    using namespace boost::interprocess;
+    mapping_ = file_mapping(path.c_str(), read_only);
+    region_ = mapped_region(mapping_, read_only);
+    data_ = static_cast<const char *>(region_.get_address());
+    size_ = region_.get_size();
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// Returns pointer to the first byte of the file.
+  const char *data() const { return data_; }
+
+  /// Returns size of the file in bytes.
+  std::size_t size() const { return size_; }
+
+  bool empty() const { return size_==0; }
+
+ private:
+  boost::interprocess::file_mapping mapping_;
+  boost::interprocess::mapped_region region_;
+  const char *data_;
+  std::size_t size_;
+};
+
+/// Exposes memory range as read only stream buffer without copying.
+class MemoryStreamBuf final : public std::streambuf {
+ public:
+  MemoryStreamBuf(const char *data, std::size_t size) {
+    char *begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+  }
+
+  /// Returns amount of consumed bytes.
+  std::size_t position() const {
+    return static_cast<std::size_t>(gptr() - eback());
+  }
+};
+
+}
+}
+#endif // UTILS_MAPPEDFILE_HPP_DEFINED
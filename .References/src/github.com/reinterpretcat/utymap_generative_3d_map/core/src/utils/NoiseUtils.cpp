@@ -1,10 +1,129 @@
 #include "utils/NoiseUtils.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_USE_SSE2
+#endif
+
 using namespace utymap::math;
 using namespace utymap::utils;
 
 const double Sqr2 = std::sqrt(2);
 
+namespace {
+
+static_assert(sizeof(Vector2)==2*sizeof(double), "Gradients are read as array of doubles.");
+static_assert(sizeof(Vector3)==3*sizeof(double), "Gradients are read as array of doubles.");
+
+#if defined(__AVX2__)
+/// Four values processed by AVX2 instructions.
+struct Lanes final {
+  static const std::size_t Size = 4;
+
+  Lanes(__m256d value) : value(value) {}
+  explicit Lanes(double value) : value(_mm256_set1_pd(value)) {}
+
+  static Lanes load(const double *data, std::size_t stride) {
+    return stride==1
+           ? _mm256_loadu_pd(data)
+           : _mm256_set_pd(data[3*stride], data[2*stride], data[stride], data[0]);
+  }
+
+  /// Reads values from given indices of array.
+  static Lanes gather(const double *data, const int *indices) {
+    return _mm256_i32gather_pd(data, _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices)), 8);
+  }
+
+  void store(double *data) const { _mm256_storeu_pd(data, value); }
+
+  /// Rounds values down and stores them as integers too.
+  Lanes floor(int *result) const {
+    __m256d floor = _mm256_floor_pd(value);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(result), _mm256_cvttpd_epi32(floor));
+    return floor;
+  }
+
+  __m256d value;
+};
+
+inline Lanes operator+(const Lanes &lhs, const Lanes &rhs) { return _mm256_add_pd(lhs.value, rhs.value); }
+inline Lanes operator-(const Lanes &lhs, const Lanes &rhs) { return _mm256_sub_pd(lhs.value, rhs.value); }
+inline Lanes operator*(const Lanes &lhs, const Lanes &rhs) { return _mm256_mul_pd(lhs.value, rhs.value); }
+
+#elif defined(NOISE_USE_SSE2)
+/// Two values processed by SSE2 instructions.
+struct Lanes final {
+  static const std::size_t Size = 2;
+
+  Lanes(__m128d value) : value(value) {}
+  explicit Lanes(double value) : value(_mm_set1_pd(value)) {}
+
+  static Lanes load(const double *data, std::size_t stride) {
+    return stride==1 ? _mm_loadu_pd(data) : _mm_set_pd(data[stride], data[0]);
+  }
+
+  /// Reads values from given indices of array.
+  static Lanes gather(const double *data, const int *indices) {
+    return _mm_set_pd(data[indices[1]], data[indices[0]]);
+  }
+
+  void store(double *data) const { _mm_storeu_pd(data, value); }
+
+  /// Rounds values down and stores them as integers too.
+  Lanes floor(int *result) const {
+    // NOTE SSE2 has no floor instruction: truncate and correct negative values.
+    __m128d truncated = _mm_cvtepi32_pd(_mm_cvttpd_epi32(value));
+    __m128d floor = _mm_sub_pd(truncated, _mm_and_pd(_mm_cmplt_pd(value, truncated), _mm_set1_pd(1)));
+    __m128i integers = _mm_cvttpd_epi32(floor);
+    std::memcpy(result, &integers, Size*sizeof(int));
+    return floor;
+  }
+
+  __m128d value;
+};
+
+inline Lanes operator+(const Lanes &lhs, const Lanes &rhs) { return _mm_add_pd(lhs.value, rhs.value); }
+inline Lanes operator-(const Lanes &lhs, const Lanes &rhs) { return _mm_sub_pd(lhs.value, rhs.value); }
+inline Lanes operator*(const Lanes &lhs, const Lanes &rhs) { return _mm_mul_pd(lhs.value, rhs.value); }
+
+#else
+/// Scalar fallback which keeps the same code path.
+struct Lanes final {
+  static const std::size_t Size = 1;
+
+  explicit Lanes(double value) : value(value) {}
+
+  static Lanes load(const double *data, std::size_t) { return Lanes(data[0]); }
+
+  static Lanes gather(const double *data, const int *indices) { return Lanes(data[indices[0]]); }
+
+  void store(double *data) const { data[0] = value; }
+
+  Lanes floor(int *result) const {
+    result[0] = static_cast<int>(std::floor(value));
+    return Lanes(result[0]);
+  }
+
+  double value;
+};
+
+inline Lanes operator+(const Lanes &lhs, const Lanes &rhs) { return Lanes(lhs.value + rhs.value); }
+inline Lanes operator-(const Lanes &lhs, const Lanes &rhs) { return Lanes(lhs.value - rhs.value); }
+inline Lanes operator*(const Lanes &lhs, const Lanes &rhs) { return Lanes(lhs.value*rhs.value); }
+#endif
+
+/// Keeps the same operation order as scalar smooth function.
+inline Lanes smoothLanes(const Lanes &t) {
+  return t*t*t*(t*(t*Lanes(6) - Lanes(15)) + Lanes(10));
+}
+}
+
 const int NoiseUtils::Hash[] =
     {
         151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
@@ -171,3 +290,138 @@ double NoiseUtils::perlin3D(double x, double y, double z, double frequency) {
 
   return a + b*tx + (c + e*tx)*ty + (d + f*tx + (g + h*tx)*ty)*tz;
 }
+
+void NoiseUtils::perlin2D(const double *x, const double *y, double *result, std::size_t count,
+                          double frequency, std::size_t stride) {
+  if (frequency < 1E-5) {
+    std::fill(result, result + count, 0.);
+    return;
+  }
+
+  const double *gx = &Gradients2D[0].x;
+  const double *gy = gx + 1;
+  const Lanes freq(frequency), one(1), sqr2(Sqr2);
+  int ix0[Lanes::Size], iy0[Lanes::Size];
+  int g00[Lanes::Size], g10[Lanes::Size], g01[Lanes::Size], g11[Lanes::Size];
+
+  std::size_t i = 0;
+  for (; i + Lanes::Size <= count; i += Lanes::Size) {
+    Lanes px = Lanes::load(x + i*stride, stride)*freq;
+    Lanes py = Lanes::load(y + i*stride, stride)*freq;
+
+    Lanes tx0 = px - px.floor(ix0);
+    Lanes ty0 = py - py.floor(iy0);
+    Lanes tx1 = tx0 - one;
+    Lanes ty1 = ty0 - one;
+
+    // NOTE hash lookups are done per lane: they are cheap and not vectorizable with SSE.
+    for (std::size_t lane = 0; lane < Lanes::Size; ++lane) {
+      int ix = ix0[lane] & HashMask;
+      int iy = iy0[lane] & HashMask;
+      int h0 = Hash[ix];
+      int h1 = Hash[ix + 1];
+      g00[lane] = (Hash[h0 + iy] & GradientsMask2D)*2;
+      g10[lane] = (Hash[h1 + iy] & GradientsMask2D)*2;
+      g01[lane] = (Hash[h0 + iy + 1] & GradientsMask2D)*2;
+      g11[lane] = (Hash[h1 + iy + 1] & GradientsMask2D)*2;
+    }
+
+    Lanes v00 = Lanes::gather(gx, g00)*tx0 + Lanes::gather(gy, g00)*ty0;
+    Lanes v10 = Lanes::gather(gx, g10)*tx1 + Lanes::gather(gy, g10)*ty0;
+    Lanes v01 = Lanes::gather(gx, g01)*tx0 + Lanes::gather(gy, g01)*ty1;
+    Lanes v11 = Lanes::gather(gx, g11)*tx1 + Lanes::gather(gy, g11)*ty1;
+
+    Lanes tx = smoothLanes(tx0);
+    Lanes ty = smoothLanes(ty0);
+
+    Lanes a = v00;
+    Lanes b = v10 - v00;
+    Lanes c = v01 - v00;
+    Lanes d = v11 - v01 - v10 + v00;
+
+    ((a + b*tx + (c + d*tx)*ty)*sqr2).store(result + i);
+  }
+
+  for (; i < count; ++i)
+    result[i] = perlin2D(x[i*stride], y[i*stride], frequency);
+}
+
+void NoiseUtils::perlin3D(const double *x, const double *y, const double *z, double *result, std::size_t count,
+                          double frequency, std::size_t stride) {
+  if (frequency < 1E-5) {
+    std::fill(result, result + count, 0.);
+    return;
+  }
+
+  const double *gx = &Gradients3D[0].x;
+  const double *gy = gx + 1;
+  const double *gz = gx + 2;
+  const Lanes freq(frequency), one(1);
+  int ix0[Lanes::Size], iy0[Lanes::Size], iz0[Lanes::Size];
+  int indices[8][Lanes::Size];
+
+  std::size_t i = 0;
+  for (; i + Lanes::Size <= count; i += Lanes::Size) {
+    Lanes px = Lanes::load(x + i*stride, stride)*freq;
+    Lanes py = Lanes::load(y + i*stride, stride)*freq;
+    Lanes pz = Lanes::load(z + i*stride, stride)*freq;
+
+    Lanes tx0 = px - px.floor(ix0);
+    Lanes ty0 = py - py.floor(iy0);
+    Lanes tz0 = pz - pz.floor(iz0);
+    Lanes tx1 = tx0 - one;
+    Lanes ty1 = ty0 - one;
+    Lanes tz1 = tz0 - one;
+
+    for (std::size_t lane = 0; lane < Lanes::Size; ++lane) {
+      int ix = ix0[lane] & HashMask;
+      int iy = iy0[lane] & HashMask;
+      int iz = iz0[lane] & HashMask;
+      int h0 = Hash[ix];
+      int h1 = Hash[ix + 1];
+      int h00 = Hash[h0 + iy];
+      int h10 = Hash[h1 + iy];
+      int h01 = Hash[h0 + iy + 1];
+      int h11 = Hash[h1 + iy + 1];
+      indices[0][lane] = (Hash[h00 + iz] & GradientsMask3D)*3;
+      indices[1][lane] = (Hash[h10 + iz] & GradientsMask3D)*3;
+      indices[2][lane] = (Hash[h01 + iz] & GradientsMask3D)*3;
+      indices[3][lane] = (Hash[h11 + iz] & GradientsMask3D)*3;
+      indices[4][lane] = (Hash[h00 + iz + 1] & GradientsMask3D)*3;
+      indices[5][lane] = (Hash[h10 + iz + 1] & GradientsMask3D)*3;
+      indices[6][lane] = (Hash[h01 + iz + 1] & GradientsMask3D)*3;
+      indices[7][lane] = (Hash[h11 + iz + 1] & GradientsMask3D)*3;
+    }
+
+    auto dot = [&](const int *g, const Lanes &tx, const Lanes &ty, const Lanes &tz) {
+      return Lanes::gather(gx, g)*tx + Lanes::gather(gy, g)*ty + Lanes::gather(gz, g)*tz;
+    };
+
+    Lanes v000 = dot(indices[0], tx0, ty0, tz0);
+    Lanes v100 = dot(indices[1], tx1, ty0, tz0);
+    Lanes v010 = dot(indices[2], tx0, ty1, tz0);
+    Lanes v110 = dot(indices[3], tx1, ty1, tz0);
+    Lanes v001 = dot(indices[4], tx0, ty0, tz1);
+    Lanes v101 = dot(indices[5], tx1, ty0, tz1);
+    Lanes v011 = dot(indices[6], tx0, ty1, tz1);
+    Lanes v111 = dot(indices[7], tx1, ty1, tz1);
+
+    Lanes tx = smoothLanes(tx0);
+    Lanes ty = smoothLanes(ty0);
+    Lanes tz = smoothLanes(tz0);
+
+    Lanes a = v000;
+    Lanes b = v100 - v000;
+    Lanes c = v010 - v000;
+    Lanes d = v001 - v000;
+    Lanes e = v110 - v010 - v100 + v000;
+    Lanes f = v101 - v001 - v100 + v000;
+    Lanes g = v011 - v001 - v010 + v000;
+    Lanes h = v111 - v011 - v101 + v001 - v110 + v010 + v100 - v000;
+
+    (a + b*tx + (c + e*tx)*ty + (d + f*tx + (g + h*tx)*ty)*tz).store(result + i);
+  }
+
+  for (; i < count; ++i)
+    result[i] = perlin3D(x[i*stride], y[i*stride], z[i*stride], frequency);
+}
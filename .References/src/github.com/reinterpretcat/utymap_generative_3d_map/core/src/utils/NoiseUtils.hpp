@@ -4,6 +4,8 @@
 #include "math/Vector2.hpp"
 #include "math/Vector3.hpp"
 
+#include <cstddef>
+
 namespace utymap {
 namespace utils {
 
@@ -17,6 +19,16 @@ class NoiseUtils final {
   /// Calculates perlin 3D noise.
   static double perlin3D(double x, double y, double z, double freq);
 
+  /// Calculates perlin 2D noise for count points using SIMD instructions if available.
+  /// Coordinates are read with given stride, so interleaved arrays can be used directly.
+  /// NOTE results are equal to scalar version unless compiler fuses multiply and add.
+  static void perlin2D(const double *x, const double *y, double *result, std::size_t count,
+                       double frequency, std::size_t stride = 1);
+
+  /// Calculates perlin 3D noise for count points using SIMD instructions if available.
+  static void perlin3D(const double *x, const double *y, const double *z, double *result, std::size_t count,
+                       double frequency, std::size_t stride = 1);
+
  private:
 
   static double dot(const utymap::math::Vector3 &g, double x, double y, double z) {
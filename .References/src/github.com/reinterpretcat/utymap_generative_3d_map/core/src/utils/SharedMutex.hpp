@@ -0,0 +1,77 @@
+#ifndef UTILS_SHAREDMUTEX_HPP_DEFINED
+#define UTILS_SHAREDMUTEX_HPP_DEFINED
+
+#include <condition_variable>
+#include <mutex>
+
+namespace utymap {
+namespace utils {
+
+/// Readers-writer lock: many readers or one writer. Waiting writer blocks new readers,
+/// so writers are not starved. Satisfies Lockable, so std::lock_guard and std::unique_lock
+/// take it exclusively; use SharedLock to take it for reading.
+class SharedMutex final {
+ public:
+  SharedMutex() : readers_(0), isWriting_(false), waitingWriters_(0) {}
+
+  SharedMutex(const SharedMutex &) = delete;
+  SharedMutex &operator=(const SharedMutex &) = delete;
+
+  void lock() {
+    std::unique_lock<std::mutex> lock(lock_);
+    ++waitingWriters_;
+    writerCondition_.wait(lock, [&]() { return !isWriting_ && readers_==0; });
+    --waitingWriters_;
+    isWriting_ = true;
+  }
+
+  void unlock() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      isWriting_ = false;
+    }
+    writerCondition_.notify_one();
+    readerCondition_.notify_all();
+  }
+
+  void lock_shared() {
+    std::unique_lock<std::mutex> lock(lock_);
+    readerCondition_.wait(lock, [&]() { return !isWriting_ && waitingWriters_==0; });
+    ++readers_;
+  }
+
+  void unlock_shared() {
+    bool isLast;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      isLast = --readers_==0;
+    }
+    if (isLast) writerCondition_.notify_one();
+  }
+
+ private:
+  std::mutex lock_;
+  std::condition_variable readerCondition_;
+  std::condition_variable writerCondition_;
+  std::size_t readers_;
+  bool isWriting_;
+  std::size_t waitingWriters_;
+};
+
+/// Holds shared mutex for reading until destroyed.
+class SharedLock final {
+ public:
+  explicit SharedLock(SharedMutex &mutex) : mutex_(mutex) { mutex_.lock_shared(); }
+
+  ~SharedLock() { mutex_.unlock_shared(); }
+
+  SharedLock(const SharedLock &) = delete;
+  SharedLock &operator=(const SharedLock &) = delete;
+
+ private:
+  SharedMutex &mutex_;
+};
+
+}
+}
+#endif // UTILS_SHAREDMUTEX_HPP_DEFINED
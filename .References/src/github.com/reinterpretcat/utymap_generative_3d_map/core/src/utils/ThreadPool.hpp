@@ -0,0 +1,122 @@
+#ifndef UTILS_THREADPOOL_HPP_DEFINED
+#define UTILS_THREADPOOL_HPP_DEFINED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utymap {
+namespace utils {
+
+/// Work stealing thread pool: every worker has own queue and takes tasks from
+/// other queues when own is empty. Tasks are taken from queue front, so tasks
+/// enqueued earlier are started earlier.
+class ThreadPool final {
+  /// Task queue of single worker.
+  struct WorkQueue final {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+ public:
+  explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency()) :
+      pending_(0), stopped_(false), next_(0) {
+    threadCount = std::max<std::size_t>(threadCount, 1);
+    for (std::size_t i = 0; i < threadCount; ++i)
+      queues_.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    for (std::size_t i = 0; i < threadCount; ++i)
+      workers_.push_back(std::thread(&ThreadPool::run, this, i));
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /// Finishes all pending tasks and stops workers.
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      stopped_ = true;
+    }
+    condition_.notify_all();
+    for (auto &worker : workers_)
+      worker.join();
+  }
+
+  /// Enqueues task for execution. Exceptions are propagated through returned future.
+  std::future<void> enqueue(std::function<void()> task) {
+    auto packagedTask = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    auto future = packagedTask->get_future();
+
+    auto &queue = *queues_[next_++%queues_.size()];
+    {
+      std::lock_guard<std::mutex> lock(queue.lock);
+      queue.tasks.push_back([packagedTask]() { (*packagedTask)(); });
+    }
+    // NOTE counter is increased after task is queued, so a worker which claims task always finds one.
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      ++pending_;
+    }
+    condition_.notify_one();
+
+    return future;
+  }
+
+  /// Returns amount of worker threads.
+  std::size_t size() const {
+    return workers_.size();
+  }
+
+ private:
+  /// Sleeps until there is a queued task, claims it and runs.
+  void run(std::size_t index) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(lock_);
+        condition_.wait(lock, [&]() { return stopped_ || pending_ > 0; });
+        if (pending_==0)
+          return;
+        --pending_;
+      }
+      pop(index)();
+    }
+  }
+
+  /// Takes claimed task from own queue or steals it from others.
+  std::function<void()> pop(std::size_t index) {
+    while (true) {
+      for (std::size_t i = 0; i < queues_.size(); ++i) {
+        auto &queue = *queues_[(index + i)%queues_.size()];
+        std::lock_guard<std::mutex> queueLock(queue.lock);
+        if (queue.tasks.empty())
+          continue;
+
+        auto task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return task;
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex lock_;
+  std::condition_variable condition_;
+  /// Amount of queued tasks which are not claimed by workers.
+  std::size_t pending_;
+  bool stopped_;
+
+  std::atomic<std::size_t> next_;
+};
+
+}
+}
+#endif // UTILS_THREADPOOL_HPP_DEFINED
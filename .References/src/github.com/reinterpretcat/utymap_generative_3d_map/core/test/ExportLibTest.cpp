@@ -81,6 +81,65 @@ BOOST_AUTO_TEST_CASE(GivenNaturalEarthTestData_WhenAllQuadKeysAreLoadedAtZoomOne
   loadQuadKeys(1, 0, 1, 0, 1, NaturalEarthMapcss);
 }
 
+BOOST_AUTO_TEST_CASE(GivenNaturalEarthTestData_WhenAllQuadKeysAreLoadedConcurrently_ThenCallbacksAreCalled) {
+  ::addToStoreInRange(InMemoryStoreKey, NaturalEarthMapcss, TEST_SHAPE_NE_110M_LAND, 1, 1, callback);
+  ::addToStoreInRange(InMemoryStoreKey, NaturalEarthMapcss, TEST_SHAPE_NE_110M_POPULATED_PLACES, 1, 1, callback);
+  const std::vector<int> tags = {0, 1, 2, 3};
+  const std::vector<int> quadKeys = {0, 0, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1};
+  std::vector<utymap::CancellationToken> tokens(4);
+  std::vector<utymap::CancellationToken *> tokenPtrs = {&tokens[0], &tokens[1], &tokens[2], &tokens[3]};
+  isCalled = false;
+
+  ::loadQuadKeys(tags.data(), NaturalEarthMapcss, quadKeys.data(), 4, 10, 10, 0,
+                 [](int tag,
+                    const char *name,
+                    const double *vertices, int vertexCount,
+                    const int *triangles, int triCount,
+                    const int *colors, int colorCount,
+                    const double *uvs, int uvCount,
+                    const int *uvMap, int uvMapCount) {
+                   isCalled = true;
+                   BOOST_CHECK_GT(vertexCount, 0);
+                   BOOST_CHECK_GT(triCount, 0);
+                 },
+                 [](int tag, uint64_t id, const char **tags, int size, const double *vertices,
+                    int vertexCount, const char **style, int styleSize) {
+                   isCalled = true;
+                 },
+                 [](const char *message) {
+                   BOOST_FAIL(message);
+                 }, tokenPtrs.data());
+
+  BOOST_CHECK(isCalled);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNaturalEarthTestData_WhenQuadKeyIsLoadedInCompactForm_ThenCallbacksAreCalled) {
+  ::addToStoreInRange(InMemoryStoreKey, NaturalEarthMapcss, TEST_SHAPE_NE_110M_LAND, 1, 1, callback);
+  utymap::CancellationToken cancelToken;
+  isCalled = false;
+
+  ::loadQuadKeyCompact(0, NaturalEarthMapcss, 1, 0, 1, 0,
+                       [](int tag,
+                          const char *name,
+                          double originX, double originY,
+                          const void *vertices, int vertexCount,
+                          const void *indices, int indexCount, int indexSize,
+                          const int *uvMap, int uvMapCount) {
+                         isCalled = true;
+                         BOOST_CHECK_GT(vertexCount, 0);
+                         BOOST_CHECK_GT(indexCount, 0);
+                         BOOST_CHECK(indexSize==2 || indexSize==4);
+                       },
+                       [](int tag, uint64_t id, const char **tags, int size, const double *vertices,
+                          int vertexCount, const char **style, int styleSize) {
+                       },
+                       [](const char *message) {
+                         BOOST_FAIL(message);
+                       }, &cancelToken);
+
+  BOOST_CHECK(isCalled);
+}
+
 BOOST_AUTO_TEST_CASE(GivenTestData_WhenQuadKeysAreLoadedAtBirdEyeZoomLevel_ThenCallbacksAreCalled) {
   ::addToStoreInQuadKey(InMemoryStoreKey, TEST_MAPCSS_DEFAULT, TEST_JSON_2_FILE, 8800, 5373, 14, callback);
 
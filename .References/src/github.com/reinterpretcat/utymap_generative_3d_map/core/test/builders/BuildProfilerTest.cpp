@@ -0,0 +1,159 @@
+#include "builders/BuildProfiler.hpp"
+#include "builders/ElementBuilder.hpp"
+#include "builders/QuadKeyBuilder.hpp"
+#include "entities/Way.hpp"
+#include "index/GeoStore.hpp"
+#include "index/InMemoryElementStore.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+using namespace utymap;
+using namespace utymap::builders;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::math;
+using namespace utymap::tests;
+
+namespace {
+const QuadKey quadKey = QuadKey(1, 0, 0);
+const std::string stylesheet = "way|z1[test=Foo] { builder: test; clip: false; }";
+
+/// Emits one triangle per visited way.
+class TestBuilder final : public ElementBuilder {
+ public:
+  explicit TestBuilder(const BuilderContext &context) : ElementBuilder(context) {}
+
+  void visitNode(const Node &) override {}
+  void visitArea(const Area &) override {}
+  void visitRelation(const Relation &) override {}
+
+  void visitWay(const Way &) override {
+    Mesh mesh("test");
+    mesh.vertices = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    mesh.triangles = {0, 1, 2};
+    context_.meshCallback(mesh);
+  }
+};
+
+Mesh createMesh() {
+  Mesh mesh("test");
+  mesh.vertices = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+  mesh.triangles = {0, 1, 2};
+  mesh.colors = {0, 0, 0};
+  return mesh;
+}
+
+struct Builders_BuildProfilerFixture {
+  DependencyProvider dependencyProvider;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Builders_BuildProfiler, Builders_BuildProfilerFixture)
+
+BOOST_AUTO_TEST_CASE(GivenNestedScopes_WhenProfiled_ThenSelfTimeExcludesNestedStages) {
+  BuildProfile profile(quadKey, false);
+  {
+    BuildProfile::Scope outer(&profile, "outer");
+    profile.addElements(2);
+    for (int i = 0; i < 3; ++i) {
+      BuildProfile::Scope inner(&profile, "inner");
+      profile.addMesh(createMesh());
+    }
+  }
+
+  const auto &outer = profile.getStatistics().at("outer");
+  const auto &inner = profile.getStatistics().at("inner");
+  BOOST_CHECK_EQUAL(outer.calls, 1);
+  BOOST_CHECK_EQUAL(outer.elements, 2);
+  BOOST_CHECK_EQUAL(outer.triangles, 0);
+  BOOST_CHECK_EQUAL(inner.calls, 3);
+  BOOST_CHECK_EQUAL(inner.triangles, 3);
+  BOOST_CHECK_EQUAL(inner.bytes, 3*(9*sizeof(double) + 6*sizeof(int)));
+  BOOST_CHECK_GE(outer.totalTime, inner.totalTime);
+  BOOST_CHECK_CLOSE(outer.selfTime + inner.totalTime, outer.totalTime, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNullProfile_WhenScopeIsUsed_ThenNothingHappens) {
+  BuildProfile::Scope scope(nullptr, "stage");
+}
+
+BOOST_AUTO_TEST_CASE(GivenProfiles_WhenMerged_ThenStatisticsAreAggregated) {
+  BuildProfiler profiler;
+  for (int i = 0; i < 2; ++i) {
+    BuildProfile profile(quadKey, profiler.isTraceEnabled());
+    {
+      BuildProfile::Scope scope(&profile, "stage");
+      profile.addElements(5);
+    }
+    profiler.merge(profile);
+  }
+
+  auto statistics = profiler.getStatistics();
+  BOOST_CHECK_EQUAL(profiler.getBuildCount(), 2);
+  BOOST_CHECK_EQUAL(statistics.at("stage").calls, 2);
+  BOOST_CHECK_EQUAL(statistics.at("stage").elements, 10);
+
+  profiler.reset();
+  BOOST_CHECK_EQUAL(profiler.getBuildCount(), 0);
+  BOOST_CHECK(profiler.getStatistics().empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenTraceEnabled_WhenTraceIsWritten_ThenValidChromeTraceIsProduced) {
+  BuildProfiler profiler(true);
+  BuildProfile profile(quadKey, profiler.isTraceEnabled());
+  {
+    BuildProfile::Scope outer(&profile, "outer");
+    BuildProfile::Scope inner(&profile, "in\"ner");
+  }
+  profiler.merge(profile);
+  std::stringstream stream;
+
+  profiler.writeTrace(stream);
+
+  boost::property_tree::ptree tree;
+  boost::property_tree::read_json(stream, tree);
+  const auto &events = tree.get_child("traceEvents");
+  BOOST_REQUIRE_EQUAL(events.size(), 2);
+  BOOST_CHECK_EQUAL(events.front().second.get<std::string>("name"), "in\"ner");
+  BOOST_CHECK_EQUAL(events.front().second.get<std::string>("ph"), "X");
+  BOOST_CHECK_EQUAL(events.front().second.get<std::string>("args.quadKey"), "1/0/0");
+  BOOST_CHECK_EQUAL(events.back().second.get<std::string>("name"), "outer");
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadKeyBuilderWithProfiler_WhenBuild_ThenStagesAreReported) {
+  auto &stringTable = *dependencyProvider.getStringTable();
+  auto &styleProvider = *dependencyProvider.getStyleProvider(stylesheet);
+  GeoStore geoStore(stringTable);
+  geoStore.registerStore("test", utymap::utils::make_unique<InMemoryElementStore>(stringTable));
+  geoStore.add("test", ElementUtils::createElement<Way>(stringTable, 1, {{"test", "Foo"}}, {{10, -10}, {20, -20}}),
+               LodRange(1, 1), styleProvider);
+  QuadKeyBuilder quadKeyBuilder(geoStore, stringTable);
+  quadKeyBuilder.registerElementBuilder("test", [](const BuilderContext &context) {
+    return utymap::utils::make_unique<TestBuilder>(context);
+  });
+  auto profiler = std::make_shared<BuildProfiler>();
+  quadKeyBuilder.setProfiler(profiler);
+  int meshes = 0;
+
+  quadKeyBuilder.build(quadKey, styleProvider, *dependencyProvider.getElevationProvider(),
+                       [&](const Mesh &) { ++meshes; }, [](const Element &) {},
+                       dependencyProvider.getCancellationToken());
+
+  auto statistics = profiler->getStatistics();
+  BOOST_CHECK_EQUAL(meshes, 1);
+  BOOST_CHECK_EQUAL(profiler->getBuildCount(), 1);
+  BOOST_CHECK_EQUAL(statistics.at("search").elements, 1);
+  BOOST_CHECK_EQUAL(statistics.at("style").elements, 1);
+  BOOST_CHECK_EQUAL(statistics.at("test").elements, 1);
+  BOOST_CHECK_EQUAL(statistics.at("test").triangles, 1);
+  BOOST_CHECK_EQUAL(statistics.at("meshCallback").calls, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,10 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+#include <fstream>
+#include <thread>
+
 #include "test_utils/DependencyProvider.hpp"
 #include "test_utils/ElementUtils.hpp"
 
@@ -80,8 +84,21 @@ struct Builders_MeshCacheFixture {
   }
 
   ~Builders_MeshCacheFixture() {
-    auto filePath = getCacheDir(*dependencyProvider.getStyleProvider()) + "/0.mesh";
-    boost::filesystem::remove(filePath);
+    boost::filesystem::remove(getFilePath());
+  }
+
+  std::string getFilePath() {
+    return getCacheDir(*dependencyProvider.getStyleProvider()) + "/0.mesh";
+  }
+
+  Mesh createMesh() const {
+    Mesh mesh("My mesh");
+    mesh.vertices.assign({1, 2, 3, 4.5, 5.555555, 6.6666666});
+    mesh.triangles.assign({1, 2, 3, 4});
+    mesh.colors.assign({4, 3, 2, 1});
+    mesh.uvs.assign({0.1, 0.2, 0.3, 0.4});
+    mesh.uvMap.assign({1, 2, 3});
+    return mesh;
   }
 
   void assertStoreAndFetch(const Element &element) {
@@ -175,14 +192,76 @@ BOOST_AUTO_TEST_CASE(GivenRelation_WhenStoreAndFetch_ThenItIsStoredAndReadBack)
 }
 
 BOOST_AUTO_TEST_CASE(GivenMesh_WhenStoreAndFetch_ThenItIsStoredAndReadBack) {
-  Mesh mesh("My mesh");
-  mesh.vertices.assign({1, 2, 3, 4.5, 5.555555, 6.6666666});
-  mesh.triangles.assign({1, 2, 3, 4});
-  mesh.colors.assign({4, 3, 2, 1});
-  mesh.uvs.assign({0.1, 0.2, 0.3, 0.4});
-  mesh.uvMap.assign({1, 2, 3});
-
-  assertStoreAndFetch(mesh);
+  assertStoreAndFetch(createMesh());
+}
+
+BOOST_AUTO_TEST_CASE(GivenCacheIsBeingWritten_WhenFetch_ThenReturnsFalse) {
+  wrapContext.meshCallback(createMesh());
+
+  BOOST_CHECK(!cache_.fetch(origContext));
+
+  cache_.unwrap(wrapContext);
+  BOOST_CHECK(cache_.fetch(origContext));
+}
+
+BOOST_AUTO_TEST_CASE(GivenCorruptedCacheFile_WhenFetch_ThenReturnsFalseAndFileIsRemoved) {
+  wrapContext.meshCallback(createMesh());
+  cache_.unwrap(wrapContext);
+  {
+    std::fstream file(getFilePath(), std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(-1, std::ios::end);
+    file.put('x');
+  }
+  resetData();
+
+  BOOST_CHECK(!cache_.fetch(origContext));
+  BOOST_CHECK_EQUAL(lastMesh_.name, "");
+  BOOST_CHECK(!boost::filesystem::exists(getFilePath()));
+}
+
+BOOST_AUTO_TEST_CASE(GivenFetchedCacheFile_WhenFetchAgain_ThenDataIsNotCheckedAgain) {
+  wrapContext.meshCallback(createMesh());
+  cache_.unwrap(wrapContext);
+  BOOST_CHECK(cache_.fetch(origContext));
+  {
+    // NOTE corrupts checksum only, so records are still readable.
+    std::fstream file(getFilePath(), std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(16, std::ios::beg);
+    file.put('x');
+  }
+  resetData();
+
+  BOOST_CHECK(cache_.fetch(origContext));
+  assertMesh(createMesh());
+  BOOST_CHECK(!MeshCache("", "mesh").fetch(origContext));
+}
+
+BOOST_AUTO_TEST_CASE(GivenCacheFileCreatedByOtherInstance_WhenFetch_ThenItIsReadBack) {
+  wrapContext.meshCallback(createMesh());
+  cache_.unwrap(wrapContext);
+  resetData();
+  MeshCache otherCache("", "mesh");
+
+  BOOST_CHECK(otherCache.fetch(origContext));
+  assertMesh(createMesh());
+}
+
+BOOST_AUTO_TEST_CASE(GivenCompleteCache_WhenFetchConcurrently_ThenAllReadersGetData) {
+  wrapContext.meshCallback(createMesh());
+  cache_.unwrap(wrapContext);
+  std::atomic<int> meshCount(0);
+  BuilderContext countContext(quadKey, origContext.styleProvider, origContext.stringTable, origContext.eleProvider,
+                              [&](const Mesh &mesh) { if (mesh.vertices.size()==6) ++meshCount; },
+                              [](const Element &) {}, origContext.cancelToken);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; ++i)
+    readers.push_back(std::thread([&]() {
+      for (int j = 0; j < 10; ++j) cache_.fetch(countContext);
+    }));
+  for (auto &reader : readers) reader.join();
+
+  BOOST_CHECK_EQUAL(meshCount.load(), 80);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
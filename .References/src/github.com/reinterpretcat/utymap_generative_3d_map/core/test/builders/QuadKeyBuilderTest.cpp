@@ -0,0 +1,137 @@
+#include "builders/ElementBuilder.hpp"
+#include "builders/QuadKeyBuilder.hpp"
+#include "entities/Way.hpp"
+#include "index/GeoStore.hpp"
+#include "index/InMemoryElementStore.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+using namespace utymap;
+using namespace utymap::builders;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::math;
+using namespace utymap::tests;
+using namespace utymap::utils;
+
+namespace {
+const QuadKey quadKey = QuadKey(1, 0, 0);
+const std::string stylesheet = "way|z1[test=Foo] { builder: test; clip: false; }"
+                               "way|z1[test=Bar] { builder: serial; clip: false; }";
+const std::size_t ElementCount = 500;
+
+/// Emits mesh named after element id and remembers threads it was called from.
+class TestBuilder final : public ElementBuilder {
+ public:
+  TestBuilder(const BuilderContext &context, std::set<std::thread::id> &threads, std::mutex &lock) :
+      ElementBuilder(context), threads_(threads), lock_(lock) {}
+
+  void visitNode(const Node &) override {}
+  void visitArea(const Area &) override {}
+  void visitRelation(const Relation &) override {}
+
+  void visitWay(const Way &way) override {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      threads_.insert(std::this_thread::get_id());
+    }
+    Mesh mesh(std::to_string(way.id));
+    mesh.vertices = {way.coordinates[0].longitude, way.coordinates[0].latitude, 0};
+    context_.meshCallback(mesh);
+  }
+
+ private:
+  std::set<std::thread::id> &threads_;
+  std::mutex &lock_;
+};
+
+struct Builders_QuadKeyBuilderFixture {
+  Builders_QuadKeyBuilderFixture() :
+      geoStore(*dependencyProvider.getStringTable()),
+      quadKeyBuilder(geoStore, *dependencyProvider.getStringTable()) {
+    auto &stringTable = *dependencyProvider.getStringTable();
+    auto &styleProvider = *dependencyProvider.getStyleProvider(stylesheet);
+    geoStore.registerStore("test", utymap::utils::make_unique<InMemoryElementStore>(stringTable));
+    for (std::size_t i = 1; i <= ElementCount; ++i) {
+      double coordinate = 1 + i*0.1;
+      geoStore.add("test", ElementUtils::createElement<Way>(stringTable, i, {{"test", i%10==0 ? "Bar" : "Foo"}},
+                                                            {{coordinate, -coordinate}, {coordinate, -coordinate - 1}}),
+                   LodRange(1, 1), styleProvider);
+    }
+  }
+
+  void registerBuilders(bool isParallel) {
+    auto factory = [&](const BuilderContext &context) {
+      return utymap::utils::make_unique<TestBuilder>(context, threads, lock);
+    };
+    quadKeyBuilder.registerElementBuilder("test", factory, isParallel);
+    quadKeyBuilder.registerElementBuilder("serial", factory);
+  }
+
+  std::vector<std::string> build() {
+    std::vector<std::string> meshes;
+    quadKeyBuilder.build(quadKey, *dependencyProvider.getStyleProvider(),
+                         *dependencyProvider.getElevationProvider(),
+                         [&](const Mesh &mesh) { meshes.push_back(mesh.name); }, [](const Element &) {},
+                         dependencyProvider.getCancellationToken());
+    return meshes;
+  }
+
+  DependencyProvider dependencyProvider;
+  GeoStore geoStore;
+  QuadKeyBuilder quadKeyBuilder;
+  std::set<std::thread::id> threads;
+  std::mutex lock;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Builders_QuadKeyBuilder, Builders_QuadKeyBuilderFixture)
+
+BOOST_AUTO_TEST_CASE(GivenSerialBuilders_WhenBuild_ThenAllElementsAreBuiltOnCallingThread) {
+  registerBuilders(false);
+
+  auto meshes = build();
+
+  BOOST_CHECK_EQUAL(meshes.size(), ElementCount);
+  BOOST_CHECK_EQUAL(threads.size(), 1);
+  BOOST_CHECK(*threads.begin()==std::this_thread::get_id());
+}
+
+BOOST_AUTO_TEST_CASE(GivenParallelBuilder_WhenBuildWithDifferentThreadPools_ThenOutputIsTheSame) {
+  registerBuilders(true);
+  auto expected = build();
+  ThreadPool singleThreadPool(1), threadPool(4);
+
+  quadKeyBuilder.setThreadPool(&singleThreadPool);
+  auto singleThreadMeshes = build();
+  quadKeyBuilder.setThreadPool(&threadPool);
+  auto meshes = build();
+
+  BOOST_CHECK_EQUAL(expected.size(), ElementCount);
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), singleThreadMeshes.begin(), singleThreadMeshes.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), meshes.begin(), meshes.end());
+}
+
+BOOST_AUTO_TEST_CASE(GivenParallelBuilder_WhenBuildIsRunByTheSameThreadPool_ThenItDoesNotDeadlock) {
+  registerBuilders(true);
+  ThreadPool threadPool(2);
+  quadKeyBuilder.setThreadPool(&threadPool);
+  std::vector<std::future<void>> results;
+
+  std::vector<std::vector<std::string>> meshes(4);
+  for (std::size_t i = 0; i < meshes.size(); ++i)
+    results.push_back(threadPool.enqueue([&, i]() { meshes[i] = build(); }));
+  for (auto &result : results)
+    result.get();
+
+  for (const auto &buildMeshes : meshes)
+    BOOST_CHECK_EQUAL(buildMeshes.size(), ElementCount);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
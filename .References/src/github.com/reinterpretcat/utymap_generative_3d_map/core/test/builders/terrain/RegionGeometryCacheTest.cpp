@@ -0,0 +1,115 @@
+#include "builders/terrain/RegionGeometryCache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace ClipperLib;
+using namespace utymap;
+using namespace utymap::builders;
+
+namespace {
+const std::size_t CacheSize = 1024*1024;
+
+RegionGeometryCache::Key createKey(double area, cInt offset = 0) {
+  Path path = {IntPoint(offset, 0), IntPoint(offset + 10, 0), IntPoint(offset + 10, 10), IntPoint(offset, 10)};
+  return RegionGeometryCache::Key{QuadKey(16, 35205, 21489), 0.01, area, 1, Paths{path}};
+}
+
+std::shared_ptr<const RegionGeometryCache::Entry> createEntry(int pointCount) {
+  auto entry = std::make_shared<RegionGeometryCache::Entry>();
+  entry->triangulation.points.resize(static_cast<std::size_t>(pointCount*2));
+  return entry;
+}
+
+/// Returns size which is used by given entry stored in cache.
+std::size_t getSize(const RegionGeometryCache::Key &key, const std::shared_ptr<const RegionGeometryCache::Entry> &entry) {
+  RegionGeometryCache cache(CacheSize);
+  cache.put(key, entry);
+  return cache.size();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(Builders_Terrain_RegionGeometryCache)
+
+BOOST_AUTO_TEST_CASE(GivenStoredEntry_WhenGetWithSameKey_ThenReturnsEntry) {
+  RegionGeometryCache cache(CacheSize);
+  auto entry = createEntry(3);
+
+  cache.put(createKey(1), entry);
+
+  BOOST_CHECK(cache.get(createKey(1))==entry);
+  BOOST_CHECK_GT(cache.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredEntry_WhenGetWithDifferentKey_ThenReturnsNull) {
+  RegionGeometryCache cache(CacheSize);
+
+  cache.put(createKey(1), createEntry(3));
+
+  BOOST_CHECK(cache.get(createKey(2))==nullptr);
+  BOOST_CHECK(cache.get(createKey(1, 5))==nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(GivenFullCache_WhenPut_ThenLeastRecentlyUsedEntryIsEvicted) {
+  auto entry = createEntry(100);
+  RegionGeometryCache cache(getSize(createKey(1), entry)*2);
+  cache.put(createKey(1), entry);
+  cache.put(createKey(2), entry);
+  cache.get(createKey(1));
+
+  cache.put(createKey(3), entry);
+
+  BOOST_CHECK(cache.get(createKey(1))!=nullptr);
+  BOOST_CHECK(cache.get(createKey(2))==nullptr);
+  BOOST_CHECK(cache.get(createKey(3))!=nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(GivenBigEntry_WhenPut_ThenItIsEvictedBySize) {
+  auto smallEntry = createEntry(10);
+  RegionGeometryCache cache(getSize(createKey(1), smallEntry)*3);
+  cache.put(createKey(1), smallEntry);
+  cache.put(createKey(2), smallEntry);
+
+  cache.put(createKey(3), createEntry(10000));
+
+  BOOST_CHECK(cache.get(createKey(1))!=nullptr);
+  BOOST_CHECK(cache.get(createKey(2))!=nullptr);
+  BOOST_CHECK(cache.get(createKey(3))==nullptr);
+  BOOST_CHECK_LE(cache.size(), getSize(createKey(1), smallEntry)*3);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredEntries_WhenSetSmallerMaxSize_ThenEntriesAreEvicted) {
+  auto entry = createEntry(100);
+  std::size_t entrySize = getSize(createKey(1), entry);
+  RegionGeometryCache cache(CacheSize);
+  cache.put(createKey(1), entry);
+  cache.put(createKey(2), entry);
+
+  cache.setMaxSize(entrySize);
+
+  BOOST_CHECK(cache.get(createKey(1))==nullptr);
+  BOOST_CHECK(cache.get(createKey(2))!=nullptr);
+  BOOST_CHECK_EQUAL(cache.size(), entrySize);
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredEntries_WhenClear_ThenCacheIsEmpty) {
+  RegionGeometryCache cache(CacheSize);
+  cache.put(createKey(1), createEntry(3));
+  cache.put(createKey(2), createEntry(3));
+
+  cache.clear();
+
+  BOOST_CHECK_EQUAL(cache.size(), 0);
+  BOOST_CHECK(cache.get(createKey(1))==nullptr);
+  BOOST_CHECK(cache.get(createKey(2))==nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(GivenZeroSize_WhenPut_ThenNothingIsStored) {
+  RegionGeometryCache cache(0);
+
+  cache.put(createKey(1), createEntry(3));
+
+  BOOST_CHECK_EQUAL(cache.size(), 0);
+  BOOST_CHECK(cache.get(createKey(1))==nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
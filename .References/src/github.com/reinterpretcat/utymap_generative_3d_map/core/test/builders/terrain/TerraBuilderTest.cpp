@@ -1,5 +1,6 @@
 #include "QuadKey.hpp"
 #include "builders/BuilderContext.hpp"
+#include "builders/terrain/RegionGeometryCache.hpp"
 #include "builders/terrain/TerraBuilder.hpp"
 #include "entities/Way.hpp"
 #include "entities/Area.hpp"
@@ -28,16 +29,20 @@ const std::string stylesheet =
 struct Builders_Terrain_TerraBuilderFixture {
   DependencyProvider dependencyProvider;
   std::unique_ptr<BuilderContext> context = nullptr;
+  CancellationToken cancelToken;
 
   std::unique_ptr<TerraBuilder> create(const QuadKey &quadKey,
-                                       std::function<void(const utymap::math::Mesh &)> meshCallback) {
+                                       std::function<void(const utymap::math::Mesh &)> meshCallback,
+                                       RegionGeometryCache *geometryCache = nullptr) {
     context = utymap::utils::make_unique<BuilderContext>(quadKey,
                                                          *dependencyProvider.getStyleProvider(stylesheet),
                                                          *dependencyProvider.getStringTable(),
                                                          *dependencyProvider.getElevationProvider(),
                                                          meshCallback,
                                                          nullptr,
-                                                         CancellationToken());
+                                                         cancelToken,
+                                                         nullptr,
+                                                         geometryCache);
     return utymap::utils::make_unique<TerraBuilder>(*context);
   }
 };
@@ -63,4 +68,29 @@ BOOST_AUTO_TEST_CASE(GivenArea_WhenComplete_ThenSurfaceMeshIsNotEmpty) {
   BOOST_CHECK(isCalled);
 }
 
+BOOST_AUTO_TEST_CASE(GivenGeometryCache_WhenBuildSameAreaTwice_ThenGeometryIsReused) {
+  RegionGeometryCache cache(1024*1024);
+  std::vector<std::pair<std::size_t, std::size_t>> meshSizes;
+  auto build = [&]() {
+    auto terraBuilder = create(QuadKey(1, 0, 0), [&](const Mesh &mesh) {
+      if (mesh.name=="terrain_surface") meshSizes.emplace_back(mesh.vertices.size(), mesh.triangles.size());
+    }, &cache);
+    ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 0,
+                                      {{"landuse", "commercial"}},
+                                      {{0, 0}, {20, 0}, {20, 20}, {0, 20}})
+        .accept(*terraBuilder);
+    terraBuilder->complete();
+  };
+
+  build();
+  std::size_t cacheSize = cache.size();
+  build();
+
+  BOOST_CHECK_GT(cacheSize, 0);
+  BOOST_CHECK_EQUAL(cache.size(), cacheSize);
+  BOOST_REQUIRE_EQUAL(meshSizes.size(), 2);
+  BOOST_CHECK_GT(meshSizes[0].second, 0);
+  BOOST_CHECK(meshSizes[0]==meshSizes[1]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
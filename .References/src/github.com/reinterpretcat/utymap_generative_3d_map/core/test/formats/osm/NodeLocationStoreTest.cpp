@@ -0,0 +1,52 @@
+#include "formats/osm/NodeLocationStore.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace utymap;
+using namespace utymap::formats;
+
+namespace {
+void assertLocations(NodeLocationStore::Type type) {
+  NodeLocationStore store(type);
+  store.add(30, GeoCoordinate(52.5271274, 13.3870120));
+  store.add(10, GeoCoordinate(-33.8688197, -151.2092955));
+  store.add(20000000, GeoCoordinate(0, 0));
+
+  GeoCoordinate coordinate;
+  BOOST_CHECK(store.get(30, coordinate));
+  BOOST_CHECK_EQUAL(coordinate.latitude, 52.5271274);
+  BOOST_CHECK_EQUAL(coordinate.longitude, 13.3870120);
+  BOOST_CHECK(store.get(10, coordinate));
+  BOOST_CHECK_EQUAL(coordinate.latitude, -33.8688197);
+  BOOST_CHECK_EQUAL(coordinate.longitude, -151.2092955);
+  BOOST_CHECK(store.get(20000000, coordinate));
+  BOOST_CHECK_EQUAL(coordinate.latitude, 0);
+  BOOST_CHECK_EQUAL(coordinate.longitude, 0);
+  BOOST_CHECK(!store.get(20, coordinate));
+  BOOST_CHECK(!store.get(40000000, coordinate));
+  BOOST_CHECK_EQUAL(store.size(), 3);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(Formats_Osm_NodeLocationStore)
+
+BOOST_AUTO_TEST_CASE(GivenUnsortedLocations_WhenGetFromSparseStore_ThenReturnsStoredLocations) {
+  assertLocations(NodeLocationStore::Type::Sparse);
+}
+
+BOOST_AUTO_TEST_CASE(GivenUnsortedLocations_WhenGetFromDenseStore_ThenReturnsStoredLocations) {
+  assertLocations(NodeLocationStore::Type::Dense);
+}
+
+BOOST_AUTO_TEST_CASE(GivenDuplicatedId_WhenGetFromSparseStore_ThenReturnsLastLocation) {
+  NodeLocationStore store(NodeLocationStore::Type::Sparse);
+  store.add(2, GeoCoordinate(1, 1));
+  store.add(1, GeoCoordinate(2, 2));
+  store.add(2, GeoCoordinate(3, 3));
+
+  GeoCoordinate coordinate;
+  BOOST_CHECK(store.get(2, coordinate));
+  BOOST_CHECK_EQUAL(coordinate.latitude, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,10 +1,16 @@
+#include "entities/Node.hpp"
 #include "entities/Relation.hpp"
+#include "entities/Way.hpp"
 #include "formats/osm/OsmDataVisitor.hpp"
+#include "formats/osm/xml/OsmXmlParser.hpp"
+#include "config.hpp"
 
 #include <boost/test/unit_test.hpp>
 
 #include "test_utils/DependencyProvider.hpp"
 
+#include <fstream>
+
 using namespace utymap::entities;
 using namespace utymap::formats;
 using namespace utymap::tests;
@@ -37,4 +43,88 @@ BOOST_AUTO_TEST_CASE(GivenRelationWithRecursion_WhenComplete_ThenDoesNotCrash) {
   visitor.complete();
 }
 
+BOOST_AUTO_TEST_CASE(GivenWayWithMissingNode_WhenVisitWay_ThenMissingNodeIsSkipped) {
+  std::vector<Way> ways;
+  OsmDataVisitor wayVisitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+    if (auto way = dynamic_cast<Way *>(&element)) ways.push_back(*way);
+    return true;
+  });
+  Tags tags = {};
+  utymap::GeoCoordinate coordinate1(1, 1), coordinate2(2, 2);
+  std::vector<std::uint64_t> nodeIds = {1, 3, 2};
+
+  wayVisitor.visitNode(1, coordinate1, tags);
+  wayVisitor.visitNode(2, coordinate2, tags);
+  wayVisitor.visitWay(10, nodeIds, tags);
+  wayVisitor.complete();
+
+  BOOST_CHECK_EQUAL(ways.size(), 1);
+  BOOST_CHECK_EQUAL(ways[0].coordinates.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenWayWithOneResolvedNode_WhenComplete_ThenWayIsNotReported) {
+  std::vector<Way> ways;
+  OsmDataVisitor wayVisitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+    if (auto way = dynamic_cast<Way *>(&element)) ways.push_back(*way);
+    return true;
+  });
+  Tags tags = {};
+  utymap::GeoCoordinate coordinate(1, 1);
+  std::vector<std::uint64_t> nodeIds = {1, 2, 3};
+
+  wayVisitor.visitNode(1, coordinate, tags);
+  wayVisitor.visitWay(10, nodeIds, tags);
+  wayVisitor.complete();
+
+  BOOST_CHECK(ways.empty());
+}
+
+BOOST_AUTO_TEST_CASE(GivenUntaggedNodes_WhenComplete_ThenOnlyRelationMemberIsReported) {
+  std::vector<std::uint64_t> nodeIds;
+  OsmDataVisitor nodeVisitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+    if (dynamic_cast<Node *>(&element)) nodeIds.push_back(element.id);
+    return true;
+  });
+  Tags tags = {};
+  Tags relationTags = {{"type", "route"}};
+  utymap::GeoCoordinate coordinate1(1, 1), coordinate2(2, 2);
+  RelationMembers members = {{2, "n", ""}};
+
+  nodeVisitor.visitNode(1, coordinate1, tags);
+  nodeVisitor.visitNode(2, coordinate2, tags);
+  nodeVisitor.visitRelation(3, members, relationTags);
+  nodeVisitor.complete();
+
+  BOOST_CHECK_EQUAL(nodeIds.size(), 1);
+  BOOST_CHECK_EQUAL(nodeIds[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenXml_WhenTwoPassImport_ThenSameElementsAreReported) {
+  auto parse = [&](const NodeReferenceCollector *references, std::vector<int> &counts) {
+    CountableOsmDataVisitor counter;
+    std::ifstream istream(TEST_XML_FILE);
+    OsmDataVisitor osmVisitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+      element.accept(counter);
+      return true;
+    }, NodeLocationStore::Type::Sparse, references);
+    OsmXmlParser<OsmDataVisitor>().parse(istream, osmVisitor);
+    osmVisitor.complete();
+    counts = {counter.nodes, counter.ways, counter.areas, counter.relations};
+  };
+  NodeReferenceCollector references;
+  std::ifstream istream(TEST_XML_FILE);
+  OsmXmlParser<NodeReferenceCollector>().parse(istream, references);
+  references.complete();
+
+  std::vector<int> onePass, twoPass;
+  parse(nullptr, onePass);
+  parse(&references, twoPass);
+
+  BOOST_CHECK_GT(twoPass[0], 0);
+  BOOST_CHECK_EQUAL(twoPass[0], onePass[0]);
+  BOOST_CHECK_EQUAL(twoPass[1], onePass[1]);
+  BOOST_CHECK_EQUAL(twoPass[2], onePass[2]);
+  BOOST_CHECK_EQUAL(twoPass[3], onePass[3]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+#include "formats/osm/CountableOsmDataVisitor.hpp"
+#include "formats/osm/json/OsmJsonParser.hpp"
+#include "formats/osm/xml/OsmXmlParser.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/test/unit_test.hpp>
+#include "config.hpp"
+#include "test_utils/DependencyProvider.hpp"
+
+#include <fstream>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+using namespace utymap::formats;
+using namespace utymap::tests;
+using namespace utymap::utils;
+
+namespace {
+/// Returns peak resident set size of the process in KB or zero if it is unknown.
+long getPeakRss() {
+#ifdef __linux__
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+#else
+  return 0;
+#endif
+}
+
+std::size_t getFileSize(const std::string &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return static_cast<std::size_t>(file.tellg());
+}
+
+/// Previous json parsing approach used as a baseline: the whole document is read into tree first.
+int parseJsonTree(std::istream &istream) {
+  boost::property_tree::ptree pt;
+  read_json(istream, pt);
+  int count = 0;
+  for (const auto &feature : pt)
+    count += static_cast<int>(pt.get_child(feature.first).get_child("features").size());
+  return count;
+}
+
+struct Formats_Osm_OsmParserBenchmarkFixture {
+  /// Runs parse function several times and reports throughput and peak memory growth.
+  template<typename Function>
+  void run(const std::string &name, const std::string &path, Function parse) {
+    const int iterations = 5;
+    int count = 0;
+    long rss = getPeakRss();
+    auto time = measure<std::chrono::microseconds>::execution([&]() {
+      for (int i = 0; i < iterations; ++i) {
+        std::ifstream istream(path);
+        count = parse(istream);
+      }
+    });
+
+    double megabytes = getFileSize(path)/(1024.*1024.);
+    BOOST_TEST_MESSAGE(name << ": " << count << " elements, " << time/iterations << " us/pass, "
+                            << megabytes*iterations/(time/1E6) << " MB/s, "
+                            << "peak rss growth " << getPeakRss() - rss << " KB");
+  }
+
+  DependencyProvider dependencyProvider;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Formats_Osm_OsmParserBenchmark, Formats_Osm_OsmParserBenchmarkFixture,
+                         *boost::unit_test::disabled())
+
+// NOTE peak rss only grows, so streaming parsers are measured before the baseline.
+BOOST_AUTO_TEST_CASE(GivenTestAssets_WhenParse_ThenReportThroughputAndMemory) {
+  run("xml streaming", TEST_XML_FILE, [&](std::istream &istream) {
+    OsmXmlParser<CountableOsmDataVisitor> parser;
+    CountableOsmDataVisitor visitor;
+    parser.parse(istream, visitor);
+    return visitor.nodes + visitor.ways + visitor.relations;
+  });
+
+  for (const std::string path : {TEST_JSON_FILE, TEST_JSON_2_FILE}) {
+    run("json streaming " + path.substr(path.find_last_of('/') + 1), path, [&](std::istream &istream) {
+      OsmJsonParser<CountableOsmDataVisitor> parser(*dependencyProvider.getStringTable());
+      CountableOsmDataVisitor visitor;
+      parser.parse(istream, visitor);
+      return visitor.nodes + visitor.ways + visitor.areas + visitor.relations;
+    });
+  }
+
+  for (const std::string path : {TEST_JSON_FILE, TEST_JSON_2_FILE}) {
+    run("json tree " + path.substr(path.find_last_of('/') + 1), path, [&](std::istream &istream) {
+      return parseJsonTree(istream);
+    });
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
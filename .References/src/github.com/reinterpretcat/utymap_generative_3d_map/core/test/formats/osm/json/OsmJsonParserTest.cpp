@@ -5,6 +5,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <fstream>
+#include <sstream>
+
 #include "test_utils/DependencyProvider.hpp"
 
 using namespace utymap::formats;
@@ -34,4 +37,36 @@ BOOST_AUTO_TEST_CASE(GivenDefaultJson_WhenParserParse_ThenHasExpectedElementCoun
   BOOST_CHECK_EQUAL(16, visitor.relations);
 }
 
+BOOST_AUTO_TEST_CASE(GivenSecondJson_WhenParserParse_ThenAllFeaturesAreVisited) {
+  std::ifstream berlinStream(TEST_JSON_2_FILE, std::ios::in);
+
+  parser.parse(berlinStream, visitor);
+
+  BOOST_CHECK_EQUAL(101, visitor.nodes);
+  BOOST_CHECK_EQUAL(249, visitor.ways);
+  BOOST_CHECK_EQUAL(285, visitor.areas);
+  BOOST_CHECK_EQUAL(257, visitor.relations);
+}
+
+BOOST_AUTO_TEST_CASE(GivenEscapedStringsAndSkippedKeys_WhenParserParse_ThenFeaturesAreVisited) {
+  std::istringstream stream(R"({"pois": {"type": "FeatureCollection", "extra": [{"a": [1, 2]}, null],
+    "features": [
+      {"geometry": {"type": "Point", "coordinates": [13.1, 52.1]}, "type": "Feature",
+       "properties": {"name": "Caf\u00e9 \"Berlin\"", "id": 1}},
+      {"geometry": {"type": "LineString", "coordinates": [[13.1, 52.1], [13.2, 52.2]]},
+       "properties": {"kind": "path", "id": 2}}
+    ]}, "empty": {"features": []}})");
+
+  parser.parse(stream, visitor);
+
+  BOOST_CHECK_EQUAL(1, visitor.nodes);
+  BOOST_CHECK_EQUAL(1, visitor.ways);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTruncatedJson_WhenParserParse_ThenThrows) {
+  std::istringstream stream(R"({"pois": {"features": [{"geometry": {"type": "Point")");
+
+  BOOST_CHECK_THROW(parser.parse(stream, visitor), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
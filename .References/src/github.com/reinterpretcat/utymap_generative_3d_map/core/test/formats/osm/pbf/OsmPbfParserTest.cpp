@@ -5,28 +5,119 @@
 #include <boost/test/unit_test.hpp>
 
 #include <fstream>
+#include <sstream>
 
 using namespace utymap::formats;
+using namespace utymap::utils;
 
 namespace {
+const int BlockCount = 20;
+const int NodesPerBlock = 100;
+
+/// Releases protobuf resources once, when all tests are finished: the library
+/// cannot be used after shutdown.
+struct ProtobufShutdownFixture {
+  ~ProtobufShutdownFixture() {
+    google::protobuf::ShutdownProtobufLibrary();
+  }
+};
 
 struct Formats_Osm_Pbf_OsmPbfParserFixture {
   Formats_Osm_Pbf_OsmPbfParserFixture() :
       istream(TEST_PBF_FILE, std::ios::binary) {
   }
 
-  ~Formats_Osm_Pbf_OsmPbfParserFixture() {
-    // In app, it should be called in class destructor which uses parser.
-    google::protobuf::ShutdownProtobufLibrary();
-  }
-
   OsmPbfParser<CountableOsmDataVisitor> parser;
   CountableOsmDataVisitor visitor;
   std::ifstream istream;
 };
 
+/// Records ids of visited elements in visiting order.
+struct OrderedOsmDataVisitor : public CountableOsmDataVisitor {
+  std::vector<std::uint64_t> ids;
+
+  void visitNode(uint64_t id, utymap::GeoCoordinate &coordinate, Tags &tags) {
+    CountableOsmDataVisitor::visitNode(id, coordinate, tags);
+    ids.push_back(id);
+  }
+
+  void visitWay(uint64_t id, std::vector<uint64_t> &nodeIds, Tags &tags) {
+    CountableOsmDataVisitor::visitWay(id, nodeIds, tags);
+    ids.push_back(id);
+  }
+
+  void visitRelation(uint64_t id, RelationMembers &members, Tags &tags) {
+    CountableOsmDataVisitor::visitRelation(id, members, tags);
+    ids.push_back(id);
+  }
+};
+
+void writeBlob(std::ostream &stream, const std::string &type, const std::string &data, bool compress) {
+  OSMPBF::Blob blob;
+  if (compress) {
+    uLongf size = compressBound(static_cast<uLong>(data.size()));
+    std::string compressed(size, '\0');
+    compress2(reinterpret_cast<Bytef *>(&compressed[0]), &size,
+              reinterpret_cast<const Bytef *>(data.data()), static_cast<uLong>(data.size()), Z_DEFAULT_COMPRESSION);
+    compressed.resize(size);
+    blob.set_zlib_data(compressed);
+    blob.set_raw_size(static_cast<std::int32_t>(data.size()));
+  } else {
+    blob.set_raw(data);
+  }
+  std::string blobData = blob.SerializeAsString();
+
+  OSMPBF::BlobHeader header;
+  header.set_type(type);
+  header.set_datasize(static_cast<std::int32_t>(blobData.size()));
+  std::string headerData = header.SerializeAsString();
+
+  auto sz = static_cast<std::uint32_t>(headerData.size());
+  char size[4] = {char(sz >> 24), char((sz >> 16) & 0xff), char((sz >> 8) & 0xff), char(sz & 0xff)};
+  stream.write(size, 4);
+  stream << headerData << blobData;
+}
+
+/// Creates pbf with node blocks followed by block with ways and relation.
+std::string createPbf() {
+  std::stringstream stream;
+  writeBlob(stream, "OSMHeader", OSMPBF::HeaderBlock().SerializeAsString(), false);
+
+  for (int block = 0; block < BlockCount; ++block) {
+    OSMPBF::PrimitiveBlock primblock;
+    primblock.mutable_stringtable()->add_s("");
+    auto dense = primblock.add_primitivegroup()->mutable_dense();
+    for (int i = 0; i < NodesPerBlock; ++i) {
+      dense->add_id(i==0 ? block*NodesPerBlock + 1 : 1);
+      dense->add_lat(i==0 ? block : 1);
+      dense->add_lon(i==0 ? block : 1);
+    }
+    writeBlob(stream, "OSMData", primblock.SerializeAsString(), block%2==0);
+  }
+
+  OSMPBF::PrimitiveBlock primblock;
+  primblock.mutable_stringtable()->add_s("");
+  primblock.mutable_stringtable()->add_s("outer");
+  auto group = primblock.add_primitivegroup();
+  for (int i = 0; i < BlockCount; ++i) {
+    auto way = group->add_ways();
+    way->set_id(100000 + i);
+    way->add_refs(i*NodesPerBlock + 1);
+    way->add_refs(1);
+  }
+  auto relation = group->add_relations();
+  relation->set_id(200000);
+  relation->add_memids(100000);
+  relation->add_roles_sid(1);
+  relation->add_types(OSMPBF::Relation::WAY);
+  writeBlob(stream, "OSMData", primblock.SerializeAsString(), true);
+
+  return stream.str();
+}
 }
 
+BOOST_GLOBAL_FIXTURE(ProtobufShutdownFixture);
+
 BOOST_FIXTURE_TEST_SUITE(Formats_Osm_Pbf_PbfParser, Formats_Osm_Pbf_OsmPbfParserFixture)
 
 BOOST_AUTO_TEST_CASE(GivenDefaultPbf_WhenParserParse_ThenHasExpectedElementCount) {
@@ -37,4 +128,41 @@ BOOST_AUTO_TEST_CASE(GivenDefaultPbf_WhenParserParse_ThenHasExpectedElementCount
   BOOST_CHECK_EQUAL(visitor.relations, 3064);
 }
 
+BOOST_AUTO_TEST_CASE(GivenGeneratedPbf_WhenParserParse_ThenHasExpectedElementCount) {
+  std::stringstream stream(createPbf());
+  OrderedOsmDataVisitor orderedVisitor;
+
+  OsmPbfParser<OrderedOsmDataVisitor>().parse(stream, orderedVisitor);
+
+  BOOST_CHECK_EQUAL(orderedVisitor.nodes, BlockCount*NodesPerBlock);
+  BOOST_CHECK_EQUAL(orderedVisitor.ways, BlockCount);
+  BOOST_CHECK_EQUAL(orderedVisitor.relations, 1);
+  BOOST_CHECK_EQUAL(orderedVisitor.ids[NodesPerBlock], NodesPerBlock + 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenGeneratedPbf_WhenParseWithThreadPool_ThenElementsAreVisitedInFileOrder) {
+  std::string pbf = createPbf();
+  std::stringstream sequentialStream(pbf), parallelStream(pbf);
+  OrderedOsmDataVisitor sequentialVisitor, parallelVisitor;
+  ThreadPool threadPool(4);
+
+  OsmPbfParser<OrderedOsmDataVisitor>().parse(sequentialStream, sequentialVisitor);
+  OsmPbfParser<OrderedOsmDataVisitor>(&threadPool).parse(parallelStream, parallelVisitor);
+
+  BOOST_CHECK_EQUAL(parallelVisitor.nodes, sequentialVisitor.nodes);
+  BOOST_CHECK_EQUAL(parallelVisitor.ways, sequentialVisitor.ways);
+  BOOST_CHECK_EQUAL(parallelVisitor.relations, sequentialVisitor.relations);
+  BOOST_CHECK(parallelVisitor.ids==sequentialVisitor.ids);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTruncatedPbf_WhenParseWithThreadPool_ThenThrows) {
+  std::string pbf = createPbf();
+  std::stringstream stream(pbf.substr(0, pbf.size() - 10));
+  OrderedOsmDataVisitor orderedVisitor;
+  ThreadPool threadPool(2);
+
+  BOOST_CHECK_THROW(OsmPbfParser<OrderedOsmDataVisitor>(&threadPool).parse(stream, orderedVisitor),
+                    std::domain_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
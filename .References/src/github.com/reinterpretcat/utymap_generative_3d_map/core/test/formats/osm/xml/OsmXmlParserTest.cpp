@@ -8,6 +8,7 @@
 #include "test_utils/DependencyProvider.hpp"
 
 #include <fstream>
+#include <sstream>
 #include <boost/test/unit_test.hpp>
 #include <numeric>
 
@@ -129,8 +130,7 @@ BOOST_AUTO_TEST_CASE(GivenTestDummyOsmXml_WhenParserParse_ThenHasProperWay) {
                       utymap::GeoCoordinate(40.8142100, -73.9341897)
                   },
                   {
-                      // NOTE eating spaces is known issue
-                      createTag("alt_name", "FranklinDelanoRooseveltDrive"),
+                      createTag("alt_name", "Franklin Delano Roosevelt Drive"),
                       createTag("lanes", "3"),
                       createTag("tiger:reviewed", "no")
                   });
@@ -146,4 +146,51 @@ BOOST_AUTO_TEST_CASE(GivenTestDummyOsmXml_WhenParserParse_ThenHasProperWay) {
   BOOST_CHECK(reduce(checkList.begin(), checkList.end()));
 }
 
+BOOST_AUTO_TEST_CASE(GivenEscapedAttributes_WhenParserParse_ThenValuesAreDecoded) {
+  std::istringstream istream(R"(<?xml version="1.0" encoding="UTF-8"?>
+<osm version="0.6"><!-- comment with <node> inside -->
+ <node id="1" lat="52.5" lon='13.4'><tag k="name" v="A &amp; B &quot;&#233;&#x20AC;&quot;"/></node>
+</osm>)");
+  bool isChecked = false;
+  OsmXmlParser<OsmDataVisitor> parser;
+  OsmDataVisitor visitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+    if (Node *node = dynamic_cast<Node *>(&element)) {
+      assertNode(*node, utymap::GeoCoordinate(52.5, 13.4), {createTag("name", "A & B \"\xC3\xA9\xE2\x82\xAC\"")});
+      isChecked = true;
+    }
+    return true;
+  });
+
+  parser.parse(istream, visitor);
+  visitor.complete();
+
+  BOOST_CHECK(isChecked);
+}
+
+BOOST_AUTO_TEST_CASE(GivenBareAmpersandBeforeQuote_WhenParserParse_ThenValueEndsAtQuote) {
+  std::istringstream istream(R"(<osm><node id="1" lat="52.5" lon="13.4"><tag k="name" v="Fish & Chips &"/></node></osm>)");
+  bool isChecked = false;
+  OsmXmlParser<OsmDataVisitor> parser;
+  OsmDataVisitor visitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+    if (Node *node = dynamic_cast<Node *>(&element)) {
+      assertNode(*node, utymap::GeoCoordinate(52.5, 13.4), {createTag("name", "Fish & Chips &")});
+      isChecked = true;
+    }
+    return true;
+  });
+
+  parser.parse(istream, visitor);
+  visitor.complete();
+
+  BOOST_CHECK(isChecked);
+}
+
+BOOST_AUTO_TEST_CASE(GivenTruncatedXml_WhenParserParse_ThenThrows) {
+  std::istringstream istream(R"(<osm><node id="1" lat="52.5" lon="13.4"><tag k="name")");
+  OsmXmlParser<CountableOsmDataVisitor> parser;
+  CountableOsmDataVisitor visitor;
+
+  BOOST_CHECK_THROW(parser.parse(istream, visitor), std::domain_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
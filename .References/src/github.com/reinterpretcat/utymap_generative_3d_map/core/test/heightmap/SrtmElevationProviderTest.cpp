@@ -3,6 +3,8 @@
 #include "config.hpp"
 #include <boost/test/unit_test.hpp>
 
+#include <vector>
+
 using namespace utymap;
 using namespace utymap::heightmap;
 
@@ -16,4 +18,38 @@ BOOST_AUTO_TEST_CASE(GivenTestLocation_WhenGetElevation_ThenReturnExpectedIntege
   BOOST_CHECK_CLOSE(ele, 34.853, 0.01);
 }
 
+BOOST_AUTO_TEST_CASE(GivenTestLocations_WhenGetElevations_ThenReturnSameValuesAsSingleCalls) {
+  SrtmElevationProvider eleProvider(TEST_ASSETS_PATH "index/");
+  QuadKey quadKey(16, 35205, 21489);
+  std::vector<GeoCoordinate> coordinates;
+  for (int i = 0; i < 100; ++i)
+    coordinates.push_back(GeoCoordinate(52.5317429 + i*0.0007, 13.3871987 + i*0.0013));
+  std::vector<double> elevations(coordinates.size());
+
+  eleProvider.getElevations(quadKey, coordinates.data(), elevations.data(), coordinates.size());
+
+  for (std::size_t i = 0; i < coordinates.size(); ++i)
+    BOOST_CHECK_EQUAL(elevations[i], eleProvider.getElevation(quadKey, coordinates[i]));
+}
+
+BOOST_AUTO_TEST_CASE(GivenMissingLocation_WhenGetElevation_ThenThrows) {
+  SrtmElevationProvider eleProvider(TEST_ASSETS_PATH "index/", 1);
+
+  BOOST_CHECK_THROW(eleProvider.getElevation(QuadKey(16, 0, 0), 10.5, 10.5), std::domain_error);
+  BOOST_CHECK_CLOSE(eleProvider.getElevation(QuadKey(16, 35205, 21489), 52.5317429, 13.3871987), 34.853, 0.01);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSameCell_WhenGetElevationTwice_ThenCellIsCachedOnce) {
+  SrtmElevationProvider eleProvider(TEST_ASSETS_PATH "index/");
+
+  eleProvider.getElevation(QuadKey(16, 35205, 21489), 52.5317429, 13.3871987);
+  eleProvider.getElevation(QuadKey(16, 35205, 21489), 52.5417429, 13.3971987);
+
+  auto statistics = eleProvider.getCacheStatistics();
+  BOOST_CHECK_EQUAL(statistics.count, 1);
+  BOOST_CHECK_EQUAL(statistics.hits, 1);
+  BOOST_CHECK_EQUAL(statistics.misses, 1);
+  BOOST_CHECK_GT(statistics.size, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
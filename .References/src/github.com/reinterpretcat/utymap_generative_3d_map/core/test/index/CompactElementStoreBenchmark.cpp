@@ -0,0 +1,136 @@
+#include "entities/Element.hpp"
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "formats/osm/xml/OsmXmlParser.hpp"
+#include "index/BoundingBoxVisitor.hpp"
+#include "index/CompactElementStore.hpp"
+#include "index/InMemoryElementStore.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "config.hpp"
+#include "test_utils/DependencyProvider.hpp"
+
+#include <fstream>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::formats;
+using namespace utymap::index;
+using namespace utymap::mapcss;
+using namespace utymap::tests;
+using namespace utymap::utils;
+
+namespace {
+const int LevelOfDetail = 16;
+const std::string stylesheet = "node|z16[amenity], node|z16[name], way|z16[highway], area|z16[building], "
+                                "area|z16[landuse], relation|z16[type] { clip: false; }";
+
+/// Estimates heap memory used by elements in InMemoryElementStore: every element is kept
+/// in its own shared_ptr with separately allocated tag and coordinate vectors.
+struct MemoryEstimator : public ElementVisitor {
+  std::size_t size = 0;
+
+  void visitNode(const Node &node) override { add(node); }
+  void visitWay(const Way &way) override { add(way, way.coordinates.capacity()); }
+  void visitArea(const Area &area) override { add(area, area.coordinates.capacity()); }
+  void visitRelation(const Relation &relation) override {
+    add(relation);
+    size += relation.elements.capacity()*sizeof(std::shared_ptr<Element>);
+    for (const auto &element : relation.elements)
+      element->accept(*this);
+  }
+
+ private:
+  template<typename T>
+  void add(const T &element, std::size_t coordinates = 0) {
+    // NOTE make_shared allocates control block together with object.
+    size += sizeof(std::shared_ptr<Element>) + sizeof(T) + 2*sizeof(long) +
+        element.tags.capacity()*sizeof(utymap::entities::Tag) + coordinates*sizeof(GeoCoordinate);
+  }
+};
+
+struct ElementCounter : public ElementVisitor {
+  std::size_t times = 0;
+  std::size_t coordinates = 0;
+
+  void visitNode(const Node &) override { ++times; }
+  void visitWay(const Way &way) override { ++times; coordinates += way.coordinates.size(); }
+  void visitArea(const Area &area) override { ++times; coordinates += area.coordinates.size(); }
+  void visitRelation(const Relation &) override { ++times; }
+};
+
+struct Index_CompactElementStoreBenchmarkFixture {
+  Index_CompactElementStoreBenchmarkFixture() :
+      styleProvider(dependencyProvider.getStyleProvider(stylesheet)) {
+  }
+
+  /// Stores all elements from test file and visits them back.
+  template<typename Store>
+  void run(const std::string &name, Store &store) {
+    BoundingBox bbox;
+    std::ifstream xmlFile(TEST_XML_FILE);
+    OsmXmlParser<OsmDataVisitor> parser;
+    OsmDataVisitor visitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+      BoundingBoxVisitor bboxVisitor;
+      element.accept(bboxVisitor);
+      bbox.expand(bboxVisitor.boundingBox);
+      elements.push_back(&element);
+      return true;
+    });
+    parser.parse(xmlFile, visitor);
+    visitor.complete();
+
+    auto storeTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (const auto *element : elements)
+        store.store(*element, LodRange(LevelOfDetail, LevelOfDetail), *styleProvider);
+    });
+    elements.clear();
+
+    quadKeys.clear();
+    GeoUtils::visitTileRange(bbox, LevelOfDetail, [&](const QuadKey &quadKey, const BoundingBox &) {
+      quadKeys.push_back(quadKey);
+    });
+
+    ElementCounter counter;
+    auto searchTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (const auto &quadKey : quadKeys)
+        store.search(quadKey, counter, CancellationToken());
+    });
+
+    BOOST_TEST_MESSAGE(name << ": " << counter.times << " elements, " << counter.coordinates << " coordinates, "
+                            << "store " << storeTime << " us, search " << searchTime << " us");
+  }
+
+  /// Estimates memory used by elements of given store if they are kept as separate objects.
+  std::size_t estimate(ElementStore &store) const {
+    MemoryEstimator estimator;
+    for (const auto &quadKey : quadKeys)
+      store.search(quadKey, estimator, CancellationToken());
+    return estimator.size;
+  }
+
+  DependencyProvider dependencyProvider;
+  std::shared_ptr<StyleProvider> styleProvider;
+  std::vector<Element *> elements;
+  std::vector<QuadKey> quadKeys;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_CompactElementStoreBenchmark, Index_CompactElementStoreBenchmarkFixture,
+                         *boost::unit_test::disabled())
+
+BOOST_AUTO_TEST_CASE(GivenCityElements_WhenStoreAndSearch_ThenReportTimingsAndMemory) {
+  InMemoryElementStore inMemoryStore(*dependencyProvider.getStringTable());
+  CompactElementStore compactStore(*dependencyProvider.getStringTable());
+
+  run("in-memory", inMemoryStore);
+  run("compact", compactStore);
+
+  BOOST_TEST_MESSAGE("memory: in-memory ~" << estimate(inMemoryStore)/1024 << " KB, "
+                         << "compact " << compactStore.getMemoryUsage()/1024 << " KB");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
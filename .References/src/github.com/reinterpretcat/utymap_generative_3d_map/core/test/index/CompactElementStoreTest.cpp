@@ -0,0 +1,119 @@
+#include "QuadKey.hpp"
+#include "entities/Element.hpp"
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "index/CompactElementStore.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::mapcss;
+using namespace utymap::tests;
+
+namespace {
+const std::string stylesheet = "area|z1[any],way|z1[any],node|z1[any],relation|z1[any] { clip: false; }";
+const double Precision = 1e-7;
+
+struct Index_CompactElementStoreFixture {
+  Index_CompactElementStoreFixture() :
+      dependencyProvider(),
+      elementStore(*dependencyProvider.getStringTable()),
+      styleProvider(dependencyProvider.getStyleProvider(stylesheet)) {
+  }
+
+  DependencyProvider dependencyProvider;
+  CompactElementStore elementStore;
+  std::shared_ptr<StyleProvider> styleProvider;
+};
+
+/// Keeps copies of visited elements.
+struct ElementCollector : public ElementVisitor {
+  std::vector<Node> nodes;
+  std::vector<Way> ways;
+  std::vector<Area> areas;
+  std::vector<Relation> relations;
+
+  void visitNode(const Node &node) override { nodes.push_back(node); }
+  void visitWay(const Way &way) override { ways.push_back(way); }
+  void visitArea(const Area &area) override { areas.push_back(area); }
+  void visitRelation(const Relation &relation) override { relations.push_back(relation); }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_CompactElementStore, Index_CompactElementStoreFixture)
+
+BOOST_AUTO_TEST_CASE(GivenWayAndArea_WhenSearch_ThenTheyAreRestored) {
+  auto &stringTable = *dependencyProvider.getStringTable();
+  elementStore.store(ElementUtils::createElement<Way>(stringTable, 1, {{"any", "true"}, {"key", "value"}},
+                                                      {{5.1234567, -5}, {5, -10}}), LodRange(1, 1), *styleProvider);
+  elementStore.store(ElementUtils::createElement<Area>(stringTable, 2, {{"any", "true"}},
+                                                       {{5, -5}, {5, -10}, {10, -10}}), LodRange(1, 1), *styleProvider);
+  ElementCollector collector;
+
+  elementStore.search(QuadKey(1, 0, 0), collector, CancellationToken());
+
+  BOOST_REQUIRE_EQUAL(collector.ways.size(), 1);
+  BOOST_REQUIRE_EQUAL(collector.areas.size(), 1);
+  const auto &way = collector.ways[0];
+  BOOST_CHECK_EQUAL(way.id, 1);
+  BOOST_REQUIRE_EQUAL(way.tags.size(), 2);
+  BOOST_CHECK_EQUAL(way.tags[1].key, stringTable.getId("key"));
+  BOOST_CHECK_EQUAL(way.tags[1].value, stringTable.getId("value"));
+  BOOST_REQUIRE_EQUAL(way.coordinates.size(), 2);
+  BOOST_CHECK_CLOSE(way.coordinates[0].latitude, 5.1234567, Precision);
+  BOOST_CHECK_CLOSE(way.coordinates[1].longitude, -10, Precision);
+  BOOST_CHECK_EQUAL(collector.areas[0].id, 2);
+  BOOST_CHECK_EQUAL(collector.areas[0].coordinates.size(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(GivenRelation_WhenSearch_ThenMembersAreRestored) {
+  auto &stringTable = *dependencyProvider.getStringTable();
+  Node node = ElementUtils::createElement<Node>(stringTable, 1, {{"n", "1"}});
+  node.coordinate = {5, -5};
+  auto inner = std::make_shared<Relation>(ElementUtils::createElement<Relation>(stringTable, 2, {{"r", "2"}}));
+  inner->elements.push_back(std::make_shared<Way>(
+      ElementUtils::createElement<Way>(stringTable, 3, {{"w", "3"}}, {{6, -6}, {7, -7}})));
+  Relation relation = ElementUtils::createElement<Relation>(stringTable, 4, {{"any", "true"}});
+  relation.elements.push_back(std::make_shared<Node>(node));
+  relation.elements.push_back(inner);
+  elementStore.store(relation, LodRange(1, 1), *styleProvider);
+  ElementCollector collector;
+
+  elementStore.search(QuadKey(1, 0, 0), collector, CancellationToken());
+
+  BOOST_CHECK(collector.nodes.empty());
+  BOOST_CHECK(collector.ways.empty());
+  BOOST_REQUIRE_EQUAL(collector.relations.size(), 1);
+  const auto &result = collector.relations[0];
+  BOOST_CHECK_EQUAL(result.id, 4);
+  BOOST_REQUIRE_EQUAL(result.elements.size(), 2);
+  BOOST_CHECK_EQUAL(result.elements[0]->id, 1);
+  BOOST_CHECK_CLOSE(std::static_pointer_cast<Node>(result.elements[0])->coordinate.latitude, 5, Precision);
+  auto resultInner = std::static_pointer_cast<Relation>(result.elements[1]);
+  BOOST_REQUIRE_EQUAL(resultInner->elements.size(), 1);
+  BOOST_CHECK_EQUAL(resultInner->elements[0]->id, 3);
+  BOOST_CHECK_EQUAL(std::static_pointer_cast<Way>(resultInner->elements[0])->coordinates.size(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenNode_WhenSearchAnotherQuadKey_ThenNothingIsFound) {
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  node.coordinate = {5, -5};
+  elementStore.store(node, LodRange(1, 1), *styleProvider);
+  ElementCollector collector;
+
+  elementStore.search(QuadKey(1, 1, 1), collector, CancellationToken());
+
+  BOOST_CHECK(collector.nodes.empty());
+  BOOST_CHECK(elementStore.hasData(QuadKey(1, 0, 0)));
+  BOOST_CHECK(!elementStore.hasData(QuadKey(1, 1, 1)));
+  BOOST_CHECK_GT(elementStore.getMemoryUsage(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
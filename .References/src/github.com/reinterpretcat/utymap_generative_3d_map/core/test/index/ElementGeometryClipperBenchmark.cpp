@@ -0,0 +1,160 @@
+#include "entities/Element.hpp"
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "formats/osm/xml/OsmXmlParser.hpp"
+#include "index/BoundingBoxVisitor.hpp"
+#include "index/ElementGeometryClipper.hpp"
+#include "utils/CoreUtils.hpp"
+#include "utils/GeoUtils.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "config.hpp"
+#include "test_utils/DependencyProvider.hpp"
+
+#include <fstream>
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::formats;
+using namespace utymap::index;
+using namespace utymap::tests;
+using namespace utymap::utils;
+
+namespace {
+const double Scale = 1E7;
+
+/// Clips ways and areas in the same way as clipper did before: new clipper and
+/// path for every element and full intersection for every crossing element.
+struct ClipperBaseline : public ElementVisitor {
+  std::size_t coordinates = 0;
+
+  void clip(const Element &element, const BoundingBox &bbox) {
+    bbox_ = bbox;
+    element.accept(*this);
+  }
+
+  void visitNode(const Node &) override {}
+  void visitWay(const Way &way) override { clip(way, false); }
+  void visitArea(const Area &area) override { clip(area, true); }
+  void visitRelation(const Relation &relation) override {
+    for (const auto &element : relation.elements)
+      element->accept(*this);
+  }
+
+ private:
+  template<typename T>
+  void clip(const T &element, bool isClosed) {
+    ClipperLib::Path shape;
+    bool allInside = true;
+    for (const auto &coordinate : element.coordinates) {
+      allInside &= bbox_.contains(coordinate);
+      shape.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(coordinate.longitude*Scale),
+                                           static_cast<ClipperLib::cInt>(coordinate.latitude*Scale)));
+    }
+    if (allInside) {
+      auto copy = std::make_shared<T>(element);
+      coordinates += copy->coordinates.size();
+      return;
+    }
+
+    ClipperLib::Path rect;
+    rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(bbox_.minPoint.longitude*Scale),
+                                        static_cast<ClipperLib::cInt>(bbox_.minPoint.latitude*Scale)));
+    rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(bbox_.maxPoint.longitude*Scale),
+                                        static_cast<ClipperLib::cInt>(bbox_.minPoint.latitude*Scale)));
+    rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(bbox_.maxPoint.longitude*Scale),
+                                        static_cast<ClipperLib::cInt>(bbox_.maxPoint.latitude*Scale)));
+    rect.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(bbox_.minPoint.longitude*Scale),
+                                        static_cast<ClipperLib::cInt>(bbox_.maxPoint.latitude*Scale)));
+
+    ClipperLib::ClipperEx clipper;
+    clipper.AddPath(rect, ClipperLib::ptClip, true);
+    clipper.AddPath(shape, ClipperLib::ptSubject, isClosed);
+    ClipperLib::PolyTree solution;
+    clipper.Execute(ClipperLib::ctIntersection, solution);
+
+    for (auto node = solution.GetFirst(); node!=nullptr; node = node->GetNext()) {
+      auto clipped = std::make_shared<T>();
+      clipped->tags = element.tags;
+      for (const auto &point : node->Contour)
+        clipped->coordinates.push_back(GeoCoordinate(point.Y/Scale, point.X/Scale));
+      coordinates += clipped->coordinates.size();
+    }
+  }
+
+  BoundingBox bbox_;
+};
+
+/// Counts coordinates of clipped elements.
+struct CoordinateCounter : public ElementVisitor {
+  std::size_t coordinates = 0;
+
+  void visitNode(const Node &) override {}
+  void visitWay(const Way &way) override { coordinates += way.coordinates.size(); }
+  void visitArea(const Area &area) override { coordinates += area.coordinates.size(); }
+  void visitRelation(const Relation &relation) override {
+    for (const auto &element : relation.elements)
+      element->accept(*this);
+  }
+};
+
+struct Index_ElementGeometryClipperBenchmarkFixture {
+  // NOTE elements are owned by visitor.
+  Index_ElementGeometryClipperBenchmarkFixture() :
+      visitor(*dependencyProvider.getStringTable(), [&](Element &element) {
+        elements.push_back(&element);
+        return true;
+      }) {
+    std::ifstream xmlFile(TEST_XML_FILE);
+    OsmXmlParser<OsmDataVisitor>().parse(xmlFile, visitor);
+    visitor.complete();
+  }
+
+  /// Calls function for every element and every tile which element touches.
+  template<typename Function>
+  void visit(int levelOfDetail, const Function &function) {
+    for (const auto *element : elements) {
+      BoundingBoxVisitor bboxVisitor;
+      element->accept(bboxVisitor);
+      GeoUtils::visitTileRange(bboxVisitor.boundingBox, levelOfDetail,
+                               [&](const QuadKey &quadKey, const BoundingBox &quadKeyBbox) {
+                                 function(*element, quadKey, quadKeyBbox);
+                               });
+    }
+  }
+
+  DependencyProvider dependencyProvider;
+  std::vector<Element *> elements;
+  OsmDataVisitor visitor;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_ElementGeometryClipperBenchmark, Index_ElementGeometryClipperBenchmarkFixture,
+                         *boost::unit_test::disabled())
+
+BOOST_AUTO_TEST_CASE(GivenCityElements_WhenClipByTiles_ThenReportTimings) {
+  for (int lod = 14; lod <= 18; lod += 2) {
+    ClipperBaseline baseline;
+    auto baselineTime = measure<std::chrono::microseconds>::execution([&]() {
+      visit(lod, [&](const Element &element, const QuadKey &, const BoundingBox &quadKeyBbox) {
+        baseline.clip(element, quadKeyBbox);
+      });
+    });
+
+    CoordinateCounter counter;
+    ElementGeometryClipper clipper([&](const Element &element, const QuadKey &) { element.accept(counter); });
+    auto clipperTime = measure<std::chrono::microseconds>::execution([&]() {
+      visit(lod, [&](const Element &element, const QuadKey &quadKey, const BoundingBox &quadKeyBbox) {
+        clipper.clipAndCall(element, quadKey, quadKeyBbox);
+      });
+    });
+
+    BOOST_TEST_MESSAGE("lod " << lod << ": baseline " << baselineTime << " us (" << baseline.coordinates
+                              << " coordinates), clipper " << clipperTime << " us (" << counter.coordinates
+                              << " coordinates)");
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
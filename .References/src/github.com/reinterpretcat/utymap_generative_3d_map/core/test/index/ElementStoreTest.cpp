@@ -73,9 +73,9 @@ BOOST_AUTO_TEST_CASE(GivenWayIntersectsTwoTilesOnce_WhenStore_GeometryIsClipped)
   TestElementStore elementStore(*dependencyProvider.getStringTable(),
     [&](const Element &element, const QuadKey &quadKey) {
       if (checkQuadKey(quadKey, 1, 0, 0)) {
-        checkGeometry<Way>(static_cast<const Way &>(element), {{10, -10}, {10, 0}});
+        checkGeometry<Way>(static_cast<const Way &>(element), {{10, 0}, {10, -10}});
       } else if (checkQuadKey(quadKey, 1, 1, 0)) {
-        checkGeometry<Way>(static_cast<const Way &>(element), {{10, 0}, {10, 10}});
+        checkGeometry<Way>(static_cast<const Way &>(element), {{10, 10}, {10, 0}});
       } else {
         BOOST_FAIL("Unexpected quadKey!");
       }
@@ -95,14 +95,14 @@ BOOST_AUTO_TEST_CASE(GivenWayIntersectsTwoTilesTwice_WhenStore_GeometryIsClipped
       [&](const Element &element, const QuadKey &quadKey) {
         if (checkQuadKey(quadKey, 1, 0, 0)) {
           checkGeometry<Way>(static_cast<const Way &>(element),
-                              {{20, 0}, {20, -10}, {10, -10}, {10, 0}});
+                              {{10, 0}, {10, -10}, {20, -10}, {20, 0}});
         } else if (checkQuadKey(quadKey, 1, 1, 0)) {
           const Relation &relation = static_cast<const Relation &>(element);
           BOOST_CHECK_EQUAL(relation.elements.size(), 2);
           checkGeometry<Way>(static_cast<const Way &>(*relation.elements[0]),
-                              {{20, 10}, {20, 0}});
+                              {{10, 10}, {10, 0}});
           checkGeometry<Way>(static_cast<const Way &>(*relation.elements[1]),
-                              {{10, 0}, {10, 10}});
+                              {{20, 0}, {20, 10}});
         } else {
           BOOST_FAIL("Unexpected quadKey!");
         }
@@ -160,6 +160,29 @@ BOOST_AUTO_TEST_CASE(GivenAreaIntersectsTwoTilesOnce_WhenStore_GeometryIsClipped
   BOOST_CHECK_EQUAL(elementStore.times, 2);
 }
 
+BOOST_AUTO_TEST_CASE(GivenClockwiseConvexAreaIntersectsTwoTiles_WhenStore_GeometryIsClippedWithPositiveOrientation) {
+  Area area = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 0,
+                                                {{"test", "Foo"}},
+                                                {{10, -10}, {20, -10}, {20, 10}, {15, 20}, {10, 10}});
+  TestElementStore elementStore(*dependencyProvider.getStringTable(),
+    [&](const Element &element, const QuadKey &quadKey) {
+      if (checkQuadKey(quadKey, 1, 0, 0)) {
+        checkGeometry<Area>(static_cast<const Area &>(element),
+                            {{20, 0}, {20, -10}, {10, -10}, {10, 0}});
+      } else if (checkQuadKey(quadKey, 1, 1, 0)) {
+        checkGeometry<Area>(static_cast<const Area &>(element),
+                            {{20, 10}, {20, 0}, {10, 0}, {10, 10}, {15, 20}});
+      } else {
+        BOOST_FAIL("Unexpected quadKey!");
+      }
+    });
+
+  elementStore.store(area, LodRange(1, 1),
+                     *dependencyProvider.getStyleProvider("area|z1[test=Foo] { key:val; clip: true;}"));
+
+  BOOST_CHECK_EQUAL(elementStore.times, 2);
+}
+
 BOOST_AUTO_TEST_CASE(GivenAreaIntersectsTwoTilesTwice_WhenStore_GeometryIsClipped) {
   Area area = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(), 0,
                                                 {{"test", "Foo"}},
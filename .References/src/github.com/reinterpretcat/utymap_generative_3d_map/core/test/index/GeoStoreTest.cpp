@@ -0,0 +1,64 @@
+#include "entities/Node.hpp"
+#include "index/GeoStore.hpp"
+#include "index/InMemoryElementStore.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include "test_utils/DependencyProvider.hpp"
+#include "test_utils/ElementUtils.hpp"
+
+using namespace utymap;
+using namespace utymap::entities;
+using namespace utymap::index;
+using namespace utymap::tests;
+
+namespace {
+const std::string StoreKey = "test";
+const std::string stylesheet = "node|z1[any] { clip: false; }";
+
+struct Index_GeoStoreFixture {
+  Index_GeoStoreFixture() :
+      dependencyProvider(),
+      geoStore(*dependencyProvider.getStringTable()) {
+    geoStore.registerStore(StoreKey,
+        utymap::utils::make_unique<InMemoryElementStore>(*dependencyProvider.getStringTable()));
+  }
+
+  void addNode(std::uint64_t id, const GeoCoordinate &coordinate) {
+    Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), id, {{"any", "true"}});
+    node.coordinate = coordinate;
+    geoStore.add(StoreKey, node, LodRange(1, 1), *dependencyProvider.getStyleProvider(stylesheet));
+  }
+
+  DependencyProvider dependencyProvider;
+  GeoStore geoStore;
+};
+
+struct NodeCollector : public ElementVisitor {
+  std::vector<std::uint64_t> ids;
+
+  void visitNode(const Node &node) override { ids.push_back(node.id); }
+  void visitWay(const Way &) override {}
+  void visitArea(const Area &) override {}
+  void visitRelation(const Relation &) override {}
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_GeoStore, Index_GeoStoreFixture)
+
+BOOST_AUTO_TEST_CASE(GivenNodesAroundAntimeridian_WhenSearchByRadius_ThenNodesOnBothSidesAreFound) {
+  addNode(1, GeoCoordinate(10, 179.99));
+  addNode(2, GeoCoordinate(10, -179.99));
+  addNode(3, GeoCoordinate(10, 170));
+  NodeCollector collector;
+
+  geoStore.search(GeoCoordinate(10, -179.995), 5000, 1, *dependencyProvider.getStyleProvider(stylesheet),
+                  collector, CancellationToken());
+
+  std::sort(collector.ids.begin(), collector.ids.end());
+  BOOST_CHECK_EQUAL(collector.ids.size(), 2);
+  BOOST_CHECK_EQUAL(collector.ids[0], 1);
+  BOOST_CHECK_EQUAL(collector.ids[1], 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -74,4 +74,17 @@ BOOST_AUTO_TEST_CASE(GivenNodeWayArea_WhenSearch_ThenAllSkipped) {
   BOOST_CHECK_EQUAL(counter.times, 0);
 }
 
+BOOST_AUTO_TEST_CASE(GivenNodeWayArea_WhenSearchByBoundingBox_ThenOnlyIntersectingAreFound) {
+  ElementCounter staged, committed;
+  BoundingBox bbox(GeoCoordinate(9, -11), GeoCoordinate(11, -9));
+
+  elementStore.search(bbox, 1, staged, CancellationToken());
+  elementStore.commit();
+  elementStore.search(bbox, 1, committed, CancellationToken());
+
+  BOOST_CHECK_EQUAL(staged.times, 1);
+  BOOST_CHECK_EQUAL(committed.times, 1);
+  BOOST_CHECK(!elementStore.hasData(BoundingBox(GeoCoordinate(20, 20), GeoCoordinate(30, 30)), 1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -185,4 +185,201 @@ BOOST_AUTO_TEST_CASE(GivenTwoAreas_WhenStoreAndSearchOnce_ThenTheyStoredTwiceAnd
   assertWayOrArea(area2, *std::dynamic_pointer_cast<Area>(counter.element));
 }
 
+BOOST_AUTO_TEST_CASE(GivenTwoAreas_WhenStoreCommitAndSearch_ThenTheyAreReadFromSegment) {
+  LodRange range(1, 1);
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Area area1 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 1,
+                                                 {{"any", "true"}},
+                                                 {{4, -4}, {5, -5}, {6, -6}});
+  Area area2 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 2,
+                                                 {{"any", "true"}},
+                                                 {{1, -1}, {2, -2}, {3, -3}});
+  ElementCounter counter;
+
+  elementStore.store(area1, range, *styleProvider);
+  elementStore.store(area2, range, *styleProvider);
+  elementStore.commit();
+  elementStore.search(quadKey, counter, CancellationToken());
+
+  BOOST_CHECK(elementStore.hasData(quadKey));
+  BOOST_CHECK(!boost::filesystem::exists(TestZoomDirectory + "/0.dat"));
+  BOOST_CHECK_EQUAL(counter.times, 2);
+  assertWayOrArea(area2, *std::dynamic_pointer_cast<Area>(counter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenCommittedAndStagedAreas_WhenSearch_ThenBothAreReturnedInInsertionOrder) {
+  LodRange range(1, 1);
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Area area1 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 1,
+                                                 {{"any", "true"}},
+                                                 {{4, -4}, {5, -5}, {6, -6}});
+  Area area2 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 2,
+                                                 {{"any", "true"}},
+                                                 {{1, -1}, {2, -2}, {3, -3}});
+  ElementCounter counter;
+
+  elementStore.store(area1, range, *styleProvider);
+  elementStore.commit();
+  elementStore.store(area2, range, *styleProvider);
+  elementStore.search(quadKey, counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 2);
+  assertWayOrArea(area2, *std::dynamic_pointer_cast<Area>(counter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenCommittedAreas_WhenCommitAgain_ThenSegmentIsMerged) {
+  LodRange range(1, 1);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Area area1 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 1,
+                                                 {{"any", "true"}},
+                                                 {{4, -4}, {5, -5}, {6, -6}});
+  Area area2 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 2,
+                                                 {{"any", "true"}},
+                                                 {{-1, 1}, {-2, 2}, {-3, 3}});
+  ElementCounter first, second;
+
+  elementStore.store(area1, range, *styleProvider);
+  elementStore.commit();
+  elementStore.store(area2, range, *styleProvider);
+  elementStore.commit();
+  elementStore.search(QuadKey(1, 0, 0), first, CancellationToken());
+  elementStore.search(QuadKey(1, 1, 1), second, CancellationToken());
+
+  BOOST_CHECK_EQUAL(first.times, 1);
+  assertWayOrArea(area1, *std::dynamic_pointer_cast<Area>(first.element));
+  BOOST_CHECK_EQUAL(second.times, 1);
+  assertWayOrArea(area2, *std::dynamic_pointer_cast<Area>(second.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenCommittedNodes_WhenSearchByBoundingBoxInNewStore_ThenOnlyIntersectingNodeIsFound) {
+  LodRange range(1, 1);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node1 = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 1, {{"any", "true"}});
+  node1.coordinate = {5, -5};
+  Node node2 = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 2, {{"any", "true"}});
+  node2.coordinate = {40, -40};
+  BoundingBox bbox(GeoCoordinate(4, -6), GeoCoordinate(6, -4));
+  ElementCounter counter;
+
+  elementStore.store(node1, range, *styleProvider);
+  elementStore.store(node2, range, *styleProvider);
+  elementStore.commit();
+  PersistentElementStore reopenedStore("", *dependencyProvider.getStringTable());
+  reopenedStore.search(bbox, 1, counter, CancellationToken());
+
+  BOOST_CHECK(boost::filesystem::exists(TestZoomDirectory + "/elements.rtree"));
+  BOOST_CHECK(!boost::filesystem::exists(TestZoomDirectory + "/elements.rtree.tmp"));
+  BOOST_CHECK(reopenedStore.hasData(bbox, 1));
+  BOOST_CHECK(!reopenedStore.hasData(BoundingBox(GeoCoordinate(-6, 4), GeoCoordinate(-4, 6)), 1));
+  BOOST_CHECK_EQUAL(counter.times, 1);
+  assertNode(node1, *std::dynamic_pointer_cast<Node>(counter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenStagingFilesWithoutJournal_WhenSearchAndCommitInNewStore_ThenTheyAreMigrated) {
+  LodRange range(1, 1);
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}});
+  node.coordinate = {5, -5};
+  ElementCounter staged, committed;
+
+  elementStore.store(node, range, *styleProvider);
+  boost::filesystem::remove(TestZoomDirectory + "/staging.jrn");
+  PersistentElementStore reopenedStore("", *dependencyProvider.getStringTable());
+  bool hasData = reopenedStore.hasData(quadKey);
+  reopenedStore.search(quadKey, staged, CancellationToken());
+  reopenedStore.commit();
+  reopenedStore.search(quadKey, committed, CancellationToken());
+
+  BOOST_CHECK(hasData);
+  BOOST_CHECK_EQUAL(staged.times, 1);
+  BOOST_CHECK_EQUAL(committed.times, 1);
+  BOOST_CHECK(!boost::filesystem::exists(TestZoomDirectory + "/0.dat"));
+  assertNode(node, *std::dynamic_pointer_cast<Node>(committed.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenCommittedAreas_WhenCommitAgain_ThenSegmentIsReplacedWithoutLeftovers) {
+  LodRange range(1, 1);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Area area1 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 1,
+                                                 {{"any", "true"}},
+                                                 {{4, -4}, {5, -5}, {6, -6}});
+  Area area2 = ElementUtils::createElement<Area>(*dependencyProvider.getStringTable(),
+                                                 2,
+                                                 {{"any", "true"}},
+                                                 {{1, -1}, {2, -2}, {3, -3}});
+  ElementCounter counter;
+
+  elementStore.store(area1, range, *styleProvider);
+  elementStore.commit();
+  elementStore.store(area2, range, *styleProvider);
+  elementStore.commit();
+  PersistentElementStore reopenedStore("", *dependencyProvider.getStringTable());
+  reopenedStore.search(QuadKey(1, 0, 0), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 2);
+  BOOST_CHECK(boost::filesystem::exists(TestZoomDirectory + "/elements.seg"));
+  BOOST_CHECK(!boost::filesystem::exists(TestZoomDirectory + "/elements.seg.tmp"));
+  BOOST_CHECK(!boost::filesystem::exists(TestZoomDirectory + "/elements.seg.bak"));
+}
+
+BOOST_AUTO_TEST_CASE(GivenSegmentOnlyInBackup_WhenSearchInNewStore_ThenItIsRestored) {
+  LodRange range(1, 1);
+  QuadKey quadKey(1, 0, 0);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}});
+  node.coordinate = {5, -5};
+  ElementCounter counter;
+
+  elementStore.store(node, range, *styleProvider);
+  elementStore.commit();
+  // simulates replacing interrupted after old segment was moved to backup.
+  boost::filesystem::rename(TestZoomDirectory + "/elements.seg", TestZoomDirectory + "/elements.seg.bak");
+  PersistentElementStore reopenedStore("", *dependencyProvider.getStringTable());
+  reopenedStore.search(quadKey, counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 1);
+  BOOST_CHECK(boost::filesystem::exists(TestZoomDirectory + "/elements.seg"));
+  assertNode(node, *std::dynamic_pointer_cast<Node>(counter.element));
+}
+
+BOOST_AUTO_TEST_CASE(GivenIndexOnlyInBackup_WhenSearchByBoundingBoxInNewStore_ThenItIsRestored) {
+  LodRange range(1, 1);
+  auto styleProvider = dependencyProvider.getStyleProvider(stylesheet);
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 7, {{"any", "true"}});
+  node.coordinate = {5, -5};
+  BoundingBox bbox(GeoCoordinate(4, -6), GeoCoordinate(6, -4));
+  ElementCounter counter;
+
+  elementStore.store(node, range, *styleProvider);
+  elementStore.commit();
+  // simulates replacing interrupted after old index was moved to backup.
+  boost::filesystem::rename(TestZoomDirectory + "/elements.rtree", TestZoomDirectory + "/elements.rtree.bak");
+  PersistentElementStore reopenedStore("", *dependencyProvider.getStringTable());
+  reopenedStore.search(bbox, 1, counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 1);
+  BOOST_CHECK(boost::filesystem::exists(TestZoomDirectory + "/elements.rtree"));
+}
+
+BOOST_AUTO_TEST_CASE(GivenEmptyStore_WhenSearch_ThenNoFilesAreCreated) {
+  ElementCounter counter;
+
+  elementStore.search(QuadKey(1, 0, 0), counter, CancellationToken());
+
+  BOOST_CHECK_EQUAL(counter.times, 0);
+  BOOST_CHECK(!elementStore.hasData(QuadKey(1, 0, 0)));
+  BOOST_CHECK(!boost::filesystem::exists(TestZoomDirectory + "/0.dat"));
+  BOOST_CHECK(!boost::filesystem::exists(TestZoomDirectory + "/0.idf"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,75 @@
+#include "index/SpatialIndex.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+
+using namespace utymap;
+using namespace utymap::index;
+
+namespace {
+/// Creates grid of small boxes: one per each integer coordinate in given range.
+std::vector<SpatialIndex::Entry> createGrid(int size) {
+  std::vector<SpatialIndex::Entry> entries;
+  for (int i = 0; i < size; ++i) {
+    for (int j = 0; j < size; ++j) {
+      entries.push_back(SpatialIndex::Entry{
+          BoundingBox(GeoCoordinate(i, j), GeoCoordinate(i + 0.5, j + 0.5)), QuadKey(1, i, j)});
+    }
+  }
+  return entries;
+}
+
+int count(const SpatialIndex &index, const BoundingBox &bbox) {
+  int times = 0;
+  index.search(bbox, [&](const SpatialIndex::Entry &) { ++times; });
+  return times;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(Index_SpatialIndex)
+
+BOOST_AUTO_TEST_CASE(GivenEmptyIndex_WhenSearch_ThenNothingIsFound) {
+  SpatialIndex index;
+
+  BOOST_CHECK_EQUAL(count(index, BoundingBox(GeoCoordinate(-90, -180), GeoCoordinate(90, 180))), 0);
+  BOOST_CHECK(!index.intersects(BoundingBox(GeoCoordinate(-90, -180), GeoCoordinate(90, 180))));
+}
+
+BOOST_AUTO_TEST_CASE(GivenGrid_WhenSearch_ThenOnlyIntersectingEntriesAreFound) {
+  SpatialIndex index(createGrid(50));
+
+  BOOST_CHECK_EQUAL(index.entries().size(), 2500);
+  BOOST_CHECK_EQUAL(count(index, BoundingBox(GeoCoordinate(10.2, 10.2), GeoCoordinate(12.2, 13.2))), 12);
+  BOOST_CHECK_EQUAL(count(index, BoundingBox(GeoCoordinate(10.6, 10.6), GeoCoordinate(10.9, 10.9))), 0);
+  BOOST_CHECK_EQUAL(count(index, BoundingBox(GeoCoordinate(-1, -1), GeoCoordinate(100, 100))), 2500);
+}
+
+BOOST_AUTO_TEST_CASE(GivenGrid_WhenIntersects_ThenReturnsTrueOnlyForCoveredArea) {
+  SpatialIndex index(createGrid(10));
+
+  BOOST_CHECK(index.intersects(BoundingBox(GeoCoordinate(5.1, 5.1), GeoCoordinate(5.2, 5.2))));
+  BOOST_CHECK(!index.intersects(BoundingBox(GeoCoordinate(5.6, 5.6), GeoCoordinate(5.7, 5.7))));
+  BOOST_CHECK(!index.intersects(BoundingBox(GeoCoordinate(20, 20), GeoCoordinate(30, 30))));
+}
+
+BOOST_AUTO_TEST_CASE(GivenIndex_WhenWriteAndRead_ThenSameEntriesAreFound) {
+  SpatialIndex index(createGrid(20));
+  std::stringstream stream;
+  BoundingBox bbox(GeoCoordinate(3.2, 4.2), GeoCoordinate(7.2, 9.2));
+
+  index.write(stream);
+  SpatialIndex result = SpatialIndex::read(stream);
+
+  BOOST_CHECK_EQUAL(result.entries().size(), index.entries().size());
+  BOOST_CHECK_EQUAL(count(result, bbox), count(index, bbox));
+  BOOST_CHECK_EQUAL(count(result, bbox), 30);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCorruptedData_WhenRead_ThenThrows) {
+  std::stringstream stream("not an index");
+
+  BOOST_CHECK_THROW(SpatialIndex::read(stream), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
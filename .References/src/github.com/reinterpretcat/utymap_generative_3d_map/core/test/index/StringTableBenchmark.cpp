@@ -0,0 +1,145 @@
+#include "entities/Element.hpp"
+#include "formats/osm/xml/OsmXmlParser.hpp"
+#include "hashing/MurmurHash3.h"
+#include "index/StringTable.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "config.hpp"
+#include "test_utils/DependencyProvider.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+using namespace utymap::entities;
+using namespace utymap::formats;
+using namespace utymap::index;
+using namespace utymap::tests;
+using namespace utymap::utils;
+
+namespace {
+/// Previous file based implementation of string table used as a baseline:
+/// it reads string bytes from data file on every lookup and acquires lock.
+class FileStringTable final {
+  using ios = std::ios;
+ public:
+  FileStringTable(const std::string &indexPath, const std::string &dataPath) :
+      indexFile_(indexPath, ios::in | ios::out | ios::binary | ios::ate | ios::app),
+      dataFile_(dataPath, ios::in | ios::out | ios::binary | ios::app),
+      nextId_(0) {
+  }
+
+  std::uint32_t getId(const std::string &str) {
+    std::uint32_t hash;
+    MurmurHash3_x86_32(str.c_str(), static_cast<int>(str.size()), 0, &hash);
+
+    std::lock_guard<std::mutex> lock(lock_);
+    auto hashLookupResult = map_.find(hash);
+    if (hashLookupResult!=map_.end()) {
+      std::string data;
+      for (std::uint32_t id : hashLookupResult->second) {
+        data.clear();
+        readString(id, data);
+        if (str==data)
+          return id;
+      }
+    }
+
+    dataFile_.seekg(0, ios::end);
+    auto offset = static_cast<std::uint32_t>(dataFile_.tellg());
+    dataFile_.seekp(0, ios::end);
+    dataFile_ << str.c_str() << '\0';
+    indexFile_.seekp(0, ios::end);
+    indexFile_.write(reinterpret_cast<char *>(&hash), sizeof(hash));
+    indexFile_.write(reinterpret_cast<char *>(&offset), sizeof(offset));
+    map_[hash].push_back(nextId_);
+    offsets_.push_back(offset);
+    return nextId_++;
+  }
+
+  std::string getString(std::uint32_t id) {
+    std::string str;
+    std::lock_guard<std::mutex> lock(lock_);
+    readString(id, str);
+    return str;
+  }
+
+ private:
+  void readString(std::uint32_t id, std::string &data) {
+    if (id < offsets_.size()) {
+      dataFile_.seekg(offsets_[id], ios::beg);
+      std::getline(dataFile_, data, '\0');
+    }
+  }
+
+  std::fstream indexFile_;
+  std::fstream dataFile_;
+  std::uint32_t nextId_;
+  std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> map_;
+  std::vector<std::uint32_t> offsets_;
+  std::mutex lock_;
+};
+
+struct Index_StringTableBenchmarkFixture {
+  Index_StringTableBenchmarkFixture() {
+    auto stringTable = dependencyProvider.getStringTable();
+    std::ifstream xmlFile(TEST_XML_FILE);
+    OsmXmlParser<OsmDataVisitor> parser;
+    OsmDataVisitor visitor(*stringTable, [&](Element &element) {
+      for (const auto &tag : element.tags) {
+        tags.push_back(stringTable->getString(tag.key));
+        tags.push_back(stringTable->getString(tag.value));
+      }
+      return true;
+    });
+    parser.parse(xmlFile, visitor);
+    visitor.complete();
+  }
+
+  ~Index_StringTableBenchmarkFixture() {
+    std::remove("bench_string.idx");
+    std::remove("bench_string.dat");
+  }
+
+  template<typename Table>
+  void run(const std::string &name, Table &table) {
+    const int iterations = 10;
+    std::uint64_t checksum = 0;
+    auto insertTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (const auto &tag : tags) checksum += table.getId(tag);
+    });
+    auto lookupTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (int i = 0; i < iterations; ++i)
+        for (const auto &tag : tags) checksum += table.getId(tag);
+    });
+    auto readTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (int i = 0; i < iterations; ++i)
+        for (std::uint32_t id = 0; id < 1000; ++id) checksum += table.getString(id).size();
+    });
+
+    BOOST_TEST_MESSAGE(name << ": " << tags.size() << " tags, first pass " << insertTime << " us, "
+                            << "lookup " << lookupTime/iterations << " us/pass, "
+                            << "getString " << readTime/iterations << " us/1000 ids, checksum " << checksum);
+  }
+
+  DependencyProvider dependencyProvider;
+  std::vector<std::string> tags;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Index_StringTableBenchmark, Index_StringTableBenchmarkFixture,
+                         *boost::unit_test::disabled())
+
+BOOST_AUTO_TEST_CASE(GivenCityTags_WhenGetIdAndGetString_ThenReportTimings) {
+  FileStringTable fileTable("bench_string.idx", "bench_string.dat");
+  run("file", fileTable);
+  std::remove("bench_string.idx");
+  std::remove("bench_string.dat");
+
+  StringTable memoryTable("bench_");
+  run("memory", memoryTable);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,10 @@
 #include <boost/test/unit_test.hpp>
 #include "test_utils/DependencyProvider.hpp"
 
+#include <cstdio>
+#include <thread>
+#include <vector>
+
 using namespace utymap::index;
 using namespace utymap::tests;
 
@@ -50,4 +54,55 @@ BOOST_AUTO_TEST_CASE(GivenThreeStrings_WhenGetStringOfSecond_ThenReturnValidStri
   BOOST_CHECK_EQUAL(str, "string2");
 }
 
+BOOST_AUTO_TEST_CASE(GivenManyStrings_WhenGetIdAndGetString_ThenReturnConsistentValues) {
+  auto stringTable = dependencyProvider.getStringTable();
+  for (int i = 0; i < 20000; ++i)
+    BOOST_CHECK_EQUAL(stringTable->getId("string" + std::to_string(i)), i);
+
+  for (int i = 0; i < 20000; ++i) {
+    BOOST_CHECK_EQUAL(stringTable->getId("string" + std::to_string(i)), i);
+    BOOST_CHECK_EQUAL(stringTable->getString(i), "string" + std::to_string(i));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenStoredStrings_WhenTableIsReopened_ThenReturnSameIds) {
+  {
+    StringTable stringTable("reopen_");
+    stringTable.getId("string1");
+    stringTable.getId("string2");
+  }
+
+  {
+    StringTable stringTable("reopen_");
+    BOOST_CHECK_EQUAL(stringTable.getId("string2"), 1);
+    BOOST_CHECK_EQUAL(stringTable.getString(0), "string1");
+    BOOST_CHECK_EQUAL(stringTable.getId("string3"), 2);
+  }
+
+  std::remove("reopen_string.idx");
+  std::remove("reopen_string.dat");
+}
+
+BOOST_AUTO_TEST_CASE(GivenSeveralThreads_WhenGetIdOfSameStrings_ThenReturnSameIds) {
+  auto stringTable = dependencyProvider.getStringTable();
+  const int count = 5000;
+  std::vector<std::vector<std::uint32_t>> results(4);
+  std::vector<std::thread> threads;
+  for (auto &result : results) {
+    threads.push_back(std::thread([&]() {
+      for (int i = 0; i < count; ++i)
+        result.push_back(stringTable->getId("string" + std::to_string(i)));
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (int i = 0; i < count; ++i) {
+    auto id = results[0][i];
+    BOOST_CHECK_EQUAL(stringTable->getString(id), "string" + std::to_string(i));
+    for (const auto &result : results)
+      BOOST_CHECK_EQUAL(result[i], id);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
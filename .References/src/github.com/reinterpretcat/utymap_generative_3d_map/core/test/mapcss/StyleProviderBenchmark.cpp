@@ -0,0 +1,147 @@
+#include "entities/Element.hpp"
+#include "entities/Node.hpp"
+#include "entities/Way.hpp"
+#include "entities/Area.hpp"
+#include "entities/Relation.hpp"
+#include "formats/osm/xml/OsmXmlParser.hpp"
+#include "mapcss/MapCssParser.hpp"
+#include "mapcss/StyleProvider.hpp"
+#include "utils/CoreUtils.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include "config.hpp"
+#include "test_utils/DependencyProvider.hpp"
+
+#include <fstream>
+
+using namespace utymap::entities;
+using namespace utymap::formats;
+using namespace utymap::index;
+using namespace utymap::mapcss;
+using namespace utymap::tests;
+using namespace utymap::utils;
+
+namespace {
+const int StartLod = 12;
+const int EndLod = 16;
+
+/// Previous matching approach used as a baseline: every rule of the level of detail
+/// is checked against element's tags. Only equality and existence conditions are supported.
+class LinearMatcher final {
+  struct Rule final {
+    std::vector<utymap::entities::Tag> conditions;
+    std::size_t declarations;
+  };
+
+ public:
+  LinearMatcher(const StyleSheet &stylesheet, const StringTable &stringTable) {
+    for (const auto &rule : stylesheet.rules) {
+      for (const auto &selector : rule.selectors) {
+        Rule compiled{{}, rule.declarations.size()};
+        for (const auto &condition : selector.conditions) {
+          compiled.conditions.push_back(utymap::entities::Tag(stringTable.getId(condition.key),
+                                            condition.operation=="=" ? stringTable.getId(condition.value) : 0));
+        }
+        for (int lod = selector.zoom.start; lod <= selector.zoom.end; ++lod)
+          rules_[lod].push_back(compiled);
+      }
+    }
+  }
+
+  std::size_t match(const Element &element, int levelOfDetail) const {
+    std::size_t count = 0;
+    auto rules = rules_.find(levelOfDetail);
+    if (rules==rules_.end()) return count;
+
+    for (const auto &rule : rules->second) {
+      bool isMatched = true;
+      for (const auto &condition : rule.conditions) {
+        auto tag = std::lower_bound(element.tags.begin(), element.tags.end(), condition);
+        isMatched &= tag!=element.tags.end() && tag->key==condition.key &&
+            (condition.value==0 || tag->value==condition.value);
+      }
+      if (isMatched) count += rule.declarations;
+    }
+    return count;
+  }
+
+ private:
+  std::unordered_map<int, std::vector<Rule>> rules_;
+};
+
+struct MapCss_StyleProviderBenchmarkFixture {
+  MapCss_StyleProviderBenchmarkFixture() {
+    auto stringTable = dependencyProvider.getStringTable();
+    std::ifstream xmlFile(TEST_XML_FILE);
+    OsmXmlParser<OsmDataVisitor> parser;
+    OsmDataVisitor visitor(*stringTable, [&](Element &element) {
+      elements.push_back(&element);
+      return true;
+    });
+    parser.parse(xmlFile, visitor);
+    visitor.complete();
+    // NOTE elements are owned by visitor's context, so they are copied through visiting.
+    for (auto *element : elements) {
+      Copier copier(copies);
+      element->accept(copier);
+    }
+    elements.clear();
+  }
+
+  /// Copies elements to keep them after visitor is destroyed.
+  struct Copier : public ElementVisitor {
+    explicit Copier(std::vector<std::shared_ptr<Element>> &copies) : copies(copies) {}
+    void visitNode(const Node &node) override { copies.push_back(std::make_shared<Node>(node)); }
+    void visitWay(const Way &way) override { copies.push_back(std::make_shared<Way>(way)); }
+    void visitArea(const Area &area) override { copies.push_back(std::make_shared<Area>(area)); }
+    void visitRelation(const Relation &relation) override { copies.push_back(std::make_shared<Relation>(relation)); }
+    std::vector<std::shared_ptr<Element>> &copies;
+  };
+
+  void run(const std::string &name, const std::string &directory, const std::string &path) {
+    std::ifstream styleFile(path);
+    StyleSheet stylesheet = MapCssParser(directory).parse(styleFile);
+    auto &stringTable = *dependencyProvider.getStringTable();
+    std::size_t checksum = 0;
+
+    LinearMatcher linearMatcher(stylesheet, stringTable);
+    auto linearTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (int lod = StartLod; lod <= EndLod; ++lod)
+        for (const auto &element : copies) checksum += linearMatcher.match(*element, lod);
+    });
+
+    StyleProvider styleProvider(stylesheet, stringTable);
+    auto coldTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (int lod = StartLod; lod <= EndLod; ++lod)
+        for (const auto &element : copies) checksum += styleProvider.forElement(*element, lod).empty();
+    });
+    auto warmTime = measure<std::chrono::microseconds>::execution([&]() {
+      for (int lod = StartLod; lod <= EndLod; ++lod)
+        for (const auto &element : copies) checksum += styleProvider.forElement(*element, lod).empty();
+    });
+
+    BOOST_TEST_MESSAGE(name << ": " << stylesheet.rules.size() << " rules, " << copies.size() << " elements, "
+                            << "linear scan " << linearTime << " us, "
+                            << "indexed " << coldTime << " us, "
+                            << "indexed with warm cache " << warmTime << " us, checksum " << checksum);
+  }
+
+  DependencyProvider dependencyProvider;
+  std::vector<Element *> elements;
+  std::vector<std::shared_ptr<Element>> copies;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(MapCss_StyleProviderBenchmark, MapCss_StyleProviderBenchmarkFixture,
+                         *boost::unit_test::disabled())
+
+BOOST_AUTO_TEST_CASE(GivenCityElements_WhenForElementWithDefaultStyle_ThenReportTimings) {
+  std::string path = TEST_ASSETS_PATH TEST_MAPCSS_DEFAULT;
+  run("default", path.substr(0, path.find_last_of('/') + 1), path);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCityElements_WhenForElementWithImportStyle_ThenReportTimings) {
+  run("import", TEST_MAPCSS_PATH, TEST_MAPCSS_PATH "import.mapcss");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -159,6 +159,36 @@ BOOST_AUTO_TEST_CASE(GivenCustomElementRuleOverridesDefault_WhenForElement_ThenS
   BOOST_CHECK(!style.has(dependencyProvider.getStringTable()->getId("key1")));
 }
 
+BOOST_AUTO_TEST_CASE(GivenSeveralMatchingRules_WhenForElementTwice_ThenLaterRuleOverridesEarlierOne) {
+  int zoomLevel = 1;
+  setSingleSelector(zoomLevel, zoomLevel, {"node"}, {{"amenity", "", ""}}, {{"key", "any"}});
+  setSingleSelector(zoomLevel, zoomLevel, {"node"}, {{"amenity", "=", "pub"}}, {{"key", "pub"}});
+  setSingleSelector(zoomLevel, zoomLevel, {"node"}, {{"amenity", "!=", "cafe"}, {"level", ">", "0"}}, {{"key", "level"}});
+  auto keyId = dependencyProvider.getStringTable()->getId("key");
+  Node pub = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 0, {{"amenity", "pub"}});
+  Node cafe = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 0, {{"amenity", "cafe"}});
+  Node bar = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 0,
+                                               {{"amenity", "bar"}, {"level", "1"}});
+
+  for (int i = 0; i < 2; ++i) {
+    BOOST_CHECK(styleProvider->forElement(pub, zoomLevel).has(keyId, "pub"));
+    BOOST_CHECK(styleProvider->forElement(cafe, zoomLevel).has(keyId, "any"));
+    BOOST_CHECK(styleProvider->forElement(bar, zoomLevel).has(keyId, "level"));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GivenNodeAndWayWithSameTags_WhenForElement_ThenStylesAreDifferent) {
+  int zoomLevel = 1;
+  setSingleSelector(zoomLevel, zoomLevel, {"node"}, {{"amenity", "=", "pub"}}, {{"key", "node"}});
+  auto keyId = dependencyProvider.getStringTable()->getId("key");
+  Node node = ElementUtils::createElement<Node>(*dependencyProvider.getStringTable(), 0, {{"amenity", "pub"}});
+  Way way = ElementUtils::createElement<Way>(*dependencyProvider.getStringTable(), 0, {{"amenity", "pub"}});
+
+  BOOST_CHECK(styleProvider->forElement(node, zoomLevel).has(keyId, "node"));
+  BOOST_CHECK(styleProvider->forElement(way, zoomLevel).empty());
+  BOOST_CHECK(styleProvider->forElement(node, zoomLevel).has(keyId, "node"));
+}
+
 BOOST_AUTO_TEST_CASE(GivenTwoDifferentStyles_WhenConstructed_ThenTheyHaveDifferentTags) {
   int zoomLevel = 1;
   setSingleSelector(zoomLevel, zoomLevel, {"node"}, {{"a", "=", "b"}}, {{"k", "v"}});
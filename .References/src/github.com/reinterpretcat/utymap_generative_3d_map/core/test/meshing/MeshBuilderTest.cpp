@@ -31,6 +31,22 @@ struct Meshing_MeshingFixture {
   MeshBuilder::GeometryOptions geometryOptions;
   MeshBuilder::AppearanceOptions appearanceOptions;
 };
+
+/// Adds quad as two triangles without shared vertices.
+void addQuad(Mesh &mesh, double x, double y, int color) {
+  const double points[] = {x, y, x + 1, y, x + 1, y + 1, x, y, x + 1, y + 1, x, y + 1};
+  for (int i = 0; i < 6; ++i) {
+    mesh.triangles.push_back(static_cast<int>(mesh.vertices.size()/3));
+    mesh.vertices.insert(mesh.vertices.end(), {points[i*2], points[i*2 + 1], 0});
+    mesh.colors.push_back(color);
+    mesh.uvs.insert(mesh.uvs.end(), {points[i*2] - x, points[i*2 + 1] - y});
+  }
+}
+
+/// Adds uv map entry which ends at current uv offset.
+void addUvMapEntry(Mesh &mesh, int textureId) {
+  mesh.uvMap.insert(mesh.uvMap.end(), {static_cast<int>(mesh.uvs.size()), textureId, 1, 1, 0, 0, 1, 1});
+}
 }
 
 BOOST_FIXTURE_TEST_SUITE(Meshing_MeshBuilder, Meshing_MeshingFixture)
@@ -150,4 +166,73 @@ BOOST_AUTO_TEST_CASE(GivenSimpleSquareWithScale_WhenAddPolygon_ThenScaledTexture
   BOOST_CHECK_EQUAL(mesh.vertices.size()*2/3, mesh.uvs.size());
 }
 
+BOOST_AUTO_TEST_CASE(GivenTriangulation_WhenAddTriangulationTwice_ThenGeometryIsTheSameAsForPolygon) {
+  Mesh expected(""), actual("");
+  Polygon polygon(4, 0);
+  geometryOptions.area = 5;
+  polygon.addContour(std::vector<DPoint> {{0, 0}, {10, 0}, {10, 10}, {0, 10}});
+  builder.addPolygon(expected, polygon, geometryOptions, appearanceOptions);
+
+  auto triangulation = builder.triangulate(polygon, geometryOptions);
+  builder.addTriangulation(actual, triangulation, geometryOptions, appearanceOptions);
+  builder.addTriangulation(actual, triangulation, geometryOptions, appearanceOptions);
+
+  BOOST_CHECK_EQUAL(actual.vertices.size(), expected.vertices.size()*2);
+  BOOST_CHECK_EQUAL(actual.triangles.size(), expected.triangles.size()*2);
+  BOOST_CHECK_EQUAL_COLLECTIONS(actual.vertices.begin(), actual.vertices.begin() + expected.vertices.size(),
+                                expected.vertices.begin(), expected.vertices.end());
+  BOOST_CHECK_EQUAL(actual.triangles[expected.triangles.size()],
+                    expected.triangles[0] + static_cast<int>(expected.vertices.size()/3));
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadWithDuplicateVertices_WhenCompact_ThenVerticesAreMerged) {
+  Mesh mesh("quad");
+  addQuad(mesh, 13.4, 52.5, 0xff0000ff);
+
+  auto result = MeshBuilder::compact(mesh);
+
+  BOOST_CHECK_EQUAL(result.name, "quad");
+  BOOST_CHECK_EQUAL(result.vertices.size(), 4);
+  BOOST_CHECK_EQUAL(result.indexCount(), 6);
+  BOOST_CHECK_EQUAL(result.indexSize(), 2);
+  BOOST_CHECK_EQUAL(result.originX, 13.4);
+  BOOST_CHECK_EQUAL(result.originY, 52.5);
+  BOOST_CHECK_EQUAL(result.vertices[2].x, 1);
+  BOOST_CHECK_EQUAL(result.vertices[2].y, 1);
+  BOOST_CHECK_EQUAL(result.vertices[2].color, 0xff0000ff);
+  BOOST_CHECK_EQUAL(result.shortIndices[3], result.shortIndices[0]);
+  BOOST_CHECK_EQUAL(result.shortIndices[4], result.shortIndices[2]);
+}
+
+BOOST_AUTO_TEST_CASE(GivenQuadsInDifferentTextureRegions_WhenCompact_ThenRegionsAreNotMerged) {
+  Mesh mesh("");
+  addQuad(mesh, 0, 0, 0);
+  addUvMapEntry(mesh, 1);
+  addQuad(mesh, 0, 0, 0);
+  addUvMapEntry(mesh, 2);
+
+  auto result = MeshBuilder::compact(mesh);
+
+  BOOST_CHECK_EQUAL(result.vertices.size(), 8);
+  BOOST_CHECK_EQUAL(result.indexCount(), 12);
+  BOOST_REQUIRE_EQUAL(result.uvMap.size(), 16);
+  BOOST_CHECK_EQUAL(result.uvMap[0], 8);
+  BOOST_CHECK_EQUAL(result.uvMap[8], 16);
+  BOOST_CHECK_EQUAL(result.uvMap[9], 2);
+}
+
+BOOST_AUTO_TEST_CASE(GivenMeshWithManyVertices_WhenCompact_ThenLongIndicesAreUsed) {
+  Mesh mesh("");
+  for (int i = 0; i < 20000; ++i)
+    addQuad(mesh, i*2, 0, 0);
+
+  auto result = MeshBuilder::compact(mesh);
+
+  BOOST_CHECK_EQUAL(result.vertices.size(), 80000);
+  BOOST_CHECK_EQUAL(result.indexSize(), 4);
+  BOOST_CHECK_EQUAL(result.indexCount(), 120000);
+  BOOST_CHECK(result.shortIndices.empty());
+  BOOST_CHECK_EQUAL(result.longIndices.back(), 79999);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
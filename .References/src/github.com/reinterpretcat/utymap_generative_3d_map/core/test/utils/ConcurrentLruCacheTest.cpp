@@ -0,0 +1,91 @@
+#include "utils/ConcurrentLruCache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+using namespace utymap::utils;
+
+BOOST_AUTO_TEST_SUITE(Utils_ConcurrentLruCache)
+
+BOOST_AUTO_TEST_CASE(GivenFullCache_WhenPut_ThenLeastRecentlyUsedIsEvicted) {
+  ConcurrentLruCache<int, int> cache(2, 1);
+  cache.put(1, 10);
+  cache.put(2, 20);
+  int value = 0;
+  BOOST_CHECK(cache.get(1, value));
+
+  cache.put(3, 30);
+
+  BOOST_CHECK(cache.get(1, value));
+  BOOST_CHECK_EQUAL(value, 10);
+  BOOST_CHECK(!cache.get(2, value));
+  BOOST_CHECK(cache.get(3, value));
+  BOOST_CHECK_EQUAL(cache.getStatistics().evictions, 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSizeFunction_WhenPut_ThenCapacityIsCheckedInBytes) {
+  ConcurrentLruCache<int, std::string> cache(10, 1, [](const int &, const std::string &value) {
+    return value.size();
+  });
+  cache.put(1, "aaaa");
+  cache.put(2, "bbbb");
+  cache.put(3, "cccc");
+
+  auto statistics = cache.getStatistics();
+  BOOST_CHECK_EQUAL(statistics.count, 2);
+  BOOST_CHECK_EQUAL(statistics.size, 8);
+  std::string value;
+  BOOST_CHECK(!cache.get(1, value));
+}
+
+BOOST_AUTO_TEST_CASE(GivenEntryLargerThanCapacity_WhenPut_ThenItIsKeptAlone) {
+  ConcurrentLruCache<int, std::string> cache(4, 1, [](const int &, const std::string &value) {
+    return value.size();
+  });
+  cache.put(1, "a");
+  cache.put(2, "bbbbbbbb");
+
+  std::string value;
+  BOOST_CHECK(cache.get(2, value));
+  BOOST_CHECK(!cache.get(1, value));
+  BOOST_CHECK_EQUAL(cache.getStatistics().count, 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenLookups_WhenGetStatistics_ThenHitsAndMissesAreCounted) {
+  ConcurrentLruCache<int, int> cache(16);
+  int value = 0;
+  cache.getOrAdd(1, []() { return 1; });
+  cache.getOrAdd(1, []() { return 2; });
+  cache.get(2, value);
+
+  auto statistics = cache.getStatistics();
+  BOOST_CHECK_EQUAL(statistics.hits, 1);
+  BOOST_CHECK_EQUAL(statistics.misses, 2);
+  BOOST_CHECK_CLOSE(statistics.hitRate(), 1./3, 0.001);
+  BOOST_CHECK_EQUAL(cache.getOrAdd(1, []() { return 3; }), 1);
+}
+
+BOOST_AUTO_TEST_CASE(GivenManyThreads_WhenGetOrAdd_ThenAllGetSameValues) {
+  ConcurrentLruCache<int, int> cache(1000);
+  std::atomic<int> mismatches(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&]() {
+      for (int i = 0; i < 1000; ++i)
+        if (cache.getOrAdd(i%100, [i]() { return i%100*2; })!=i%100*2)
+          ++mismatches;
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  auto statistics = cache.getStatistics();
+  BOOST_CHECK_EQUAL(mismatches.load(), 0);
+  BOOST_CHECK_EQUAL(statistics.count, 100);
+  BOOST_CHECK_EQUAL(statistics.hits + statistics.misses, 4000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,56 @@
+#include "utils/CoreUtils.hpp"
+#include "utils/NoiseUtils.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace utymap::utils;
+
+namespace {
+const std::size_t Count = 1000000;
+const double Frequency = 0.1;
+
+struct Utils_NoiseUtilsBenchmarkFixture {
+  Utils_NoiseUtilsBenchmarkFixture() : x(Count), y(Count), z(Count), result(Count) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> distribution(-1000, 1000);
+    for (std::size_t i = 0; i < Count; ++i) {
+      x[i] = distribution(generator);
+      y[i] = distribution(generator);
+      z[i] = distribution(generator);
+    }
+  }
+
+  std::vector<double> x, y, z, result;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(Utils_NoiseUtilsBenchmark, Utils_NoiseUtilsBenchmarkFixture, *boost::unit_test::disabled())
+
+BOOST_AUTO_TEST_CASE(GivenMillionPoints_WhenPerlin2d_ThenReportScalarAndBatchTimings) {
+  auto scalarTime = measure<std::chrono::microseconds>::execution([&]() {
+    for (std::size_t i = 0; i < Count; ++i)
+      result[i] = NoiseUtils::perlin2D(x[i], y[i], Frequency);
+  });
+  auto batchTime = measure<std::chrono::microseconds>::execution([&]() {
+    NoiseUtils::perlin2D(x.data(), y.data(), result.data(), Count, Frequency);
+  });
+
+  BOOST_TEST_MESSAGE("perlin2D: scalar " << scalarTime << " us, batch " << batchTime << " us");
+}
+
+BOOST_AUTO_TEST_CASE(GivenMillionPoints_WhenPerlin3d_ThenReportScalarAndBatchTimings) {
+  auto scalarTime = measure<std::chrono::microseconds>::execution([&]() {
+    for (std::size_t i = 0; i < Count; ++i)
+      result[i] = NoiseUtils::perlin3D(x[i], y[i], z[i], Frequency);
+  });
+  auto batchTime = measure<std::chrono::microseconds>::execution([&]() {
+    NoiseUtils::perlin3D(x.data(), y.data(), z.data(), result.data(), Count, Frequency);
+  });
+
+  BOOST_TEST_MESSAGE("perlin3D: scalar " << scalarTime << " us, batch " << batchTime << " us");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
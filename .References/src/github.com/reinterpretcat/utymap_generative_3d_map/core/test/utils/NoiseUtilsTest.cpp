@@ -2,10 +2,24 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <random>
+#include <vector>
+
 using namespace utymap::utils;
 
 namespace {
 const double Tolerance = 1e-3;
+/// Allows difference caused by fused multiply add in scalar version.
+const double BatchTolerance = 1e-12;
+
+std::vector<double> createCoordinates(std::size_t count) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-1000, 1000);
+  std::vector<double> coordinates(count);
+  for (auto &coordinate : coordinates)
+    coordinate = distribution(generator);
+  return coordinates;
+}
 }
 
 BOOST_AUTO_TEST_SUITE(Utils_NoiseUtils)
@@ -17,4 +31,46 @@ BOOST_AUTO_TEST_CASE(GivenTestValues_WhenPerlin3d_ThenReturnExpectedValues) {
   BOOST_CHECK_CLOSE(NoiseUtils::perlin3D(52, 120, 13, 0.12), -0.1014592, Tolerance);
 }
 
+BOOST_AUTO_TEST_CASE(GivenCoordinates_WhenPerlin2dBatch_ThenReturnScalarValues) {
+  const std::size_t count = 1003;
+  auto x = createCoordinates(count), y = createCoordinates(count*2);
+  std::vector<double> result(count);
+
+  NoiseUtils::perlin2D(x.data(), y.data(), result.data(), count, 0.1);
+
+  for (std::size_t i = 0; i < count; ++i)
+    BOOST_CHECK_SMALL(result[i] - NoiseUtils::perlin2D(x[i], y[i], 0.1), BatchTolerance);
+}
+
+BOOST_AUTO_TEST_CASE(GivenInterleavedCoordinates_WhenPerlin2dBatch_ThenReturnScalarValues) {
+  const std::size_t count = 501;
+  auto points = createCoordinates(count*2);
+  std::vector<double> result(count);
+
+  NoiseUtils::perlin2D(points.data(), points.data() + 1, result.data(), count, 0.3, 2);
+
+  for (std::size_t i = 0; i < count; ++i)
+    BOOST_CHECK_SMALL(result[i] - NoiseUtils::perlin2D(points[i*2], points[i*2 + 1], 0.3), BatchTolerance);
+}
+
+BOOST_AUTO_TEST_CASE(GivenCoordinates_WhenPerlin3dBatch_ThenReturnScalarValues) {
+  const std::size_t count = 1003;
+  auto x = createCoordinates(count), y = createCoordinates(count*2), z = createCoordinates(count*3);
+  std::vector<double> result(count);
+
+  NoiseUtils::perlin3D(x.data(), y.data(), z.data(), result.data(), count, 0.12);
+
+  for (std::size_t i = 0; i < count; ++i)
+    BOOST_CHECK_SMALL(result[i] - NoiseUtils::perlin3D(x[i], y[i], z[i], 0.12), BatchTolerance);
+}
+
+BOOST_AUTO_TEST_CASE(GivenZeroFrequency_WhenPerlinBatch_ThenReturnZeros) {
+  std::vector<double> x = {1, 2, 3}, y = {4, 5, 6}, result = {1, 1, 1};
+
+  NoiseUtils::perlin2D(x.data(), y.data(), result.data(), x.size(), 0);
+
+  for (double value : result)
+    BOOST_CHECK_EQUAL(value, 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
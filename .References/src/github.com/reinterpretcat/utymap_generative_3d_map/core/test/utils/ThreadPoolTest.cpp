@@ -0,0 +1,47 @@
+#include "utils/ThreadPool.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <stdexcept>
+
+using namespace utymap::utils;
+
+BOOST_AUTO_TEST_SUITE(Utils_ThreadPool)
+
+BOOST_AUTO_TEST_CASE(GivenManyTasks_WhenEnqueue_ThenAllAreExecuted) {
+  std::atomic<int> counter(0);
+  std::vector<std::future<void>> results;
+  {
+    ThreadPool pool(4);
+    for (int i = 0; i < 1000; ++i)
+      results.push_back(pool.enqueue([&]() { ++counter; }));
+    for (auto &result : results)
+      result.get();
+  }
+
+  BOOST_CHECK_EQUAL(counter.load(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(GivenSingleWorker_WhenEnqueue_ThenTasksAreExecutedInOrder) {
+  std::vector<int> order;
+  {
+    ThreadPool pool(1);
+    for (int i = 0; i < 10; ++i)
+      pool.enqueue([&order, i]() { order.push_back(i); });
+  }
+
+  BOOST_CHECK_EQUAL(order.size(), 10);
+  for (int i = 0; i < 10; ++i)
+    BOOST_CHECK_EQUAL(order[i], i);
+}
+
+BOOST_AUTO_TEST_CASE(GivenThrowingTask_WhenGetResult_ThenExceptionIsPropagated) {
+  ThreadPool pool(2);
+
+  auto result = pool.enqueue([]() { throw std::domain_error("error"); });
+
+  BOOST_CHECK_THROW(result.get(), std::domain_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()